@@ -102,6 +102,7 @@ namespace dxvk {
       // Create the buffer and set the entire buffer slice as mapped,
       // so that we only have to update it when invalidating the buffer
       m_buffer = m_parent->GetDXVKDevice()->createBuffer(info, GetMemoryFlags());
+      m_buffer->enableRelocation();
       m_mapped = m_buffer->getSliceHandle();
 
       m_mapMode = DetermineMapMode();
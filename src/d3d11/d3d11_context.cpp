@@ -3361,9 +3361,14 @@ namespace dxvk {
   template<DxbcProgramType ShaderStage>
   void D3D11CommonContext<ContextType>::BindShader(
     const D3D11CommonShader*    pShaderModule) {
-    if (pShaderModule) {
+    // Shaders that failed to compile asynchronously
+    // are treated the same way as unbound shaders
+    Rc<DxvkShader> shader = pShaderModule
+      ? pShaderModule->GetShader()
+      : nullptr;
+
+    if (shader != nullptr) {
       auto buffer = pShaderModule->GetIcb();
-      auto shader = pShaderModule->GetShader();
 
       if (unlikely(shader->needsLibraryCompile()))
         m_device->requestCompileShader(shader);
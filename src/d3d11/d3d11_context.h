@@ -72,7 +72,10 @@ namespace dxvk {
     template<typename T> friend class D3D11DeviceContextExt;
     template<typename T> friend class D3D11UserDefinedAnnotation;
 
-    constexpr static VkDeviceSize StagingBufferSize = 4ull << 20;
+    // Deferred contexts cannot reuse staging memory since command lists
+    // may be executed any number of times, so they need a new buffer
+    // whenever the current one runs full. Use a smaller one there.
+    constexpr static VkDeviceSize StagingBufferSize = IsDeferred ? 4ull << 20 : 16ull << 20;
   public:
     
     D3D11CommonContext(
@@ -1068,6 +1071,9 @@ namespace dxvk {
 
     template<bool AllowFlush = !IsDeferred, typename Cmd>
     void EmitCs(Cmd&& command) {
+      if constexpr (!IsDeferred)
+        GetTypedContext()->ConsiderCsChunkFlush();
+
       m_cmdData = nullptr;
 
       if (unlikely(!m_csChunk->push(command))) {
@@ -1083,6 +1089,11 @@ namespace dxvk {
 
     template<typename M, bool AllowFlush = !IsDeferred, typename Cmd, typename... Args>
     M* EmitCsCmd(Cmd&& command, Args&&... args) {
+      // Only check before recording the command since
+      // the caller may modify the data afterwards
+      if constexpr (!IsDeferred)
+        GetTypedContext()->ConsiderCsChunkFlush();
+
       M* data = m_csChunk->pushCmd<M, Cmd, Args...>(
         command, std::forward<Args>(args)...);
 
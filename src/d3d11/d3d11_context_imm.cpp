@@ -892,6 +892,8 @@ namespace dxvk {
   
   
   void D3D11ImmediateContext::EmitCsChunk(DxvkCsChunkRef&& chunk) {
+    m_csFlushPolicy.notifyFlush();
+
     chunk->finalize();
     m_csSeqNum = m_csThread.dispatchChunk(std::move(chunk));
   }
@@ -960,6 +962,9 @@ namespace dxvk {
     // Signal the submission fence and flush the command list
     uint64_t submissionId = ++m_submissionId;
 
+    // Staging memory can be reused once the submission completes
+    m_staging.endRegion(m_submissionFence, submissionId);
+
     if (hEvent) {
       m_submissionFence->setCallback(submissionId, [hEvent] {
         SetEvent(hEvent);
@@ -102,6 +102,7 @@ namespace dxvk {
     
     DxvkCsThread            m_csThread;
     uint64_t                m_csSeqNum = 0ull;
+    DxvkCsFlushPolicy       m_csFlushPolicy;
 
     uint32_t                m_mappedImageCount = 0u;
 
@@ -119,6 +120,12 @@ namespace dxvk {
 
     Com<D3D11DeviceContextState, false> m_stateObject;
     
+    void ConsiderCsChunkFlush() {
+      if (unlikely(m_csFlushPolicy.needsCheck(m_csChunk->size()))
+       && m_csFlushPolicy.shouldFlush(m_csChunk->size(), m_csThread))
+        FlushCsChunk();
+    }
+
     HRESULT MapBuffer(
             D3D11Buffer*                pResource,
             D3D11_MAP                   MapType,
@@ -47,6 +47,7 @@ namespace dxvk {
     m_d3d11Formats      (m_dxvkDevice),
     m_d3d11Options      (m_dxvkDevice->instance()->config(), m_dxvkDevice),
     m_dxbcOptions       (m_dxvkDevice, m_d3d11Options),
+    m_shaderModules     (m_dxvkDevice.ptr()),
     m_maxFeatureLevel   (GetMaxFeatureLevel(m_dxvkDevice->instance(), m_dxvkDevice->adapter())),
     m_deviceFeatures    (m_dxvkDevice->instance(), m_dxvkDevice->adapter(), m_featureLevel) {
     m_initializer = new D3D11Initializer(this);
@@ -1981,27 +1982,40 @@ namespace dxvk {
     if (FAILED(hr))
       return hr;
 
-    auto shader = commonShader.GetShader();
+    // Shaders that are still being compiled
+    // will be validated by the worker thread
+    if (!commonShader.IsPending()
+     && !CheckShaderSupport(commonShader.GetShader().ptr()))
+      return E_INVALIDARG;
+
+    *pShaderModule = std::move(commonShader);
+    return S_OK;
+  }
+
 
-    if (shader->flags().test(DxvkShaderFlag::ExportsStencilRef)
+  bool D3D11Device::CheckShaderSupport(
+    const DxvkShader*             pShader) const {
+    if (!pShader)
+      return false;
+
+    if (pShader->flags().test(DxvkShaderFlag::ExportsStencilRef)
      && !m_dxvkDevice->features().extShaderStencilExport)
-      return E_INVALIDARG;
+      return false;
 
-    if (shader->flags().test(DxvkShaderFlag::ExportsViewportIndexLayerFromVertexStage)
+    if (pShader->flags().test(DxvkShaderFlag::ExportsViewportIndexLayerFromVertexStage)
      && (!m_dxvkDevice->features().vk12.shaderOutputViewportIndex
       || !m_dxvkDevice->features().vk12.shaderOutputLayer))
-      return E_INVALIDARG;
+      return false;
 
-    if (shader->flags().test(DxvkShaderFlag::UsesSparseResidency)
+    if (pShader->flags().test(DxvkShaderFlag::UsesSparseResidency)
      && !m_dxvkDevice->features().core.features.shaderResourceResidency)
-      return E_INVALIDARG;
+      return false;
 
-    if (shader->flags().test(DxvkShaderFlag::UsesFragmentCoverage)
+    if (pShader->flags().test(DxvkShaderFlag::UsesFragmentCoverage)
      && !m_dxvkDevice->properties().extConservativeRasterization.fullyCoveredFragmentShaderInputVariable)
-      return E_INVALIDARG;
+      return false;
 
-    *pShaderModule = std::move(commonShader);
-    return S_OK;
+    return true;
   }
 
 
@@ -2499,6 +2513,9 @@ namespace dxvk {
 
     D3D11ShaderResourceView* pSRV = static_cast<D3D11ShaderResourceView*>(srv);
     Rc<DxvkImageView> pIV = pSRV->GetImageView();
+
+    // CUDA keeps using the view, so it must not be relocated
+    pIV->image()->disableRelocation();
     VkImageView vkImageView = pIV->handle();
 
     VkImageViewHandleInfoNVX imageViewHandleInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_HANDLE_INFO_NVX};
@@ -2590,6 +2607,9 @@ namespace dxvk {
         return false;
       }
 
+      // The GPU address must remain valid, so pin the image
+      dxvkImage->disableRelocation();
+
       // The d3d11 nvapi provides us a texture but vulkan only lets us get the GPU address from an imageview.  So, make a private imageview and get the address from that...
 
       D3D11_SHADER_RESOURCE_VIEW_DESC resourceViewDesc;
@@ -2626,6 +2646,9 @@ namespace dxvk {
     }
     else if (resourceDesc.Dim == D3D11_RESOURCE_DIMENSION_BUFFER) {
       D3D11Buffer *buffer = GetCommonBuffer(pResource);
+
+      // The GPU address must remain valid, so pin the buffer
+      buffer->GetBuffer()->disableRelocation();
       const DxvkBufferSliceHandle bufSliceHandle = buffer->GetBuffer()->getSliceHandle();
       VkBuffer vkBuffer = bufSliceHandle.handle;
 
@@ -2662,6 +2685,9 @@ namespace dxvk {
       return false;
     }
 
+    // The driver handle refers to the view, so pin the image
+    dxvkImage->disableRelocation();
+
     if (!SUCCEEDED(m_device->CreateUnorderedAccessView(pResource, pDesc, ppUAV))) {
       return false;
     }
@@ -2707,6 +2733,9 @@ namespace dxvk {
       return false;
     }
 
+    // The driver handle refers to the view, so pin the image
+    dxvkImage->disableRelocation();
+
     if (!SUCCEEDED(m_device->CreateShaderResourceView(pResource, pDesc, ppSRV))) {
       return false;
     }
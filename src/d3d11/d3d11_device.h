@@ -429,6 +429,9 @@ namespace dxvk {
 
     bool Is11on12Device() const;
 
+    bool CheckShaderSupport(
+      const DxvkShader*             pShader) const;
+
     static D3D_FEATURE_LEVEL GetMaxFeatureLevel(
       const Rc<DxvkInstance>& Instance,
       const Rc<DxvkAdapter>&  Adapter);
@@ -16,7 +16,7 @@ namespace dxvk {
    * zero-initialization for buffers and images.
    */
   class D3D11Initializer {
-    constexpr static size_t MaxTransferMemory    = 32 * 1024 * 1024;
+    constexpr static size_t MaxTransferMemory    = 8 * 1024 * 1024;
     constexpr static size_t MaxTransferCommands  = 512;
   public:
 
@@ -41,7 +41,8 @@ ID3D11VkExtShader : public IUnknown {
    *    \ref pCode is \c nullptr, this will return the total
    *    code size, otherwise the number of bytes written.
    * \param [out] pCode SPIR-V shader code
-   * \returns \c S_OK, or \c S_FALSE if the buffer was too small
+   * \returns \c S_OK, or \c S_FALSE if the buffer was too small,
+   *    or \c E_FAIL if the shader failed to compile
    */
   virtual HRESULT STDMETHODCALLTYPE GetSpirvCode(
           SIZE_T*                 pCodeSize,
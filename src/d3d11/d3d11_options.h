@@ -117,6 +117,10 @@ namespace dxvk {
     /// race conditions.
     bool enableContextLock;
 
+    /// Translate shaders on worker threads and only
+    /// wait for them when they are first bound
+    bool asyncShaderCompile;
+
     /// Shader dump path
     std::string shaderDumpPath;
   };
@@ -9,6 +9,7 @@ namespace dxvk {
   
   D3D11CommonShader::D3D11CommonShader(
           D3D11Device*    pDevice,
+          DxvkShaderCache* pShaderCache,
     const DxvkShaderKey*  pShaderKey,
     const DxbcModuleInfo* pDxbcModuleInfo,
     const void*           pShaderBytecode,
@@ -29,26 +30,19 @@ namespace dxvk {
         std::ios_base::binary | std::ios_base::trunc));
     }
 
-    // Error out if the shader is invalid
-    DxbcModule module(reader);
-    auto programInfo = module.programInfo();
-
-    if (!programInfo)
-      throw DxvkError("Invalid shader binary.");
-
-    // Decide whether we need to create a pass-through
-    // geometry shader for vertex shader stream output
-    bool passthroughShader = pDxbcModuleInfo->xfb != nullptr
-      && (programInfo->type() == DxbcProgramType::VertexShader
-       || programInfo->type() == DxbcProgramType::DomainShader);
+    // Skip translation entirely if the shader has been
+    // compiled with the same options in a previous run
+    Sha1Hash optionHash = ComputeModuleInfoHash(pDxbcModuleInfo);
+    m_shader = pShaderCache->lookupShader(*pShaderKey, optionHash);
 
-    if (programInfo->shaderStage() != pShaderKey->type() && !passthroughShader)
-      throw DxvkError("Mismatching shader type.");
+    if (m_shader == nullptr) {
+      auto t0 = dxvk::high_resolution_clock::now();
+      m_shader = CompileShader(pShaderKey, pDxbcModuleInfo, reader, name);
+      m_shader->setShaderKey(*pShaderKey);
+      auto t1 = dxvk::high_resolution_clock::now();
 
-    m_shader = passthroughShader
-      ? module.compilePassthroughShader(*pDxbcModuleInfo, name)
-      : module.compile                 (*pDxbcModuleInfo, name);
-    m_shader->setShaderKey(*pShaderKey);
+      pShaderCache->addShader(*pShaderKey, optionHash, m_shader, t1 - t0);
+    }
     
     if (dumpPath.size() != 0) {
       std::ofstream dumpStream(
@@ -80,9 +74,222 @@ namespace dxvk {
     pDevice->GetDXVKDevice()->registerShader(m_shader);
   }
 
+
+  D3D11CommonShader::D3D11CommonShader(
+    const Rc<D3D11ShaderCompileJob>& Job)
+  : m_job(Job) {
+
+  }
+
+
+  Rc<DxvkShader> D3D11CommonShader::CompileShader(
+    const DxvkShaderKey*  pShaderKey,
+    const DxbcModuleInfo* pDxbcModuleInfo,
+          DxbcReader&     Reader,
+    const std::string&    Name) {
+    // Error out if the shader is invalid
+    DxbcModule module(Reader);
+    auto programInfo = module.programInfo();
+
+    if (!programInfo)
+      throw DxvkError("Invalid shader binary.");
+
+    // Decide whether we need to create a pass-through
+    // geometry shader for vertex shader stream output
+    bool passthroughShader = pDxbcModuleInfo->xfb != nullptr
+      && (programInfo->type() == DxbcProgramType::VertexShader
+       || programInfo->type() == DxbcProgramType::DomainShader);
+
+    if (programInfo->shaderStage() != pShaderKey->type() && !passthroughShader)
+      throw DxvkError("Mismatching shader type.");
+
+    return passthroughShader
+      ? module.compilePassthroughShader(*pDxbcModuleInfo, Name)
+      : module.compile                 (*pDxbcModuleInfo, Name);
+  }
+
+
+  Sha1Hash D3D11CommonShader::ComputeModuleInfoHash(
+    const DxbcModuleInfo* pDxbcModuleInfo) {
+    // Hash options member by member since the
+    // structs may contain uninitialized padding
+    const DxbcOptions& options = pDxbcModuleInfo->options;
+    std::vector<char> data;
+
+    auto add = [&data] (const auto& value) {
+      auto bytes = reinterpret_cast<const char*>(&value);
+      data.insert(data.end(), bytes, bytes + sizeof(value));
+    };
+
+    add(options.useDepthClipWorkaround);
+    add(options.supportsTypedUavLoadR32);
+    add(options.useSubgroupOpsForAtomicCounters);
+    add(options.zeroInitWorkgroupMemory);
+    add(options.invariantPosition);
+    add(options.forceVolatileTgsmAccess);
+    add(options.disableMsaa);
+    add(options.forceSampleRateShading);
+    add(options.enableSampleShadingInterlock);
+    add(options.floatControl.raw());
+    add(options.minSsboAlignment);
+    add(options.optimizeSpirv);
+
+    if (pDxbcModuleInfo->tess)
+      add(pDxbcModuleInfo->tess->maxTessFactor);
+
+    if (pDxbcModuleInfo->xfb) {
+      const DxbcXfbInfo* xfb = pDxbcModuleInfo->xfb;
+
+      for (uint32_t i = 0; i < xfb->entryCount; i++) {
+        const DxbcXfbEntry& entry = xfb->entries[i];
+
+        if (entry.semanticName)
+          data.insert(data.end(), entry.semanticName, entry.semanticName + std::strlen(entry.semanticName) + 1);
+
+        add(entry.semanticIndex);
+        add(entry.componentIndex);
+        add(entry.componentCount);
+        add(entry.streamId);
+        add(entry.bufferId);
+        add(entry.offset);
+      }
+
+      add(xfb->strides);
+      add(xfb->rasterizedStream);
+    }
+
+    return Sha1Hash::compute(data.data(), data.size());
+  }
+
   
-  D3D11ShaderModuleSet:: D3D11ShaderModuleSet() { }
-  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() { }
+  D3D11ShaderCompileJob::D3D11ShaderCompileJob(
+          D3D11Device*              pDevice,
+          DxvkShaderCache*          pShaderCache,
+          D3D11ShaderCompileStats*  pStats,
+    const DxvkShaderKey*            pShaderKey,
+    const DxbcModuleInfo*           pDxbcModuleInfo,
+    const void*                     pShaderBytecode,
+          size_t                    BytecodeLength)
+  : m_device      (pDevice),
+    m_shaderCache (pShaderCache),
+    m_stats       (pStats),
+    m_shaderKey   (*pShaderKey),
+    m_moduleInfo  (*pDxbcModuleInfo),
+    m_bytecode    (reinterpret_cast<const char*>(pShaderBytecode),
+                   reinterpret_cast<const char*>(pShaderBytecode) + BytecodeLength) {
+    // Stream output shaders are always compiled synchronously
+    // since we'd have to copy the semantic names as well
+    if (pDxbcModuleInfo->xfb)
+      throw DxvkError("Cannot defer stream output shader.");
+
+    if (pDxbcModuleInfo->tess) {
+      m_tessInfo = *pDxbcModuleInfo->tess;
+      m_moduleInfo.tess = &m_tessInfo;
+    }
+
+    // Validate the shader binary up front so that we can
+    // still report errors from the create method. This
+    // only parses the header and chunks, which is cheap.
+    DxbcReader reader(m_bytecode.data(), m_bytecode.size());
+    DxbcModule module(reader);
+
+    auto programInfo = module.programInfo();
+
+    if (!programInfo)
+      throw DxvkError("Invalid shader binary.");
+
+    if (programInfo->shaderStage() != pShaderKey->type())
+      throw DxvkError("Mismatching shader type.");
+  }
+
+
+  D3D11ShaderCompileJob::~D3D11ShaderCompileJob() {
+
+  }
+
+
+  bool D3D11ShaderCompileJob::Execute() {
+    State expected = State::Pending;
+
+    if (!m_state.compare_exchange_strong(expected, State::Running))
+      return false;
+
+    D3D11CommonShader result;
+
+    try {
+      result = D3D11CommonShader(m_device, m_shaderCache, &m_shaderKey,
+        &m_moduleInfo, m_bytecode.data(), m_bytecode.size());
+
+      // We can no longer fail shader creation at this point, so
+      // unsupported shaders will be treated as unbound instead
+      if (!m_device->CheckShaderSupport(result.GetShader().ptr())) {
+        Logger::err(str::format("D3D11: Shader ", m_shaderKey.toString(), " not supported"));
+        result = D3D11CommonShader();
+      }
+    } catch (const DxvkError& e) {
+      Logger::err(e.message());
+      result = D3D11CommonShader();
+    } catch (const std::exception& e) {
+      Logger::err(str::format("D3D11: Failed to compile shader ", m_shaderKey.toString(), ": ", e.what()));
+      result = D3D11CommonShader();
+    } catch (...) {
+      // Waiters block until the job is done, so any
+      // failure must still complete the job below
+      Logger::err(str::format("D3D11: Failed to compile shader ", m_shaderKey.toString()));
+      result = D3D11CommonShader();
+    }
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+    m_result = std::move(result);
+    m_bytecode = std::vector<char>();
+
+    m_state.store(State::Done, std::memory_order_release);
+    m_cond.notify_all();
+    return true;
+  }
+
+
+  void D3D11ShaderCompileJob::WaitForResult() {
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    // Compile the shader on the calling thread if no
+    // worker has picked it up yet, otherwise wait
+    if (!Execute()) {
+      std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+      m_cond.wait(lock, [this] {
+        return IsDone();
+      });
+    }
+
+    auto t1 = dxvk::high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+    m_stats->waitCount += 1;
+    m_stats->waitTimeUs += us.count();
+  }
+
+
+  D3D11ShaderModuleSet::D3D11ShaderModuleSet(DxvkDevice* pDevice)
+  : m_shaderCache(pDevice, "d3d11") { }
+
+
+  D3D11ShaderModuleSet::~D3D11ShaderModuleSet() {
+    { std::lock_guard<dxvk::mutex> lock(m_workerLock);
+      m_workersStopped = true;
+      m_workerCond.notify_all();
+    }
+
+    for (auto& thread : m_workerThreads)
+      thread.join();
+
+    uint64_t jobCount = m_stats.jobCount.load();
+
+    if (jobCount) {
+      Logger::info(str::format("D3D11: Compiled ", jobCount, " shaders asynchronously, ",
+        m_stats.waitCount.load(), " binds waited for ", m_stats.waitTimeUs.load() / 1000.0, " ms"));
+    }
+  }
   
   
   HRESULT D3D11ShaderModuleSet::GetShaderModule(
@@ -105,10 +312,17 @@ namespace dxvk {
     // This shader has not been compiled yet, so we have to create a
     // new module. This takes a while, so we won't lock the structure.
     D3D11CommonShader module;
+    Rc<D3D11ShaderCompileJob> job;
     
     try {
-      module = D3D11CommonShader(pDevice, pShaderKey,
-        pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+      if (pDevice->GetOptions()->asyncShaderCompile && !pDxbcModuleInfo->xfb) {
+        job = new D3D11ShaderCompileJob(pDevice, &m_shaderCache, &m_stats,
+          pShaderKey, pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+        module = D3D11CommonShader(job);
+      } else {
+        module = D3D11CommonShader(pDevice, &m_shaderCache, pShaderKey,
+          pDxbcModuleInfo, pShaderBytecode, BytecodeLength);
+      }
     } catch (const DxvkError& e) {
       Logger::err(e.message());
       return E_INVALIDARG;
@@ -125,10 +339,58 @@ namespace dxvk {
         return S_OK;
       }
     }
+
+    if (job != nullptr)
+      EnqueueJob(job);
     
     *pShader = std::move(module);
     return S_OK;
   }
+
+
+  void D3D11ShaderModuleSet::EnqueueJob(
+    const Rc<D3D11ShaderCompileJob>& Job) {
+    std::lock_guard<dxvk::mutex> lock(m_workerLock);
+
+    if (m_workerThreads.empty()) {
+      uint32_t threadCount = dxvk::thread::hardware_concurrency() / 4;
+      threadCount = std::clamp(threadCount, 1u, 4u);
+
+      for (uint32_t i = 0; i < threadCount; i++)
+        m_workerThreads.emplace_back([this] () { RunWorker(); });
+    }
+
+    m_workerQueue.push(Job);
+    m_workerCond.notify_one();
+
+    m_stats.jobCount += 1;
+  }
+
+
+  void D3D11ShaderModuleSet::RunWorker() {
+    env::setThreadName("dxvk-shader");
+
+    while (true) {
+      Rc<D3D11ShaderCompileJob> job;
+
+      { std::unique_lock<dxvk::mutex> lock(m_workerLock);
+
+        m_workerCond.wait(lock, [this] {
+          return m_workersStopped || !m_workerQueue.empty();
+        });
+
+        // Finish any remaining jobs before exiting since
+        // pending shaders may still reference the cache
+        if (m_workerQueue.empty())
+          return;
+
+        job = std::move(m_workerQueue.front());
+        m_workerQueue.pop();
+      }
+
+      job->Execute();
+    }
+  }
   
 
   D3D11ExtShader::D3D11ExtShader(
@@ -165,6 +427,11 @@ namespace dxvk {
           SIZE_T*                 pCodeSize,
           void*                   pCode) {
     auto shader = m_shader->GetShader();
+
+    // Asynchronous compilation may have failed
+    if (unlikely(shader == nullptr))
+      return E_FAIL;
+
     auto code = shader->getRawCode();
 
     HRESULT hr = S_OK;
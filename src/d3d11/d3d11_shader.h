@@ -1,10 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
+#include <queue>
 #include <unordered_map>
 
 #include "../dxbc/dxbc_module.h"
 #include "../dxvk/dxvk_device.h"
+#include "../dxvk/dxvk_shader_cache.h"
 
 #include "../d3d10/d3d10_shader.h"
 
@@ -18,13 +21,16 @@
 namespace dxvk {
   
   class D3D11Device;
+  class D3D11ShaderCompileJob;
   
   /**
    * \brief Common shader object
    * 
    * Stores the compiled SPIR-V shader and the SHA-1
    * hash of the original DXBC shader, which can be
-   * used to identify the shader.
+   * used to identify the shader. If the shader is
+   * being compiled asynchronously, accessing the
+   * shader will wait for compilation to finish.
    */
   class D3D11CommonShader {
     
@@ -33,34 +39,164 @@ namespace dxvk {
     D3D11CommonShader();
     D3D11CommonShader(
             D3D11Device*    pDevice,
+            DxvkShaderCache* pShaderCache,
       const DxvkShaderKey*  pShaderKey,
       const DxbcModuleInfo* pDxbcModuleInfo,
       const void*           pShaderBytecode,
             size_t          BytecodeLength);
+    explicit D3D11CommonShader(
+      const Rc<D3D11ShaderCompileJob>& Job);
     ~D3D11CommonShader();
 
-    Rc<DxvkShader> GetShader() const {
-      return m_shader;
-    }
+    Rc<DxvkShader> GetShader() const;
 
-    DxvkBufferSlice GetIcb() const {
-      return m_buffer != nullptr
-        ? DxvkBufferSlice(m_buffer)
-        : DxvkBufferSlice();
-    }
+    DxvkBufferSlice GetIcb() const;
+
+    bool IsPending() const;
     
     std::string GetName() const {
-      return m_shader->debugName();
+      auto shader = GetShader();
+
+      return shader != nullptr
+        ? shader->debugName()
+        : std::string();
     }
     
   private:
     
     Rc<DxvkShader> m_shader;
     Rc<DxvkBuffer> m_buffer;
+
+    Rc<D3D11ShaderCompileJob> m_job;
+
+    static Rc<DxvkShader> CompileShader(
+      const DxvkShaderKey*  pShaderKey,
+      const DxbcModuleInfo* pDxbcModuleInfo,
+            DxbcReader&     Reader,
+      const std::string&    Name);
+
+    static Sha1Hash ComputeModuleInfoHash(
+      const DxbcModuleInfo* pDxbcModuleInfo);
     
   };
 
 
+  /**
+   * \brief Asynchronous shader compile statistics
+   */
+  struct D3D11ShaderCompileStats {
+    std::atomic<uint64_t> jobCount    = { 0ull };
+    std::atomic<uint64_t> waitCount   = { 0ull };
+    std::atomic<uint64_t> waitTimeUs  = { 0ull };
+  };
+
+
+  /**
+   * \brief Shader compile job
+   *
+   * Stores a copy of everything needed to translate a
+   * shader on a worker thread. If the shader is needed
+   * before a worker has picked up the job, it will be
+   * compiled on the calling thread instead.
+   */
+  class D3D11ShaderCompileJob : public RcObject {
+
+  public:
+
+    D3D11ShaderCompileJob(
+            D3D11Device*              pDevice,
+            DxvkShaderCache*          pShaderCache,
+            D3D11ShaderCompileStats*  pStats,
+      const DxvkShaderKey*            pShaderKey,
+      const DxbcModuleInfo*           pDxbcModuleInfo,
+      const void*                     pShaderBytecode,
+            size_t                    BytecodeLength);
+
+    ~D3D11ShaderCompileJob();
+
+    /**
+     * \brief Checks whether compilation has finished
+     * \returns \c true if the result is available
+     */
+    bool IsDone() const {
+      return m_state.load(std::memory_order_acquire) == State::Done;
+    }
+
+    /**
+     * \brief Retrieves compiled shader
+     *
+     * Waits for compilation to finish if necessary. If
+     * compilation failed, the returned shader is empty.
+     * \returns Compiled shader
+     */
+    const D3D11CommonShader& GetResult() {
+      if (unlikely(!IsDone()))
+        WaitForResult();
+
+      return m_result;
+    }
+
+    /**
+     * \brief Compiles the shader
+     *
+     * Does nothing if another thread is
+     * already compiling the shader.
+     * \returns \c true if the shader was compiled
+     */
+    bool Execute();
+
+  private:
+
+    enum class State : uint32_t {
+      Pending,
+      Running,
+      Done,
+    };
+
+    D3D11Device*              m_device;
+    DxvkShaderCache*          m_shaderCache;
+    D3D11ShaderCompileStats*  m_stats;
+
+    DxvkShaderKey             m_shaderKey;
+    DxbcModuleInfo            m_moduleInfo;
+    DxbcTessInfo              m_tessInfo;
+    std::vector<char>         m_bytecode;
+
+    std::atomic<State>        m_state = { State::Pending };
+
+    dxvk::mutex               m_mutex;
+    dxvk::condition_variable  m_cond;
+
+    D3D11CommonShader         m_result;
+
+    void WaitForResult();
+
+  };
+
+
+  inline Rc<DxvkShader> D3D11CommonShader::GetShader() const {
+    if (unlikely(m_job != nullptr))
+      return m_job->GetResult().GetShader();
+
+    return m_shader;
+  }
+
+
+  inline DxvkBufferSlice D3D11CommonShader::GetIcb() const {
+    if (unlikely(m_job != nullptr))
+      return m_job->GetResult().GetIcb();
+
+    return m_buffer != nullptr
+      ? DxvkBufferSlice(m_buffer)
+      : DxvkBufferSlice();
+  }
+
+
+  inline bool D3D11CommonShader::IsPending() const {
+    return m_job != nullptr && !m_job->IsDone();
+  }
+
+
   /**
    * \brief Extended shader interface
    */
@@ -173,12 +309,15 @@ namespace dxvk {
    * times, so we should cache the resulting shader modules
    * and reuse them rather than creating new ones. This
    * class is thread-safe.
+   *
+   * If enabled, shaders will be compiled on worker threads,
+   * and shader creation will return a pending shader module.
    */
   class D3D11ShaderModuleSet {
     
   public:
     
-    D3D11ShaderModuleSet();
+    D3D11ShaderModuleSet(DxvkDevice* pDevice);
     ~D3D11ShaderModuleSet();
     
     HRESULT GetShaderModule(
@@ -197,6 +336,21 @@ namespace dxvk {
       DxvkShaderKey,
       D3D11CommonShader,
       DxvkHash, DxvkEq> m_modules;
+
+    DxvkShaderCache m_shaderCache;
+
+    D3D11ShaderCompileStats m_stats;
+
+    dxvk::mutex                     m_workerLock;
+    dxvk::condition_variable        m_workerCond;
+    std::queue<Rc<D3D11ShaderCompileJob>> m_workerQueue;
+    std::vector<dxvk::thread>       m_workerThreads;
+    bool                            m_workersStopped = false;
+
+    void EnqueueJob(
+      const Rc<D3D11ShaderCompileJob>& Job);
+
+    void RunWorker();
     
   };
   
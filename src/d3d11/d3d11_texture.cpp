@@ -242,9 +242,10 @@ namespace dxvk {
     if (m_11on12.Resource != nullptr)
       vkImage = VkImage(m_11on12.VulkanHandle);
 
-    if (!vkImage)
+    if (!vkImage) {
       m_image = m_device->GetDXVKDevice()->createImage(imageInfo, memoryProperties);
-    else
+      m_image->enableRelocation();
+    } else
       m_image = m_device->GetDXVKDevice()->importImage(imageInfo, vkImage, memoryProperties);
 
     if (imageInfo.sharing.mode == DxvkSharedHandleMode::Export)
@@ -1058,6 +1059,9 @@ namespace dxvk {
           VkImageCreateInfo*    pInfo) {
     const Rc<DxvkImage> image = m_texture->GetImage();
     const DxvkImageCreateInfo& info = image->info();
+
+    // The application may hold on to the image handle
+    image->disableRelocation();
     
     if (pHandle != nullptr)
       *pHandle = image->handle();
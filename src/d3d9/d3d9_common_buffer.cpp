@@ -11,6 +11,8 @@ namespace dxvk {
     : m_parent ( pDevice ), m_desc ( *pDesc ),
       m_mapMode(DetermineMapMode(pDevice->GetOptions())) {
     m_buffer = CreateBuffer();
+    m_buffer->enableRelocation();
+
     if (m_mapMode == D3D9_COMMON_BUFFER_MAP_MODE_BUFFER)
       m_stagingBuffer = CreateStagingBuffer();
 
@@ -108,6 +110,12 @@ namespace dxvk {
         info.stages |= VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT;
         info.access |= VK_ACCESS_SHADER_WRITE_BIT;
       }
+
+      if (m_parent->SupportsVertexPulling()) {
+        info.usage  |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        info.stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+        info.access |= VK_ACCESS_SHADER_READ_BIT;
+      }
     }
     else if (m_desc.Type == D3DRTYPE_INDEXBUFFER) {
       info.usage  |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
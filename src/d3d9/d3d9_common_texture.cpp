@@ -67,6 +67,8 @@ namespace dxvk {
           throw e;
       }
 
+      m_image->enableRelocation();
+
       if (pSharedHandle && *pSharedHandle == nullptr) {
         *pSharedHandle = m_image->sharedHandle();
         ExportImageInfo();
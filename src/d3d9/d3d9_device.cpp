@@ -2698,6 +2698,13 @@ namespace dxvk {
     auto upSlice = AllocUPBuffer(bufferSize);
     FillUPVertexBuffer(upSlice.mapPtr, pVertexStreamZeroData, dataSize, bufferSize);
 
+    if (UseVertexPulling()) {
+      BindVertexFetch(&upSlice.slice, VertexStreamZeroStride);
+
+      // Stream 0 gets reset after the draw
+      m_flags.set(D3D9DeviceFlag::DirtyVertexFetch);
+    }
+
     EmitCs([this,
       cBufferSlice  = std::move(upSlice.slice),
       cPrimType     = PrimitiveType,
@@ -2757,6 +2764,14 @@ namespace dxvk {
     FillUPVertexBuffer(data, pVertexStreamZeroData, vertexDataSize, vertexBufferSize);
     std::memcpy(data + vertexBufferSize, pIndexData, indicesSize);
 
+    if (UseVertexPulling()) {
+      DxvkBufferSlice vertexSlice = upSlice.slice.subSlice(0, vertexBufferSize);
+      BindVertexFetch(&vertexSlice, VertexStreamZeroStride);
+
+      // Stream 0 gets reset after the draw
+      m_flags.set(D3D9DeviceFlag::DirtyVertexFetch);
+    }
+
     EmitCs([this,
       cVertexSize   = vertexBufferSize,
       cBufferSlice  = std::move(upSlice.slice),
@@ -4227,6 +4242,12 @@ namespace dxvk {
                   | VK_ACCESS_INDEX_READ_BIT;
       info.stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
 
+      if (SupportsVertexPulling()) {
+        info.usage  |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        info.access |= VK_ACCESS_SHADER_READ_BIT;
+        info.stages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+      }
+
       Rc<DxvkBuffer> buffer = m_dxvkDevice->createBuffer(info, memoryFlags);
 
       if (size <= UPBufferSize) {
@@ -4267,8 +4288,6 @@ namespace dxvk {
 
 
   D3D9BufferSlice D3D9DeviceEx::AllocStagingBuffer(VkDeviceSize size) {
-    m_stagingBufferAllocated += size;
-
     D3D9BufferSlice result;
     result.slice = m_stagingBuffer.alloc(256, size);
     result.mapPtr = result.slice.mapPtr(0);
@@ -4276,79 +4295,13 @@ namespace dxvk {
   }
 
 
-  void D3D9DeviceEx::EmitStagingBufferMarker() {
-    if (m_stagingBufferLastAllocated == m_stagingBufferAllocated)
-      return;
-
-    D3D9StagingBufferMarkerPayload payload;
-    payload.sequenceNumber = GetCurrentSequenceNumber();
-    payload.allocated = m_stagingBufferAllocated;
-    m_stagingBufferLastAllocated = m_stagingBufferAllocated;
-
-    Rc<D3D9StagingBufferMarker> marker = new D3D9StagingBufferMarker(payload);
-    m_stagingBufferMarkers.push(marker);
-
-    EmitCs([
-      cMarker = std::move(marker)
-    ] (DxvkContext* ctx) {
-      ctx->insertMarker(cMarker);
-    });
-  }
-
-
   void D3D9DeviceEx::WaitStagingBuffer() {
-    // The number below is not a hard limit, however we can be reasonably
-    // sure that there will never be more than two additional staging buffers
-    // in flight in addition to the number of staging buffers specified here.
-    constexpr VkDeviceSize maxStagingMemoryInFlight = env::is32BitHostPlatform()
-      ? StagingBufferSize * 4
-      : StagingBufferSize * 16;
-
-    // If the game uploads a significant amount of data at once, it's
-    // possible that we exceed the limit while the queue is empty. In
-    // that case, enforce a flush early to populate the marker queue.
-    bool didFlush = false;
-
-    if (m_stagingBufferLastSignaled + maxStagingMemoryInFlight < m_stagingBufferAllocated
-     && m_stagingBufferMarkers.empty()) {
+    // If the game uploads a significant amount of data at once, flush
+    // early so that the staging buffer can wait for and reuse memory
+    // instead of having to allocate a new buffer once the current
+    // region does not fit into the ring anymore.
+    if (2 * m_stagingBuffer.getRegionSize() > StagingBufferSize)
       Flush();
-      didFlush = true;
-    }
-
-    // Process the marker queue. We'll remove as many markers as we
-    // can without stalling, and will stall until we're below the
-    // allocation limit again.
-    uint64_t lastSequenceNumber = m_csThread.lastSequenceNumber();
-
-    while (!m_stagingBufferMarkers.empty()) {
-      const auto& marker = m_stagingBufferMarkers.front();
-      const auto& payload = marker->payload();
-
-      bool needsStall = m_stagingBufferLastSignaled + maxStagingMemoryInFlight < m_stagingBufferAllocated;
-
-      if (payload.sequenceNumber > lastSequenceNumber) {
-        if (!needsStall)
-          break;
-
-        SynchronizeCsThread(payload.sequenceNumber);
-        lastSequenceNumber = payload.sequenceNumber;
-      }
-
-      if (marker->isInUse(DxvkAccess::Read)) {
-        if (!needsStall)
-          break;
-
-        if (!didFlush) {
-          Flush();
-          didFlush = true;
-        }
-
-        m_dxvkDevice->waitForResource(marker, DxvkAccess::Read);
-      }
-
-      m_stagingBufferLastSignaled = marker->payload().allocated;
-      m_stagingBufferMarkers.pop();
-    }
   }
 
 
@@ -5093,6 +5046,8 @@ namespace dxvk {
 
 
   void D3D9DeviceEx::EmitCsChunk(DxvkCsChunkRef&& chunk) {
+    m_csFlushPolicy.notifyFlush();
+
     chunk->finalize();
     m_csSeqNum = m_csThread.dispatchChunk(std::move(chunk));
   }
@@ -5233,6 +5188,11 @@ namespace dxvk {
         ? sizeof(D3D9FixedFunctionVertexBlendDataSW)
         : sizeof(D3D9FixedFunctionVertexBlendDataHW));
 
+    m_vsVertexFetch = D3D9ConstantBuffer(this,
+      DxsoProgramType::VertexShader,
+      DxsoConstantBuffers::VSVertexFetch,
+      SmallConstantBufferSize);
+
     if (m_usingGraphicsPipelines) {
       m_specBuffer = D3D9ConstantBuffer(this,
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -5463,12 +5423,13 @@ namespace dxvk {
     m_initializer->Flush();
     m_converter->Flush();
 
-    EmitStagingBufferMarker();
-
     // Add commands to flush the threaded
     // context, then flush the command list
     uint64_t submissionId = ++m_submissionId;
 
+    // Staging memory can be reused once the submission completes
+    m_stagingBuffer.endRegion(m_submissionFence, submissionId);
+
     EmitCs<false>([
       cSubmissionFence  = m_submissionFence,
       cSubmissionId     = submissionId
@@ -6550,6 +6511,9 @@ namespace dxvk {
     if (m_flags.test(D3D9DeviceFlag::DirtyInputLayout))
       BindInputLayout();
 
+    if (m_flags.test(D3D9DeviceFlag::DirtyVertexFetch) && UseVertexPulling())
+      BindVertexFetch(nullptr, 0);
+
     if (likely(UseProgrammablePS())) {
       UploadConstants<DxsoProgramTypes::PixelShader>();
 
@@ -6640,6 +6604,9 @@ namespace dxvk {
   void D3D9DeviceEx::BindInputLayout() {
     m_flags.clr(D3D9DeviceFlag::DirtyInputLayout);
 
+    if (SupportsVertexPulling())
+      m_flags.set(D3D9DeviceFlag::DirtyVertexFetch);
+
     if (m_state.vertexDecl == nullptr) {
       EmitCs([&cIaState = m_iaState] (DxvkContext* ctx) {
         cIaState.streamsUsed = 0;
@@ -6663,7 +6630,8 @@ namespace dxvk {
         cVertexDecl       = std::move(vertexDecl),
         cVertexShader     = std::move(vertexShader),
         cStreamsInstanced = m_instancedData,
-        cStreamFreq       = streamFreq
+        cStreamFreq       = streamFreq,
+        cVertexPulling    = UseVertexPulling()
       ] (DxvkContext* ctx) {
         cIaState.streamsInstanced = cStreamsInstanced;
         cIaState.streamsUsed      = 0;
@@ -6731,6 +6699,13 @@ namespace dxvk {
           bindMask |= 1u << binding.binding;
         }
 
+        // The vertex shader fetches its inputs from storage
+        // buffers, so keep vertex input state out of the pipeline
+        if (cVertexPulling) {
+          ctx->setInputLayout(0, nullptr, 0, nullptr);
+          return;
+        }
+
         // Compact the attribute and binding lists to filter
         // out attributes and bindings not used by the shader
         uint32_t attrCount = CompactSparseList(attrList.data(), attrMask);
@@ -6744,6 +6719,97 @@ namespace dxvk {
   }
 
 
+  void D3D9DeviceEx::BindVertexFetch(
+    const DxvkBufferSlice*                  pStreamZero,
+          UINT                              StreamZeroStride) {
+    m_flags.clr(D3D9DeviceFlag::DirtyVertexFetch);
+
+    const auto& isgn = GetCommonShader(m_state.vertexShader)->GetIsgn();
+
+    D3D9VertexFetchData fetchData;
+
+    std::array<DxvkBufferSlice, caps::InputRegisterCount> slices;
+
+    // Input locations match the ones used by BindInputLayout
+    const uint32_t inputCount = std::min(isgn.elemCount, caps::InputRegisterCount);
+
+    // ProcessVertices may draw without a vertex declaration.
+    // BindInputLayout binds no attributes in that case, so
+    // bind empty fetch data for all inputs.
+    if (m_state.vertexDecl == nullptr) {
+      void* mapPtr = m_vsVertexFetch.Alloc(sizeof(fetchData));
+      std::memcpy(mapPtr, &fetchData, sizeof(fetchData));
+
+      EmitCs([
+        cInputCount = inputCount
+      ] (DxvkContext* ctx) {
+        for (uint32_t i = 0; i < cInputCount; i++) {
+          ctx->bindUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT,
+            getVertexFetchBufferSlot(i), DxvkBufferSlice());
+        }
+      });
+
+      return;
+    }
+
+    const auto& elements = m_state.vertexDecl->GetElements();
+
+    for (uint32_t i = 0; i < inputCount; i++) {
+      const auto& decl = isgn.elems[i];
+
+      for (const auto& element : elements) {
+        DxsoSemantic elementSemantic = { static_cast<DxsoUsage>(element.Usage), element.UsageIndex };
+        if (elementSemantic.usage == DxsoUsage::PositionT)
+          elementSemantic.usage = DxsoUsage::Position;
+
+        if (elementSemantic != decl.semantic)
+          continue;
+
+        auto& entry = fetchData.elements[i];
+        entry.type = element.Type;
+
+        // Bind buffers from the start so that the descriptor offset
+        // is always aligned, and fetch relative to that instead.
+        if (element.Stream == 0 && pStreamZero != nullptr) {
+          entry.offset = uint32_t(pStreamZero->offset()) + element.Offset;
+          entry.stride = StreamZeroStride;
+
+          slices[i] = DxvkBufferSlice(pStreamZero->buffer(), 0,
+            pStreamZero->offset() + pStreamZero->length());
+        } else {
+          const auto& vbo = m_state.vertexBuffers[element.Stream];
+          D3D9CommonBuffer* buffer = GetCommonBuffer(vbo.vertexBuffer);
+
+          entry.offset = vbo.offset + element.Offset;
+          entry.stride = vbo.stride;
+
+          if (buffer != nullptr)
+            slices[i] = buffer->GetBufferSlice<D3D9_COMMON_BUFFER_TYPE_REAL>();
+        }
+
+        uint32_t instanceData = m_state.streamFreq[element.Stream];
+        if (instanceData & D3DSTREAMSOURCE_INSTANCEDATA)
+          entry.divisor = instanceData & 0x7FFFFF; // Remove instance packed-in flags in the data.
+
+        break;
+      }
+    }
+
+    void* mapPtr = m_vsVertexFetch.Alloc(sizeof(fetchData));
+    std::memcpy(mapPtr, &fetchData, sizeof(fetchData));
+
+    EmitCs([
+      cSlices     = std::move(slices),
+      cInputCount = inputCount
+    ] (DxvkContext* ctx) mutable {
+      for (uint32_t i = 0; i < cInputCount; i++) {
+        ctx->bindUniformBuffer(VK_SHADER_STAGE_VERTEX_BIT,
+          getVertexFetchBufferSlot(i), std::move(cSlices[i]));
+      }
+    });
+  }
+
+
   void D3D9DeviceEx::BindVertexBuffer(
         UINT                              Slot,
         D3D9VertexBuffer*                 pBuffer,
@@ -6758,6 +6824,9 @@ namespace dxvk {
     ] (DxvkContext* ctx) mutable {
       ctx->bindVertexBuffer(cSlotId, std::move(cBufferSlice), cStride);
     });
+
+    if (SupportsVertexPulling())
+      m_flags.set(D3D9DeviceFlag::DirtyVertexFetch);
   }
 
   void D3D9DeviceEx::BindIndices() {
@@ -7205,6 +7274,12 @@ namespace dxvk {
   }
 
 
+  bool D3D9DeviceEx::UseVertexPulling() {
+    // Fixed-function vertex shaders always use regular vertex input
+    return SupportsVertexPulling() && UseProgrammableVS();
+  }
+
+
   bool D3D9DeviceEx::UseProgrammablePS() {
     return m_state.pixelShader != nullptr;
   }
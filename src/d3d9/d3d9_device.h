@@ -64,6 +64,7 @@ namespace dxvk {
     DirtyDepthBias,
     DirtyAlphaTestState,
     DirtyInputLayout,
+    DirtyVertexFetch,
     DirtyViewportScissor,
     DirtyMultiSampleState,
 
@@ -108,13 +109,6 @@ namespace dxvk {
     void*           mapPtr = nullptr;
   };
 
-  struct D3D9StagingBufferMarkerPayload {
-    uint64_t        sequenceNumber;
-    VkDeviceSize    allocated;
-  };
-
-  using D3D9StagingBufferMarker = DxvkMarker<D3D9StagingBufferMarkerPayload>;
-
   class D3D9DeviceEx final : public ComObjectClamp<IDirect3DDevice9Ex> {
     constexpr static uint32_t DefaultFrameLatency = 3;
     constexpr static uint32_t MaxFrameLatency     = 20;
@@ -125,7 +119,11 @@ namespace dxvk {
 
     constexpr static uint32_t NullStreamIdx = caps::MaxStreams;
 
-    constexpr static VkDeviceSize StagingBufferSize = 4ull << 20;
+    // Staging memory is reused once the GPU is done with it, so the
+    // ring size limits the amount of staging memory in flight.
+    constexpr static VkDeviceSize StagingBufferSize = env::is32BitHostPlatform()
+      ? 16ull << 20
+      : 64ull << 20;
 
     friend class D3D9SwapChainEx;
     friend struct D3D9WindowContext;
@@ -681,6 +679,10 @@ namespace dxvk {
 
     bool SupportsSWVP();
 
+    bool SupportsVertexPulling() const {
+      return m_dxsoOptions.vertexPulling;
+    }
+
     bool IsExtended();
 
     HWND GetWindow();
@@ -903,6 +905,19 @@ namespace dxvk {
 
     void BindInputLayout();
 
+    /**
+     * \brief Binds vertex data for vertex pulling
+     *
+     * Binds the vertex buffer of each vertex shader input as a
+     * storage buffer and uploads the corresponding fetch info.
+     * \param [in] pStreamZero Optional buffer slice that replaces
+     *    stream 0, used for user pointer draws
+     * \param [in] StreamZeroStride Stride of \c pStreamZero
+     */
+    void BindVertexFetch(
+      const DxvkBufferSlice*                  pStreamZero,
+            UINT                              StreamZeroStride);
+
     void BindVertexBuffer(
             UINT                              Slot,
             D3D9VertexBuffer*                 pBuffer,
@@ -1010,6 +1025,10 @@ namespace dxvk {
 
     template<bool AllowFlush = true, typename Cmd>
     void EmitCs(Cmd&& command) {
+      if (unlikely(m_csFlushPolicy.needsCheck(m_csChunk->size()))
+       && m_csFlushPolicy.shouldFlush(m_csChunk->size(), m_csThread))
+        FlushCsChunk();
+
       if (unlikely(!m_csChunk->push(command))) {
         EmitCsChunk(std::move(m_csChunk));
         m_csChunk = AllocCsChunk();
@@ -1045,8 +1064,6 @@ namespace dxvk {
 
     D3D9BufferSlice AllocStagingBuffer(VkDeviceSize size);
 
-    void EmitStagingBufferMarker();
-
     void WaitStagingBuffer();
 
     bool ShouldRecord();
@@ -1194,6 +1211,8 @@ namespace dxvk {
 
     bool UseProgrammableVS();
 
+    bool UseVertexPulling();
+
     bool UseProgrammablePS();
 
     uint32_t GetAlphaTestPrecision();
@@ -1252,6 +1271,7 @@ namespace dxvk {
 
     D3D9ConstantBuffer              m_vsFixedFunction;
     D3D9ConstantBuffer              m_vsVertexBlend;
+    D3D9ConstantBuffer              m_vsVertexFetch;
     D3D9ConstantBuffer              m_psFixedFunction;
     D3D9ConstantBuffer              m_psShared;
     D3D9ConstantBuffer              m_specBuffer;
@@ -1261,10 +1281,6 @@ namespace dxvk {
     void*                           m_upBufferMapPtr  = nullptr;
 
     DxvkStagingBuffer               m_stagingBuffer;
-    VkDeviceSize                    m_stagingBufferAllocated      = 0ull;
-    VkDeviceSize                    m_stagingBufferLastAllocated  = 0ull;
-    VkDeviceSize                    m_stagingBufferLastSignaled   = 0ull;
-    std::queue<Rc<D3D9StagingBufferMarker>> m_stagingBufferMarkers;
 
     D3D9Cursor                      m_cursor;
 
@@ -1370,6 +1386,7 @@ namespace dxvk {
     DxvkCsThread                    m_csThread;
     DxvkCsChunkRef                  m_csChunk;
     uint64_t                        m_csSeqNum = 0ull;
+    DxvkCsFlushPolicy               m_csFlushPolicy;
 
     Rc<sync::Fence>                 m_submissionFence;
     uint64_t                        m_submissionId = 0ull;
@@ -86,6 +86,9 @@ namespace dxvk {
           VkImageCreateInfo*    pInfo) {
     const Rc<DxvkImage> image = m_texture->GetImage();
     const DxvkImageCreateInfo& info = image->info();
+
+    // The application may hold on to the image handle
+    image->disableRelocation();
     
     if (pHandle != nullptr)
       *pHandle = image->handle();
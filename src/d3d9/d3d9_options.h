@@ -124,6 +124,10 @@ namespace dxvk {
     /// don't match entirely to the regular vertex shader in this way.
     bool longMad;
 
+    /// Fetch vertex attributes from storage buffers in programmable
+    /// vertex shaders instead of using fixed-function vertex input.
+    bool enableVertexPulling;
+
     /// Cached dynamic buffers: Maps all buffers in cached memory.
     bool cachedDynamicBuffers;
 
@@ -30,6 +30,24 @@ namespace dxvk {
     float coeff[4] = {};
   };
 
+  /**
+   * \brief Vertex fetch info for one input location
+   *
+   * Used by vertex shaders that pull their inputs from storage
+   * buffers. The type is a \c D3DDECLTYPE, where \c D3DDECLTYPE_UNUSED
+   * denotes an input that is not provided by the vertex declaration.
+   */
+  struct D3D9VertexFetchElement {
+    uint32_t offset  = 0u;
+    uint32_t stride  = 0u;
+    uint32_t divisor = 0u;
+    uint32_t type    = D3DDECLTYPE_UNUSED;
+  };
+
+  struct D3D9VertexFetchData {
+    std::array<D3D9VertexFetchElement, caps::InputRegisterCount> elements = { };
+  };
+
   struct D3D9RenderStateInfo {
     std::array<float, 3> fogColor = { };
     float fogScale   = 0.0f;
@@ -13,7 +13,8 @@ namespace dxvk {
     const Rc<DxbcIsgn>&       osgn,
     const Rc<DxbcIsgn>&       psgn,
     const DxbcAnalysisInfo&   analysis)
-  : m_moduleInfo (moduleInfo),
+  : m_fileName   (fileName),
+    m_moduleInfo (moduleInfo),
     m_programInfo(programInfo),
     m_module     (spvVersion(1, 6)),
     m_isgn       (isgn),
@@ -272,7 +273,9 @@ namespace dxvk {
         info.xfbStrides[i] = m_moduleInfo.xfb->strides[i];
     }
 
-    return new DxvkShader(info, m_module.compile());
+    return new DxvkShader(info, m_moduleInfo.options.optimizeSpirv
+      ? m_module.compileOptimized(m_fileName)
+      : m_module.compile());
   }
   
   
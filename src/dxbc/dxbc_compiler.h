@@ -399,6 +399,7 @@ namespace dxvk {
     
   private:
     
+    std::string         m_fileName;
     DxbcModuleInfo      m_moduleInfo;
     DxbcProgramInfo     m_programInfo;
     SpirvModule         m_module;
@@ -42,10 +42,16 @@ namespace dxvk {
   
   Rc<DxvkShader> DxbcModule::compile(
     const DxbcModuleInfo& moduleInfo,
-    const std::string&    fileName) const {
+    const std::string&    fileName,
+          DxvkShaderCompileTimings* timings) const {
     if (m_shexChunk == nullptr)
       throw DxvkError("DxbcModule::compile: No SHDR/SHEX chunk");
     
+    high_resolution_clock::time_point t0, t1, t2;
+
+    if (unlikely(timings))
+      t0 = high_resolution_clock::now();
+
     DxbcAnalysisInfo analysisInfo;
     
     DxbcAnalyzer analyzer(moduleInfo,
@@ -54,6 +60,9 @@ namespace dxvk {
       m_psgnChunk, analysisInfo);
     
     this->runAnalyzer(analyzer, m_shexChunk->slice());
+
+    if (unlikely(timings))
+      t1 = high_resolution_clock::now();
     
     DxbcCompiler compiler(
       fileName, moduleInfo,
@@ -62,8 +71,19 @@ namespace dxvk {
       m_psgnChunk, analysisInfo);
     
     this->runCompiler(compiler, m_shexChunk->slice());
-    
-    return compiler.finalize();
+
+    if (unlikely(timings))
+      t2 = high_resolution_clock::now();
+
+    Rc<DxvkShader> shader = compiler.finalize();
+
+    if (unlikely(timings)) {
+      timings->analyze  += t1 - t0;
+      timings->compile  += t2 - t1;
+      timings->finalize += high_resolution_clock::now() - t2;
+    }
+
+    return shader;
   }
   
   
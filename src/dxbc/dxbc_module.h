@@ -57,11 +57,13 @@ namespace dxvk {
      * \param [in] moduleInfo DXBC module info
      * \param [in] fileName File name, will be added to
      *        the compiled SPIR-V for debugging purposes.
+     * \param [out] timings Optional per-stage timings
      * \returns The compiled shader object
      */
     Rc<DxvkShader> compile(
       const DxbcModuleInfo& moduleInfo,
-      const std::string&    fileName) const;
+      const std::string&    fileName,
+            DxvkShaderCompileTimings* timings = nullptr) const;
     
     /**
      * \brief Compiles a pass-through geometry shader
@@ -40,6 +40,7 @@ namespace dxvk {
     disableMsaa              = options.disableMsaa;
     forceSampleRateShading   = options.forceSampleRateShading;
     enableSampleShadingInterlock = device->features().extFragmentShaderInterlock.fragmentShaderSampleInterlock;
+    optimizeSpirv            = device->config().optimizeShaders;
 
     // Figure out float control flags to match D3D11 rules
     if (options.floatControls) {
@@ -55,6 +55,9 @@ namespace dxvk {
 
     /// Minimum storage buffer alignment
     VkDeviceSize minSsboAlignment = 0;
+
+    /// Run SPIR-V optimization passes
+    bool optimizeSpirv = false;
   };
   
 }
\ No newline at end of file
@@ -19,7 +19,8 @@ namespace dxvk {
     const DxsoProgramInfo&    programInfo,
     const DxsoAnalysisInfo&   analysis,
     const D3D9ConstantLayout& layout)
-    : m_moduleInfo ( moduleInfo )
+    : m_fileName   ( fileName )
+    , m_moduleInfo ( moduleInfo )
     , m_programInfo( programInfo )
     , m_analysis   ( &analysis )
     , m_layout     ( &layout )
@@ -234,7 +235,9 @@ namespace dxvk {
     if (m_programInfo.type() == DxsoProgramTypes::PixelShader)
       info.flatShadingInputs = m_ps.flatShadingMask;
 
-    return new DxvkShader(info, m_module.compile());
+    return new DxvkShader(info, m_moduleInfo.options.optimizeSpirv
+      ? m_module.compileOptimized(m_fileName)
+      : m_module.compile());
   }
 
   void DxsoCompiler::emitInit() {
@@ -464,6 +467,9 @@ namespace dxvk {
 
     m_specUbo = SetupSpecUBO(m_module, m_bindings);
 
+    if (m_moduleInfo.options.vertexPulling)
+      this->emitVsVertexFetchInit();
+
     this->emitFunctionBegin(
       m_vs.functionId,
       m_module.defVoidType(),
@@ -3207,32 +3213,41 @@ void DxsoCompiler::emitControlFlowGenericLoop(
     for (uint32_t i = 0; i < m_isgn.elemCount; i++) {
       const auto& elem = m_isgn.elems[i];
       const uint32_t slot = elem.slot;
-      
-      DxsoRegisterInfo info;
-      info.type.ctype   = DxsoScalarType::Float32;
-      info.type.ccount  = 4;
-      info.type.alength = 1;
-      info.sclass       = spv::StorageClassInput;
 
-      DxsoRegisterPointer inputPtr;
-      inputPtr.id          = emitNewVariable(info);
-      inputPtr.type.ctype  = DxsoScalarType::Float32;
-      inputPtr.type.ccount = info.type.ccount;
+      DxsoRegisterValue indexVal;
 
-      m_module.decorateLocation(inputPtr.id, slot);
+      if (m_programInfo.type() == DxsoProgramType::VertexShader
+       && m_moduleInfo.options.vertexPulling) {
+        indexVal = this->emitVsVertexFetch(slot);
+      } else {
+        DxsoRegisterInfo info;
+        info.type.ctype   = DxsoScalarType::Float32;
+        info.type.ccount  = 4;
+        info.type.alength = 1;
+        info.sclass       = spv::StorageClassInput;
+
+        DxsoRegisterPointer inputPtr;
+        inputPtr.id          = emitNewVariable(info);
+        inputPtr.type.ctype  = DxsoScalarType::Float32;
+        inputPtr.type.ccount = info.type.ccount;
+
+        m_module.decorateLocation(inputPtr.id, slot);
+
+        if (m_programInfo.type() == DxsoProgramType::PixelShader
+         && m_moduleInfo.options.forceSampleRateShading) {
+          m_module.enableCapability(spv::CapabilitySampleRateShading);
+          m_module.decorate(inputPtr.id, spv::DecorationSample);
+        }
 
-      if (m_programInfo.type() == DxsoProgramType::PixelShader
-       && m_moduleInfo.options.forceSampleRateShading) {
-        m_module.enableCapability(spv::CapabilitySampleRateShading);
-        m_module.decorate(inputPtr.id, spv::DecorationSample);
-      }
+        std::string name =
+          str::format("in_", elem.semantic.usage, elem.semantic.usageIndex);
+        m_module.setDebugName(inputPtr.id, name.c_str());
 
-      std::string name =
-        str::format("in_", elem.semantic.usage, elem.semantic.usageIndex);
-      m_module.setDebugName(inputPtr.id, name.c_str());
+        if (elem.centroid)
+          m_module.decorate(inputPtr.id, spv::DecorationCentroid);
 
-      if (elem.centroid)
-        m_module.decorate(inputPtr.id, spv::DecorationCentroid);
+        indexVal = this->emitValueLoad(inputPtr);
+      }
 
       uint32_t typeId    = this->getVectorTypeId({ DxsoScalarType::Float32, 4 });
       uint32_t ptrTypeId = m_module.defPointerType(typeId, spv::StorageClassPrivate);
@@ -3241,10 +3256,7 @@ void DxsoCompiler::emitControlFlowGenericLoop(
 
       DxsoRegisterPointer indexPtr;
       indexPtr.id   = m_module.opAccessChain(ptrTypeId, m_vArray, 1, &regNumVar);
-      indexPtr.type = inputPtr.type;
-      indexPtr.type.ccount = 4;
-
-      DxsoRegisterValue indexVal = this->emitValueLoad(inputPtr);
+      indexPtr.type = indexVal.type;
 
       DxsoRegisterValue workingReg;
       workingReg.type = indexVal.type;
@@ -3297,6 +3309,299 @@ void DxsoCompiler::emitControlFlowGenericLoop(
   }
 
 
+  void DxsoCompiler::emitVsVertexFetchInit() {
+    uint32_t uvec4Type = getVectorTypeId({ DxsoScalarType::Uint32, 4 });
+
+    // Declare uniform buffer containing per-input fetch info,
+    // i.e. the byte offset, stride, instance divisor and type
+    uint32_t fetchArray  = m_module.defArrayTypeUnique(uvec4Type,
+      m_module.constu32(caps::InputRegisterCount));
+    uint32_t fetchStruct = m_module.defStructTypeUnique(1, &fetchArray);
+
+    m_vs.fetchInfo = m_module.newVar(
+      m_module.defPointerType(fetchStruct, spv::StorageClassUniform),
+      spv::StorageClassUniform);
+
+    m_module.decorateArrayStride  (fetchArray, 16);
+
+    m_module.setDebugName         (fetchStruct, "fetch_info_t");
+    m_module.setDebugMemberName   (fetchStruct, 0, "elements");
+    m_module.decorate             (fetchStruct, spv::DecorationBlock);
+    m_module.memberDecorateOffset (fetchStruct, 0, 0);
+
+    uint32_t bindingId = computeResourceSlotId(
+      m_programInfo.type(), DxsoBindingType::ConstantBuffer,
+      DxsoConstantBuffers::VSVertexFetch);
+
+    m_module.setDebugName         (m_vs.fetchInfo, "fetch_info");
+    m_module.decorateDescriptorSet(m_vs.fetchInfo, 0);
+    m_module.decorateBinding      (m_vs.fetchInfo, bindingId);
+
+    DxvkBindingInfo binding = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER };
+    binding.resourceBinding = bindingId;
+    binding.viewType        = VK_IMAGE_VIEW_TYPE_MAX_ENUM;
+    binding.access          = VK_ACCESS_UNIFORM_READ_BIT;
+    binding.uboSet          = VK_TRUE;
+    m_bindings.push_back(binding);
+
+    m_vs.vertexIndex = this->emitRegisterPtr(
+      "vs_vertex_index", DxsoScalarType::Sint32, 1, 0,
+      spv::StorageClassInput, spv::BuiltInVertexIndex).id;
+
+    m_vs.instanceIndex = this->emitRegisterPtr(
+      "vs_instance_index", DxsoScalarType::Sint32, 1, 0,
+      spv::StorageClassInput, spv::BuiltInInstanceIndex).id;
+
+    m_vs.fetchDecodeFunc = m_module.allocateId();
+    m_module.setDebugName(m_vs.fetchDecodeFunc, "vs_decode_attribute");
+  }
+
+
+  void DxsoCompiler::emitVsVertexFetchDecode() {
+    uint32_t floatType = getScalarTypeId(DxsoScalarType::Float32);
+    uint32_t sintType  = getScalarTypeId(DxsoScalarType::Sint32);
+    uint32_t uintType  = getScalarTypeId(DxsoScalarType::Uint32);
+    uint32_t vec2Type  = getVectorTypeId({ DxsoScalarType::Float32, 2 });
+    uint32_t vec4Type  = getVectorTypeId({ DxsoScalarType::Float32, 4 });
+    uint32_t uvec4Type = getVectorTypeId({ DxsoScalarType::Uint32,  4 });
+
+    // vec4 vs_decode_attribute(uint type, uvec4 data). This must
+    // not be emitted inside vs_main, so end that function first.
+    this->emitFunctionEnd();
+
+    std::array<uint32_t, 2> argTypes = {{ uintType, uvec4Type }};
+
+    m_module.functionBegin(vec4Type, m_vs.fetchDecodeFunc,
+      m_module.defFunctionType(vec4Type, argTypes.size(), argTypes.data()),
+      spv::FunctionControlMaskNone);
+
+    uint32_t typeArg = m_module.functionParameter(uintType);
+    uint32_t dataArg = m_module.functionParameter(uvec4Type);
+
+    m_module.opLabel(m_module.allocateId());
+
+    std::array<uint32_t, 4> words;
+
+    for (uint32_t i = 0; i < words.size(); i++)
+      words[i] = m_module.opCompositeExtract(uintType, dataArg, 1, &i);
+
+    const uint32_t zero = m_module.constf32(0.0f);
+    const uint32_t one  = m_module.constf32(1.0f);
+
+    auto f32 = [&] (uint32_t word) {
+      return m_module.opBitcast(floatType, words[word]);
+    };
+
+    auto uscaled = [&] (uint32_t word, uint32_t offset, uint32_t count) {
+      return m_module.opConvertUtoF(floatType,
+        m_module.opBitFieldUExtract(uintType, words[word],
+          m_module.constu32(offset), m_module.constu32(count)));
+    };
+
+    auto sscaled = [&] (uint32_t word, uint32_t offset, uint32_t count) {
+      return m_module.opConvertStoF(floatType,
+        m_module.opBitFieldSExtract(sintType,
+          m_module.opBitcast(sintType, words[word]),
+          m_module.constu32(offset), m_module.constu32(count)));
+    };
+
+    auto unorm = [&] (uint32_t word, uint32_t offset, uint32_t count) {
+      return m_module.opFMul(floatType, uscaled(word, offset, count),
+        m_module.constf32(1.0f / float((1u << count) - 1u)));
+    };
+
+    auto snorm = [&] (uint32_t word, uint32_t offset, uint32_t count) {
+      return m_module.opFMax(floatType, m_module.constf32(-1.0f),
+        m_module.opFMul(floatType, sscaled(word, offset, count),
+          m_module.constf32(1.0f / float((1u << (count - 1u)) - 1u))));
+    };
+
+    auto half = [&] (uint32_t word, uint32_t component) {
+      return m_module.opCompositeExtract(floatType,
+        m_module.opUnpackHalf2x16(vec2Type, words[word]), 1, &component);
+    };
+
+    auto vec4 = [&] (uint32_t x, uint32_t y, uint32_t z, uint32_t w) {
+      std::array<uint32_t, 4> ids = {{ x, y, z, w }};
+      return m_module.opCompositeConstruct(vec4Type, ids.size(), ids.data());
+    };
+
+    // One case per D3DDECLTYPE, with D3DDECLTYPE_UNUSED and
+    // anything invalid falling through to the default case.
+    // Missing components are filled in with (0, 0, 0, 1),
+    // matching the behaviour of the fixed-function path.
+    std::array<SpirvSwitchCaseLabel, D3DDECLTYPE_UNUSED> caseLabels;
+    std::array<SpirvPhiLabel, D3DDECLTYPE_UNUSED + 1> phiLabels;
+
+    for (uint32_t i = 0; i < caseLabels.size(); i++) {
+      caseLabels[i].literal = i;
+      caseLabels[i].labelId = m_module.allocateId();
+    }
+
+    uint32_t defaultLabel = m_module.allocateId();
+    uint32_t mergeLabel   = m_module.allocateId();
+
+    m_module.opSelectionMerge(mergeLabel, spv::SelectionControlMaskNone);
+    m_module.opSwitch(typeArg, defaultLabel, caseLabels.size(), caseLabels.data());
+
+    for (uint32_t i = 0; i < caseLabels.size(); i++) {
+      m_module.opLabel(caseLabels[i].labelId);
+
+      uint32_t value = 0;
+
+      switch (D3DDECLTYPE(i)) {
+        case D3DDECLTYPE_FLOAT1:    value = vec4(f32(0), zero, zero, one); break;
+        case D3DDECLTYPE_FLOAT2:    value = vec4(f32(0), f32(1), zero, one); break;
+        case D3DDECLTYPE_FLOAT3:    value = vec4(f32(0), f32(1), f32(2), one); break;
+        case D3DDECLTYPE_FLOAT4:    value = vec4(f32(0), f32(1), f32(2), f32(3)); break;
+        case D3DDECLTYPE_D3DCOLOR:  value = vec4(unorm(0, 16, 8), unorm(0, 8, 8), unorm(0, 0, 8), unorm(0, 24, 8)); break;
+        case D3DDECLTYPE_UBYTE4:    value = vec4(uscaled(0, 0, 8), uscaled(0, 8, 8), uscaled(0, 16, 8), uscaled(0, 24, 8)); break;
+        case D3DDECLTYPE_SHORT2:    value = vec4(sscaled(0, 0, 16), sscaled(0, 16, 16), zero, one); break;
+        case D3DDECLTYPE_SHORT4:    value = vec4(sscaled(0, 0, 16), sscaled(0, 16, 16), sscaled(1, 0, 16), sscaled(1, 16, 16)); break;
+        case D3DDECLTYPE_UBYTE4N:   value = vec4(unorm(0, 0, 8), unorm(0, 8, 8), unorm(0, 16, 8), unorm(0, 24, 8)); break;
+        case D3DDECLTYPE_SHORT2N:   value = vec4(snorm(0, 0, 16), snorm(0, 16, 16), zero, one); break;
+        case D3DDECLTYPE_SHORT4N:   value = vec4(snorm(0, 0, 16), snorm(0, 16, 16), snorm(1, 0, 16), snorm(1, 16, 16)); break;
+        case D3DDECLTYPE_USHORT2N:  value = vec4(unorm(0, 0, 16), unorm(0, 16, 16), zero, one); break;
+        case D3DDECLTYPE_USHORT4N:  value = vec4(unorm(0, 0, 16), unorm(0, 16, 16), unorm(1, 0, 16), unorm(1, 16, 16)); break;
+        case D3DDECLTYPE_UDEC3:     value = vec4(uscaled(0, 0, 10), uscaled(0, 10, 10), uscaled(0, 20, 10), uscaled(0, 30, 2)); break;
+        case D3DDECLTYPE_DEC3N:     value = vec4(snorm(0, 0, 10), snorm(0, 10, 10), snorm(0, 20, 10), snorm(0, 30, 2)); break;
+        case D3DDECLTYPE_FLOAT16_2: value = vec4(half(0, 0), half(0, 1), zero, one); break;
+        case D3DDECLTYPE_FLOAT16_4: value = vec4(half(0, 0), half(0, 1), half(1, 0), half(1, 1)); break;
+        default:                    value = m_module.constvec4f32(0.0f, 0.0f, 0.0f, 0.0f); break;
+      }
+
+      phiLabels[i].varId   = value;
+      phiLabels[i].labelId = caseLabels[i].labelId;
+
+      m_module.opBranch(mergeLabel);
+    }
+
+    m_module.opLabel(defaultLabel);
+    m_module.opBranch(mergeLabel);
+
+    phiLabels[D3DDECLTYPE_UNUSED].varId   = m_module.constvec4f32(0.0f, 0.0f, 0.0f, 0.0f);
+    phiLabels[D3DDECLTYPE_UNUSED].labelId = defaultLabel;
+
+    m_module.opLabel(mergeLabel);
+    m_module.opReturnValue(m_module.opPhi(vec4Type, phiLabels.size(), phiLabels.data()));
+    m_module.functionEnd();
+  }
+
+
+  DxsoRegisterValue DxsoCompiler::emitVsVertexFetch(
+          uint32_t                location) {
+    uint32_t boolType  = m_module.defBoolType();
+    uint32_t sintType  = getScalarTypeId(DxsoScalarType::Sint32);
+    uint32_t uintType  = getScalarTypeId(DxsoScalarType::Uint32);
+    uint32_t uvec4Type = getVectorTypeId({ DxsoScalarType::Uint32, 4 });
+
+    // Declare storage buffer for this input. The device binds the
+    // vertex buffer of the stream that provides the attribute.
+    uint32_t arrayType  = m_module.defRuntimeArrayTypeUnique(uintType);
+    uint32_t structType = m_module.defStructTypeUnique(1, &arrayType);
+    uint32_t bufferId   = m_module.newVar(
+      m_module.defPointerType(structType, spv::StorageClassUniform),
+      spv::StorageClassUniform);
+
+    m_module.decorateArrayStride  (arrayType, sizeof(uint32_t));
+    m_module.decorate             (structType, spv::DecorationBufferBlock);
+    m_module.memberDecorateOffset (structType, 0, 0);
+
+    uint32_t bindingId = getVertexFetchBufferSlot(location);
+
+    std::string name = str::format("vb", location);
+    m_module.setDebugName         (bufferId, name.c_str());
+    m_module.decorateDescriptorSet(bufferId, 0);
+    m_module.decorateBinding      (bufferId, bindingId);
+    m_module.decorate             (bufferId, spv::DecorationNonWritable);
+
+    DxvkBindingInfo binding = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+    binding.resourceBinding = bindingId;
+    binding.viewType        = VK_IMAGE_VIEW_TYPE_MAX_ENUM;
+    binding.access          = VK_ACCESS_SHADER_READ_BIT;
+    binding.uboSet          = VK_TRUE;
+    m_bindings.push_back(binding);
+
+    // Load fetch info for this input
+    std::array<uint32_t, 2> infoIndices = {{
+      m_module.constu32(0), m_module.constu32(location) }};
+
+    uint32_t info = m_module.opLoad(uvec4Type,
+      m_module.opAccessChain(
+        m_module.defPointerType(uvec4Type, spv::StorageClassUniform),
+        m_vs.fetchInfo, infoIndices.size(), infoIndices.data()));
+
+    std::array<uint32_t, 4> infoWords;
+
+    for (uint32_t i = 0; i < infoWords.size(); i++)
+      infoWords[i] = m_module.opCompositeExtract(uintType, info, 1, &i);
+
+    uint32_t offset  = infoWords[0];
+    uint32_t stride  = infoWords[1];
+    uint32_t divisor = infoWords[2];
+    uint32_t type    = infoWords[3];
+
+    // Per-instance data uses the instance index divided by the
+    // stream frequency, everything else uses the vertex index.
+    uint32_t vertexIndex = m_module.opBitcast(uintType,
+      m_module.opLoad(sintType, m_vs.vertexIndex));
+    uint32_t instanceIndex = m_module.opBitcast(uintType,
+      m_module.opLoad(sintType, m_vs.instanceIndex));
+
+    uint32_t index = m_module.opSelect(uintType,
+      m_module.opINotEqual(boolType, divisor, m_module.constu32(0)),
+      m_module.opUDiv(uintType, instanceIndex,
+        m_module.opUMax(uintType, divisor, m_module.constu32(1))),
+      vertexIndex);
+
+    uint32_t address = m_module.opIAdd(uintType, offset,
+      m_module.opIMul(uintType, index, stride));
+
+    // Vertex data is not necessarily dword-aligned, so load one
+    // extra dword and shift the data into place if necessary.
+    uint32_t dwordIndex = m_module.opShiftRightLogical(uintType,
+      address, m_module.constu32(2));
+    uint32_t shift = m_module.opShiftLeftLogical(uintType,
+      m_module.opBitwiseAnd(uintType, address, m_module.constu32(3)),
+      m_module.constu32(3));
+
+    uint32_t dwordPtrType = m_module.defPointerType(uintType, spv::StorageClassUniform);
+
+    std::array<uint32_t, 5> dwords;
+
+    for (uint32_t i = 0; i < dwords.size(); i++) {
+      std::array<uint32_t, 2> indices = {{ m_module.constu32(0),
+        m_module.opIAdd(uintType, dwordIndex, m_module.constu32(i)) }};
+
+      dwords[i] = m_module.opLoad(uintType,
+        m_module.opAccessChain(dwordPtrType, bufferId,
+          indices.size(), indices.data()));
+    }
+
+    uint32_t isAligned = m_module.opIEqual(boolType, shift, m_module.constu32(0));
+    uint32_t invShift = m_module.opISub(uintType, m_module.constu32(32), shift);
+
+    std::array<uint32_t, 4> words;
+
+    for (uint32_t i = 0; i < words.size(); i++) {
+      uint32_t unaligned = m_module.opBitwiseOr(uintType,
+        m_module.opShiftRightLogical(uintType, dwords[i], shift),
+        m_module.opShiftLeftLogical(uintType, dwords[i + 1], invShift));
+
+      words[i] = m_module.opSelect(uintType, isAligned, dwords[i], unaligned);
+    }
+
+    std::array<uint32_t, 2> args = {{ type,
+      m_module.opCompositeConstruct(uvec4Type, words.size(), words.data()) }};
+
+    DxsoRegisterValue result;
+    result.type = { DxsoScalarType::Float32, 4 };
+    result.id   = m_module.opFunctionCall(getVectorTypeId(result.type),
+      m_vs.fetchDecodeFunc, args.size(), args.data());
+    return result;
+  }
+
+
   void DxsoCompiler::emitLinkerOutputSetup() {
     bool outputtedColor0 = false;
     bool outputtedColor1 = false;
@@ -3656,6 +3961,9 @@ void DxsoCompiler::emitControlFlowGenericLoop(
 
 
   void DxsoCompiler::emitVsFinalize() {
+    if (m_moduleInfo.options.vertexPulling)
+      this->emitVsVertexFetchDecode();
+
     this->emitMainFunctionBegin();
 
     this->emitInputSetup();
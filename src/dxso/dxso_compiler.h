@@ -148,6 +148,13 @@ namespace dxvk {
     // Rasterizer output registers
     DxsoRegisterPointer oPos;
     DxsoRegisterPointer oPSize;
+
+    ////////////////////////////
+    // Vertex pulling resources
+    uint32_t fetchInfo        = 0;
+    uint32_t fetchDecodeFunc  = 0;
+    uint32_t vertexIndex      = 0;
+    uint32_t instanceIndex    = 0;
   };
 
   /**
@@ -251,6 +258,7 @@ namespace dxvk {
 
   private:
 
+    std::string                m_fileName;
     DxsoModuleInfo             m_moduleInfo;
     DxsoProgramInfo            m_programInfo;
     const DxsoAnalysisInfo*    m_analysis;
@@ -679,6 +687,12 @@ namespace dxvk {
     // Shader finalization methods
     void emitInputSetup();
 
+    void emitVsVertexFetchInit();
+    void emitVsVertexFetchDecode();
+
+    DxsoRegisterValue emitVsVertexFetch(
+            uint32_t                location);
+
     void emitVsClipping();
     void setupRenderStateInfo();
     void emitFog();
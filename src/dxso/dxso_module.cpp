@@ -25,13 +25,25 @@ namespace dxvk {
     const DxsoModuleInfo&     moduleInfo,
     const std::string&        fileName,
     const DxsoAnalysisInfo&   analysis,
-    const D3D9ConstantLayout& layout) {
+    const D3D9ConstantLayout& layout,
+          DxvkShaderCompileTimings* timings) {
+    high_resolution_clock::time_point t0;
+
+    if (unlikely(timings))
+      t0 = high_resolution_clock::now();
+
     auto compiler = std::make_unique<DxsoCompiler>(
       fileName, moduleInfo,
       m_header.info(), analysis,
       layout);
 
     this->runCompiler(*compiler, m_code.iter());
+
+    if (unlikely(timings)) {
+      auto t1 = high_resolution_clock::now();
+      timings->compile += t1 - t0;
+      t0 = t1;
+    }
     m_isgn = compiler->isgn();
 
     m_meta            = compiler->meta();
@@ -46,7 +58,12 @@ namespace dxvk {
     // after that.
     m_usedRTs = compiler->usedRTs();
 
-    return compiler->compile();
+    Rc<DxvkShader> shader = compiler->compile();
+
+    if (unlikely(timings))
+      timings->finalize += high_resolution_clock::now() - t0;
+
+    return shader;
   }
 
   void DxsoModule::runAnalyzer(
@@ -31,6 +31,17 @@ namespace dxvk {
 
     longMad = options.longMad;
     robustness2Supported = devFeatures.extRobustness2.robustBufferAccess2;
+
+    optimizeSpirv = device->config().optimizeShaders;
+
+    // Vertex pulling binds one storage buffer per vertex shader
+    // input, on top of the SWVP constant buffer, so make sure the
+    // device can actually provide that many descriptors.
+    const auto& limits = devInfo.core.properties.limits;
+
+    vertexPulling = options.enableVertexPulling
+      && limits.maxPerStageDescriptorStorageBuffers > caps::InputRegisterCount
+      && limits.maxDescriptorSetStorageBuffers      > caps::InputRegisterCount;
   }
 
 }
\ No newline at end of file
@@ -49,6 +49,13 @@ namespace dxvk {
 
     /// Whether or not we can rely on robustness2 to handle oob constant access
     bool robustness2Supported;
+
+    /// Run SPIR-V optimization passes
+    bool optimizeSpirv;
+
+    /// Fetch vertex shader inputs from storage buffers
+    /// rather than declaring vertex input variables
+    bool vertexPulling;
   };
 
 }
\ No newline at end of file
@@ -28,6 +28,7 @@ namespace dxvk {
     VSClipPlanes     = 3,
     VSFixedFunction  = 4,
     VSVertexBlendData = 5,
+    VSVertexFetch    = 6,
     VSCount,
 
     PSConstantBuffer = 0,
@@ -57,6 +58,11 @@ namespace dxvk {
     return getSWVPBufferSlot() + 1;
   }
 
+  // Storage buffers used for vertex pulling, one per input location
+  constexpr uint32_t getVertexFetchBufferSlot(uint32_t location) {
+    return getSpecConstantBufferSlot() + 1 + location;
+  }
+
   uint32_t RegisterLinkerSlot(DxsoSemantic semantic);
 
 }
\ No newline at end of file
@@ -252,6 +252,7 @@ namespace dxvk {
         && CHECK_FEATURE_NEED(extMemoryBudget)
         && CHECK_FEATURE_NEED(extMemoryPriority.memoryPriority)
         && CHECK_FEATURE_NEED(extNonSeamlessCubeMap.nonSeamlessCubeMap)
+        && CHECK_FEATURE_NEED(extPageableDeviceLocalMemory.pageableDeviceLocalMemory)
         && CHECK_FEATURE_NEED(extRobustness2.robustBufferAccess2)
         && CHECK_FEATURE_NEED(extRobustness2.robustImageAccess2)
         && CHECK_FEATURE_NEED(extRobustness2.nullDescriptor)
@@ -350,7 +351,8 @@ namespace dxvk {
     enabledFeatures.extDepthClipEnable.depthClipEnable =
       m_deviceFeatures.extDepthClipEnable.depthClipEnable;
 
-    // Used to make pipeline library stuff less clunky
+    // Used to make pipeline library stuff less clunky, and to reduce
+    // the number of pipelines with differing blend or sample state
     enabledFeatures.extExtendedDynamicState3.extendedDynamicState3AlphaToCoverageEnable =
       m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3AlphaToCoverageEnable;
     enabledFeatures.extExtendedDynamicState3.extendedDynamicState3DepthClipEnable =
@@ -362,6 +364,14 @@ namespace dxvk {
       m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3SampleMask;
     enabledFeatures.extExtendedDynamicState3.extendedDynamicState3LineRasterizationMode =
       m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3LineRasterizationMode;
+    enabledFeatures.extExtendedDynamicState3.extendedDynamicState3ColorBlendEnable =
+      m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3ColorBlendEnable;
+    enabledFeatures.extExtendedDynamicState3.extendedDynamicState3ColorBlendEquation =
+      m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3ColorBlendEquation;
+    enabledFeatures.extExtendedDynamicState3.extendedDynamicState3ColorWriteMask =
+      m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3ColorWriteMask;
+    enabledFeatures.extExtendedDynamicState3.extendedDynamicState3PolygonMode =
+      m_deviceFeatures.extExtendedDynamicState3.extendedDynamicState3PolygonMode;
 
     // Used for both pNext shader module info, and fast-linking pipelines provided
     // that graphicsPipelineLibraryIndependentInterpolationDecoration is supported
@@ -382,6 +392,12 @@ namespace dxvk {
     enabledFeatures.extMemoryPriority.memoryPriority =
       m_deviceFeatures.extMemoryPriority.memoryPriority;
 
+    // Let the driver page out low-priority allocations
+    // instead of failing or thrashing when over budget
+    enabledFeatures.extPageableDeviceLocalMemory.pageableDeviceLocalMemory =
+      m_deviceFeatures.extPageableDeviceLocalMemory.pageableDeviceLocalMemory &&
+      m_deviceFeatures.extMemoryPriority.memoryPriority;
+
     // Require robustBufferAccess2 since we use the robustness alignment
     // info in a number of places, and require null descriptor support
     // since we no longer have a fallback for those in the backend
@@ -574,6 +590,10 @@ namespace dxvk {
           enabledFeatures.extNonSeamlessCubeMap = *reinterpret_cast<const VkPhysicalDeviceNonSeamlessCubeMapFeaturesEXT*>(f);
           break;
 
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT:
+          enabledFeatures.extPageableDeviceLocalMemory = *reinterpret_cast<const VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT*>(f);
+          break;
+
         case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ROBUSTNESS_2_FEATURES_EXT:
           enabledFeatures.extRobustness2 = *reinterpret_cast<const VkPhysicalDeviceRobustness2FeaturesEXT*>(f);
           break;
@@ -872,6 +892,11 @@ namespace dxvk {
       m_deviceFeatures.extNonSeamlessCubeMap.pNext = std::exchange(m_deviceFeatures.core.pNext, &m_deviceFeatures.extNonSeamlessCubeMap);
     }
 
+    if (m_deviceExtensions.supports(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME)) {
+      m_deviceFeatures.extPageableDeviceLocalMemory.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT;
+      m_deviceFeatures.extPageableDeviceLocalMemory.pNext = std::exchange(m_deviceFeatures.core.pNext, &m_deviceFeatures.extPageableDeviceLocalMemory);
+    }
+
     if (m_deviceExtensions.supports(VK_EXT_ROBUSTNESS_2_EXTENSION_NAME)) {
       m_deviceFeatures.extRobustness2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ROBUSTNESS_2_FEATURES_EXT;
       m_deviceFeatures.extRobustness2.pNext = std::exchange(m_deviceFeatures.core.pNext, &m_deviceFeatures.extRobustness2);
@@ -980,6 +1005,7 @@ namespace dxvk {
       &devExtensions.extMemoryBudget,
       &devExtensions.extMemoryPriority,
       &devExtensions.extNonSeamlessCubeMap,
+      &devExtensions.extPageableDeviceLocalMemory,
       &devExtensions.extRobustness2,
       &devExtensions.extShaderModuleIdentifier,
       &devExtensions.extShaderStencilExport,
@@ -1079,6 +1105,11 @@ namespace dxvk {
       enabledFeatures.extNonSeamlessCubeMap.pNext = std::exchange(enabledFeatures.core.pNext, &enabledFeatures.extNonSeamlessCubeMap);
     }
 
+    if (devExtensions.extPageableDeviceLocalMemory) {
+      enabledFeatures.extPageableDeviceLocalMemory.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT;
+      enabledFeatures.extPageableDeviceLocalMemory.pNext = std::exchange(enabledFeatures.core.pNext, &enabledFeatures.extPageableDeviceLocalMemory);
+    }
+
     if (devExtensions.extShaderModuleIdentifier) {
       enabledFeatures.extShaderModuleIdentifier.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT;
       enabledFeatures.extShaderModuleIdentifier.pNext = std::exchange(enabledFeatures.core.pNext, &enabledFeatures.extShaderModuleIdentifier);
@@ -1234,6 +1265,10 @@ namespace dxvk {
       "\n  extDynamicState3RasterizationSamples   : ", features.extExtendedDynamicState3.extendedDynamicState3RasterizationSamples ? "1" : "0",
       "\n  extDynamicState3SampleMask             : ", features.extExtendedDynamicState3.extendedDynamicState3SampleMask ? "1" : "0",
       "\n  extDynamicState3LineRasterizationMode  : ", features.extExtendedDynamicState3.extendedDynamicState3LineRasterizationMode ? "1" : "0",
+      "\n  extDynamicState3ColorBlendEnable       : ", features.extExtendedDynamicState3.extendedDynamicState3ColorBlendEnable ? "1" : "0",
+      "\n  extDynamicState3ColorBlendEquation     : ", features.extExtendedDynamicState3.extendedDynamicState3ColorBlendEquation ? "1" : "0",
+      "\n  extDynamicState3ColorWriteMask         : ", features.extExtendedDynamicState3.extendedDynamicState3ColorWriteMask ? "1" : "0",
+      "\n  extDynamicState3PolygonMode            : ", features.extExtendedDynamicState3.extendedDynamicState3PolygonMode ? "1" : "0",
       "\n", VK_EXT_FRAGMENT_SHADER_INTERLOCK_EXTENSION_NAME,
       "\n  fragmentShaderSampleInterlock          : ", features.extFragmentShaderInterlock.fragmentShaderSampleInterlock ? "1" : "0",
       "\n  fragmentShaderPixelInterlock           : ", features.extFragmentShaderInterlock.fragmentShaderPixelInterlock ? "1" : "0",
@@ -1250,6 +1285,8 @@ namespace dxvk {
       "\n  memoryPriority                         : ", features.extMemoryPriority.memoryPriority ? "1" : "0",
       "\n", VK_EXT_NON_SEAMLESS_CUBE_MAP_EXTENSION_NAME,
       "\n  nonSeamlessCubeMap                     : ", features.extNonSeamlessCubeMap.nonSeamlessCubeMap ? "1" : "0",
+      "\n", VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME,
+      "\n  pageableDeviceLocalMemory              : ", features.extPageableDeviceLocalMemory.pageableDeviceLocalMemory ? "1" : "0",
       "\n", VK_EXT_ROBUSTNESS_2_EXTENSION_NAME,
       "\n  robustBufferAccess2                    : ", features.extRobustness2.robustBufferAccess2 ? "1" : "0",
       "\n  robustImageAccess2                     : ", features.extRobustness2.robustImageAccess2 ? "1" : "0",
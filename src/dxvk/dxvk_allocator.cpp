@@ -0,0 +1,280 @@
+#include "dxvk_allocator.h"
+
+namespace dxvk {
+
+  DxvkTlsfAllocator::DxvkTlsfAllocator(VkDeviceSize size)
+  : m_size(size), m_freeSize(size) {
+    for (auto& list : m_freeLists)
+      list = InvalidBlock;
+
+    // Mark the entire range as free
+    insertFreeBlock(createBlock(0, size));
+  }
+
+
+  DxvkTlsfAllocator::~DxvkTlsfAllocator() {
+
+  }
+
+
+  DxvkSubAllocation DxvkTlsfAllocator::alloc(
+          VkDeviceSize          size,
+          VkDeviceSize          alignment) {
+    VkDeviceSize alignedSize = align(std::max<VkDeviceSize>(size, 1), alignment);
+
+    // Most free blocks are suitably aligned, so try to find a block
+    // of the exact size class first. Only reserve extra space for
+    // alignment if that block cannot be used, so that the search
+    // remains constant-time in either case.
+    uint32_t blockIndex = findFreeBlock(alignedSize);
+
+    if (blockIndex != InvalidBlock) {
+      const Block& block = m_blocks[blockIndex];
+
+      if (align(block.offset, alignment) + alignedSize > block.offset + block.size)
+        blockIndex = InvalidBlock;
+    }
+
+    if (blockIndex == InvalidBlock && alignment > 1)
+      blockIndex = findFreeBlock(alignedSize + alignment - 1);
+
+    if (blockIndex == InvalidBlock)
+      return DxvkSubAllocation();
+
+    removeFreeBlock(blockIndex);
+
+    VkDeviceSize blockStart = m_blocks[blockIndex].offset;
+    VkDeviceSize blockEnd   = m_blocks[blockIndex].offset + m_blocks[blockIndex].size;
+
+    VkDeviceSize allocStart = align(blockStart, alignment);
+    VkDeviceSize allocEnd   = allocStart + alignedSize;
+
+    // Return unused space in front of and behind the
+    // allocation to the free lists as separate blocks.
+    // Note that creating blocks may reallocate storage.
+    if (allocStart != blockStart) {
+      uint32_t padIndex = createBlock(blockStart, allocStart - blockStart);
+
+      Block& pad = m_blocks[padIndex];
+      Block& block = m_blocks[blockIndex];
+
+      pad.prevPhys = block.prevPhys;
+      pad.nextPhys = blockIndex;
+
+      if (pad.prevPhys != InvalidBlock)
+        m_blocks[pad.prevPhys].nextPhys = padIndex;
+
+      block.prevPhys = padIndex;
+      insertFreeBlock(padIndex);
+    }
+
+    if (allocEnd != blockEnd) {
+      uint32_t tailIndex = createBlock(allocEnd, blockEnd - allocEnd);
+
+      Block& tail = m_blocks[tailIndex];
+      Block& block = m_blocks[blockIndex];
+
+      tail.prevPhys = blockIndex;
+      tail.nextPhys = block.nextPhys;
+
+      if (tail.nextPhys != InvalidBlock)
+        m_blocks[tail.nextPhys].prevPhys = tailIndex;
+
+      block.nextPhys = tailIndex;
+      insertFreeBlock(tailIndex);
+    }
+
+    Block& block = m_blocks[blockIndex];
+    block.offset = allocStart;
+    block.size   = alignedSize;
+
+    m_freeSize -= alignedSize;
+
+    DxvkSubAllocation result;
+    result.block  = blockIndex;
+    result.offset = allocStart;
+    result.length = alignedSize;
+    return result;
+  }
+
+
+  void DxvkTlsfAllocator::free(
+          uint32_t              block) {
+    m_freeSize += m_blocks[block].size;
+
+    // Merge with adjacent free blocks. Free blocks are never
+    // adjacent to each other, so this needs no iteration.
+    uint32_t prevIndex = m_blocks[block].prevPhys;
+
+    if (prevIndex != InvalidBlock && m_blocks[prevIndex].isFree) {
+      removeFreeBlock(prevIndex);
+
+      Block& prev = m_blocks[prevIndex];
+      Block& curr = m_blocks[block];
+
+      curr.offset   = prev.offset;
+      curr.size    += prev.size;
+      curr.prevPhys = prev.prevPhys;
+
+      if (curr.prevPhys != InvalidBlock)
+        m_blocks[curr.prevPhys].nextPhys = block;
+
+      destroyBlock(prevIndex);
+    }
+
+    uint32_t nextIndex = m_blocks[block].nextPhys;
+
+    if (nextIndex != InvalidBlock && m_blocks[nextIndex].isFree) {
+      removeFreeBlock(nextIndex);
+
+      Block& next = m_blocks[nextIndex];
+      Block& curr = m_blocks[block];
+
+      curr.size    += next.size;
+      curr.nextPhys = next.nextPhys;
+
+      if (curr.nextPhys != InvalidBlock)
+        m_blocks[curr.nextPhys].prevPhys = block;
+
+      destroyBlock(nextIndex);
+    }
+
+    insertFreeBlock(block);
+  }
+
+
+  VkDeviceSize DxvkTlsfAllocator::largestFreeBlock() const {
+    if (!m_flBitmap)
+      return 0;
+
+    uint32_t fl = 63u - bit::lzcnt(m_flBitmap);
+    uint32_t sl = 31u - bit::lzcnt(m_slBitmaps[fl]);
+
+    VkDeviceSize result = 0;
+
+    for (uint32_t i = m_freeLists[fl * SlCount + sl]; i != InvalidBlock; i = m_blocks[i].nextFree)
+      result = std::max(result, m_blocks[i].size);
+
+    return result;
+  }
+
+
+  uint32_t DxvkTlsfAllocator::createBlock(
+          VkDeviceSize          offset,
+          VkDeviceSize          size) {
+    uint32_t index = m_unusedBlocks;
+
+    if (index != InvalidBlock) {
+      m_unusedBlocks = m_blocks[index].nextFree;
+    } else {
+      index = uint32_t(m_blocks.size());
+      m_blocks.emplace_back();
+    }
+
+    Block& block = m_blocks[index];
+    block = Block();
+    block.offset = offset;
+    block.size   = size;
+    return index;
+  }
+
+
+  void DxvkTlsfAllocator::destroyBlock(
+          uint32_t              block) {
+    m_blocks[block].nextFree = m_unusedBlocks;
+    m_unusedBlocks = block;
+  }
+
+
+  void DxvkTlsfAllocator::insertFreeBlock(
+          uint32_t              block) {
+    auto [fl, sl] = computeListIndex(m_blocks[block].size);
+    uint32_t& head = m_freeLists[fl * SlCount + sl];
+
+    Block& entry = m_blocks[block];
+    entry.isFree   = true;
+    entry.prevFree = InvalidBlock;
+    entry.nextFree = head;
+
+    if (head != InvalidBlock)
+      m_blocks[head].prevFree = block;
+
+    head = block;
+
+    m_flBitmap      |= uint64_t(1u) << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+  }
+
+
+  void DxvkTlsfAllocator::removeFreeBlock(
+          uint32_t              block) {
+    auto [fl, sl] = computeListIndex(m_blocks[block].size);
+    uint32_t& head = m_freeLists[fl * SlCount + sl];
+
+    Block& entry = m_blocks[block];
+    entry.isFree = false;
+
+    if (entry.prevFree != InvalidBlock)
+      m_blocks[entry.prevFree].nextFree = entry.nextFree;
+    else
+      head = entry.nextFree;
+
+    if (entry.nextFree != InvalidBlock)
+      m_blocks[entry.nextFree].prevFree = entry.prevFree;
+
+    if (head == InvalidBlock) {
+      m_slBitmaps[fl] &= ~(1u << sl);
+
+      if (!m_slBitmaps[fl])
+        m_flBitmap &= ~(uint64_t(1u) << fl);
+    }
+  }
+
+
+  uint32_t DxvkTlsfAllocator::findFreeBlock(
+          VkDeviceSize          size) const {
+    // Round up to the next size class so that any
+    // block in the selected list is large enough
+    if (size >= SlCount) {
+      uint32_t msb = 63u - bit::lzcnt(uint64_t(size));
+      size += (VkDeviceSize(1) << (msb - SlBits)) - 1;
+    }
+
+    auto [fl, sl] = computeListIndex(size);
+
+    if (fl >= FlCount)
+      return InvalidBlock;
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+
+    if (!slMap) {
+      uint64_t flMap = fl + 1 < FlCount
+        ? m_flBitmap & (~uint64_t(0) << (fl + 1))
+        : uint64_t(0);
+
+      if (!flMap)
+        return InvalidBlock;
+
+      fl = bit::tzcnt(flMap);
+      slMap = m_slBitmaps[fl];
+    }
+
+    sl = bit::tzcnt(slMap);
+    return m_freeLists[fl * SlCount + sl];
+  }
+
+
+  std::pair<uint32_t, uint32_t> DxvkTlsfAllocator::computeListIndex(
+          VkDeviceSize          size) {
+    // Sizes below the second-level count all go into the first
+    // list, with one second-level entry per possible size
+    if (size < SlCount)
+      return std::make_pair(0u, uint32_t(size));
+
+    uint32_t msb = 63u - bit::lzcnt(uint64_t(size));
+    uint32_t fl = msb - SlBits + 1;
+    uint32_t sl = uint32_t(size >> (msb - SlBits)) ^ SlCount;
+    return std::make_pair(fl, sl);
+  }
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "dxvk_include.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Sub-allocation
+   *
+   * Stores the location of an allocated range as well as
+   * an opaque handle that is needed to free the range.
+   */
+  struct DxvkSubAllocation {
+    uint32_t      block  = ~0u;
+    VkDeviceSize  offset = 0;
+    VkDeviceSize  length = 0;
+
+    explicit operator bool () const {
+      return block != ~0u;
+    }
+  };
+
+
+  /**
+   * \brief Two-level segregated fit allocator
+   *
+   * Manages an address range without touching the underlying
+   * memory, so block metadata is stored out of band. Free
+   * blocks are sorted into size classes, with the first level
+   * being the power of two and the second level subdividing
+   * that range linearly. Allocating and freeing a range are
+   * both constant-time operations, independent of the number
+   * of free blocks. This is not thread-safe.
+   */
+  class DxvkTlsfAllocator {
+    constexpr static uint32_t SlBits  = 4;
+    constexpr static uint32_t SlCount = 1u << SlBits;
+    constexpr static uint32_t FlCount = 64;
+
+    constexpr static uint32_t InvalidBlock = ~0u;
+  public:
+
+    explicit DxvkTlsfAllocator(VkDeviceSize size);
+
+    ~DxvkTlsfAllocator();
+
+    DxvkTlsfAllocator             (const DxvkTlsfAllocator&) = delete;
+    DxvkTlsfAllocator& operator = (const DxvkTlsfAllocator&) = delete;
+
+    /**
+     * \brief Allocates a range
+     *
+     * The size of the returned range is aligned to the
+     * given alignment, and may thus be larger than the
+     * requested size.
+     * \param [in] size Number of bytes to allocate
+     * \param [in] alignment Required alignment
+     * \returns Allocated range, or an invalid
+     *    allocation if no suitable block is free
+     */
+    DxvkSubAllocation alloc(
+            VkDeviceSize          size,
+            VkDeviceSize          alignment);
+
+    /**
+     * \brief Frees a range
+     *
+     * Merges the range with adjacent free blocks.
+     * \param [in] block Block handle of the allocation
+     */
+    void free(
+            uint32_t              block);
+
+    /**
+     * \brief Queries total size of the managed range
+     * \returns Total size, in bytes
+     */
+    VkDeviceSize size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Queries number of free bytes
+     * \returns Total size of all free blocks
+     */
+    VkDeviceSize freeSize() const {
+      return m_freeSize;
+    }
+
+    /**
+     * \brief Checks whether no ranges are allocated
+     * \returns \c true if the entire range is free
+     */
+    bool isEmpty() const {
+      return m_freeSize == m_size;
+    }
+
+    /**
+     * \brief Computes size of the largest free block
+     *
+     * Only needs to scan one free list, so this is
+     * cheap enough to use for statistics.
+     * \returns Size of largest free block, in bytes
+     */
+    VkDeviceSize largestFreeBlock() const;
+
+    /**
+     * \brief Queries size of an allocated block
+     *
+     * \param [in] block Block handle of the allocation
+     * \returns Size of the block, in bytes
+     */
+    VkDeviceSize blockSize(uint32_t block) const {
+      return m_blocks[block].size;
+    }
+
+  private:
+
+    struct Block {
+      VkDeviceSize  offset    = 0;
+      VkDeviceSize  size      = 0;
+      uint32_t      prevPhys  = InvalidBlock;
+      uint32_t      nextPhys  = InvalidBlock;
+      uint32_t      prevFree  = InvalidBlock;
+      uint32_t      nextFree  = InvalidBlock;
+      bool          isFree    = false;
+    };
+
+    VkDeviceSize  m_size      = 0;
+    VkDeviceSize  m_freeSize  = 0;
+
+    std::vector<Block> m_blocks;
+    uint32_t           m_unusedBlocks = InvalidBlock;
+
+    uint64_t                            m_flBitmap = 0;
+    std::array<uint32_t, FlCount>       m_slBitmaps = { };
+    std::array<uint32_t, FlCount * SlCount> m_freeLists;
+
+    uint32_t createBlock(
+            VkDeviceSize          offset,
+            VkDeviceSize          size);
+
+    void destroyBlock(
+            uint32_t              block);
+
+    void insertFreeBlock(
+            uint32_t              block);
+
+    void removeFreeBlock(
+            uint32_t              block);
+
+    uint32_t findFreeBlock(
+            VkDeviceSize          size) const;
+
+    static std::pair<uint32_t, uint32_t> computeListIndex(
+            VkDeviceSize          size);
+
+  };
+
+}
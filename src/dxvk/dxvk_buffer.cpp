@@ -95,6 +95,93 @@ namespace dxvk {
   }
   
   
+  void DxvkBuffer::enableRelocation() {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    if (m_relocatable || !canRelocate())
+      return;
+
+    DxvkMemoryOwner owner;
+    owner.resource = this;
+    owner.type     = DxvkMemoryOwnerType::Buffer;
+
+    m_relocatable = m_memAlloc->setMemoryOwner(m_buffer.memory, owner);
+  }
+
+
+  void DxvkBuffer::disableRelocation() {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    if (!m_relocatable)
+      return;
+
+    m_memAlloc->setMemoryOwner(m_buffer.memory, DxvkMemoryOwner());
+    m_relocatable = false;
+  }
+
+
+  DxvkBufferHandle DxvkBuffer::allocRelocationStorage() {
+    { std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+      if (!m_relocatable || !canRelocate())
+        return DxvkBufferHandle();
+    }
+
+    return allocBuffer(1, false);
+  }
+
+
+  DxvkBufferHandle DxvkBuffer::assignStorage(
+          DxvkBufferHandle&&    storage) {
+    std::unique_lock<sync::Spinlock> freeLock(m_freeMutex);
+
+    // The buffer may have been pinned by another thread
+    // after the relocation storage has been allocated
+    if (!m_relocatable)
+      return DxvkBufferHandle();
+
+    // Transfer ownership to the new allocation so that the
+    // defragmenter does not try to move the old one again
+    DxvkMemoryOwner owner;
+    owner.resource = this;
+    owner.type     = DxvkMemoryOwnerType::Buffer;
+
+    m_memAlloc->setMemoryOwner(m_buffer.memory, DxvkMemoryOwner());
+    m_memAlloc->setMemoryOwner(storage.memory, owner);
+
+    m_physSlice.handle = storage.buffer;
+    m_physSlice.offset = 0;
+    m_physSlice.length = m_physSliceLength;
+    m_physSlice.mapPtr = storage.memory.mapPtr(0);
+
+    return std::exchange(m_buffer, std::move(storage));
+  }
+
+
+  bool DxvkBuffer::canRelocate() const {
+    // Only buffers with exactly one slice that has never been
+    // renamed can be moved without tracking additional state
+    if (!m_memAlloc || m_lazyAlloc || !m_buffers.empty())
+      return false;
+
+    if (!m_freeSlices.empty() || m_physSliceCount != 1)
+      return false;
+
+    if (m_physSlice.handle != m_buffer.buffer)
+      return false;
+
+    // Mapped memory and sparse buffers must stay where they are,
+    // and cached buffer views would keep the old buffer handle.
+    if ((m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+     || (m_info.flags & VK_BUFFER_CREATE_SPARSE_BINDING_BIT))
+      return false;
+
+    return !(m_info.usage & (
+      VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT |
+      VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT));
+  }
+
+
   DxvkBufferHandle DxvkBuffer::allocBuffer(VkDeviceSize sliceCount, bool clear) const {
     VkBufferCreateInfo info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
     info.flags = m_info.flags;
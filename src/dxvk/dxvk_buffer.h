@@ -324,6 +324,50 @@ namespace dxvk {
       return m_import.buffer != VK_NULL_HANDLE;
     }
 
+    /**
+     * \brief Allows the buffer to be relocated
+     *
+     * Registers the buffer with the memory allocator so that
+     * the defragmenter can move it to a different location.
+     * Must only be used for buffers that are only ever accessed
+     * from the CS thread, and whose memory is never mapped.
+     * Has no effect if the buffer cannot be relocated.
+     */
+    void enableRelocation();
+
+    /**
+     * \brief Pins buffer memory
+     *
+     * Prevents the buffer from being relocated. Must be
+     * called before exposing the Vulkan buffer handle.
+     */
+    void disableRelocation();
+
+    /**
+     * \brief Allocates storage for relocation
+     *
+     * Creates a new backing buffer with the same properties
+     * as the current one. Called by the context on the CS
+     * thread when relocating the buffer.
+     * \returns New storage, or a null handle if the buffer
+     *    cannot be relocated in its current state.
+     */
+    DxvkBufferHandle allocRelocationStorage();
+
+    /**
+     * \brief Replaces backing storage
+     *
+     * The caller must copy the buffer contents and keep the
+     * previous storage alive until the GPU is done using it.
+     * Buffer bindings must be updated as with \c rename.
+     * \param [in] storage New backing storage
+     * \returns Previous backing storage, or a null handle
+     *    if the buffer has been pinned in the meantime. In
+     *    that case, \c storage is left unchanged.
+     */
+    DxvkBufferHandle assignStorage(
+            DxvkBufferHandle&&    storage);
+
   private:
 
     Rc<vk::DeviceFn>        m_vkd;
@@ -349,6 +393,8 @@ namespace dxvk {
     std::vector<DxvkBufferHandle>       m_buffers;
     std::vector<DxvkBufferSliceHandle>  m_freeSlices;
 
+    bool                    m_relocatable = false;
+
     alignas(CACHE_LINE_SIZE)
     sync::Spinlock                      m_swapMutex;
     std::vector<DxvkBufferSliceHandle>  m_nextSlices;
@@ -368,6 +414,8 @@ namespace dxvk {
 
     DxvkBufferHandle createSparseBuffer() const;
 
+    bool canRelocate() const;
+
     VkDeviceSize computeSliceAlignment(
             DxvkDevice*           device) const;
     
@@ -811,6 +811,17 @@ namespace dxvk {
     void cmdSetBlendConstants(const float blendConstants[4]) {
       m_vkd->vkCmdSetBlendConstants(m_cmd.execBuffer, blendConstants);
     }
+
+
+    void cmdSetColorBlendState(
+            uint32_t                attachmentCount,
+      const VkBool32*               blendEnables,
+      const VkColorBlendEquationEXT* blendEquations,
+      const VkColorComponentFlags*  writeMasks) {
+      m_vkd->vkCmdSetColorBlendEnableEXT(m_cmd.execBuffer, 0, attachmentCount, blendEnables);
+      m_vkd->vkCmdSetColorBlendEquationEXT(m_cmd.execBuffer, 0, attachmentCount, blendEquations);
+      m_vkd->vkCmdSetColorWriteMaskEXT(m_cmd.execBuffer, 0, attachmentCount, writeMasks);
+    }
     
 
     void cmdSetDepthBiasState(
@@ -890,6 +901,12 @@ namespace dxvk {
     }
 
 
+    void cmdSetPolygonMode(
+            VkPolygonMode           polygonMode) {
+      m_vkd->vkCmdSetPolygonModeEXT(m_cmd.execBuffer, polygonMode);
+    }
+
+
     void cmdSetRasterizerState(
             VkCullModeFlags         cullMode,
             VkFrontFace             frontFace) {
@@ -18,7 +18,8 @@ namespace dxvk {
     m_execAcquires(DxvkCmdBuffer::ExecBuffer),
     m_execBarriers(DxvkCmdBuffer::ExecBuffer),
     m_queryManager(m_common->queryPool()),
-    m_staging     (device, StagingBufferSize) {
+    m_staging     (device, StagingBufferSize),
+    m_stagingFence(new sync::Fence()) {
     // Init framebuffer info with default render pass in case
     // the app does not explicitly bind any render targets
     m_state.om.framebufferInfo = makeFramebufferInfo(m_state.om.renderTargets);
@@ -66,6 +67,11 @@ namespace dxvk {
     // Maintenance5 introduced a bounded BindIndexBuffer function
     if (m_device->features().khrMaintenance5.maintenance5)
       m_features.set(DxvkContextFeature::IndexBufferRobustness);
+
+    // Blend and multisample state are dynamic for all pipelines
+    // if the device supports the required extended dynamic state
+    if (m_device->canUseExtendedDynamicState())
+      m_features.set(DxvkContextFeature::ExtendedDynamicState);
   }
   
   
@@ -99,6 +105,11 @@ namespace dxvk {
 
 
   void DxvkContext::endFrame() {
+    if (m_type == DxvkContextType::Primary) {
+      m_common->memoryManager().updateMemoryBudget();
+      this->relocateResources();
+    }
+
     if (m_descriptorPool->shouldSubmit(true)) {
       m_cmd->trackDescriptorPool(m_descriptorPool, m_descriptorManager);
       m_descriptorPool = m_descriptorManager->getDescriptorPool();
@@ -107,6 +118,11 @@ namespace dxvk {
 
 
   void DxvkContext::flushCommandList(DxvkSubmitStatus* status) {
+    // Staging memory used by this command list can be
+    // reused once the command list has finished executing
+    if (m_staging.endRegion(m_stagingFence, m_stagingFenceValue + 1))
+      m_cmd->queueSignal(m_stagingFence, ++m_stagingFenceValue);
+
     auto cmdList = this->endRecording();
     if (m_type == DxvkContextType::Primary)
       cmdList->setLfx2Aux(m_device->lfx2().VulkanContextBeforeSubmit(m_device->getLfx2VkContext()));
@@ -1842,7 +1858,13 @@ namespace dxvk {
     // Allocate new backing resource
     DxvkBufferSliceHandle prevSlice = buffer->rename(slice);
     m_cmd->freeBufferSlice(buffer, prevSlice);
-    
+
+    this->invalidateBufferBindings(buffer);
+  }
+
+
+  void DxvkContext::invalidateBufferBindings(
+    const Rc<DxvkBuffer>&           buffer) {
     // We also need to update all bindings that the buffer
     // may be bound to either directly or through views.
     VkBufferUsageFlags usage = buffer->info().usage &
@@ -2233,6 +2255,202 @@ namespace dxvk {
   }
 
 
+  void DxvkContext::relocateResources() {
+    DxvkRelocationList relocations = m_common->memoryDefragmenter().getRelocations();
+
+    if (relocations.empty())
+      return;
+
+    this->spillRenderPass(true);
+
+    m_execBarriers.recordCommands(m_cmd);
+
+    // Failing to relocate a resource is not fatal, the
+    // resource will simply stay where it currently is.
+    try {
+      for (const auto& buffer : relocations.buffers)
+        this->relocateBuffer(buffer);
+
+      for (const auto& image : relocations.images)
+        this->relocateImage(image);
+    } catch (const DxvkError& e) {
+      Logger::warn(str::format("DxvkContext: Failed to relocate resource: ", e.message()));
+    }
+  }
+
+
+  void DxvkContext::relocateBuffer(
+    const Rc<DxvkBuffer>&           buffer) {
+    DxvkBufferHandle storage = buffer->allocRelocationStorage();
+
+    // The buffer may have been renamed since it was registered,
+    // in which case we can't move it. Pin it so that the
+    // defragmenter can give up on the chunk.
+    if (!storage.buffer) {
+      buffer->disableRelocation();
+      return;
+    }
+
+    DxvkBufferSliceHandle srcSlice = buffer->getSliceHandle();
+    DxvkBufferSliceHandle dstSlice = srcSlice;
+    dstSlice.handle = storage.buffer;
+    dstSlice.offset = 0;
+
+    VkBufferCopy2 copyRegion = { VK_STRUCTURE_TYPE_BUFFER_COPY_2 };
+    copyRegion.srcOffset = srcSlice.offset;
+    copyRegion.dstOffset = dstSlice.offset;
+    copyRegion.size      = srcSlice.length;
+
+    VkCopyBufferInfo2 copyInfo = { VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2 };
+    copyInfo.srcBuffer = srcSlice.handle;
+    copyInfo.dstBuffer = dstSlice.handle;
+    copyInfo.regionCount = 1;
+    copyInfo.pRegions = &copyRegion;
+
+    m_cmd->cmdCopyBuffer(DxvkCmdBuffer::ExecBuffer, &copyInfo);
+
+    m_execBarriers.accessBuffer(srcSlice,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_READ_BIT,
+      buffer->info().stages,
+      buffer->info().access);
+
+    m_execBarriers.accessBuffer(dstSlice,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      buffer->info().stages,
+      buffer->info().access);
+
+    // Keep the old buffer alive until the copy has completed. If
+    // the buffer got pinned in the meantime, its handle may have
+    // been exposed already, so keep it and retire the new storage.
+    DxvkBufferHandle retiredBuffer = buffer->assignStorage(std::move(storage));
+    bool relocated = retiredBuffer.buffer != VK_NULL_HANDLE;
+
+    if (!relocated)
+      retiredBuffer = std::move(storage);
+
+    Rc<DxvkRetiredStorage> retired = new DxvkRetiredStorage(
+      m_device->vkd(), std::move(retiredBuffer));
+
+    m_cmd->trackResource<DxvkAccess::None>(retired);
+    m_cmd->trackResource<DxvkAccess::Write>(buffer);
+
+    if (relocated)
+      this->invalidateBufferBindings(buffer);
+  }
+
+
+  void DxvkContext::relocateImage(
+    const Rc<DxvkImage>&            image) {
+    DxvkPhysicalImage storage = image->allocRelocationStorage();
+
+    if (!storage.image) {
+      image->disableRelocation();
+      return;
+    }
+
+    VkImageSubresourceRange subresources = image->getAvailableSubresources();
+
+    VkImageLayout srcLayout = image->pickLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    VkImageLayout dstLayout = image->pickLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // Barriers are recorded using the current image handle,
+    // so the old image needs to be transitioned before the
+    // new storage is assigned to the image.
+    if (srcLayout != image->info().layout) {
+      m_execAcquires.accessImage(
+        image, subresources,
+        image->info().layout,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        srcLayout,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT);
+      m_execAcquires.recordCommands(m_cmd);
+    }
+
+    std::vector<VkImageView> retiredViews;
+    DxvkPhysicalImage retiredImage = image->assignStorage(std::move(storage), retiredViews);
+
+    if (!retiredImage.image) {
+      // The image got pinned, undo the layout transition
+      // and destroy the storage that we just allocated.
+      if (srcLayout != image->info().layout) {
+        m_execBarriers.accessImage(
+          image, subresources,
+          srcLayout,
+          VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+          image->info().layout,
+          image->info().stages,
+          image->info().access);
+      }
+
+      auto vk = m_device->vkd();
+      vk->vkDestroyImage(vk->device(), storage.image, nullptr);
+      return;
+    }
+
+    m_execAcquires.accessImage(
+      image, subresources,
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+      dstLayout,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT);
+    m_execAcquires.recordCommands(m_cmd);
+
+    for (uint32_t i = 0; i < image->info().mipLevels; i++) {
+      VkImageSubresourceLayers layers = { };
+      layers.mipLevel       = i;
+      layers.baseArrayLayer = 0;
+      layers.layerCount     = image->info().numLayers;
+
+      VkExtent3D extent = image->mipLevelExtent(i);
+
+      for (auto aspects = subresources.aspectMask; aspects; ) {
+        auto aspect = vk::getNextAspect(aspects);
+
+        VkImageCopy2 copyRegion = { VK_STRUCTURE_TYPE_IMAGE_COPY_2 };
+        copyRegion.srcSubresource = layers;
+        copyRegion.srcSubresource.aspectMask = aspect;
+        copyRegion.dstSubresource = layers;
+        copyRegion.dstSubresource.aspectMask = aspect;
+        copyRegion.extent = extent;
+
+        VkCopyImageInfo2 copyInfo = { VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2 };
+        copyInfo.srcImage = retiredImage.image;
+        copyInfo.srcImageLayout = srcLayout;
+        copyInfo.dstImage = image->handle();
+        copyInfo.dstImageLayout = dstLayout;
+        copyInfo.regionCount = 1;
+        copyInfo.pRegions = &copyRegion;
+
+        m_cmd->cmdCopyImage(DxvkCmdBuffer::ExecBuffer, &copyInfo);
+      }
+    }
+
+    m_execBarriers.accessImage(
+      image, subresources,
+      dstLayout,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      image->info().layout,
+      image->info().stages,
+      image->info().access);
+
+    Rc<DxvkRetiredStorage> retired = new DxvkRetiredStorage(
+      m_device->vkd(), std::move(retiredImage), std::move(retiredViews));
+
+    m_cmd->trackResource<DxvkAccess::None>(retired);
+    m_cmd->trackResource<DxvkAccess::Write>(image);
+
+    // Views of the image may be bound to any shader stage
+    m_descriptorState.dirtyViews(
+      VK_SHADER_STAGE_ALL_GRAPHICS |
+      VK_SHADER_STAGE_COMPUTE_BIT);
+  }
+
+
   void DxvkContext::updateBuffer(
     const Rc<DxvkBuffer>&           buffer,
           VkDeviceSize              offset,
@@ -4509,6 +4727,8 @@ namespace dxvk {
         DxvkContextFlag::GpDirtyBlendConstants,
         DxvkContextFlag::GpDirtyStencilRef,
         DxvkContextFlag::GpDirtyMultisampleState,
+        DxvkContextFlag::GpDirtyBlendState,
+        DxvkContextFlag::GpDirtyPolygonMode,
         DxvkContextFlag::GpDirtyRasterizerState,
         DxvkContextFlag::GpDirtyViewport,
         DxvkContextFlag::GpDirtyDepthBias,
@@ -4941,6 +5161,8 @@ namespace dxvk {
       DxvkContextFlag::GpDirtyBlendConstants,
       DxvkContextFlag::GpDirtyStencilRef,
       DxvkContextFlag::GpDirtyMultisampleState,
+      DxvkContextFlag::GpDirtyBlendState,
+      DxvkContextFlag::GpDirtyPolygonMode,
       DxvkContextFlag::GpDirtyRasterizerState,
       DxvkContextFlag::GpDirtyViewport,
       DxvkContextFlag::GpDirtyDepthBias,
@@ -5017,9 +5239,12 @@ namespace dxvk {
                 DxvkContextFlag::GpDynamicStencilRef,
                 DxvkContextFlag::GpDynamicMultisampleState,
                 DxvkContextFlag::GpDynamicRasterizerState,
+                DxvkContextFlag::GpDynamicBlendState,
+                DxvkContextFlag::GpDynamicPolygonMode,
                 DxvkContextFlag::GpIndependentSets);
     
     m_flags.set(m_state.gp.state.useDynamicBlendConstants()
+             || m_features.test(DxvkContextFeature::ExtendedDynamicState)
       ? DxvkContextFlag::GpDynamicBlendConstants
       : DxvkContextFlag::GpDirtyBlendConstants);
     
@@ -5028,7 +5253,7 @@ namespace dxvk {
       : DxvkContextFlag::GpDirtyRasterizerState);
 
     // Retrieve and bind actual Vulkan pipeline handle
-    auto pipelineInfo = m_state.gp.pipeline->getPipelineHandle(m_state.gp.state);
+    auto pipelineInfo = m_state.gp.pipeline->getPipelineHandle(m_state.gp.state, m_gpInstanceCache);
 
     if (unlikely(!pipelineInfo.first))
       return false;
@@ -5071,6 +5296,23 @@ namespace dxvk {
         DxvkContextFlag::GpDirtyMultisampleState);
     }
 
+    // With extended dynamic state, blend and multisample state are
+    // always dynamic, and so is the polygon mode for fast pipelines
+    if (m_features.test(DxvkContextFeature::ExtendedDynamicState)) {
+      m_flags.set(
+        DxvkContextFlag::GpDynamicBlendState,
+        DxvkContextFlag::GpDynamicMultisampleState,
+        DxvkContextFlag::GpDirtyBlendState,
+        DxvkContextFlag::GpDirtyMultisampleState);
+
+      if (pipelineInfo.second == DxvkGraphicsPipelineType::FastPipeline
+       && DxvkGraphicsPipelinePreRasterizationState::useDynamicPolygonMode(m_device.ptr(), m_state.gp.state)) {
+        m_flags.set(
+          DxvkContextFlag::GpDynamicPolygonMode,
+          DxvkContextFlag::GpDirtyPolygonMode);
+      }
+    }
+
     // If necessary, dirty descriptor sets due to layout incompatibilities
     bool newIndependentSets = m_flags.test(DxvkContextFlag::GpIndependentSets);
 
@@ -5796,6 +6038,53 @@ namespace dxvk {
         m_cmd->cmdSetAlphaToCoverageState(m_state.gp.state.ms.enableAlphaToCoverage());
     }
 
+    if (unlikely(m_flags.all(DxvkContextFlag::GpDirtyBlendState,
+                             DxvkContextFlag::GpDynamicBlendState))) {
+      m_flags.clr(DxvkContextFlag::GpDirtyBlendState);
+
+      // Compute attachment blend state the same way
+      // we would when compiling the pipeline
+      uint32_t outputMask = DxvkGraphicsPipelineFragmentOutputState::getOutputMask(
+        m_state.gp.state, m_state.gp.shaders.fs.ptr());
+
+      std::array<VkBool32,                MaxNumRenderTargets> blendEnables;
+      std::array<VkColorBlendEquationEXT, MaxNumRenderTargets> blendEquations;
+      std::array<VkColorComponentFlags,   MaxNumRenderTargets> writeMasks;
+
+      uint32_t attachmentCount = 0;
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (m_state.gp.state.rt.getColorFormat(i))
+          attachmentCount = i + 1;
+      }
+
+      for (uint32_t i = 0; i < attachmentCount; i++) {
+        VkPipelineColorBlendAttachmentState attachment =
+          DxvkGraphicsPipelineFragmentOutputState::getAttachmentState(
+            m_state.gp.state, outputMask, i);
+
+        blendEnables[i] = attachment.blendEnable;
+        blendEquations[i].srcColorBlendFactor = attachment.srcColorBlendFactor;
+        blendEquations[i].dstColorBlendFactor = attachment.dstColorBlendFactor;
+        blendEquations[i].colorBlendOp        = attachment.colorBlendOp;
+        blendEquations[i].srcAlphaBlendFactor = attachment.srcAlphaBlendFactor;
+        blendEquations[i].dstAlphaBlendFactor = attachment.dstAlphaBlendFactor;
+        blendEquations[i].alphaBlendOp        = attachment.alphaBlendOp;
+        writeMasks[i] = attachment.colorWriteMask;
+      }
+
+      if (attachmentCount) {
+        m_cmd->cmdSetColorBlendState(attachmentCount,
+          blendEnables.data(), blendEquations.data(), writeMasks.data());
+      }
+    }
+
+    if (unlikely(m_flags.all(DxvkContextFlag::GpDirtyPolygonMode,
+                             DxvkContextFlag::GpDynamicPolygonMode))) {
+      m_flags.clr(DxvkContextFlag::GpDirtyPolygonMode);
+      m_cmd->cmdSetPolygonMode(m_state.gp.state.rs.polygonMode());
+    }
+
     if (unlikely(m_flags.all(DxvkContextFlag::GpDirtyBlendConstants,
                              DxvkContextFlag::GpDynamicBlendConstants))) {
       m_flags.clr(DxvkContextFlag::GpDirtyBlendConstants);
@@ -5967,6 +6256,13 @@ namespace dxvk {
     if (m_flags.test(DxvkContextFlag::DirtyDrawBuffer) && Indirect)
       this->trackDrawBuffer();
 
+    // Base pipelines get replaced by optimized pipelines depending on
+    // how often they are used. Re-bind the pipeline once available.
+    if (unlikely(m_flags.test(DxvkContextFlag::GpIndependentSets))) {
+      if (m_state.gp.pipeline->trackBasePipelineDraw(m_gpInstanceCache.instance))
+        m_flags.set(DxvkContextFlag::GpDirtyPipelineState);
+    }
+
     return true;
   }
   
@@ -6409,6 +6705,8 @@ namespace dxvk {
       DxvkContextFlag::GpDirtyBlendConstants,
       DxvkContextFlag::GpDirtyStencilRef,
       DxvkContextFlag::GpDirtyMultisampleState,
+      DxvkContextFlag::GpDirtyBlendState,
+      DxvkContextFlag::GpDirtyPolygonMode,
       DxvkContextFlag::GpDirtyRasterizerState,
       DxvkContextFlag::GpDirtyViewport,
       DxvkContextFlag::GpDirtyDepthBias,
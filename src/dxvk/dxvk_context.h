@@ -21,7 +21,7 @@ namespace dxvk {
    * recorded.
    */
   class DxvkContext : public RcObject {
-    constexpr static VkDeviceSize StagingBufferSize = 4ull << 20;
+    constexpr static VkDeviceSize StagingBufferSize = 16ull << 20;
   public:
     
     DxvkContext(const Rc<DxvkDevice>& device, DxvkContextType type);
@@ -1424,6 +1424,8 @@ namespace dxvk {
 
     DxvkGpuQueryManager     m_queryManager;
     DxvkStagingBuffer       m_staging;
+    Rc<sync::Fence>         m_stagingFence;
+    uint64_t                m_stagingFenceValue = 0ull;
     
     DxvkGlobalPipelineBarrier m_globalRoGraphicsBarrier;
     DxvkGlobalPipelineBarrier m_globalRwGraphicsBarrier;
@@ -1442,6 +1444,8 @@ namespace dxvk {
     std::array<DxvkGraphicsPipeline*, 4096> m_gpLookupCache = { };
     std::array<DxvkComputePipeline*,   256> m_cpLookupCache = { };
 
+    DxvkGraphicsPipelineInstanceCache m_gpInstanceCache;
+
     Lfx2Frame m_lfx2Frame = {};
     uint64_t m_frameCsTime = 0;
     uint64_t m_minQueuingDelay = 0;
@@ -1603,6 +1607,17 @@ namespace dxvk {
 
     void flushSharedImages();
 
+    void relocateResources();
+
+    void relocateBuffer(
+      const Rc<DxvkBuffer>&           buffer);
+
+    void relocateImage(
+      const Rc<DxvkImage>&            image);
+
+    void invalidateBufferBindings(
+      const Rc<DxvkBuffer>&           buffer);
+
     void startRenderPass();
     void spillRenderPass(bool suspend);
     
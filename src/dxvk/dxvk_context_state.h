@@ -20,7 +20,7 @@ namespace dxvk {
    * of the graphics and compute pipelines
    * has changed and/or needs to be updated.
    */
-  enum class DxvkContextFlag : uint32_t  {
+  enum class DxvkContextFlag : uint64_t  {
     GpRenderPassBound,          ///< Render pass is currently bound
     GpRenderPassSuspended,      ///< Render pass is currently suspended
     GpXfbActive,                ///< Transform feedback is enabled
@@ -37,6 +37,8 @@ namespace dxvk {
     GpDirtyStencilRef,          ///< Stencil reference has changed
     GpDirtyMultisampleState,    ///< Multisample state has changed
     GpDirtyRasterizerState,     ///< Cull mode and front face have changed
+    GpDirtyBlendState,          ///< Color blend state has changed
+    GpDirtyPolygonMode,         ///< Polygon mode has changed
     GpDirtyViewport,            ///< Viewport state has changed
     GpDirtySpecConstants,       ///< Graphics spec constants are out of date
     GpDynamicBlendConstants,    ///< Blend constants are dynamic
@@ -46,6 +48,8 @@ namespace dxvk {
     GpDynamicStencilRef,        ///< Stencil reference is dynamic
     GpDynamicMultisampleState,  ///< Multisample state is dynamic
     GpDynamicRasterizerState,   ///< Cull mode and front face are dynamic
+    GpDynamicBlendState,        ///< Color blend state is dynamic
+    GpDynamicPolygonMode,       ///< Polygon mode is dynamic
     GpDynamicVertexStrides,     ///< Vertex buffer strides are dynamic
     GpIndependentSets,          ///< Graphics pipeline layout was created with independent sets
     
@@ -66,6 +70,7 @@ namespace dxvk {
     TrackGraphicsPipeline,
     VariableMultisampleRate,
     IndexBufferRobustness,
+    ExtendedDynamicState,
     FeatureCount
   };
 
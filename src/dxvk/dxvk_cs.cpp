@@ -18,69 +18,83 @@ namespace dxvk {
 
 
   void DxvkCsChunk::executeAll(DxvkContext* ctx) {
-    auto cmd = m_head;
-    
     if (m_flags.test(DxvkCsChunkFlag::SingleUse)) {
+      this->executeCommands<true>(ctx);
       m_commandOffset = 0;
-      
-      while (cmd != nullptr) {
-        auto next = cmd->next();
-        cmd->exec(ctx);
-        cmd->~DxvkCsCmd();
-        cmd = next;
-      }
-
-      m_head = nullptr;
-      m_tail = nullptr;
     } else {
-      while (cmd != nullptr) {
-        cmd->exec(ctx);
-        cmd = cmd->next();
-      }
+      this->executeCommands<false>(ctx);
     }
   }
   
   
   void DxvkCsChunk::reset() {
-    auto cmd = m_head;
+    size_t offset = 0;
 
-    while (cmd != nullptr) {
-      auto next = cmd->next();
-      cmd->~DxvkCsCmd();
-      cmd = next;
+    while (offset < m_commandOffset) {
+      auto header = reinterpret_cast<const DxvkCsCmdHeader*>(m_data + offset);
+      auto funcs = header->funcs;
+
+      funcs->destroy(m_data + offset + funcs->payloadOffset);
+      offset += funcs->size;
     }
-    
-    m_head = nullptr;
-    m_tail = nullptr;
 
     m_commandOffset = 0;
   }
 
+
+  template<bool Destroy>
+  void DxvkCsChunk::executeCommands(DxvkContext* ctx) {
+    size_t offset = 0;
+
+    while (offset < m_commandOffset) {
+      auto header = reinterpret_cast<const DxvkCsCmdHeader*>(m_data + offset);
+      auto funcs = header->funcs;
+
+      void* payload = m_data + offset + funcs->payloadOffset;
+      funcs->exec(payload, ctx);
+
+      if constexpr (Destroy)
+        funcs->destroy(payload);
+
+      offset += funcs->size;
+    }
+  }
+
   void DxvkCsChunk::finalize() {
     m_queuedTimestamp = high_resolution_clock::now();
   }
 
 
   DxvkCsChunkPool::DxvkCsChunkPool() {
-    
+    for (uint32_t i = 0; i < MagazineCount; i++)
+      pushMagazine(m_emptyList, &m_magazines[i]);
   }
   
   
   DxvkCsChunkPool::~DxvkCsChunkPool() {
-    for (DxvkCsChunk* chunk : m_chunks)
-      delete chunk;
+    for (const auto& magazine : m_magazines) {
+      for (uint32_t i = 0; i < magazine.count; i++)
+        delete magazine.chunks[i];
+    }
+
+    for (const auto& cache : m_caches) {
+      for (uint32_t i = 0; i < cache.count; i++)
+        delete cache.chunks[i];
+    }
   }
   
   
   DxvkCsChunk* DxvkCsChunkPool::allocChunk(DxvkCsChunkFlags flags) {
     DxvkCsChunk* chunk = nullptr;
 
-    { std::lock_guard<dxvk::mutex> lock(m_mutex);
-      
-      if (m_chunks.size() != 0) {
-        chunk = m_chunks.back();
-        m_chunks.pop_back();
-      }
+    ThreadCache& cache = getThreadCache();
+
+    if (likely(cache.lock.try_lock())) {
+      chunk = cache.count
+        ? cache.chunks[--cache.count]
+        : allocFromGlobalPool(cache);
+
+      cache.lock.unlock();
     }
     
     if (!chunk)
@@ -93,18 +107,124 @@ namespace dxvk {
   
   void DxvkCsChunkPool::freeChunk(DxvkCsChunk* chunk) {
     chunk->reset();
-    
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-    m_chunks.push_back(chunk);
+
+    ThreadCache& cache = getThreadCache();
+
+    if (likely(cache.lock.try_lock())) {
+      if (cache.count == cache.chunks.size())
+        freeToGlobalPool(cache);
+
+      cache.chunks[cache.count++] = chunk;
+      cache.lock.unlock();
+    } else {
+      // Only happens if another thread mapped to the
+      // same cache is accessing it at the same time
+      delete chunk;
+    }
+  }
+
+
+  DxvkCsChunkPool::ThreadCache& DxvkCsChunkPool::getThreadCache() {
+    // Thread IDs are not necessarily consecutive, so hash
+    // them in order to distribute threads across caches
+    uint32_t hash = dxvk::this_thread::get_id() * 0x9e3779b1u;
+    return m_caches[hash >> (32 - CacheCountLog2)];
+  }
+
+
+  DxvkCsChunkPool::Magazine* DxvkCsChunkPool::popMagazine(std::atomic<uint64_t>& list) {
+    uint64_t head = list.load(std::memory_order_acquire);
+    uint64_t next;
+
+    do {
+      uint32_t index = uint32_t(head & ListIndexMask);
+
+      if (!index)
+        return nullptr;
+
+      // The tag prevents the exchange from succeeding if the
+      // magazine was popped and pushed again in the meantime
+      uint64_t tag = (head & ~ListIndexMask) + (1ull << 32);
+      next = tag | m_magazines[index - 1].next.load(std::memory_order_relaxed);
+    } while (!list.compare_exchange_weak(head, next,
+      std::memory_order_acquire, std::memory_order_acquire));
+
+    return &m_magazines[uint32_t(head & ListIndexMask) - 1];
+  }
+
+
+  void DxvkCsChunkPool::pushMagazine(std::atomic<uint64_t>& list, Magazine* magazine) {
+    uint32_t index = uint32_t(magazine - m_magazines.data()) + 1;
+
+    uint64_t head = list.load(std::memory_order_relaxed);
+    uint64_t next;
+
+    do {
+      magazine->next.store(uint32_t(head & ListIndexMask), std::memory_order_relaxed);
+      next = ((head & ~ListIndexMask) + (1ull << 32)) | index;
+    } while (!list.compare_exchange_weak(head, next,
+      std::memory_order_release, std::memory_order_relaxed));
+  }
+
+
+  DxvkCsChunk* DxvkCsChunkPool::allocFromGlobalPool(ThreadCache& cache) {
+    Magazine* magazine = popMagazine(m_fullList);
+
+    if (!magazine)
+      return nullptr;
+
+    for (uint32_t i = 0; i < magazine->count; i++)
+      cache.chunks[cache.count++] = magazine->chunks[i];
+
+    magazine->count = 0;
+    pushMagazine(m_emptyList, magazine);
+
+    return cache.count ? cache.chunks[--cache.count] : nullptr;
+  }
+
+
+  void DxvkCsChunkPool::freeToGlobalPool(ThreadCache& cache) {
+    Magazine* magazine = popMagazine(m_emptyList);
+
+    // Return the oldest half of the cache in one batch. If all
+    // magazines are in use, the pool is at capacity, so free
+    // the chunks instead of retaining more memory.
+    for (uint32_t i = 0; i < MagazineSize; i++) {
+      if (magazine)
+        magazine->chunks[i] = cache.chunks[i];
+      else
+        delete cache.chunks[i];
+    }
+
+    for (uint32_t i = MagazineSize; i < cache.count; i++)
+      cache.chunks[i - MagazineSize] = cache.chunks[i];
+
+    cache.count -= MagazineSize;
+
+    if (magazine) {
+      magazine->count = MagazineSize;
+      pushMagazine(m_fullList, magazine);
+    }
   }
   
   
   DxvkCsThread::DxvkCsThread(
     const Rc<DxvkDevice>&   device,
     const Rc<DxvkContext>&  context)
-  : m_device(device), m_context(context),
-    m_thread([this] { threadFunc(); }) {
-    
+  : m_device(device), m_context(context) {
+    int32_t spinCount = device->config().csThreadSpinCount;
+
+    // Spinning only makes sense if the application thread and
+    // the CS thread are likely to run on separate cores
+    if (spinCount < 0)
+      spinCount = dxvk::thread::hardware_concurrency() > 4 ? 256 : 0;
+
+    m_spinCount = uint32_t(spinCount);
+
+    for (uint64_t i = 0; i < QueueSize; i++)
+      m_queue[i].seq.store(i, std::memory_order_relaxed);
+
+    m_thread = dxvk::thread([this] { threadFunc(); });
   }
   
   
@@ -119,14 +239,33 @@ namespace dxvk {
   
   
   uint64_t DxvkCsThread::dispatchChunk(DxvkCsChunkRef&& chunk) {
-    uint64_t seq;
+    uint64_t seq = ++m_chunksDispatched;
+    uint64_t pos = seq - 1;
 
-    { std::unique_lock<dxvk::mutex> lock(m_mutex);
-      seq = ++m_chunksDispatched;
-      m_chunksQueued.push_back(std::move(chunk));
+    QueueEntry& entry = m_queue[pos % QueueSize];
+
+    if (unlikely(entry.seq.load(std::memory_order_acquire) != pos)) {
+      // The queue is full, wait for the chunk that previously
+      // occupied this entry to be executed before reusing it
+      this->synchronize(seq - QueueSize);
+
+      sync::spin(200, [&entry, pos] {
+        return entry.seq.load(std::memory_order_acquire) == pos;
+      });
     }
-    
-    m_condOnAdd.notify_one();
+
+    entry.chunk = std::move(chunk);
+    entry.seq.store(seq);
+
+    // Only take the lock if the CS thread is actually asleep.
+    // This pairs with the store in waitForChunk, both being
+    // sequentially consistent ensures that either we see the
+    // flag here, or the CS thread sees the new chunk.
+    if (m_consumerWaiting.load()) {
+      { std::unique_lock<dxvk::mutex> lock(m_mutex); }
+      m_condOnAdd.notify_one();
+    }
+
     return seq;
   }
   
@@ -143,10 +282,22 @@ namespace dxvk {
 
       auto t0 = dxvk::high_resolution_clock::now();
 
-      { std::unique_lock<dxvk::mutex> lock(m_counterMutex);
+      bool done = false;
+
+      for (uint32_t i = 0; i < m_spinCount && !done; i++) {
+        sync::pause();
+        done = m_chunksExecuted.load(std::memory_order_acquire) >= seq;
+      }
+
+      if (!done) {
+        std::unique_lock<dxvk::mutex> lock(m_counterMutex);
+        m_syncWaiters += 1;
+
         m_condOnSync.wait(lock, [this, seq] {
           return m_chunksExecuted.load() >= seq;
         });
+
+        m_syncWaiters -= 1;
       }
 
       auto t1 = dxvk::high_resolution_clock::now();
@@ -156,56 +307,83 @@ namespace dxvk {
       m_device->addStatCtr(DxvkStatCounter::CsSyncTicks, ticks.count());
     }
   }
+
+
+  bool DxvkCsThread::waitForChunk(
+          QueueEntry&           entry,
+          uint64_t              seq) {
+    if (entry.seq.load(std::memory_order_acquire) == seq)
+      return true;
+
+    for (uint32_t i = 0; i < m_spinCount; i++) {
+      sync::pause();
+
+      if (entry.seq.load(std::memory_order_acquire) == seq) {
+        m_context->addStatCtr(DxvkStatCounter::CsSpinHitCount, 1);
+        return true;
+      }
+    }
+
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+    m_consumerWaiting.store(true);
+
+    m_condOnAdd.wait(lock, [this, &entry, seq] {
+      return (entry.seq.load() == seq)
+          || (m_stopped.load());
+    });
+
+    m_consumerWaiting.store(false, std::memory_order_relaxed);
+    m_context->addStatCtr(DxvkStatCounter::CsWakeupCount, 1);
+
+    return entry.seq.load(std::memory_order_acquire) == seq;
+  }
+
+
+  void DxvkCsThread::notifySync() {
+    // Same pattern as chunk dispatch, only wake up
+    // threads in synchronize if there are any.
+    if (m_syncWaiters.load()) {
+      { std::unique_lock<dxvk::mutex> lock(m_counterMutex); }
+      m_condOnSync.notify_all();
+    }
+  }
   
   
   void DxvkCsThread::threadFunc() {
     env::setThreadName("dxvk-cs");
 
-    // Local chunk queue, we use two queues and swap between
-    // them in order to potentially reduce lock contention.
-    std::vector<DxvkCsChunkRef> chunks;
-
     high_resolution_clock::time_point lastFinish;
 
+    uint64_t pos = 0;
+
     try {
-      while (!m_stopped.load()) {
-        { std::unique_lock<dxvk::mutex> lock(m_mutex);
-
-          m_condOnAdd.wait(lock, [this] {
-            return (!m_chunksQueued.empty())
-                || (m_stopped.load());
-          });
-
-          std::swap(chunks, m_chunksQueued);
-        }
-
-        for (auto& chunk : chunks) {
-          m_context->addStatCtr(DxvkStatCounter::CsChunkCount, 1);
-          m_context->tryBeginLfx2FrameImplicit(false);
-          high_resolution_clock::time_point start = high_resolution_clock::now();
-          chunk->executeAll(m_context.ptr());
-          high_resolution_clock::time_point end = high_resolution_clock::now();
-          m_context->recordChunkExecutionTiming(
-              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
-              std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(
-                  lastFinish - chunk->getQueuedTimestamp()).count(), 0LL)
-          );
-          lastFinish = end;
-
-          // Use a separate mutex for the chunk counter, this
-          // will only ever be contested if synchronization is
-          // actually necessary.
-          { std::unique_lock<dxvk::mutex> lock(m_counterMutex);
-            m_chunksExecuted += 1;
-            m_condOnSync.notify_one();
-          }
-
-          // Explicitly free chunk here to release
-          // references to any resources held by it
-          chunk = DxvkCsChunkRef();
-        }
-
-        chunks.clear();
+      while (!m_stopped.load(std::memory_order_relaxed)) {
+        QueueEntry& entry = m_queue[pos % QueueSize];
+
+        if (!waitForChunk(entry, pos + 1))
+          break;
+
+        DxvkCsChunkRef chunk = std::move(entry.chunk);
+        entry.seq.store(pos + QueueSize, std::memory_order_release);
+
+        m_context->addStatCtr(DxvkStatCounter::CsChunkCount, 1);
+        m_context->tryBeginLfx2FrameImplicit(false);
+        high_resolution_clock::time_point start = high_resolution_clock::now();
+        chunk->executeAll(m_context.ptr());
+        high_resolution_clock::time_point end = high_resolution_clock::now();
+        m_context->recordChunkExecutionTiming(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+            std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                lastFinish - chunk->getQueuedTimestamp()).count(), 0LL)
+        );
+        lastFinish = end;
+
+        m_chunksExecuted.store(++pos);
+        notifySync();
+
+        // Explicitly free chunk here to release
+        // references to any resources held by it
+        chunk = DxvkCsChunkRef();
       }
     } catch (const DxvkError& e) {
       Logger::err("Exception on CS thread!");
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
@@ -7,79 +8,103 @@
 
 #include "../util/thread.h"
 
+#include "../util/sync/sync_spinlock.h"
+
 #include "dxvk_device.h"
 #include "dxvk_context.h"
 
 namespace dxvk {
   
   /**
-   * \brief Command stream operation
+   * \brief Command function table
    * 
-   * An abstract representation of an operation
-   * that can be recorded into a command list.
+   * Stores type-specific functions to execute and destroy
+   * a command, as well as the layout of the command within
+   * a chunk. The address of the table acts as the opcode of
+   * the command, and is the only data stored per command
+   * in addition to the payload itself.
    */
-  class DxvkCsCmd {
-    
+  struct DxvkCsCmdFuncs {
+    void (*exec)    (void* payload, DxvkContext* ctx);
+    void (*destroy) (void* payload);
+    uint32_t payloadOffset;
+    uint32_t size;
+  };
+
+
+  /**
+   * \brief Command header
+   * 
+   * Commands are stored back to back in a chunk, so
+   * the size stored in the function table is used to
+   * find the next command. No next pointer is needed.
+   */
+  struct DxvkCsCmdHeader {
+    const DxvkCsCmdFuncs* funcs;
+  };
+
+  constexpr size_t DxvkCsCmdAlignment = alignof(DxvkCsCmdHeader);
+
+
+  /**
+   * \brief Command layout
+   * 
+   * Computes offset and size of a command with the given
+   * payload type. Commands are aligned to the header size,
+   * or the payload alignment if that is larger.
+   */
+  template<typename P>
+  struct DxvkCsCmdLayout {
+    constexpr static size_t Alignment     = std::max(alignof(P), DxvkCsCmdAlignment);
+    constexpr static size_t PayloadOffset = align(sizeof(DxvkCsCmdHeader), alignof(P));
+    constexpr static size_t Size          = align(PayloadOffset + sizeof(P), DxvkCsCmdAlignment);
+  };
+
+
+  /**
+   * \brief No-op command
+   * 
+   * Used to pad the command stream in case a
+   * command requires a larger alignment.
+   */
+  class DxvkCsNopCmd {
+
   public:
-    
-    virtual ~DxvkCsCmd() { }
-    
-    /**
-     * \brief Retrieves next command in a command chain
-     * 
-     * This can be used to quickly iterate
-     * over commands within a chunk.
-     * \returns Pointer the next command
-     */
-    DxvkCsCmd* next() const {
-      return m_next;
-    }
-    
-    /**
-     * \brief Sets next command in a command chain
-     * \param [in] next Next command
-     */
-    void setNext(DxvkCsCmd* next) {
-      m_next = next;
-    }
-    
-    /**
-     * \brief Executes embedded commands
-     * \param [in] ctx The target context
-     */
-    virtual void exec(DxvkContext* ctx) = 0;
-    
-  private:
-    
-    DxvkCsCmd* m_next = nullptr;
-    
+
+    static void exec(void*, DxvkContext*) { }
+
+    static void destroy(void*) { }
+
+    constexpr static DxvkCsCmdFuncs Funcs = { &exec, &destroy,
+      uint32_t(sizeof(DxvkCsCmdHeader)), uint32_t(sizeof(DxvkCsCmdHeader)) };
+
   };
   
   
   /**
    * \brief Typed command
    * 
-   * Stores a function object which is
-   * used to execute an embedded command.
+   * Provides the function table for a function
+   * object which is used as the command payload.
    */
   template<typename T>
-  class alignas(16) DxvkCsTypedCmd : public DxvkCsCmd {
+  class DxvkCsTypedCmd {
     
   public:
-    
-    DxvkCsTypedCmd(T&& cmd)
-    : m_command(std::move(cmd)) { }
-    
-    DxvkCsTypedCmd             (DxvkCsTypedCmd&&) = delete;
-    DxvkCsTypedCmd& operator = (DxvkCsTypedCmd&&) = delete;
-    
-    void exec(DxvkContext* ctx) {
-      m_command(ctx);
+
+    using Payload = T;
+    using Layout  = DxvkCsCmdLayout<Payload>;
+
+    static void exec(void* payload, DxvkContext* ctx) {
+      (*static_cast<Payload*>(payload))(ctx);
     }
-    
-  private:
-    
-    T m_command;
+
+    static void destroy(void* payload) {
+      static_cast<Payload*>(payload)->~Payload();
+    }
+
+    constexpr static DxvkCsCmdFuncs Funcs = { &exec, &destroy,
+      uint32_t(Layout::PayloadOffset), uint32_t(Layout::Size) };
     
   };
 
@@ -92,30 +117,33 @@ namespace dxvk {
    * submitting the command to a cs chunk.
    */
   template<typename T, typename M>
-  class alignas(16) DxvkCsDataCmd : public DxvkCsCmd {
+  class DxvkCsDataCmd {
 
   public:
 
-    template<typename... Args>
-    DxvkCsDataCmd(T&& cmd, Args&&... args)
-    : m_command (std::move(cmd)),
-      m_data    (std::forward<Args>(args)...) { }
-    
-    DxvkCsDataCmd             (DxvkCsDataCmd&&) = delete;
-    DxvkCsDataCmd& operator = (DxvkCsDataCmd&&) = delete;
+    struct Payload {
+      template<typename... Args>
+      Payload(T&& cmd, Args&&... args)
+      : command (std::move(cmd)),
+        data    (std::forward<Args>(args)...) { }
 
-    void exec(DxvkContext* ctx) {
-      m_command(ctx, &m_data);
-    }
+      T command;
+      M data;
+    };
+
+    using Layout = DxvkCsCmdLayout<Payload>;
 
-    M* data() {
-      return &m_data;
+    static void exec(void* payload, DxvkContext* ctx) {
+      auto p = static_cast<Payload*>(payload);
+      p->command(ctx, &p->data);
     }
 
-  private:
+    static void destroy(void* payload) {
+      static_cast<Payload*>(payload)->~Payload();
+    }
 
-    T m_command;
-    M m_data;
+    constexpr static DxvkCsCmdFuncs Funcs = { &exec, &destroy,
+      uint32_t(Layout::PayloadOffset), uint32_t(Layout::Size) };
 
   };
   
@@ -152,6 +180,17 @@ namespace dxvk {
       return m_commandOffset == 0;
     }
 
+    /**
+     * \brief Queries amount of data stored in the chunk
+     * 
+     * Can be used to check whether any commands
+     * were added to the chunk since a given point.
+     * \returns Number of bytes used by commands
+     */
+    size_t size() const {
+      return m_commandOffset;
+    }
+
     /**
      * \brief Tries to add a command to the chunk
      * 
@@ -164,23 +203,7 @@ namespace dxvk {
      */
     template<typename T>
     bool push(T& command) {
-      using FuncType = DxvkCsTypedCmd<T>;
-      
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
-        return false;
-      
-      DxvkCsCmd* tail = m_tail;
-      
-      m_tail = new (m_data + m_commandOffset)
-        FuncType(std::move(command));
-      
-      if (likely(tail != nullptr))
-        tail->setNext(m_tail);
-      else
-        m_head = m_tail;
-      
-      m_commandOffset += sizeof(FuncType);
-      return true;
+      return this->emplace<DxvkCsTypedCmd<T>>(std::move(command)) != nullptr;
     }
 
     /**
@@ -192,22 +215,10 @@ namespace dxvk {
      */
     template<typename M, typename T, typename... Args>
     M* pushCmd(T& command, Args&&... args) {
-      using FuncType = DxvkCsDataCmd<T, M>;
-      
-      if (unlikely(m_commandOffset > MaxBlockSize - sizeof(FuncType)))
-        return nullptr;
-      
-      FuncType* func = new (m_data + m_commandOffset)
-        FuncType(std::move(command), std::forward<Args>(args)...);
-      
-      if (likely(m_tail != nullptr))
-        m_tail->setNext(func);
-      else
-        m_head = func;
-      m_tail = func;
-
-      m_commandOffset += sizeof(FuncType);
-      return func->data();
+      auto payload = this->emplace<DxvkCsDataCmd<T, M>>(
+        std::move(command), std::forward<Args>(args)...);
+
+      return payload ? &payload->data : nullptr;
     }
     
     /**
@@ -245,14 +256,36 @@ namespace dxvk {
     size_t m_commandOffset = 0;
 
     high_resolution_clock::time_point m_queuedTimestamp;
-    
-    DxvkCsCmd* m_head = nullptr;
-    DxvkCsCmd* m_tail = nullptr;
 
     DxvkCsChunkFlags m_flags;
     
     alignas(64)
     char m_data[MaxBlockSize];
+
+    template<typename Cmd, typename... Args>
+    typename Cmd::Payload* emplace(Args&&... args) {
+      using Layout = typename Cmd::Layout;
+
+      size_t offset = align(m_commandOffset, Layout::Alignment);
+
+      if (unlikely(offset + Layout::Size > MaxBlockSize))
+        return nullptr;
+
+      // Pad with no-ops if the command is over-aligned
+      for (size_t i = m_commandOffset; i < offset; i += sizeof(DxvkCsCmdHeader))
+        new (m_data + i) DxvkCsCmdHeader { &DxvkCsNopCmd::Funcs };
+
+      new (m_data + offset) DxvkCsCmdHeader { &Cmd::Funcs };
+
+      auto payload = new (m_data + offset + Layout::PayloadOffset)
+        typename Cmd::Payload(std::forward<Args>(args)...);
+
+      m_commandOffset = offset + Layout::Size;
+      return payload;
+    }
+
+    template<bool Destroy>
+    void executeCommands(DxvkContext* ctx);
     
   };
   
@@ -263,6 +296,12 @@ namespace dxvk {
    * Implements a pool of CS chunks which can be
    * recycled. The goal is to reduce the number
    * of dynamic memory allocations.
+   * 
+   * Chunks are cached in small per-thread caches, which
+   * exchange chunks with a global pool in batches of a
+   * full magazine. The global pool is a lock-free stack
+   * with a fixed number of magazines, which also caps
+   * the amount of memory retained by the pool.
    */
   class DxvkCsChunkPool {
     
@@ -293,9 +332,46 @@ namespace dxvk {
     void freeChunk(DxvkCsChunk* chunk);
     
   private:
-    
-    dxvk::mutex               m_mutex;
-    std::vector<DxvkCsChunk*> m_chunks;
+
+    constexpr static uint32_t MagazineSize  = 16;
+    constexpr static uint32_t MagazineCount = 32;
+    constexpr static uint32_t CacheCountLog2 = 3;
+    constexpr static uint32_t CacheCount    = 1u << CacheCountLog2;
+
+    constexpr static uint64_t ListIndexMask = 0xffffffffull;
+
+    struct Magazine {
+      std::atomic<uint32_t> next  = { 0u };
+      uint32_t              count = 0u;
+      std::array<DxvkCsChunk*, MagazineSize> chunks = { };
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ThreadCache {
+      sync::Spinlock        lock;
+      uint32_t              count = 0u;
+      std::array<DxvkCsChunk*, 2 * MagazineSize> chunks = { };
+    };
+
+    std::array<Magazine,    MagazineCount>  m_magazines;
+    std::array<ThreadCache, CacheCount>     m_caches;
+
+    // Lists store the tag in the upper 32 bits in order to
+    // avoid ABA issues, and the magazine index plus one in
+    // the lower 32 bits, with zero indicating an empty list.
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t> m_fullList  = { 0ull };
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<uint64_t> m_emptyList = { 0ull };
+
+    ThreadCache& getThreadCache();
+
+    Magazine* popMagazine(std::atomic<uint64_t>& list);
+
+    void pushMagazine(std::atomic<uint64_t>& list, Magazine* magazine);
+
+    DxvkCsChunk* allocFromGlobalPool(ThreadCache& cache);
+
+    void freeToGlobalPool(ThreadCache& cache);
     
   };
   
@@ -384,10 +460,15 @@ namespace dxvk {
    * \brief Command stream thread
    * 
    * Spawns a thread that will execute
-   * commands on a DXVK context. 
+   * commands on a DXVK context. Chunks are passed
+   * to the thread through a bounded lock-free ring,
+   * and the thread is only woken up via the mutex
+   * and condition variable if it is actually asleep.
    */
   class DxvkCsThread {
-    
+    /// Number of chunks the queue can hold, must be a power of two.
+    /// Dispatching more chunks blocks until the thread catches up.
+    constexpr static uint64_t QueueSize = 1024;
   public:
 
     constexpr static uint64_t SynchronizeAll = ~0ull;
@@ -428,24 +509,132 @@ namespace dxvk {
       return m_chunksExecuted.load();
     }
 
+    /**
+     * \brief Checks whether the CS thread is idle
+     *
+     * The CS thread is idle if all dispatched chunks have
+     * been fully executed. This is only a hint since the
+     * state may change at any time.
+     * \returns \c true if no chunks are pending
+     */
+    bool isIdle() const {
+      return m_chunksExecuted.load(std::memory_order_relaxed)
+          >= m_chunksDispatched.load(std::memory_order_relaxed);
+    }
+
   private:
+
+    /**
+     * \brief Queue entry
+     *
+     * The sequence number determines the state of the entry.
+     * If it equals the ring position, the entry is free and
+     * can be written by the producer which owns that position,
+     * if it is one larger, the chunk is ready for execution.
+     */
+    struct QueueEntry {
+      std::atomic<uint64_t>     seq = { 0ull };
+      DxvkCsChunkRef            chunk;
+    };
     
     Rc<DxvkDevice>              m_device;
     Rc<DxvkContext>             m_context;
 
-    dxvk::mutex                 m_counterMutex;
+    uint32_t                    m_spinCount = 0;
+
+    alignas(CACHE_LINE_SIZE)
     std::atomic<uint64_t>       m_chunksDispatched = { 0ull };
+
+    alignas(CACHE_LINE_SIZE)
     std::atomic<uint64_t>       m_chunksExecuted   = { 0ull };
-    
-    std::atomic<bool>           m_stopped = { false };
+    std::atomic<uint32_t>       m_syncWaiters      = { 0u };
+    dxvk::mutex                 m_counterMutex;
+    dxvk::condition_variable    m_condOnSync;
+
+    alignas(CACHE_LINE_SIZE)
+    std::atomic<bool>           m_consumerWaiting  = { false };
+    std::atomic<bool>           m_stopped          = { false };
     dxvk::mutex                 m_mutex;
     dxvk::condition_variable    m_condOnAdd;
-    dxvk::condition_variable    m_condOnSync;
-    std::vector<DxvkCsChunkRef> m_chunksQueued;
+
+    alignas(CACHE_LINE_SIZE)
+    std::array<QueueEntry, QueueSize> m_queue;
+
     dxvk::thread                m_thread;
-    
+
+    bool waitForChunk(
+            QueueEntry&           entry,
+            uint64_t              seq);
+
+    void notifySync();
+
     void threadFunc();
     
   };
-  
+
+
+  /**
+   * \brief Adaptive chunk flush policy
+   * 
+   * Decides whether a partially filled chunk should be
+   * dispatched early. Whenever the chunk grows past a
+   * given threshold, the CS thread is polled, and if it
+   * is idle, the chunk gets dispatched so that the CS
+   * thread does not need to wait for a full chunk. The
+   * polling interval shrinks while the CS thread is
+   * starved and grows while it is busy, so that work
+   * is batched more aggressively in the latter case.
+   */
+  class DxvkCsFlushPolicy {
+    constexpr static size_t MinInterval = 1024;
+    constexpr static size_t MaxInterval = DxvkCsChunk::MaxBlockSize;
+  public:
+
+    /**
+     * \brief Checks whether the CS thread needs to be polled
+     *
+     * Cheap check that can be done for every command.
+     * \param [in] chunkSize Size of the current chunk
+     * \returns \c true if \ref shouldFlush needs to be called
+     */
+    bool needsCheck(size_t chunkSize) const {
+      return chunkSize >= m_threshold;
+    }
+
+    /**
+     * \brief Checks whether to dispatch the chunk early
+     *
+     * Polls the CS thread and adjusts the polling interval.
+     * \param [in] chunkSize Size of the current chunk
+     * \param [in] thread The CS thread
+     * \returns \c true if the chunk should be dispatched
+     */
+    bool shouldFlush(size_t chunkSize, const DxvkCsThread& thread) {
+      if (thread.isIdle()) {
+        m_interval = std::max(m_interval / 2, MinInterval);
+        return true;
+      }
+
+      m_interval = std::min(m_interval * 2, MaxInterval);
+      m_threshold = chunkSize + m_interval;
+      return false;
+    }
+
+    /**
+     * \brief Notifies the policy about a dispatched chunk
+     *
+     * Must be called whenever a chunk is dispatched,
+     * regardless of whether it was dispatched early.
+     */
+    void notifyFlush() {
+      m_threshold = m_interval;
+    }
+
+  private:
+
+    size_t m_interval  = MinInterval * 4;
+    size_t m_threshold = MinInterval * 4;
+
+  };
+
 }
@@ -0,0 +1,191 @@
+#include "dxvk_defrag.h"
+#include "dxvk_device.h"
+
+namespace dxvk {
+
+  DxvkRetiredStorage::DxvkRetiredStorage(
+    const Rc<vk::DeviceFn>&         vkd,
+          DxvkBufferHandle&&        buffer)
+  : m_vkd(vkd), m_buffer(std::move(buffer)) { }
+
+
+  DxvkRetiredStorage::DxvkRetiredStorage(
+    const Rc<vk::DeviceFn>&         vkd,
+          DxvkPhysicalImage&&       image,
+          std::vector<VkImageView>&& views)
+  : m_vkd(vkd), m_image(std::move(image)), m_views(std::move(views)) { }
+
+
+  DxvkRetiredStorage::~DxvkRetiredStorage() {
+    for (auto view : m_views)
+      m_vkd->vkDestroyImageView(m_vkd->device(), view, nullptr);
+
+    m_vkd->vkDestroyBuffer(m_vkd->device(), m_buffer.buffer, nullptr);
+    m_vkd->vkDestroyImage(m_vkd->device(), m_image.image, nullptr);
+  }
+
+
+
+
+  DxvkMemoryDefragmenter::DxvkMemoryDefragmenter(
+          DxvkDevice*           device,
+          DxvkMemoryAllocator&  memAlloc)
+  : m_device    (device),
+    m_memAlloc  (&memAlloc),
+    m_budget    (determineBudget(device)) {
+
+  }
+
+
+  DxvkMemoryDefragmenter::~DxvkMemoryDefragmenter() {
+
+  }
+
+
+  DxvkRelocationList DxvkMemoryDefragmenter::getRelocations() {
+    DxvkRelocationList result;
+    m_frameId += 1;
+
+    if (!m_budget)
+      return result;
+
+    // Only do any work if the GPU had some time to spare during
+    // the last frame, since moving resources is not free and we
+    // don't want to steal GPU time from GPU-bound applications.
+    uint64_t idleTicks = m_device->getStatCounters().getCtr(DxvkStatCounter::GpuIdleTicks);
+    uint64_t idleDelta = idleTicks - m_prevIdleTicks;
+    m_prevIdleTicks = idleTicks;
+
+    if (idleDelta < MinGpuIdleTicks)
+      return result;
+
+    std::lock_guard<dxvk::mutex> lock(m_memAlloc->m_mutex);
+
+    VkDeviceSize budget = m_budget;
+
+    for (uint32_t i = 0; i < m_memAlloc->m_memProps.memoryTypeCount; i++) {
+      DxvkMemoryType* type = &m_memAlloc->m_memTypes[i];
+
+      // Host-visible memory may be mapped at any time, and
+      // fragmentation in system memory is less of an issue
+      VkMemoryPropertyFlags flags = type->memType.propertyFlags;
+
+      if (!(flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+       || (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        continue;
+
+      collectRelocations(type, result, budget);
+      selectEvacuationChunk(type);
+    }
+
+    return result;
+  }
+
+
+  void DxvkMemoryDefragmenter::collectRelocations(
+          DxvkMemoryType*       type,
+          DxvkRelocationList&   list,
+          VkDeviceSize&         budget) {
+    for (const auto& chunk : type->chunks) {
+      if (!chunk->isEvacuating() || chunk->isEmpty())
+        continue;
+
+      // Give pending initialization and upload commands on
+      // other threads some time to complete before moving
+      // anything out of the chunk.
+      if (chunk->m_evacuationFrame + EvacuationDelay > m_frameId)
+        continue;
+
+      bool hasOwners = false;
+
+      for (uint32_t i = 0; i < chunk->m_owners.size(); i++) {
+        const DxvkMemoryOwner& owner = chunk->m_owners[i];
+
+        if (!owner.resource)
+          continue;
+
+        hasOwners = true;
+
+        VkDeviceSize size = chunk->m_allocator.blockSize(i);
+
+        if (size > budget)
+          return;
+
+        // If the reference count was zero, the resource is
+        // currently being destroyed, and its memory will
+        // be freed as soon as we release the lock.
+        DxvkPagedResource* resource = owner.resource;
+
+        if (resource->incRef() == 1) {
+          resource->decRef();
+          continue;
+        }
+
+        if (owner.type == DxvkMemoryOwnerType::Buffer)
+          list.buffers.emplace_back(static_cast<DxvkBuffer*>(resource));
+        else
+          list.images.emplace_back(static_cast<DxvkImage*>(resource));
+
+        resource->decRef();
+        budget -= size;
+      }
+
+      // The remaining allocations belong to resources that
+      // cannot be moved, so there is no point in keeping
+      // new allocations out of the chunk any longer.
+      if (!hasOwners) {
+        chunk->m_evacuationFrame  = 0;
+        chunk->m_evacuationFailed = true;
+      }
+    }
+  }
+
+
+  void DxvkMemoryDefragmenter::selectEvacuationChunk(
+          DxvkMemoryType*       type) {
+    DxvkMemoryChunk* candidate = nullptr;
+    VkDeviceSize candidateUsed = 0;
+
+    for (const auto& chunk : type->chunks) {
+      if (chunk->isEvacuating())
+        return;
+
+      if (chunk->isEmpty() || chunk->m_evacuationFailed)
+        continue;
+
+      VkDeviceSize used = chunk->m_allocator.size() - chunk->m_allocator.freeSize();
+
+      if (used < chunk->m_allocator.size() / 2 && (!candidate || used < candidateUsed)) {
+        candidate = chunk.ptr();
+        candidateUsed = used;
+      }
+    }
+
+    if (!candidate)
+      return;
+
+    // Only evacuate the chunk if the remaining chunks have
+    // plenty of free memory, otherwise we'd likely end up
+    // allocating a new chunk for the relocated resources.
+    VkDeviceSize freeSize = 0;
+
+    for (const auto& chunk : type->chunks) {
+      if (chunk.ptr() != candidate && candidate->isCompatible(chunk))
+        freeSize += chunk->m_allocator.freeSize();
+    }
+
+    if (freeSize >= 2 * candidateUsed)
+      candidate->m_evacuationFrame = m_frameId;
+  }
+
+
+  VkDeviceSize DxvkMemoryDefragmenter::determineBudget(
+          DxvkDevice*           device) {
+    int32_t option = device->config().memoryDefragmentationBudget;
+
+    return option > 0
+      ? VkDeviceSize(option) << 20
+      : VkDeviceSize(0);
+  }
+
+}
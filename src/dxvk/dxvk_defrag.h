@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+
+#include "dxvk_buffer.h"
+#include "dxvk_image.h"
+#include "dxvk_memory.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+
+  /**
+   * \brief Retired resource storage
+   *
+   * Keeps the previous backing storage of a relocated
+   * buffer or image alive until the GPU has finished
+   * copying from it, and destroys it afterwards.
+   */
+  class DxvkRetiredStorage : public DxvkResource {
+
+  public:
+
+    DxvkRetiredStorage(
+      const Rc<vk::DeviceFn>&         vkd,
+            DxvkBufferHandle&&        buffer);
+
+    DxvkRetiredStorage(
+      const Rc<vk::DeviceFn>&         vkd,
+            DxvkPhysicalImage&&       image,
+            std::vector<VkImageView>&& views);
+
+    ~DxvkRetiredStorage();
+
+  private:
+
+    Rc<vk::DeviceFn>          m_vkd;
+
+    DxvkBufferHandle          m_buffer;
+    DxvkPhysicalImage         m_image;
+    std::vector<VkImageView>  m_views;
+
+  };
+
+
+  /**
+   * \brief Relocation list
+   *
+   * Resources that should be moved to
+   * a different memory location.
+   */
+  struct DxvkRelocationList {
+    std::vector<Rc<DxvkBuffer>> buffers;
+    std::vector<Rc<DxvkImage>>  images;
+
+    bool empty() const {
+      return buffers.empty() && images.empty();
+    }
+  };
+
+
+  /**
+   * \brief Memory defragmenter
+   *
+   * Picks sparsely used device memory chunks and marks
+   * them for evacuation, so that no new allocations
+   * are served from them. Once the chunk has been
+   * quiet for a few frames, the resources that are
+   * still using it are handed to the context, which
+   * copies them to a different location. The chunk
+   * gets freed once the last resource has moved.
+   *
+   * Only resources that have explicitly opted into
+   * relocation are considered, and relocation only
+   * happens while the GPU has had some idle time.
+   */
+  class DxvkMemoryDefragmenter {
+    /// Number of frames between marking a chunk
+    /// for evacuation and moving resources out
+    constexpr static uint64_t EvacuationDelay = 2;
+    /// Minimum GPU idle time per frame, in microseconds
+    constexpr static uint64_t MinGpuIdleTicks = 1000;
+  public:
+
+    DxvkMemoryDefragmenter(
+            DxvkDevice*           device,
+            DxvkMemoryAllocator&  memAlloc);
+
+    ~DxvkMemoryDefragmenter();
+
+    /**
+     * \brief Queries resources to relocate
+     *
+     * Must be called exactly once per frame from the
+     * thread that owns the primary context. The amount
+     * of memory returned is limited by the configured
+     * per-frame budget.
+     * \returns Resources to relocate this frame
+     */
+    DxvkRelocationList getRelocations();
+
+  private:
+
+    DxvkDevice*           m_device;
+    DxvkMemoryAllocator*  m_memAlloc;
+
+    VkDeviceSize          m_budget;
+
+    uint64_t              m_frameId       = 0;
+    uint64_t              m_prevIdleTicks = 0;
+
+    void collectRelocations(
+            DxvkMemoryType*       type,
+            DxvkRelocationList&   list,
+            VkDeviceSize&         budget);
+
+    void selectEvacuationChunk(
+            DxvkMemoryType*       type);
+
+    static VkDeviceSize determineBudget(
+            DxvkDevice*           device);
+
+  };
+
+}
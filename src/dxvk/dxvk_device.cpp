@@ -71,6 +71,20 @@ namespace dxvk {
   }
 
 
+  bool DxvkDevice::canUseExtendedDynamicState() const {
+    const auto& features = m_features.extExtendedDynamicState3;
+
+    return features.extendedDynamicState3ColorBlendEnable
+        && features.extendedDynamicState3ColorBlendEquation
+        && features.extendedDynamicState3ColorWriteMask
+        && features.extendedDynamicState3PolygonMode
+        && features.extendedDynamicState3RasterizationSamples
+        && features.extendedDynamicState3SampleMask
+        && features.extendedDynamicState3AlphaToCoverageEnable
+        && m_options.enableExtendedDynamicState != Tristate::False;
+  }
+
+
   bool DxvkDevice::mustTrackPipelineLifetime() const {
     switch (m_options.trackPipelineLifetime) {
       case Tristate::True:
@@ -207,6 +221,7 @@ namespace dxvk {
     DxvkStatCounters result;
     result.setCtr(DxvkStatCounter::PipeCountGraphics, pipe.numGraphicsPipelines);
     result.setCtr(DxvkStatCounter::PipeCountLibrary,  pipe.numGraphicsLibraries);
+    result.setCtr(DxvkStatCounter::PipeCountSaved,    pipe.numGraphicsPipelinesSaved);
     result.setCtr(DxvkStatCounter::PipeCountCompute,  pipe.numComputePipelines);
     result.setCtr(DxvkStatCounter::PipeTasksDone,     workers.tasksCompleted);
     result.setCtr(DxvkStatCounter::PipeTasksTotal,    workers.tasksTotal);
@@ -229,6 +229,16 @@ namespace dxvk {
      */
     bool canUsePipelineCacheControl() const;
 
+    /**
+     * \brief Checks whether extended dynamic state can be used
+     *
+     * If supported, blend state, multisample state and polygon
+     * modes are set dynamically, which reduces the number of
+     * distinct pipelines that need to be compiled.
+     * \returns \c true if all required features are supported.
+     */
+    bool canUseExtendedDynamicState() const;
+
     /**
      * \brief Checks whether pipelines should be tracked
      * \returns \c true if pipelines need to be tracked
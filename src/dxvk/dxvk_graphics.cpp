@@ -210,17 +210,14 @@ namespace dxvk {
     const DxvkDevice*                     device,
     const DxvkGraphicsPipelineStateInfo&  state,
     const DxvkShader*                     fs) {
+    // With extended dynamic state, blend state and multisample state
+    // are set at draw time, so leave them at fixed default values in
+    // order to not create redundant pipelines.
+    useExtendedDynamicState = device->canUseExtendedDynamicState();
+
     // Set up color formats and attachment blend states. Disable the write
     // mask for any attachment that the fragment shader does not write to.
-    uint32_t fsOutputMask = fs ? fs->info().outputMask : 0u;
-
-    // Dual-source blending can only write to one render target
-    if (state.useDualSourceBlending())
-      fsOutputMask &= 0x1;
-
-    const VkColorComponentFlags rgbaWriteMask
-      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-      | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    uint32_t fsOutputMask = getOutputMask(state, fs);
 
     cbInfo.logicOpEnable  = state.om.enableLogicOp();
     cbInfo.logicOp        = state.om.logicOp();
@@ -233,36 +230,8 @@ namespace dxvk {
       if (rtColorFormats[i]) {
         rtInfo.colorAttachmentCount = i + 1;
 
-        auto formatInfo = lookupFormatInfo(rtColorFormats[i]);
-
-        if ((fsOutputMask & (1 << i)) && formatInfo) {
-          VkColorComponentFlags writeMask = state.omBlend[i].colorWriteMask();
-
-          if (writeMask != rgbaWriteMask) {
-            writeMask = util::remapComponentMask(
-              state.omBlend[i].colorWriteMask(), state.omSwizzle[i].mapping());
-          }
-
-          writeMask &= formatInfo->componentMask;
-
-          if (writeMask == formatInfo->componentMask)
-            writeMask = rgbaWriteMask;
-
-          if (writeMask) {
-            cbAttachments[i] = state.omBlend[i].state();
-            cbAttachments[i].colorWriteMask = writeMask;
-
-            // If we're rendering to an emulated alpha-only render target, fix up blending
-            if (cbAttachments[i].blendEnable && formatInfo->componentMask == VK_COLOR_COMPONENT_R_BIT && state.omSwizzle[i].rIndex() == 3) {
-              cbAttachments[i].srcColorBlendFactor = util::remapAlphaToColorBlendFactor(
-                std::exchange(cbAttachments[i].srcAlphaBlendFactor, VK_BLEND_FACTOR_ONE));
-              cbAttachments[i].dstColorBlendFactor = util::remapAlphaToColorBlendFactor(
-                std::exchange(cbAttachments[i].dstAlphaBlendFactor, VK_BLEND_FACTOR_ZERO));
-              cbAttachments[i].colorBlendOp =
-                std::exchange(cbAttachments[i].alphaBlendOp, VK_BLEND_OP_ADD);
-            }
-          }
-        }
+        if (!useExtendedDynamicState)
+          cbAttachments[i] = getAttachmentState(state, fsOutputMask, i);
       }
     }
 
@@ -308,9 +277,74 @@ namespace dxvk {
     msInfo.pSampleMask            = &msSampleMask;
     msInfo.alphaToCoverageEnable  = state.ms.enableAlphaToCoverage() && cbUseDynamicAlphaToCoverage;
 
+    if (useExtendedDynamicState) {
+      msInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+      msInfo.alphaToCoverageEnable = VK_FALSE;
+      msSampleMask = 0x1;
+    }
+
     // We need to be fully consistent with the pipeline state here, and
     // while we could consistently infer it, just don't take any chances
-    cbUseDynamicBlendConstants = state.useDynamicBlendConstants();
+    cbUseDynamicBlendConstants = state.useDynamicBlendConstants() || useExtendedDynamicState;
+  }
+
+
+  uint32_t DxvkGraphicsPipelineFragmentOutputState::getOutputMask(
+    const DxvkGraphicsPipelineStateInfo&  state,
+    const DxvkShader*                     fs) {
+    uint32_t fsOutputMask = fs ? fs->info().outputMask : 0u;
+
+    // Dual-source blending can only write to one render target
+    if (state.useDualSourceBlending())
+      fsOutputMask &= 0x1;
+
+    return fsOutputMask;
+  }
+
+
+  VkPipelineColorBlendAttachmentState DxvkGraphicsPipelineFragmentOutputState::getAttachmentState(
+    const DxvkGraphicsPipelineStateInfo&  state,
+          uint32_t                        outputMask,
+          uint32_t                        index) {
+    const VkColorComponentFlags rgbaWriteMask
+      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+      | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendAttachmentState result = { };
+
+    auto formatInfo = lookupFormatInfo(state.rt.getColorFormat(index));
+
+    if (!(outputMask & (1u << index)) || !formatInfo)
+      return result;
+
+    VkColorComponentFlags writeMask = state.omBlend[index].colorWriteMask();
+
+    if (writeMask != rgbaWriteMask) {
+      writeMask = util::remapComponentMask(
+        state.omBlend[index].colorWriteMask(), state.omSwizzle[index].mapping());
+    }
+
+    writeMask &= formatInfo->componentMask;
+
+    if (writeMask == formatInfo->componentMask)
+      writeMask = rgbaWriteMask;
+
+    if (writeMask) {
+      result = state.omBlend[index].state();
+      result.colorWriteMask = writeMask;
+
+      // If we're rendering to an emulated alpha-only render target, fix up blending
+      if (result.blendEnable && formatInfo->componentMask == VK_COLOR_COMPONENT_R_BIT && state.omSwizzle[index].rIndex() == 3) {
+        result.srcColorBlendFactor = util::remapAlphaToColorBlendFactor(
+          std::exchange(result.srcAlphaBlendFactor, VK_BLEND_FACTOR_ONE));
+        result.dstColorBlendFactor = util::remapAlphaToColorBlendFactor(
+          std::exchange(result.dstAlphaBlendFactor, VK_BLEND_FACTOR_ZERO));
+        result.colorBlendOp =
+          std::exchange(result.alphaBlendOp, VK_BLEND_OP_ADD);
+      }
+    }
+
+    return result;
   }
 
 
@@ -329,6 +363,7 @@ namespace dxvk {
            && msSampleMask                    == other.msSampleMask
            && cbUseDynamicBlendConstants      == other.cbUseDynamicBlendConstants
            && cbUseDynamicAlphaToCoverage     == other.cbUseDynamicAlphaToCoverage
+           && useExtendedDynamicState         == other.useExtendedDynamicState
            && feedbackLoop                    == other.feedbackLoop;
 
     for (uint32_t i = 0; i < rtInfo.colorAttachmentCount && eq; i++)
@@ -369,6 +404,7 @@ namespace dxvk {
     hash.add(uint32_t(msSampleMask));
     hash.add(uint32_t(cbUseDynamicBlendConstants));
     hash.add(uint32_t(cbUseDynamicAlphaToCoverage));
+    hash.add(uint32_t(useExtendedDynamicState));
     hash.add(uint32_t(feedbackLoop));
 
     for (uint32_t i = 0; i < rtInfo.colorAttachmentCount; i++)
@@ -399,11 +435,14 @@ namespace dxvk {
     auto vk = m_device->vkd();
 
     uint32_t dynamicStateCount = 0;
-    std::array<VkDynamicState, 4> dynamicStates = { };
+    std::array<VkDynamicState, 8> dynamicStates = { };
+
+    bool hasDynamicMultisampleState = state.useExtendedDynamicState
+      || (m_device->features().extExtendedDynamicState3.extendedDynamicState3RasterizationSamples
+       && m_device->features().extExtendedDynamicState3.extendedDynamicState3SampleMask
+       && state.msInfo.sampleShadingEnable);
 
-    if (m_device->features().extExtendedDynamicState3.extendedDynamicState3RasterizationSamples
-     && m_device->features().extExtendedDynamicState3.extendedDynamicState3SampleMask
-     && state.msInfo.sampleShadingEnable) {
+    if (hasDynamicMultisampleState) {
       dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_RASTERIZATION_SAMPLES_EXT;
       dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_SAMPLE_MASK_EXT;
 
@@ -415,6 +454,12 @@ namespace dxvk {
     if (state.cbUseDynamicBlendConstants)
       dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_BLEND_CONSTANTS;
 
+    if (state.useExtendedDynamicState) {
+      dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT;
+      dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT;
+      dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT;
+    }
+
     VkPipelineDynamicStateCreateInfo dyInfo = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
 
     if (dynamicStateCount) {
@@ -471,9 +516,12 @@ namespace dxvk {
     // Set up tessellation state
     tsInfo.patchControlPoints = state.ia.patchVertexCount();
     
-    // Set up basic rasterization state
+    // Set up basic rasterization state. If the polygon mode
+    // can be set dynamically, always use the default value.
+    rsUseDynamicPolygonMode = useDynamicPolygonMode(device, state);
+
     rsInfo.depthClampEnable         = VK_TRUE;
-    rsInfo.polygonMode              = state.rs.polygonMode();
+    rsInfo.polygonMode              = rsUseDynamicPolygonMode ? VK_POLYGON_MODE_FILL : state.rs.polygonMode();
     rsInfo.depthBiasEnable          = state.rs.depthBiasEnable();
     rsInfo.lineWidth                = 1.0f;
 
@@ -553,6 +601,9 @@ namespace dxvk {
     if (eq)
       eq = rsLineInfo.lineRasterizationMode == other.rsLineInfo.lineRasterizationMode;
 
+    if (eq)
+      eq = rsUseDynamicPolygonMode == other.rsUseDynamicPolygonMode;
+
     return eq;
   }
 
@@ -575,10 +626,21 @@ namespace dxvk {
     hash.add(bit::cast<uint32_t>(rsConservativeInfo.extraPrimitiveOverestimationSize));
 
     hash.add(rsLineInfo.lineRasterizationMode);
+    hash.add(rsUseDynamicPolygonMode);
     return hash;
   }
 
 
+  bool DxvkGraphicsPipelinePreRasterizationState::useDynamicPolygonMode(
+    const DxvkDevice*                     device,
+    const DxvkGraphicsPipelineStateInfo&  state) {
+    // The line rasterization mode depends on the polygon mode, so
+    // only make it dynamic if no special line mode is requested.
+    return device->canUseExtendedDynamicState()
+        && state.rs.lineMode() == VK_LINE_RASTERIZATION_MODE_DEFAULT_EXT;
+  }
+
+
   bool DxvkGraphicsPipelinePreRasterizationState::isLineRendering(
     const DxvkGraphicsPipelineStateInfo&  state,
     const DxvkShader*                     tes,
@@ -693,6 +755,8 @@ namespace dxvk {
     const DxvkDevice*                     device,
     const DxvkGraphicsPipelineStateInfo&  state,
           DxvkGraphicsPipelineFlags       flags) {
+    bool useExtendedDynamicState = device->canUseExtendedDynamicState();
+
     dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT;
     dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT;
 
@@ -705,7 +769,7 @@ namespace dxvk {
     if (state.useDynamicDepthBounds())
       dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_DEPTH_BOUNDS;
     
-    if (state.useDynamicBlendConstants())
+    if (state.useDynamicBlendConstants() || useExtendedDynamicState)
       dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_BLEND_CONSTANTS;
     
     if (state.useDynamicStencilRef())
@@ -716,6 +780,20 @@ namespace dxvk {
       dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_FRONT_FACE;
     }
 
+    if (useExtendedDynamicState) {
+      dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT;
+      dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT;
+      dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT;
+      dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_RASTERIZATION_SAMPLES_EXT;
+      dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_SAMPLE_MASK_EXT;
+
+      if (!flags.test(DxvkGraphicsPipelineFlag::HasSampleMaskExport))
+        dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_ALPHA_TO_COVERAGE_ENABLE_EXT;
+
+      if (DxvkGraphicsPipelinePreRasterizationState::useDynamicPolygonMode(device, state))
+        dyStates[dyInfo.dynamicStateCount++] = VK_DYNAMIC_STATE_POLYGON_MODE_EXT;
+    }
+
     if (dyInfo.dynamicStateCount)
       dyInfo.pDynamicStates = dyStates.data();
   }
@@ -818,6 +896,23 @@ namespace dxvk {
     }
 
     info.undefinedInputs = (providedInputs & consumedInputs) ^ consumedInputs;
+
+    // Deal with outputs that are not consumed by the next stage. Skip
+    // tessellation control shaders since matching patch constants is
+    // not trivial, as well as anything that feeds into transform
+    // feedback, since captured outputs must be preserved.
+    if ((shaderInfo.stage == VK_SHADER_STAGE_VERTEX_BIT
+      || shaderInfo.stage == VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT
+      || shaderInfo.stage == VK_SHADER_STAGE_GEOMETRY_BIT)
+     && !shader->flags().test(DxvkShaderFlag::HasTransformFeedback)) {
+      auto nextStage = getNextStageShader(shaders, shaderInfo.stage);
+
+      if (nextStage == nullptr || nextStage->info().stage != VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT) {
+        uint32_t consumedOutputs = nextStage != nullptr ? nextStage->info().inputMask : 0u;
+        info.unusedOutputs = shaderInfo.outputMask & ~consumedOutputs;
+      }
+    }
+
     return info;
   }
 
@@ -849,6 +944,22 @@ namespace dxvk {
   }
 
 
+  Rc<DxvkShader> DxvkGraphicsPipelineShaderState::getNextStageShader(
+    const DxvkGraphicsPipelineShaders&    shaders,
+    const VkShaderStageFlagBits           stage) {
+    if (stage == VK_SHADER_STAGE_VERTEX_BIT && shaders.tcs != nullptr)
+      return shaders.tcs;
+
+    if (stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT)
+      return shaders.tes;
+
+    if (stage != VK_SHADER_STAGE_GEOMETRY_BIT && shaders.gs != nullptr)
+      return shaders.gs;
+
+    return shaders.fs;
+  }
+
+
   DxvkPipelineSpecConstantState::DxvkPipelineSpecConstantState() {
 
   }
@@ -911,6 +1022,86 @@ namespace dxvk {
   }
 
 
+  DxvkGraphicsPipelineInstanceTable::Table::Table(size_t size)
+  : mask(size - 1), entries(new std::atomic<DxvkGraphicsPipelineInstance*>[size]) {
+    for (size_t i = 0; i < size; i++)
+      entries[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+
+  DxvkGraphicsPipelineInstanceTable::DxvkGraphicsPipelineInstanceTable() {
+
+  }
+
+
+  DxvkGraphicsPipelineInstanceTable::~DxvkGraphicsPipelineInstanceTable() {
+
+  }
+
+
+  DxvkGraphicsPipelineInstance* DxvkGraphicsPipelineInstanceTable::find(
+    const DxvkGraphicsPipelineStateInfo&  state,
+          size_t                          hash) const {
+    const Table* table = m_table.load(std::memory_order_acquire);
+
+    if (unlikely(!table))
+      return nullptr;
+
+    // The load factor is kept below one half, so
+    // there is always at least one empty slot.
+    for (size_t i = hash & table->mask; ; i = (i + 1) & table->mask) {
+      DxvkGraphicsPipelineInstance* instance = table->entries[i].load(std::memory_order_acquire);
+
+      if (!instance)
+        return nullptr;
+
+      if (instance->hash == hash && instance->state == state)
+        return instance;
+    }
+  }
+
+
+  void DxvkGraphicsPipelineInstanceTable::insert(
+          DxvkGraphicsPipelineInstance*   instance) {
+    Table* table = m_table.load(std::memory_order_relaxed);
+
+    if (!table || 2 * (m_count + 1) > table->mask + 1) {
+      // Build the new table before publishing it, so that
+      // concurrent lookups always see a complete table.
+      size_t size = table ? 2 * (table->mask + 1) : 16;
+      auto newTable = std::make_unique<Table>(size);
+
+      if (table) {
+        for (size_t i = 0; i <= table->mask; i++) {
+          DxvkGraphicsPipelineInstance* entry = table->entries[i].load(std::memory_order_relaxed);
+
+          if (entry)
+            insertEntry(*newTable, entry);
+        }
+      }
+
+      table = newTable.get();
+      m_tables.push_back(std::move(newTable));
+    }
+
+    insertEntry(*table, instance);
+    m_table.store(table, std::memory_order_release);
+    m_count += 1;
+  }
+
+
+  void DxvkGraphicsPipelineInstanceTable::insertEntry(
+          Table&                          table,
+          DxvkGraphicsPipelineInstance*   instance) {
+    size_t i = instance->hash & table.mask;
+
+    while (table.entries[i].load(std::memory_order_relaxed))
+      i = (i + 1) & table.mask;
+
+    table.entries[i].store(instance, std::memory_order_release);
+  }
+
+
   DxvkGraphicsPipeline::DxvkGraphicsPipeline(
           DxvkDevice*                 device,
           DxvkPipelineManager*        pipeMgr,
@@ -960,6 +1151,8 @@ namespace dxvk {
   
   
   DxvkGraphicsPipeline::~DxvkGraphicsPipeline() {
+    m_workers->cancelGraphicsPipeline(this);
+
     this->destroyBasePipelines();
     this->destroyOptimizedPipelines();
   }
@@ -979,37 +1172,63 @@ namespace dxvk {
 
 
   std::pair<VkPipeline, DxvkGraphicsPipelineType> DxvkGraphicsPipeline::getPipelineHandle(
-    const DxvkGraphicsPipelineStateInfo& state) {
-    DxvkGraphicsPipelineInstance* instance = this->findInstance(state);
+    const DxvkGraphicsPipelineStateInfo& state,
+          DxvkGraphicsPipelineInstanceCache& cache) {
+    DxvkGraphicsPipelineInstance* entry = nullptr;
+
+    // Pipeline state often gets marked as dirty even though the
+    // state vector did not change, so check the last instance
+    // used by the calling context before hashing the state.
+    if (cache.pipeline == this && cache.instance->state == state)
+      entry = cache.instance;
 
-    if (unlikely(!instance)) {
+    size_t hash = 0;
+
+    if (!entry) {
+      hash = state.hash();
+      entry = this->findInstance(state, hash);
+    }
+
+    if (unlikely(!entry)) {
       // Exit early if the state vector is invalid
       if (!this->validatePipelineState(state, true))
         return std::make_pair(VK_NULL_HANDLE, DxvkGraphicsPipelineType::FastPipeline);
 
       // Prevent other threads from adding new instances and check again
       std::unique_lock<dxvk::mutex> lock(m_mutex);
-      instance = this->findInstance(state);
-
-      if (!instance) {
-        // Keep pipeline object locked, at worst we're going to stall
-        // a state cache worker and the current thread needs priority.
-        bool canCreateBasePipeline = this->canCreateBasePipeline(state);
-        instance = this->createInstance(state, canCreateBasePipeline);
-
-        // Unlock here since we may dispatch the pipeline to a worker,
-        // which will then acquire it to increment the use counter.
-        lock.unlock();
-
-        // If necessary, compile an optimized pipeline variant
-        if (!instance->fastHandle.load())
-          m_workers->compileGraphicsPipeline(this, state, DxvkPipelinePriority::Low);
-
-        // Only store pipelines in the state cache that cannot benefit
-        // from pipeline libraries, or if that feature is disabled.
-        if (!canCreateBasePipeline)
-          this->writePipelineStateToCache(state);
-      }
+      entry = this->findInstance(state, hash);
+
+      // Keep pipeline object locked, at worst we're going to stall
+      // a state cache worker and the current thread needs priority.
+      // Optimized variants of base pipelines are compiled on demand
+      // once the instance has been drawn with often enough.
+      if (!entry)
+        entry = this->addInstance(state, hash);
+    }
+
+    cache.pipeline = this;
+    cache.instance = entry;
+
+    // If the state vector was normalized, use the instance
+    // that was created for the normalized state instead.
+    DxvkGraphicsPipelineInstance* instance = entry->canonical
+      ? entry->canonical
+      : entry;
+
+    // Report the first use of each instance to the state cache. This
+    // includes instances compiled ahead of time by the state cache so
+    // that it can keep track of when and how often pipelines are used.
+    if (unlikely(!instance->isUsed.load(std::memory_order_relaxed))
+     && !instance->isUsed.exchange(VK_TRUE, std::memory_order_relaxed)) {
+      // Only store pipelines in the state cache that cannot benefit
+      // from pipeline libraries, or if that feature is disabled.
+      // Otherwise, store the vertex shader library instead, which
+      // is only done here so that libraries compiled ahead of time
+      // do not get a first use recorded unless they are drawn with.
+      if (!this->canCreateBasePipeline(instance->state))
+        this->writePipelineStateToCache(instance->state);
+      else if (!m_vsLibraryUsed.exchange(true, std::memory_order_relaxed))
+        this->writePipelineLibraryToCache();
     }
 
     // Find a pipeline handle to use. If no optimized pipeline has
@@ -1023,30 +1242,72 @@ namespace dxvk {
   }
 
 
+  bool DxvkGraphicsPipeline::trackBasePipelineDraw(
+          DxvkGraphicsPipelineInstance*  instance) {
+    if (instance->canonical)
+      instance = instance->canonical;
+
+    if (instance->fastHandle.load(std::memory_order_acquire))
+      return true;
+
+    // Stop counting once the instance is as hot as it gets
+    uint32_t drawCount = instance->drawCount.load(std::memory_order_relaxed);
+
+    if (drawCount > HotDrawCount)
+      return false;
+
+    drawCount = instance->drawCount.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Queue the compile again with a higher priority if the
+    // instance is still in use, so that pipelines which are
+    // actually hot get optimized before rarely used ones.
+    // Redundant compile requests are skipped by the worker.
+    if (m_device->config().enableGraphicsPipelineLibrary == Tristate::True)
+      return false;
+
+    if (drawCount == PromoteDrawCount)
+      m_workers->compileGraphicsPipeline(this, instance->state, DxvkPipelinePriority::Low);
+    else if (drawCount == HotDrawCount)
+      m_workers->compileGraphicsPipeline(this, instance->state, DxvkPipelinePriority::Normal);
+
+    return false;
+  }
+
+
   void DxvkGraphicsPipeline::compilePipeline(
     const DxvkGraphicsPipelineStateInfo& state) {
     if (m_device->config().enableGraphicsPipelineLibrary == Tristate::True)
       return;
 
     // Try to find an existing instance that contains a base pipeline
-    DxvkGraphicsPipelineInstance* instance = this->findInstance(state);
+    size_t hash = state.hash();
+
+    DxvkGraphicsPipelineInstance* instance = this->findInstance(state, hash);
+
+    if (instance && instance->canonical)
+      instance = instance->canonical;
 
     if (!instance) {
       // Exit early if the state vector is invalid
       if (!this->validatePipelineState(state, false))
         return;
 
+      // State cache entries written by older versions may not be
+      // normalized, make sure to not compile redundant pipelines.
+      DxvkGraphicsPipelineStateInfo normalizedState = this->normalizeState(state);
+      size_t normalizedHash = normalizedState.hash();
+
       // Do not compile if this pipeline can be fast linked. This essentially
       // disables the state cache for pipelines that do not benefit from it.
-      if (this->canCreateBasePipeline(state))
+      if (this->canCreateBasePipeline(normalizedState))
         return;
 
       // Prevent other threads from adding new instances and check again
       std::unique_lock<dxvk::mutex> lock(m_mutex);
-      instance = this->findInstance(state);
+      instance = this->findInstance(normalizedState, normalizedHash);
 
       if (!instance)
-        instance = this->createInstance(state, false);
+        instance = this->createInstance(normalizedState, normalizedHash, false);
     }
 
     // Exit if another thread is already compiling
@@ -1055,7 +1316,7 @@ namespace dxvk {
      || instance->isCompiling.exchange(VK_TRUE, std::memory_order_acquire))
       return;
 
-    VkPipeline pipeline = this->getOptimizedPipeline(state);
+    VkPipeline pipeline = this->getOptimizedPipeline(instance->state);
     instance->fastHandle.store(pipeline, std::memory_order_release);
 
     // Log pipeline state on error
@@ -1105,6 +1366,7 @@ namespace dxvk {
 
   DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::createInstance(
     const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash,
           bool                           doCreateBasePipeline) {
     VkPipeline baseHandle = VK_NULL_HANDLE;
     VkPipeline fastHandle = VK_NULL_HANDLE;
@@ -1119,18 +1381,48 @@ namespace dxvk {
       this->logPipelineState(LogLevel::Error, state);
 
     m_stats->numGraphicsPipelines += 1;
-    return &(*m_pipelines.emplace(state, baseHandle, fastHandle));
+
+    auto instance = &(*m_pipelines.emplace(state, hash, baseHandle, fastHandle));
+    m_instances.insert(instance);
+    return instance;
   }
   
   
-  DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::findInstance(
-    const DxvkGraphicsPipelineStateInfo& state) {
-    for (auto& instance : m_pipelines) {
-      if (instance.state == state)
-        return &instance;
+  DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::addInstance(
+    const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash) {
+    DxvkGraphicsPipelineStateInfo normalizedState = this->normalizeState(state);
+
+    if (normalizedState == state)
+      return this->createInstance(state, hash, this->canCreateBasePipeline(state));
+
+    // Look up or create the instance for the normalized state,
+    // and add an alias for the original state vector that does
+    // not own any Vulkan pipelines so that subsequent lookups
+    // with the same state do not need to normalize it again.
+    size_t normalizedHash = normalizedState.hash();
+
+    DxvkGraphicsPipelineInstance* instance = this->findInstance(normalizedState, normalizedHash);
+
+    if (instance) {
+      m_stats->numGraphicsPipelinesSaved += 1;
+    } else {
+      bool canCreateBasePipeline = this->canCreateBasePipeline(normalizedState);
+      instance = this->createInstance(normalizedState, normalizedHash, canCreateBasePipeline);
     }
-    
-    return nullptr;
+
+    auto alias = &(*m_pipelines.emplace(state, hash, VK_NULL_HANDLE, VK_NULL_HANDLE));
+    alias->canonical = instance;
+
+    m_instances.insert(alias);
+    return alias;
+  }
+
+
+  DxvkGraphicsPipelineInstance* DxvkGraphicsPipeline::findInstance(
+    const DxvkGraphicsPipelineStateInfo& state,
+          size_t                         hash) {
+    return m_instances.find(state, hash);
   }
   
   
@@ -1366,6 +1658,12 @@ namespace dxvk {
   SpirvCodeBuffer DxvkGraphicsPipeline::getShaderCode(
     const Rc<DxvkShader>&                shader,
     const DxvkShaderModuleCreateInfo&    info) const {
+    if (info.unusedOutputs && !m_device->config().optimizeShaders) {
+      DxvkShaderModuleCreateInfo patchedInfo = info;
+      patchedInfo.unusedOutputs = 0;
+      return shader->getCode(m_bindings, patchedInfo);
+    }
+
     return shader->getCode(m_bindings, info);
   }
 
@@ -1485,6 +1783,97 @@ namespace dxvk {
   }
   
   
+  DxvkGraphicsPipelineStateInfo DxvkGraphicsPipeline::normalizeState(
+    const DxvkGraphicsPipelineStateInfo& state) const {
+    DxvkGraphicsPipelineStateInfo result = state;
+
+    // Remove vertex attributes not consumed by the vertex shader, and
+    // reset bindings that are not used by any remaining attribute. The
+    // binding array cannot be compacted since binding indices are used
+    // directly when binding vertex buffers.
+    uint32_t vsInputMask = m_shaders.vs->info().inputMask;
+    uint32_t bindingMask = 0;
+    uint32_t attributeCount = 0;
+
+    for (uint32_t i = 0; i < state.il.attributeCount(); i++) {
+      if (vsInputMask & (1u << state.ilAttributes[i].location())) {
+        bindingMask |= 1u << state.ilAttributes[i].binding();
+        result.ilAttributes[attributeCount++] = state.ilAttributes[i];
+      }
+    }
+
+    for (uint32_t i = attributeCount; i < state.il.attributeCount(); i++)
+      result.ilAttributes[i] = DxvkIlAttribute();
+
+    for (uint32_t i = 0; i < state.il.bindingCount(); i++) {
+      uint32_t binding = state.ilBindings[i].binding();
+
+      if (!(bindingMask & (1u << binding)))
+        result.ilBindings[i] = DxvkIlBinding(binding, 0, VK_VERTEX_INPUT_RATE_VERTEX, 1);
+    }
+
+    result.il = DxvkIlInfo(attributeCount, state.il.bindingCount());
+
+    // The context decides whether to use dynamic strides based on
+    // the original state, so the normalized state must agree
+    if (result.useDynamicVertexStrides() != state.useDynamicVertexStrides()) {
+      for (uint32_t i = 0; i < state.il.bindingCount(); i++)
+        result.ilBindings[i] = state.ilBindings[i];
+    }
+
+    // Depth and stencil state only matter if the respective tests are enabled
+    if (!state.ds.enableDepthTest()) {
+      result.ds = DxvkDsInfo(VK_FALSE, VK_FALSE,
+        state.ds.enableDepthBoundsTest(),
+        state.ds.enableStencilTest(),
+        VK_COMPARE_OP_NEVER);
+    }
+
+    if (!state.ds.enableStencilTest()) {
+      result.dsFront = DxvkDsStencilOp();
+      result.dsBack  = DxvkDsStencilOp();
+    }
+
+    // Reset blend state for render targets that are not written,
+    // and use canonical blend factors if blending is disabled.
+    uint32_t fsOutputMask = m_shaders.fs != nullptr
+      ? m_shaders.fs->info().outputMask
+      : 0u;
+
+    if (state.useDualSourceBlending())
+      fsOutputMask &= 0x1;
+
+    for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+      if (!(fsOutputMask & (1u << i)) || !state.writesRenderTarget(i)) {
+        result.omBlend[i] = DxvkOmAttachmentBlend();
+        result.omSwizzle[i] = DxvkOmAttachmentSwizzle();
+      } else if (!state.omBlend[i].blendEnable()) {
+        result.omBlend[i] = DxvkOmAttachmentBlend(VK_FALSE,
+          VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+          VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+          state.omBlend[i].colorWriteMask());
+      }
+    }
+
+    // Dynamic state is set up based on the original state vector
+    if (result.useDynamicBlendConstants() != state.useDynamicBlendConstants()
+     || result.useDualSourceBlending() != state.useDualSourceBlending()) {
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        result.omBlend[i] = state.omBlend[i];
+        result.omSwizzle[i] = state.omSwizzle[i];
+      }
+    }
+
+    // Spec constants not used by any shader have no effect
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (!(m_specConstantMask & (1u << i)))
+        result.sc.specConstants[i] = 0;
+    }
+
+    return result;
+  }
+
+
   void DxvkGraphicsPipeline::writePipelineStateToCache(
     const DxvkGraphicsPipelineStateInfo& state) const {
     DxvkStateCacheKey key;
@@ -1496,6 +1885,17 @@ namespace dxvk {
 
     m_stateCache->addGraphicsPipeline(key, state);
   }
+
+
+  void DxvkGraphicsPipeline::writePipelineLibraryToCache() const {
+    DxvkStateCacheKey key;
+    if (m_shaders.vs  != nullptr) key.vs = m_shaders.vs->getShaderKey();
+    if (m_shaders.tcs != nullptr) key.tcs = m_shaders.tcs->getShaderKey();
+    if (m_shaders.tes != nullptr) key.tes = m_shaders.tes->getShaderKey();
+    if (m_shaders.gs  != nullptr) key.gs = m_shaders.gs->getShaderKey();
+
+    m_stateCache->addPipelineLibrary(key);
+  }
   
   
   void DxvkGraphicsPipeline::logPipelineState(
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <mutex>
 
 #include "../util/sync/sync_list.h"
@@ -16,6 +17,7 @@
 namespace dxvk {
   
   class DxvkDevice;
+  class DxvkGraphicsPipeline;
   class DxvkStateCache;
   class DxvkPipelineManager;
   class DxvkPipelineWorkers;
@@ -118,6 +120,7 @@ namespace dxvk {
     VkSampleMask                                    msSampleMask               = 0u;
     VkBool32                                        cbUseDynamicBlendConstants = VK_FALSE;
     VkBool32                                        cbUseDynamicAlphaToCoverage = VK_FALSE;
+    VkBool32                                        useExtendedDynamicState    = VK_FALSE;
 
     std::array<VkPipelineColorBlendAttachmentState, MaxNumRenderTargets> cbAttachments  = { };
     std::array<VkFormat,                            MaxNumRenderTargets> rtColorFormats = { };
@@ -127,6 +130,15 @@ namespace dxvk {
     bool eq(const DxvkGraphicsPipelineFragmentOutputState& other) const;
 
     size_t hash() const;
+
+    static uint32_t getOutputMask(
+      const DxvkGraphicsPipelineStateInfo&  state,
+      const DxvkShader*                     fs);
+
+    static VkPipelineColorBlendAttachmentState getAttachmentState(
+      const DxvkGraphicsPipelineStateInfo&  state,
+            uint32_t                        outputMask,
+            uint32_t                        index);
   };
 
 
@@ -181,6 +193,7 @@ namespace dxvk {
     VkPipelineRasterizationStateStreamCreateInfoEXT       rsXfbStreamInfo     = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_STREAM_CREATE_INFO_EXT };
     VkPipelineRasterizationConservativeStateCreateInfoEXT rsConservativeInfo  = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_CONSERVATIVE_STATE_CREATE_INFO_EXT };
     VkPipelineRasterizationLineStateCreateInfoEXT         rsLineInfo          = { VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_LINE_STATE_CREATE_INFO_EXT };
+    VkBool32                                              rsUseDynamicPolygonMode = VK_FALSE;
 
     bool eq(const DxvkGraphicsPipelinePreRasterizationState& other) const;
 
@@ -191,6 +204,10 @@ namespace dxvk {
       const DxvkShader*                     tes,
       const DxvkShader*                     gs);
 
+    static bool useDynamicPolygonMode(
+      const DxvkDevice*                     device,
+      const DxvkGraphicsPipelineStateInfo&  state);
+
   };
 
 
@@ -228,7 +245,7 @@ namespace dxvk {
             DxvkGraphicsPipelineFlags       flags);
 
     VkPipelineDynamicStateCreateInfo  dyInfo    = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
-    std::array<VkDynamicState, 12>    dyStates  = { };
+    std::array<VkDynamicState, 20>    dyStates  = { };
 
     bool eq(const DxvkGraphicsPipelineDynamicState& other) const;
 
@@ -269,6 +286,10 @@ namespace dxvk {
       const DxvkGraphicsPipelineShaders&    shaders,
       const VkShaderStageFlagBits           stage);
 
+    Rc<DxvkShader> getNextStageShader(
+      const DxvkGraphicsPipelineShaders&    shaders,
+      const VkShaderStageFlagBits           stage);
+
   };
 
 
@@ -353,22 +374,101 @@ namespace dxvk {
    * 
    * Stores a state vector and the
    * corresponding pipeline handle.
+   * State vectors that normalize to a different state
+   * vector only reference the canonical instance and
+   * do not own any pipeline handles themselves.
    */
   struct DxvkGraphicsPipelineInstance {
     DxvkGraphicsPipelineInstance() { }
     DxvkGraphicsPipelineInstance(
       const DxvkGraphicsPipelineStateInfo&  state_,
+            size_t                          hash_,
             VkPipeline                      baseHandle_,
             VkPipeline                      fastHandle_)
     : state       (state_),
+      hash        (hash_),
       baseHandle  (baseHandle_),
       fastHandle  (fastHandle_),
       isCompiling (fastHandle_ != VK_NULL_HANDLE) { }
 
     DxvkGraphicsPipelineStateInfo state;
+    size_t                        hash        = 0;
     std::atomic<VkPipeline>       baseHandle  = { VK_NULL_HANDLE };
     std::atomic<VkPipeline>       fastHandle  = { VK_NULL_HANDLE };
     std::atomic<VkBool32>         isCompiling = { VK_FALSE };
+    std::atomic<VkBool32>         isUsed      = { VK_FALSE };
+    std::atomic<uint32_t>         drawCount   = { 0u };
+    DxvkGraphicsPipelineInstance* canonical   = nullptr;
+  };
+
+
+  /**
+   * \brief Graphics pipeline instance table
+   *
+   * Insert-only open-addressing hash table that maps state
+   * vectors to pipeline instances. Lookups are lock-free,
+   * insertions must be externally synchronized. When the
+   * table grows, old tables are kept alive until the object
+   * is destroyed since other threads may still access them.
+   */
+  class DxvkGraphicsPipelineInstanceTable {
+
+  public:
+
+    DxvkGraphicsPipelineInstanceTable();
+
+    ~DxvkGraphicsPipelineInstanceTable();
+
+    /**
+     * \brief Looks up a pipeline instance
+     *
+     * \param [in] state Pipeline state vector
+     * \param [in] hash Hash of the state vector
+     * \returns Pipeline instance, or \c nullptr
+     */
+    DxvkGraphicsPipelineInstance* find(
+      const DxvkGraphicsPipelineStateInfo&  state,
+            size_t                          hash) const;
+
+    /**
+     * \brief Adds a pipeline instance
+     *
+     * The instance must not already be in the table.
+     * \param [in] instance Pipeline instance
+     */
+    void insert(
+            DxvkGraphicsPipelineInstance*   instance);
+
+  private:
+
+    struct Table {
+      Table(size_t size);
+
+      size_t                                      mask;
+      std::unique_ptr<std::atomic<DxvkGraphicsPipelineInstance*>[]> entries;
+    };
+
+    std::atomic<Table*>                 m_table = { nullptr };
+    std::vector<std::unique_ptr<Table>> m_tables;
+    size_t                              m_count = 0;
+
+    static void insertEntry(
+            Table&                          table,
+            DxvkGraphicsPipelineInstance*   instance);
+
+  };
+
+
+  /**
+   * \brief Graphics pipeline instance cache
+   *
+   * Stores the pipeline instance that was looked up last.
+   * Owned by a context, so that redundant lookups with
+   * an unchanged state vector avoid hashing the state.
+   */
+  struct DxvkGraphicsPipelineInstanceCache {
+    const DxvkGraphicsPipeline*   pipeline = nullptr;
+    DxvkGraphicsPipelineInstance* instance = nullptr;
   };
 
 
@@ -533,10 +633,12 @@ namespace dxvk {
      * Retrieves a pipeline handle for the given pipeline
      * state. If necessary, a new pipeline will be created.
      * \param [in] state Pipeline state vector
+     * \param [in,out] cache Last instance used by the caller
      * \returns Pipeline handle and handle type
      */
     std::pair<VkPipeline, DxvkGraphicsPipelineType> getPipelineHandle(
-      const DxvkGraphicsPipelineStateInfo&    state);
+      const DxvkGraphicsPipelineStateInfo&    state,
+            DxvkGraphicsPipelineInstanceCache& cache);
     
     /**
      * \brief Compiles a pipeline
@@ -548,6 +650,20 @@ namespace dxvk {
     void compilePipeline(
       const DxvkGraphicsPipelineStateInfo&    state);
 
+    /**
+     * \brief Tracks a draw using a base pipeline
+     *
+     * Counts draws for the given instance and queues an
+     * optimized pipeline for compilation once the instance
+     * is used frequently enough. Rarely used instances will
+     * keep using the base pipeline.
+     * \param [in] instance Currently bound pipeline instance
+     * \returns \c true if an optimized pipeline is available
+     *    and the pipeline should be re-bound by the caller.
+     */
+    bool trackBasePipelineDraw(
+            DxvkGraphicsPipelineInstance*   instance);
+
     /**
      * \brief Acquires the pipeline
      *
@@ -567,6 +683,14 @@ namespace dxvk {
 
   private:
 
+    /// Number of draws after which an optimized
+    /// variant of a base pipeline gets compiled
+    constexpr static uint32_t PromoteDrawCount = 16;
+
+    /// Number of draws after which an optimized
+    /// pipeline is compiled with normal priority
+    constexpr static uint32_t HotDrawCount = 256;
+
     DxvkDevice*                 m_device;    
     DxvkPipelineManager*        m_manager;
     DxvkPipelineWorkers*        m_workers;
@@ -581,6 +705,8 @@ namespace dxvk {
     DxvkShaderPipelineLibrary*  m_vsLibrary;
     DxvkShaderPipelineLibrary*  m_fsLibrary;
 
+    std::atomic<bool>           m_vsLibraryUsed = { false };
+
     uint32_t m_vsIn  = 0;
     uint32_t m_fsOut = 0;
 
@@ -589,6 +715,7 @@ namespace dxvk {
     alignas(CACHE_LINE_SIZE)
     dxvk::mutex                                   m_mutex;
     sync::List<DxvkGraphicsPipelineInstance>      m_pipelines;
+    DxvkGraphicsPipelineInstanceTable             m_instances;
     uint32_t                                      m_useCount = 0;
 
     std::unordered_map<
@@ -603,10 +730,16 @@ namespace dxvk {
     
     DxvkGraphicsPipelineInstance* createInstance(
       const DxvkGraphicsPipelineStateInfo& state,
+            size_t                         hash,
             bool                           doCreateBasePipeline);
     
+    DxvkGraphicsPipelineInstance* addInstance(
+      const DxvkGraphicsPipelineStateInfo& state,
+            size_t                         hash);
+
     DxvkGraphicsPipelineInstance* findInstance(
-      const DxvkGraphicsPipelineStateInfo& state);
+      const DxvkGraphicsPipelineStateInfo& state,
+            size_t                         hash);
 
     bool canCreateBasePipeline(
       const DxvkGraphicsPipelineStateInfo& state) const;
@@ -640,8 +773,13 @@ namespace dxvk {
       const DxvkGraphicsPipelineStateInfo& state,
             bool                           trusted) const;
     
+    DxvkGraphicsPipelineStateInfo normalizeState(
+      const DxvkGraphicsPipelineStateInfo& state) const;
+
     void writePipelineStateToCache(
       const DxvkGraphicsPipelineStateInfo& state) const;
+
+    void writePipelineLibraryToCache() const;
     
     void logPipelineState(
             LogLevel                       level,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dxvk_hash.h"
 #include "dxvk_limits.h"
 
 #include <cstring>
@@ -748,6 +749,33 @@ namespace dxvk {
       return !bit::bcmpeq(this, &other);
     }
 
+    size_t hash() const {
+      // The state vector is fairly large, so hash four
+      // independent lanes to avoid a long dependency chain.
+      constexpr size_t WordCount = sizeof(*this) / sizeof(uint64_t);
+      static_assert(WordCount % 4 == 0);
+
+      auto words = reinterpret_cast<const uint64_t*>(this);
+
+      uint64_t lanes[4] = {
+        0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+        0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+
+      for (size_t i = 0; i < WordCount; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+          uint64_t lane = lanes[j] ^ words[i + j];
+          lanes[j] = ((lane << 31) | (lane >> 33)) * 0x9e3779b185ebca87ull;
+        }
+      }
+
+      DxvkHashState hash;
+
+      for (uint64_t lane : lanes)
+        hash.add(size_t(lane ^ (lane >> 32)));
+
+      return hash;
+    }
+
     bool useDynamicStencilRef() const {
       return ds.enableStencilTest();
     }
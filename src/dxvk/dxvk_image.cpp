@@ -9,7 +9,7 @@ namespace dxvk {
     const DxvkImageCreateInfo&  createInfo,
           DxvkMemoryAllocator&  memAlloc,
           VkMemoryPropertyFlags memFlags)
-  : m_vkd(device->vkd()), m_device(device), m_info(createInfo), m_memFlags(memFlags) {
+  : m_vkd(device->vkd()), m_device(device), m_memAlloc(&memAlloc), m_info(createInfo), m_memFlags(memFlags) {
 
     // Copy the compatible view formats to a persistent array
     m_viewFormats.resize(createInfo.viewFormatCount);
@@ -97,20 +97,7 @@ namespace dxvk {
         memoryProperties.dedicated.image = m_image.image;
       }
 
-      // Use high memory priority for GPU-writable resources
-      bool isGpuWritable = (m_info.access & (
-        VK_ACCESS_SHADER_WRITE_BIT                  |
-        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT         |
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT        |
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)) != 0;
-
-      DxvkMemoryFlags hints(DxvkMemoryFlag::GpuReadable);
-
-      if (isGpuWritable)
-        hints.set(DxvkMemoryFlag::GpuWritable);
-
-      m_image.memory = memAlloc.alloc(memoryRequirements, memoryProperties, hints);
+      m_image.memory = memAlloc.alloc(memoryRequirements, memoryProperties, getMemoryHints());
 
       // Try to bind the allocated memory slice to the image
       if (m_vkd->vkBindImageMemory(m_vkd->device(), m_image.image,
@@ -227,14 +214,217 @@ namespace dxvk {
   }
 
 
+  void DxvkImage::enableRelocation() {
+    std::lock_guard<dxvk::mutex> lock(m_viewMutex);
+
+    if (!m_relocatable && canRelocate())
+      m_relocatable = m_memAlloc->setMemoryOwner(m_image.memory, getMemoryOwner());
+  }
+
+
+  void DxvkImage::disableRelocation() {
+    std::lock_guard<dxvk::mutex> lock(m_viewMutex);
+
+    if (m_relocatable) {
+      m_memAlloc->setMemoryOwner(m_image.memory, DxvkMemoryOwner());
+      m_relocatable = false;
+    }
+  }
+
+
+  DxvkPhysicalImage DxvkImage::allocRelocationStorage() {
+    { std::lock_guard<dxvk::mutex> lock(m_viewMutex);
+
+      if (!m_relocatable)
+        return DxvkPhysicalImage();
+    }
+
+    VkImageFormatListCreateInfo formatList = { VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO };
+    formatList.viewFormatCount = m_info.viewFormatCount;
+    formatList.pViewFormats    = m_info.viewFormats;
+
+    VkImageCreateInfo info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO, &formatList };
+    info.flags                 = m_info.flags;
+    info.imageType             = m_info.type;
+    info.format                = m_info.format;
+    info.extent                = m_info.extent;
+    info.mipLevels             = m_info.mipLevels;
+    info.arrayLayers           = m_info.numLayers;
+    info.samples               = m_info.sampleCount;
+    info.tiling                = m_info.tiling;
+    info.usage                 = m_info.usage;
+    info.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    DxvkPhysicalImage result;
+
+    if (m_vkd->vkCreateImage(m_vkd->device(), &info, nullptr, &result.image))
+      return DxvkPhysicalImage();
+
+    DxvkMemoryRequirements memoryRequirements = { };
+    memoryRequirements.tiling = info.tiling;
+    memoryRequirements.dedicated = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+    memoryRequirements.core = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2, &memoryRequirements.dedicated };
+
+    VkImageMemoryRequirementsInfo2 memoryRequirementInfo = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
+    memoryRequirementInfo.image = result.image;
+
+    m_vkd->vkGetImageMemoryRequirements2(m_vkd->device(),
+      &memoryRequirementInfo, &memoryRequirements.core);
+
+    DxvkMemoryProperties memoryProperties = { };
+    memoryProperties.flags = m_memFlags;
+
+    if (memoryRequirements.dedicated.prefersDedicatedAllocation) {
+      memoryProperties.dedicated = { VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+      memoryProperties.dedicated.image = result.image;
+    }
+
+    try {
+      result.memory = m_memAlloc->alloc(memoryRequirements, memoryProperties, getMemoryHints());
+    } catch (const DxvkError&) {
+      m_vkd->vkDestroyImage(m_vkd->device(), result.image, nullptr);
+      return DxvkPhysicalImage();
+    }
+
+    if (m_vkd->vkBindImageMemory(m_vkd->device(), result.image,
+        result.memory.memory(), result.memory.offset()) != VK_SUCCESS) {
+      m_vkd->vkDestroyImage(m_vkd->device(), result.image, nullptr);
+      return DxvkPhysicalImage();
+    }
+
+    return result;
+  }
+
+
+  DxvkPhysicalImage DxvkImage::assignStorage(
+          DxvkPhysicalImage&&         storage,
+          std::vector<VkImageView>&   retiredViews) {
+    std::lock_guard<dxvk::mutex> lock(m_viewMutex);
+
+    // The image may have been pinned by another thread
+    // after the relocation storage has been allocated
+    if (!m_relocatable)
+      return DxvkPhysicalImage();
+
+    // Transfer ownership to the new allocation so that the
+    // defragmenter does not try to move the old one again
+    m_memAlloc->setMemoryOwner(m_image.memory, DxvkMemoryOwner());
+    m_memAlloc->setMemoryOwner(storage.memory, getMemoryOwner());
+
+    DxvkPhysicalImage result = std::exchange(m_image, std::move(storage));
+
+    // Views are created while holding the lock, so
+    // none of them can refer to the old image now.
+    // Recreating the views overwrites each handle
+    // atomically, so that other threads never see
+    // a null handle while the views are replaced.
+    for (auto view : m_trackedViews) {
+      for (uint32_t i = 0; i < DxvkImageView::ViewCount; i++) {
+        VkImageView handle = view->m_views[i].load();
+
+        if (handle)
+          retiredViews.push_back(handle);
+      }
+
+      view->createViews();
+    }
+
+    return result;
+  }
+
+
+  bool DxvkImage::canRelocate() const {
+    if (!m_memAlloc || m_shared)
+      return false;
+
+    // Mapped and sparse images must stay where they are
+    if ((m_memFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+     || (m_info.flags & VK_IMAGE_CREATE_SPARSE_BINDING_BIT)
+     || (m_info.tiling != VK_IMAGE_TILING_OPTIMAL))
+      return false;
+
+    // Attachments may be used by other contexts, e.g. for
+    // presentation, and multi-planar images need special
+    // care when copying, so leave those alone as well.
+    if (m_info.usage & (
+          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+          VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT))
+      return false;
+
+    if (formatInfo()->flags.test(DxvkFormatFlag::MultiPlane))
+      return false;
+
+    VkImageUsageFlags transferUsage =
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+      VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    return (m_info.usage & transferUsage) == transferUsage;
+  }
+
+
+  DxvkMemoryFlags DxvkImage::getMemoryHints() const {
+    // Use high memory priority for GPU-writable resources
+    bool isGpuWritable = (m_info.access & (
+      VK_ACCESS_SHADER_WRITE_BIT                  |
+      VK_ACCESS_COLOR_ATTACHMENT_READ_BIT         |
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT        |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)) != 0;
+
+    DxvkMemoryFlags hints(DxvkMemoryFlag::GpuReadable);
+
+    if (isGpuWritable)
+      hints.set(DxvkMemoryFlag::GpuWritable);
+
+    return hints;
+  }
+
+
+  DxvkMemoryOwner DxvkImage::getMemoryOwner() {
+    DxvkMemoryOwner owner;
+    owner.resource = this;
+    owner.type     = DxvkMemoryOwnerType::Image;
+    return owner;
+  }
+
+
   DxvkImageView::DxvkImageView(
     const Rc<vk::DeviceFn>&         vkd,
     const Rc<DxvkImage>&            image,
     const DxvkImageViewCreateInfo&  info)
   : m_vkd(vkd), m_image(image), m_info(info) {
     for (uint32_t i = 0; i < ViewCount; i++)
-      m_views[i] = VK_NULL_HANDLE;
-    
+      m_views[i].store(VK_NULL_HANDLE);
+
+    // Register the view with the image so that the
+    // view handles can be recreated on relocation
+    std::lock_guard<dxvk::mutex> lock(m_image->m_viewMutex);
+    this->createViews();
+
+    m_image->m_trackedViews.push_back(this);
+  }
+  
+  
+  DxvkImageView::~DxvkImageView() {
+    { std::lock_guard<dxvk::mutex> lock(m_image->m_viewMutex);
+
+      auto& views = m_image->m_trackedViews;
+      auto entry = std::find(views.begin(), views.end(), this);
+
+      if (entry != views.end()) {
+        *entry = views.back();
+        views.pop_back();
+      }
+    }
+
+    for (uint32_t i = 0; i < ViewCount; i++)
+      m_vkd->vkDestroyImageView(m_vkd->device(), m_views[i].load(), nullptr);
+  }
+
+
+  void DxvkImageView::createViews() {
     switch (m_info.type) {
       case VK_IMAGE_VIEW_TYPE_1D:
       case VK_IMAGE_VIEW_TYPE_1D_ARRAY: {
@@ -274,12 +464,6 @@ namespace dxvk {
         throw DxvkError(str::format("DxvkImageView: Invalid view type: ", m_info.type));
     }
   }
-  
-  
-  DxvkImageView::~DxvkImageView() {
-    for (uint32_t i = 0; i < ViewCount; i++)
-      m_vkd->vkDestroyImageView(m_vkd->device(), m_views[i], nullptr);
-  }
 
   
   void DxvkImageView::createView(VkImageViewType type, uint32_t numLayers) {
@@ -306,8 +490,10 @@ namespace dxvk {
         VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
     }
     
+    VkImageView view = VK_NULL_HANDLE;
+
     if (m_vkd->vkCreateImageView(m_vkd->device(),
-          &viewInfo, nullptr, &m_views[type]) != VK_SUCCESS) {
+          &viewInfo, nullptr, &view) != VK_SUCCESS) {
       throw DxvkError(str::format(
         "DxvkImageView: Failed to create image view:"
         "\n  View type:       ", viewInfo.viewType,
@@ -330,6 +516,8 @@ namespace dxvk {
         "\n    Usage:         ", std::hex, m_image->info().usage,
         "\n    Tiling:        ", m_image->info().tiling));
     }
+
+    m_views[type].store(view, std::memory_order_release);
   }
   
 }
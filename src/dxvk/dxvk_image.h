@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+
 #include "dxvk_descriptor.h"
 #include "dxvk_format.h"
 #include "dxvk_memory.h"
@@ -330,21 +333,79 @@ namespace dxvk {
      * \returns The shared handle with the type given by DxvkSharedHandleInfo::type
      */
     HANDLE sharedHandle() const;
+
+    /**
+     * \brief Allows the image to be relocated
+     *
+     * Registers the image with the memory allocator so that
+     * the defragmenter can move it to a different location.
+     * Must only be used for images that are only ever accessed
+     * from the CS thread. Has no effect if the image cannot be
+     * relocated, e.g. because it is shared or host-visible.
+     */
+    void enableRelocation();
+
+    /**
+     * \brief Pins image memory
+     *
+     * Prevents the image from being relocated. Must be
+     * called before exposing the Vulkan image handle.
+     */
+    void disableRelocation();
+
+    /**
+     * \brief Allocates storage for relocation
+     *
+     * Creates a new image with the same properties as the
+     * current one. Called by the context on the CS thread
+     * when relocating the image.
+     * \returns New storage, or a null handle if the image
+     *    cannot be relocated.
+     */
+    DxvkPhysicalImage allocRelocationStorage();
+
+    /**
+     * \brief Replaces backing storage
+     *
+     * Recreates all image views for the new image. The caller
+     * must copy the image contents and keep the previous image
+     * as well as the returned view handles alive until the GPU
+     * is done using them.
+     * \param [in] storage New backing storage
+     * \param [out] retiredViews Previous image view handles
+     * \returns Previous backing storage, or a null handle
+     *    if the image has been pinned in the meantime. In
+     *    that case, \c storage is left unchanged.
+     */
+    DxvkPhysicalImage assignStorage(
+            DxvkPhysicalImage&&         storage,
+            std::vector<VkImageView>&   retiredViews);
     
   private:
     
     Rc<vk::DeviceFn>      m_vkd;
     const DxvkDevice*     m_device;
+    DxvkMemoryAllocator*  m_memAlloc = nullptr;
     DxvkImageCreateInfo   m_info;
     VkMemoryPropertyFlags m_memFlags;
     DxvkPhysicalImage     m_image;
 
     bool m_shared = false;
+    bool m_relocatable = false;
 
     small_vector<VkFormat, 4> m_viewFormats;
+
+    dxvk::mutex                 m_viewMutex;
+    std::vector<DxvkImageView*> m_trackedViews;
     
     bool canShareImage(const VkImageCreateInfo&  createInfo, const DxvkSharedHandleInfo& sharingInfo) const;
 
+    bool canRelocate() const;
+
+    DxvkMemoryFlags getMemoryHints() const;
+
+    DxvkMemoryOwner getMemoryOwner();
+
   };
   
   
@@ -380,13 +441,18 @@ namespace dxvk {
      * 
      * If the view does not support the requested image
      * view type, \c VK_NULL_HANDLE will be returned.
+     *
+     * Handles change when the image gets relocated. This
+     * may be called from any thread, but the image must
+     * be pinned before exposing the handle to external
+     * code, e.g. through interop interfaces.
      * \param [in] viewType The requested view type
      * \returns The image view handle
      */
     VkImageView handle(VkImageViewType viewType) const {
       if (unlikely(viewType == VK_IMAGE_VIEW_TYPE_MAX_ENUM))
         viewType = m_info.type;
-      return m_views[viewType];
+      return m_views[viewType].load(std::memory_order_acquire);
     }
     
     /**
@@ -555,7 +621,10 @@ namespace dxvk {
     Rc<DxvkImage>     m_image;
     
     DxvkImageViewCreateInfo m_info;
-    VkImageView             m_views[ViewCount];
+
+    std::array<std::atomic<VkImageView>, ViewCount> m_views;
+
+    void createViews();
 
     void createView(VkImageViewType type, uint32_t numLayers);
     
@@ -15,14 +15,16 @@ namespace dxvk {
           VkDeviceMemory        memory,
           VkDeviceSize          offset,
           VkDeviceSize          length,
-          void*                 mapPtr)
+          void*                 mapPtr,
+          uint32_t              block)
   : m_alloc   (alloc),
     m_chunk   (chunk),
     m_type    (type),
     m_memory  (memory),
     m_offset  (offset),
     m_length  (length),
-    m_mapPtr  (mapPtr) { }
+    m_mapPtr  (mapPtr),
+    m_block   (block) { }
   
   
   DxvkMemory::DxvkMemory(DxvkMemory&& other)
@@ -32,7 +34,9 @@ namespace dxvk {
     m_memory  (std::exchange(other.m_memory, VkDeviceMemory(VK_NULL_HANDLE))),
     m_offset  (std::exchange(other.m_offset, 0)),
     m_length  (std::exchange(other.m_length, 0)),
-    m_mapPtr  (std::exchange(other.m_mapPtr, nullptr)) { }
+    m_mapPtr  (std::exchange(other.m_mapPtr, nullptr)),
+    m_block   (std::exchange(other.m_block,  ~0u)),
+    m_cached  (std::exchange(other.m_cached, false)) { }
   
   
   DxvkMemory& DxvkMemory::operator = (DxvkMemory&& other) {
@@ -44,6 +48,8 @@ namespace dxvk {
     m_offset  = std::exchange(other.m_offset, 0);
     m_length  = std::exchange(other.m_length, 0);
     m_mapPtr  = std::exchange(other.m_mapPtr, nullptr);
+    m_block   = std::exchange(other.m_block,  ~0u);
+    m_cached  = std::exchange(other.m_cached, false);
     return *this;
   }
   
@@ -64,9 +70,9 @@ namespace dxvk {
           DxvkMemoryType*       type,
           DxvkDeviceMemory      memory,
           DxvkMemoryFlags       hints)
-  : m_alloc(alloc), m_type(type), m_memory(memory), m_hints(hints) {
-    // Mark the entire chunk as free
-    m_freeList.push_back(FreeSlice { 0, memory.memSize });
+  : m_alloc(alloc), m_type(type), m_memory(memory), m_hints(hints),
+    m_allocator(memory.memSize) {
+
   }
   
   
@@ -86,84 +92,49 @@ namespace dxvk {
     // be refined a bit in the future if necessary.
     if (m_memory.memFlags != flags || !checkHints(hints))
       return DxvkMemory();
-    
-    // If the chunk is full, return
-    if (m_freeList.size() == 0)
+
+    // Don't put anything into chunks that we're trying to free
+    if (isEvacuating())
       return DxvkMemory();
     
-    // Select the slice to allocate from in a worst-fit
-    // manner. This may help keep fragmentation low.
-    auto bestSlice = m_freeList.begin();
-    
-    for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
-      if (slice->length == size) {
-        bestSlice = slice;
-        break;
-      } else if (slice->length > bestSlice->length) {
-        bestSlice = slice;
-      }
-    }
-    
-    // We need to align the allocation to the requested alignment
-    const VkDeviceSize sliceStart = bestSlice->offset;
-    const VkDeviceSize sliceEnd   = bestSlice->offset + bestSlice->length;
-    
-    const VkDeviceSize allocStart = dxvk::align(sliceStart,        align);
-    const VkDeviceSize allocEnd   = dxvk::align(allocStart + size, align);
-    
-    if (allocEnd > sliceEnd)
+    // Look up a free block in constant time. Alignment is applied
+    // to both the offset and the size of the allocation.
+    DxvkSubAllocation slice = m_allocator.alloc(size, align);
+
+    if (!slice)
       return DxvkMemory();
     
-    // We can use this slice, but we'll have to add
-    // the unused parts of it back to the free list.
-    m_freeList.erase(bestSlice);
-    
-    if (allocStart != sliceStart)
-      m_freeList.push_back({ sliceStart, allocStart - sliceStart });
-    
-    if (allocEnd != sliceEnd)
-      m_freeList.push_back({ allocEnd, sliceEnd - allocEnd });
-    
-    // Create the memory object with the aligned slice
     return DxvkMemory(m_alloc, this, m_type,
-      m_memory.memHandle, allocStart, allocEnd - allocStart,
-      reinterpret_cast<char*>(m_memory.memPointer) + allocStart);
+      m_memory.memHandle, slice.offset, slice.length,
+      reinterpret_cast<char*>(m_memory.memPointer) + slice.offset,
+      slice.block);
   }
   
   
   void DxvkMemoryChunk::free(
-          VkDeviceSize  offset,
-          VkDeviceSize  length) {
-    // Remove adjacent entries from the free list and then add
-    // a new slice that covers all those entries. Without doing
-    // so, the slice could not be reused for larger allocations.
-    auto curr = m_freeList.begin();
-    
-    while (curr != m_freeList.end()) {
-      if (curr->offset == offset + length) {
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else if (curr->offset + curr->length == offset) {
-        offset -= curr->length;
-        length += curr->length;
-        curr = m_freeList.erase(curr);
-      } else {
-        curr++;
-      }
-    }
-    
-    m_freeList.push_back({ offset, length });
+          uint32_t      block) {
+    m_allocator.free(block);
+
+    if (block < m_owners.size())
+      m_owners[block] = DxvkMemoryOwner();
+
+    // Usage changed, so evacuating the chunk may succeed now
+    m_evacuationFailed = false;
   }
   
   
-  bool DxvkMemoryChunk::isEmpty() const {
-    return m_freeList.size() == 1
-        && m_freeList[0].length == m_memory.memSize;
+  bool DxvkMemoryChunk::isCompatible(const Rc<DxvkMemoryChunk>& other) const {
+    return other->m_memory.memFlags == m_memory.memFlags && other->m_hints == m_hints;
   }
 
 
-  bool DxvkMemoryChunk::isCompatible(const Rc<DxvkMemoryChunk>& other) const {
-    return other->m_memory.memFlags == m_memory.memFlags && other->m_hints == m_hints;
+  void DxvkMemoryChunk::setOwner(
+          uint32_t              block,
+    const DxvkMemoryOwner&      owner) {
+    if (block >= m_owners.size())
+      m_owners.resize(block + 1);
+
+    m_owners[block] = owner;
   }
 
 
@@ -189,6 +160,7 @@ namespace dxvk {
       m_memHeaps[i].properties = m_memProps.memoryHeaps[i];
       m_memHeaps[i].stats      = DxvkMemoryStats { 0, 0 };
       m_memHeaps[i].budget     = 0;
+      m_memHeaps[i].overBudget = false;
     }
     
     for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
@@ -200,6 +172,8 @@ namespace dxvk {
 
     if (device->features().core.features.sparseBinding)
       m_sparseMemoryTypes = determineSparseMemoryTypes(device);
+
+    updateMemoryBudget();
   }
   
   
@@ -212,8 +186,6 @@ namespace dxvk {
           DxvkMemoryRequirements            req,
           DxvkMemoryProperties              info,
           DxvkMemoryFlags                   hints) {
-    std::lock_guard<dxvk::mutex> lock(m_mutex);
-
     // Keep small allocations together to avoid fragmenting
     // chunks for larger resources with lots of small gaps,
     // as well as resources with potentially weird lifetimes
@@ -227,6 +199,18 @@ namespace dxvk {
     if (info.flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
       hints = hints & DxvkMemoryFlag::Transient;
 
+    // Serve small allocations from a per-thread cache if possible
+    // so that creating resources on multiple threads at once does
+    // not serialize on the allocator lock.
+    DxvkMemory cached = this->tryAllocFromCache(req, info, hints);
+
+    if (cached)
+      return cached;
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    VkMemoryPropertyFlags requestedFlags = info.flags;
+
     // If requested, try with a dedicated allocation first.
     if (info.dedicated.image || info.dedicated.buffer) {
       DxvkMemory result = this->tryAlloc(req, info, hints);
@@ -278,6 +262,16 @@ namespace dxvk {
         return result;
     }
 
+    // Exceed the heap budget rather than failing the allocation
+    // if the resource cannot be placed in system memory either
+    info.flags = requestedFlags;
+    hints.set(DxvkMemoryFlag::IgnoreConstraints, DxvkMemoryFlag::IgnoreBudget);
+
+    DxvkMemory result = this->tryAlloc(req, info, hints);
+
+    if (result)
+      return result;
+
     // We weren't able to allocate memory for this resource form any type
     this->logMemoryError(req.core.memoryRequirements);
     this->logMemoryStats();
@@ -286,6 +280,146 @@ namespace dxvk {
   }
   
   
+  DxvkMemoryStats DxvkMemoryAllocator::getMemoryStats(uint32_t heap) {
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    DxvkMemoryStats result = m_memHeaps[heap].stats;
+    result.memoryBudget = m_memHeaps[heap].budget;
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      if (m_memTypes[i].heapId != heap)
+        continue;
+
+      for (const auto& chunk : m_memTypes[i].chunks)
+        result.memoryFragmented += chunk->getFragmentedSize();
+    }
+
+    return result;
+  }
+
+
+  bool DxvkMemoryAllocator::setMemoryOwner(
+    const DxvkMemory&           memory,
+    const DxvkMemoryOwner&      owner) {
+    if (!memory.m_chunk || memory.m_cached)
+      return false;
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+    memory.m_chunk->setOwner(memory.m_block, owner);
+    return true;
+  }
+
+
+  DxvkMemory DxvkMemoryAllocator::tryAllocFromCache(
+    const DxvkMemoryRequirements&           req,
+    const DxvkMemoryProperties&             info,
+          DxvkMemoryFlags                   hints) {
+    if (req.dedicated.requiresDedicatedAllocation
+     || info.dedicated.image || info.dedicated.buffer
+     || info.sharedExport.handleTypes || info.sharedImportWin32.handleType)
+      return DxvkMemory();
+
+    VkDeviceSize size      = req.core.memoryRequirements.size;
+    VkDeviceSize alignment = req.core.memoryRequirements.alignment;
+
+    if (req.tiling == VK_IMAGE_TILING_OPTIMAL) {
+      VkDeviceSize granularity = m_device->properties().core.properties.limits.bufferImageGranularity;
+      size      = align(size,      granularity);
+      alignment = align(alignment, granularity);
+    }
+
+    // Blocks are aligned to their own size, so rounding the
+    // block size up to a power of two that is at least as large
+    // as the alignment satisfies both requirements at once.
+    VkDeviceSize blockSize = std::max(size, alignment);
+
+    if (blockSize > (VkDeviceSize(1) << SmallBlockMaxSizeLog2))
+      return DxvkMemory();
+
+    uint32_t sizeLog2 = std::max(SmallBlockMinSizeLog2,
+      32u - bit::lzcnt(uint32_t(blockSize - 1)));
+
+    VkDeviceSize length = VkDeviceSize(1) << sizeLog2;
+
+    // Use the memory type that a regular allocation would
+    // try first, and let the slow path handle the rest.
+    DxvkMemoryType* type = nullptr;
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount && !type; i++) {
+      const bool supported = (req.core.memoryRequirements.memoryTypeBits & (1u << i)) != 0;
+      const bool adequate  = (m_memTypes[i].memType.propertyFlags & info.flags) == info.flags;
+
+      if (supported && adequate)
+        type = &m_memTypes[i];
+    }
+
+    // Let the regular allocation path deal with heaps that are
+    // over budget, so that resources can be placed in system
+    // memory, and so that cached blocks do not keep chunks
+    // alive that could otherwise be freed.
+    if (!type || type->heap->overBudget)
+      return DxvkMemory();
+
+    // If another thread is using the same cache, don't wait
+    // for it and take the regular allocation path instead.
+    ThreadCache& cache = getThreadCache();
+
+    if (!cache.lock.try_lock())
+      return DxvkMemory();
+
+    std::lock_guard<sync::Spinlock> cacheLock(cache.lock, std::adopt_lock);
+
+    SmallBlockList& list = getSmallBlockList(cache, type, info.flags, hints, sizeLog2);
+    list.used = true;
+
+    if (!list.count) {
+      // Carve out multiple blocks at once so that subsequent
+      // allocations of the same size can skip the lock. These
+      // blocks count as used memory until they are returned.
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      uint32_t batchSize = clamp(uint32_t(SmallBlockBatchSize >> sizeLog2), 1u, SmallBlockListSize);
+
+      while (list.count < batchSize) {
+        DxvkMemory memory = this->tryAllocFromType(type, length, length, info, hints);
+
+        if (!memory)
+          break;
+
+        if (!memory.m_chunk)
+          return memory;
+
+        SmallBlock& entry = list.blocks[list.count++];
+        entry.chunk  = memory.m_chunk;
+        entry.block  = memory.m_block;
+        entry.offset = memory.m_offset;
+
+        // The block is owned by the cache now
+        memory.m_alloc = nullptr;
+      }
+
+      if (!list.count)
+        return DxvkMemory();
+    }
+
+    // Don't hand out blocks from chunks that the defragmenter
+    // is trying to free. The block stays in the cache until
+    // the cache gets trimmed, which returns it to the chunk.
+    if (list.blocks[list.count - 1].chunk->isEvacuating())
+      return DxvkMemory();
+
+    const SmallBlock& entry = list.blocks[--list.count];
+    const DxvkDeviceMemory& devMem = entry.chunk->getDeviceMemory();
+
+    DxvkMemory result(this, entry.chunk, type,
+      devMem.memHandle, entry.offset, length,
+      reinterpret_cast<char*>(devMem.memPointer) + entry.offset,
+      entry.block);
+    result.m_cached = true;
+    return result;
+  }
+
+
   DxvkMemory DxvkMemoryAllocator::tryAlloc(
     const DxvkMemoryRequirements&           req,
     const DxvkMemoryProperties&             info,
@@ -384,16 +518,13 @@ namespace dxvk {
 
     bool useMemoryPriority = (info.flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
                           && (m_device->features().extMemoryPriority.memoryPriority);
-    
-    if (type->heap->budget && type->heap->stats.memoryAllocated + size > type->heap->budget)
-      return DxvkDeviceMemory();
 
-    float priority = 0.0f;
+    float priority = getMemoryPriority(hints);
 
-    if (hints.test(DxvkMemoryFlag::GpuReadable))
-      priority = 0.5f;
-    if (hints.test(DxvkMemoryFlag::GpuWritable))
-      priority = 1.0f;
+    // Fail if the heap is over budget so that the caller
+    // can try to place the resource in system memory
+    if (!hints.test(DxvkMemoryFlag::IgnoreBudget) && isOverBudget(type->heap, size, priority))
+      return DxvkDeviceMemory();
 
     DxvkDeviceMemory result;
     result.memSize  = size;
@@ -401,7 +532,7 @@ namespace dxvk {
     result.priority = priority;
 
     VkMemoryPriorityAllocateInfoEXT priorityInfo = { VK_STRUCTURE_TYPE_MEMORY_PRIORITY_ALLOCATE_INFO_EXT };
-    priorityInfo.priority       = priority;
+    priorityInfo.priority       = getDevicePriority(type->heap, priority);
 
     VkMemoryAllocateInfo memoryInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
     memoryInfo.allocationSize   = size;
@@ -440,6 +571,11 @@ namespace dxvk {
 
   void DxvkMemoryAllocator::free(
     const DxvkMemory&           memory) {
+    // Keep cached blocks around for subsequent allocations,
+    // the memory remains accounted for as used memory.
+    if (memory.m_cached && this->tryFreeToCache(memory))
+      return;
+
     std::lock_guard<dxvk::mutex> lock(m_mutex);
     memory.m_type->heap->stats.memoryUsed -= memory.m_length;
 
@@ -447,8 +583,7 @@ namespace dxvk {
       this->freeChunkMemory(
         memory.m_type,
         memory.m_chunk,
-        memory.m_offset,
-        memory.m_length);
+        memory.m_block);
     } else {
       DxvkDeviceMemory devMem;
       devMem.memHandle  = memory.m_memory;
@@ -461,12 +596,83 @@ namespace dxvk {
   }
 
   
+  bool DxvkMemoryAllocator::tryFreeToCache(
+    const DxvkMemory&           memory) {
+    // Return memory to its chunk right away if the chunk is
+    // being evacuated or if the heap is over budget
+    if (memory.m_chunk->isEvacuating() || memory.m_type->heap->overBudget)
+      return false;
+
+    ThreadCache& cache = getThreadCache();
+
+    if (!cache.lock.try_lock())
+      return false;
+
+    std::lock_guard<sync::Spinlock> cacheLock(cache.lock, std::adopt_lock);
+
+    // Chunk hints match the hints of any request that was
+    // served from the chunk, except for constraint flags.
+    DxvkMemoryFlags hints = memory.m_chunk->getHints();
+    hints.clr(DxvkMemoryFlag::IgnoreConstraints, DxvkMemoryFlag::IgnoreBudget);
+
+    SmallBlockList& list = getSmallBlockList(cache, memory.m_type,
+      memory.m_chunk->getDeviceMemory().memFlags, hints,
+      bit::tzcnt(uint32_t(memory.m_length)));
+
+    list.used = true;
+
+    // If the list is full, the block is returned to its chunk
+    if (list.count == SmallBlockListSize)
+      return false;
+
+    SmallBlock& entry = list.blocks[list.count++];
+    entry.chunk  = memory.m_chunk;
+    entry.block  = memory.m_block;
+    entry.offset = memory.m_offset;
+    return true;
+  }
+
+
+  void DxvkMemoryAllocator::trimCaches() {
+    for (auto& cache : m_caches) {
+      std::lock_guard<sync::Spinlock> cacheLock(cache.lock);
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      for (auto& list : cache.lists) {
+        // Return all blocks of lists that have not been used since
+        // the last trim, as well as blocks that keep chunks alive
+        // which are being evacuated or live on a heap that is over
+        // budget, so that those chunks can actually be freed.
+        bool drain = !list.used || list.type->heap->overBudget;
+        uint32_t count = 0;
+
+        for (uint32_t i = 0; i < list.count; i++) {
+          const SmallBlock& entry = list.blocks[i];
+
+          if (drain || entry.chunk->isEvacuating()) {
+            VkDeviceSize length = VkDeviceSize(1) << list.sizeLog2;
+
+            list.type->heap->stats.memoryUsed -= length;
+            this->freeChunkMemory(list.type, entry.chunk, entry.block);
+
+            m_device->notifyMemoryUse(list.type->heapId, -length);
+          } else {
+            list.blocks[count++] = entry;
+          }
+        }
+
+        list.count = count;
+        list.used = false;
+      }
+    }
+  }
+
+
   void DxvkMemoryAllocator::freeChunkMemory(
           DxvkMemoryType*       type,
           DxvkMemoryChunk*      chunk,
-          VkDeviceSize          offset,
-          VkDeviceSize          length) {
-    chunk->free(offset, length);
+          uint32_t              block) {
+    chunk->free(block);
 
     if (chunk->isEmpty()) {
       Rc<DxvkMemoryChunk> chunkRef = chunk;
@@ -476,7 +682,9 @@ namespace dxvk {
       // freed are prioritized for allocations to reduce memory pressure.
       type->chunks.erase(std::remove(type->chunks.begin(), type->chunks.end(), chunkRef));
 
-      if (!this->shouldFreeChunk(type, chunkRef))
+      // Always free chunks that have been evacuated by the defragmenter,
+      // since keeping them around would defeat the purpose.
+      if (!chunkRef->isEvacuating() && !this->shouldFreeChunk(type, chunkRef))
         type->chunks.push_back(std::move(chunkRef));
     }
   }
@@ -550,9 +758,9 @@ namespace dxvk {
     VkDeviceSize budget = heap->budget;
 
     if (!budget)
-      budget = (heap->properties.size * 4) / 5;
+      budget = heap->properties.size;
 
-    return heap->stats.memoryAllocated + allocationSize > budget;
+    return heap->stats.memoryAllocated + allocationSize > (budget * 4) / 5;
   }
 
 
@@ -572,6 +780,146 @@ namespace dxvk {
   }
 
 
+  bool DxvkMemoryAllocator::isOverBudget(
+    const DxvkMemoryHeap*       heap,
+          VkDeviceSize          allocationSize,
+          float                 priority) const {
+    // Only video memory can be demoted to a slower heap. High-priority
+    // resources such as render targets always stay in video memory even
+    // if that forces the driver to evict other resources, since placing
+    // them in system memory would be far more expensive. This only
+    // affects where new memory gets allocated, resources that already
+    // live in video memory stay there.
+    if (!heap->budget || priority >= PriorityHigh
+     || !(heap->properties.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+      return false;
+
+    // Move rarely used resources out of the way a bit early so
+    // that more important ones can still use video memory.
+    VkDeviceSize budget = heap->budget;
+
+    if (priority < PriorityMedium)
+      budget = (budget * 4) / 5;
+
+    return heap->stats.memoryAllocated + allocationSize > budget;
+  }
+
+
+  void DxvkMemoryAllocator::updateMemoryBudget() {
+    DxvkAdapterMemoryInfo heapInfo = m_device->adapter()->getMemoryHeapInfo();
+
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    bool usePageableMemory = m_device->features().extPageableDeviceLocalMemory.pageableDeviceLocalMemory;
+
+    for (uint32_t i = 0; i < m_memProps.memoryHeapCount; i++) {
+      DxvkMemoryHeap* heap = &m_memHeaps[i];
+
+      // The reported heap usage includes memory allocated by other
+      // devices and the driver itself. Subtract that from the budget
+      // so that we can compare it to our own allocation stats.
+      VkDeviceSize budget = heapInfo.heaps[i].memoryBudget;
+      VkDeviceSize usage = heapInfo.heaps[i].memoryAllocated;
+      VkDeviceSize externalUsage = usage - std::min(usage, heap->stats.memoryUsed);
+
+      heap->budget = budget - std::min(budget, externalUsage);
+
+      bool overBudget = heap->stats.memoryAllocated > heap->budget;
+
+      if (heap->overBudget != overBudget) {
+        heap->overBudget = overBudget;
+
+        if (usePageableMemory)
+          updateMemoryPriorities(heap);
+      }
+    }
+
+    // Cache locks must be taken before the allocator lock
+    lock.unlock();
+
+    trimCaches();
+  }
+
+
+  void DxvkMemoryAllocator::updateMemoryPriorities(
+    const DxvkMemoryHeap*       heap) {
+    auto vk = m_device->vkd();
+
+    for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+      DxvkMemoryType* type = &m_memTypes[i];
+
+      if (type->heap != heap || !(type->memType.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        continue;
+
+      for (const auto& chunk : type->chunks) {
+        const DxvkDeviceMemory& memory = chunk->getDeviceMemory();
+
+        vk->vkSetDeviceMemoryPriorityEXT(vk->device(), memory.memHandle,
+          getDevicePriority(heap, memory.priority));
+      }
+    }
+  }
+
+
+  float DxvkMemoryAllocator::getMemoryPriority(
+          DxvkMemoryFlags       hints) {
+    // Render targets and storage resources are the most important,
+    // followed by regular read-only resources and small allocations
+    // such as constant buffers. Everything else, e.g. staging data,
+    // is rarely used by the GPU.
+    if (hints.test(DxvkMemoryFlag::GpuWritable))
+      return PriorityHigh;
+
+    if (hints.any(DxvkMemoryFlag::GpuReadable, DxvkMemoryFlag::Small))
+      return PriorityMedium;
+
+    return PriorityLow;
+  }
+
+
+  float DxvkMemoryAllocator::getDevicePriority(
+    const DxvkMemoryHeap*       heap,
+          float                 priority) {
+    // Lower the priority of anything that isn't high-priority while
+    // the heap is over budget, so that the driver pages those out
+    // first rather than thrashing on frequently used resources.
+    return (heap->overBudget && priority < PriorityHigh)
+      ? priority * 0.5f
+      : priority;
+  }
+
+
+  DxvkMemoryAllocator::ThreadCache& DxvkMemoryAllocator::getThreadCache() {
+    // Thread IDs are not necessarily consecutive, so hash
+    // them in order to distribute threads across caches
+    uint32_t hash = dxvk::this_thread::get_id() * 0x9e3779b1u;
+    return m_caches[hash >> (32 - CacheCountLog2)];
+  }
+
+
+  DxvkMemoryAllocator::SmallBlockList& DxvkMemoryAllocator::getSmallBlockList(
+          ThreadCache&          cache,
+          DxvkMemoryType*       type,
+          VkMemoryPropertyFlags flags,
+          DxvkMemoryFlags       hints,
+          uint32_t              sizeLog2) {
+    // Applications only use a handful of distinct memory
+    // types and sizes, so a linear search is good enough
+    for (auto& list : cache.lists) {
+      if (list.type == type && list.flags == flags
+       && list.hints == hints && list.sizeLog2 == sizeLog2)
+        return list;
+    }
+
+    SmallBlockList& list = cache.lists.emplace_back();
+    list.type     = type;
+    list.flags    = flags;
+    list.hints    = hints;
+    list.sizeLog2 = sizeLog2;
+    return list;
+  }
+
+
   uint32_t DxvkMemoryAllocator::determineSparseMemoryTypes(
           DxvkDevice*           device) const {
     auto vk = device->vkd();
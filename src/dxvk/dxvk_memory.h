@@ -1,21 +1,58 @@
 #pragma once
 
+#include "../util/thread.h"
+
+#include "../util/sync/sync_spinlock.h"
+
 #include "dxvk_adapter.h"
+#include "dxvk_allocator.h"
 
 namespace dxvk {
   
   class DxvkMemoryAllocator;
   class DxvkMemoryChunk;
+  class DxvkMemoryDefragmenter;
+  class DxvkPagedResource;
   
   /**
    * \brief Memory stats
    * 
    * Reports the amount of device memory
    * allocated and used by the application.
+   * Fragmented memory is the amount of free
+   * chunk memory that lies outside of the
+   * largest free block of each chunk. The
+   * budget is the amount of memory that the
+   * application can allocate on the heap.
    */
   struct DxvkMemoryStats {
-    VkDeviceSize memoryAllocated = 0;
-    VkDeviceSize memoryUsed      = 0;
+    VkDeviceSize memoryAllocated  = 0;
+    VkDeviceSize memoryUsed       = 0;
+    VkDeviceSize memoryFragmented = 0;
+    VkDeviceSize memoryBudget     = 0;
+  };
+
+
+  /**
+   * \brief Memory owner type
+   */
+  enum class DxvkMemoryOwnerType : uint32_t {
+    None    = 0,
+    Buffer  = 1,
+    Image   = 2,
+  };
+
+
+  /**
+   * \brief Memory owner
+   *
+   * Resource that a memory slice is bound to. Only
+   * set for resources that can be relocated in order
+   * to defragment device memory.
+   */
+  struct DxvkMemoryOwner {
+    DxvkPagedResource*    resource = nullptr;
+    DxvkMemoryOwnerType   type     = DxvkMemoryOwnerType::None;
   };
 
 
@@ -62,11 +99,15 @@ namespace dxvk {
    * 
    * Corresponds to a Vulkan memory heap and stores
    * its properties as well as allocation statistics.
+   * The budget is the amount of memory that we can
+   * allocate without exceeding the budget reported
+   * by the driver, and is zero if not yet known.
    */
   struct DxvkMemoryHeap {
     VkMemoryHeap      properties;
     DxvkMemoryStats   stats;
     VkDeviceSize      budget;
+    std::atomic<bool> overBudget;
   };
 
 
@@ -106,7 +147,8 @@ namespace dxvk {
       VkDeviceMemory        memory,
       VkDeviceSize          offset,
       VkDeviceSize          length,
-      void*                 mapPtr);
+      void*                 mapPtr,
+      uint32_t              block = ~0u);
     DxvkMemory             (DxvkMemory&& other);
     DxvkMemory& operator = (DxvkMemory&& other);
     ~DxvkMemory();
@@ -171,6 +213,8 @@ namespace dxvk {
     VkDeviceSize          m_offset = 0;
     VkDeviceSize          m_length = 0;
     void*                 m_mapPtr = nullptr;
+    uint32_t              m_block  = ~0u;
+    bool                  m_cached = false;
     
     void free();
     
@@ -189,6 +233,7 @@ namespace dxvk {
     GpuWritable       = 2,  ///< High-priority resource
     Transient         = 3,  ///< Resource is short-lived
     IgnoreConstraints = 4,  ///< Ignore most allocation flags
+    IgnoreBudget      = 5,  ///< Allow exceeding the heap budget
   };
 
   using DxvkMemoryFlags = Flags<DxvkMemoryFlag>;
@@ -201,7 +246,7 @@ namespace dxvk {
    * sub-allocator. This is not thread-safe.
    */
   class DxvkMemoryChunk : public RcObject {
-    
+    friend class DxvkMemoryDefragmenter;
   public:
     
     DxvkMemoryChunk(
@@ -235,18 +280,29 @@ namespace dxvk {
      * Returns a slice back to the chunk.
      * Called automatically when a memory
      * slice runs out of scope.
-     * \param [in] offset Slice offset
-     * \param [in] length Slice length
+     * \param [in] block Sub-allocator block handle
      */
     void free(
-            VkDeviceSize  offset,
-            VkDeviceSize  length);
+            uint32_t      block);
 
     /**
      * \brief Checks whether the chunk is being used
      * \returns \c true if there are no allocations left
      */
-    bool isEmpty() const;
+    bool isEmpty() const {
+      return m_allocator.isEmpty();
+    }
+
+    /**
+     * \brief Queries amount of fragmented memory
+     *
+     * Free memory that cannot be used to serve
+     * an allocation of the largest free size.
+     * \returns Fragmented memory, in bytes
+     */
+    VkDeviceSize getFragmentedSize() const {
+      return m_allocator.freeSize() - m_allocator.largestFreeBlock();
+    }
 
     /**
      * \brief Checks whether hints and flags of another chunk match
@@ -254,19 +310,57 @@ namespace dxvk {
      */
     bool isCompatible(const Rc<DxvkMemoryChunk>& other) const;
 
+    /**
+     * \brief Queries memory hints of the chunk
+     * \returns Memory hints the chunk was created with
+     */
+    DxvkMemoryFlags getHints() const {
+      return m_hints;
+    }
+
+    /**
+     * \brief Queries underlying device memory
+     * \returns Device memory object of the chunk
+     */
+    const DxvkDeviceMemory& getDeviceMemory() const {
+      return m_memory;
+    }
+
+    /**
+     * \brief Sets owner of an allocation
+     *
+     * \param [in] block Sub-allocator block handle
+     * \param [in] owner Resource owning the allocation
+     */
+    void setOwner(
+            uint32_t              block,
+      const DxvkMemoryOwner&      owner);
+
+    /**
+     * \brief Checks whether the chunk is being evacuated
+     *
+     * Chunks that are being evacuated will not serve any
+     * new allocations, so that they can be freed once
+     * all resources have been moved to other chunks.
+     * \returns \c true if the chunk is being evacuated
+     */
+    bool isEvacuating() const {
+      return m_evacuationFrame != 0;
+    }
+
   private:
     
-    struct FreeSlice {
-      VkDeviceSize offset;
-      VkDeviceSize length;
-    };
-    
     DxvkMemoryAllocator*  m_alloc;
     DxvkMemoryType*       m_type;
     DxvkDeviceMemory      m_memory;
     DxvkMemoryFlags       m_hints;
     
-    std::vector<FreeSlice> m_freeList;
+    DxvkTlsfAllocator     m_allocator;
+
+    std::vector<DxvkMemoryOwner> m_owners;
+
+    std::atomic<uint64_t> m_evacuationFrame  = { 0ull };
+    bool                  m_evacuationFailed = false;
 
     bool checkHints(DxvkMemoryFlags hints) const;
     
@@ -303,6 +397,7 @@ namespace dxvk {
   class DxvkMemoryAllocator {
     friend class DxvkMemory;
     friend class DxvkMemoryChunk;
+    friend class DxvkMemoryDefragmenter;
 
     constexpr static VkDeviceSize SmallAllocationThreshold = 256 << 10;
   public:
@@ -335,16 +430,82 @@ namespace dxvk {
      * \brief Queries memory stats
      * 
      * Returns the total amount of memory
-     * allocated and used for a given heap.
+     * allocated and used for a given heap,
+     * as well as the amount of memory lost
+     * to fragmentation within chunks.
      * \param [in] heap Heap index
      * \returns Memory stats for this heap
      */
-    DxvkMemoryStats getMemoryStats(uint32_t heap) const {
-      return m_memHeaps[heap].stats;
-    }
+    DxvkMemoryStats getMemoryStats(uint32_t heap);
+
+    /**
+     * \brief Sets owner of a memory slice
+     *
+     * Resources that register themselves as the owner of
+     * their memory may get relocated by the defragmenter.
+     * Pass a default owner in order to pin the memory.
+     * Memory served from a thread cache cannot have an
+     * owner since it may be recycled without the lock.
+     * \param [in] memory Memory slice
+     * \param [in] owner Resource owning the memory
+     * \returns \c true if the memory was sub-allocated
+     *    from a chunk, and can therefore be relocated
+     */
+    bool setMemoryOwner(
+      const DxvkMemory&           memory,
+      const DxvkMemoryOwner&      owner);
+
+    /**
+     * \brief Updates memory budget
+     *
+     * Queries the current per-heap memory budget from the
+     * driver. While a heap is over budget, new allocations
+     * that are not high-priority will be placed in system
+     * memory if possible, and the priority of existing
+     * low-priority chunks is lowered so that the driver
+     * pages those out first. Existing allocations are not
+     * moved to system memory, so staying within budget
+     * relies on the driver honoring those priorities.
+     * Also trims the small block caches. Should be called
+     * once per frame.
+     */
+    void updateMemoryBudget();
     
   private:
 
+    constexpr static float PriorityLow    = 0.25f;
+    constexpr static float PriorityMedium = 0.5f;
+    constexpr static float PriorityHigh   = 1.0f;
+
+    constexpr static uint32_t     SmallBlockMinSizeLog2 = 8;
+    constexpr static uint32_t     SmallBlockMaxSizeLog2 = 16;
+    constexpr static uint32_t     SmallBlockListSize    = 16;
+    constexpr static VkDeviceSize SmallBlockBatchSize   = 256 << 10;
+
+    constexpr static uint32_t CacheCountLog2 = 3;
+    constexpr static uint32_t CacheCount     = 1u << CacheCountLog2;
+
+    struct SmallBlock {
+      DxvkMemoryChunk*      chunk  = nullptr;
+      uint32_t              block  = ~0u;
+      VkDeviceSize          offset = 0;
+    };
+
+    struct SmallBlockList {
+      DxvkMemoryType*       type     = nullptr;
+      VkMemoryPropertyFlags flags    = 0;
+      DxvkMemoryFlags       hints;
+      uint32_t              sizeLog2 = 0;
+      uint32_t              count    = 0;
+      bool                  used     = false;
+      std::array<SmallBlock, SmallBlockListSize> blocks = { };
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ThreadCache {
+      sync::Spinlock              lock;
+      std::vector<SmallBlockList> lists;
+    };
+
     DxvkDevice*                                     m_device;
     VkPhysicalDeviceMemoryProperties                m_memProps;
     
@@ -356,6 +517,13 @@ namespace dxvk {
 
     uint32_t m_sparseMemoryTypes = 0u;
 
+    std::array<ThreadCache, CacheCount>             m_caches;
+
+    DxvkMemory tryAllocFromCache(
+      const DxvkMemoryRequirements&           req,
+      const DxvkMemoryProperties&             info,
+            DxvkMemoryFlags                   hints);
+
     DxvkMemory tryAlloc(
       const DxvkMemoryRequirements&           req,
       const DxvkMemoryProperties&             info,
@@ -376,12 +544,16 @@ namespace dxvk {
     
     void free(
       const DxvkMemory&           memory);
+
+    bool tryFreeToCache(
+      const DxvkMemory&           memory);
+
+    void trimCaches();
     
     void freeChunkMemory(
             DxvkMemoryType*       type,
             DxvkMemoryChunk*      chunk,
-            VkDeviceSize          offset,
-            VkDeviceSize          length);
+            uint32_t              block);
     
     void freeDeviceMemory(
             DxvkMemoryType*       type,
@@ -402,6 +574,30 @@ namespace dxvk {
     void freeEmptyChunks(
       const DxvkMemoryHeap*       heap);
 
+    bool isOverBudget(
+      const DxvkMemoryHeap*       heap,
+            VkDeviceSize          allocationSize,
+            float                 priority) const;
+
+    void updateMemoryPriorities(
+      const DxvkMemoryHeap*       heap);
+
+    static float getMemoryPriority(
+            DxvkMemoryFlags       hints);
+
+    static float getDevicePriority(
+      const DxvkMemoryHeap*       heap,
+            float                 priority);
+
+    ThreadCache& getThreadCache();
+
+    static SmallBlockList& getSmallBlockList(
+            ThreadCache&          cache,
+            DxvkMemoryType*       type,
+            VkMemoryPropertyFlags flags,
+            DxvkMemoryFlags       hints,
+            uint32_t              sizeLog2);
+
     uint32_t determineSparseMemoryTypes(
             DxvkDevice*           device) const;
 
@@ -1,3 +1,5 @@
+#include "../util/log/log.h"
+
 #include "dxvk_options.h"
 
 namespace dxvk {
@@ -5,14 +7,26 @@ namespace dxvk {
   DxvkOptions::DxvkOptions(const Config& config) {
     enableDebugUtils      = config.getOption<bool>    ("dxvk.enableDebugUtils",       false);
     enableStateCache      = config.getOption<bool>    ("dxvk.enableStateCache",       true);
+    enableShaderCache     = config.getOption<bool>    ("dxvk.enableShaderCache",      true);
+    optimizeShaders       = config.getOption<bool>    ("dxvk.optimizeShaders",        false);
     numCompilerThreads    = config.getOption<int32_t> ("dxvk.numCompilerThreads",     0);
     enableGraphicsPipelineLibrary = config.getOption<Tristate>("dxvk.enableGraphicsPipelineLibrary", Tristate::Auto);
+    enableExtendedDynamicState = config.getOption<Tristate>("dxvk.enableExtendedDynamicState", Tristate::Auto);
     trackPipelineLifetime = config.getOption<Tristate>("dxvk.trackPipelineLifetime",  Tristate::Auto);
     useRawSsbo            = config.getOption<Tristate>("dxvk.useRawSsbo",             Tristate::Auto);
     maxChunkSize          = config.getOption<int32_t> ("dxvk.maxChunkSize",           0);
+    memoryDefragmentationBudget = config.getOption<int32_t>("dxvk.memoryDefragmentationBudget", 0);
+    csThreadSpinCount     = config.getOption<int32_t> ("dxvk.csThreadSpinCount",      -1);
     hud                   = config.getOption<std::string>("dxvk.hud", "");
     tearFree              = config.getOption<Tristate>("dxvk.tearFree",               Tristate::Auto);
     hideIntegratedGraphics = config.getOption<bool>   ("dxvk.hideIntegratedGraphics", false);
+
+    // Extended dynamic state cannot be used without driver
+    // support, so there is nothing that True could force
+    if (enableExtendedDynamicState == Tristate::True) {
+      Logger::warn("DXVK: dxvk.enableExtendedDynamicState only supports Auto and False, using Auto");
+      enableExtendedDynamicState = Tristate::Auto;
+    }
   }
 
 }
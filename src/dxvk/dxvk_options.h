@@ -14,6 +14,12 @@ namespace dxvk {
     /// Enable state cache
     bool enableStateCache;
 
+    /// Enable persistent shader cache
+    bool enableShaderCache;
+
+    /// Enable SPIR-V optimization passes
+    bool optimizeShaders;
+
     /// Number of compiler threads
     /// when using the state cache
     int32_t numCompilerThreads;
@@ -21,6 +27,11 @@ namespace dxvk {
     /// Enable graphics pipeline library
     Tristate enableGraphicsPipelineLibrary;
 
+    /// Enable extended dynamic state for
+    /// blend and multisample state. Only
+    /// \c Auto and \c False are supported.
+    Tristate enableExtendedDynamicState;
+
     /// Enables pipeline lifetime tracking
     Tristate trackPipelineLifetime;
 
@@ -30,6 +41,14 @@ namespace dxvk {
     /// Maximum memory chunk size in MiB
     int32_t maxChunkSize;
 
+    /// Amount of memory to relocate per
+    /// frame for defragmentation, in MiB
+    int32_t memoryDefragmentationBudget;
+
+    /// Number of iterations the CS thread spins
+    /// for new work before going to sleep
+    int32_t csThreadSpinCount;
+
     /// HUD elements
     std::string hud;
 
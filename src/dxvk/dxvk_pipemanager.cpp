@@ -18,16 +18,35 @@ namespace dxvk {
   }
 
 
+  DxvkPipelineWorkerStats DxvkPipelineWorkers::getStats() const {
+    DxvkPipelineWorkerStats result;
+    result.tasksCompleted = m_tasksCompleted.load(std::memory_order_acquire);
+    result.tasksTotal = m_tasksTotal.load(std::memory_order_relaxed);
+    result.tasksCancelled = m_tasksCancelled.load(std::memory_order_relaxed);
+    result.tasksStolen = m_tasksStolen.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < result.queues.size(); i++) {
+      const auto& counters = m_queueCounters[i];
+
+      uint64_t started = counters.started.load(std::memory_order_relaxed);
+      uint64_t retired = started + counters.cancelled.load(std::memory_order_relaxed);
+      uint64_t queued = counters.queued.load(std::memory_order_relaxed);
+
+      auto& queue = result.queues[i];
+      queue.queueDepth = queued > retired ? queued - retired : 0ull;
+      queue.tasksStarted = started;
+      queue.totalWaitTime = counters.totalWaitTime.load(std::memory_order_relaxed);
+      queue.maxWaitTime = counters.maxWaitTime.load(std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+
+
   void DxvkPipelineWorkers::compilePipelineLibrary(
           DxvkShaderPipelineLibrary*      library,
           DxvkPipelinePriority            priority) {
-    std::unique_lock lock(m_lock);
-    this->startWorkers();
-
-    m_tasksTotal += 1;
-
-    m_buckets[uint32_t(priority)].queue.emplace(library);
-    notifyWorkers(priority);
+    enqueueEntry(PipelineEntry(library), priority);
   }
 
 
@@ -35,128 +54,327 @@ namespace dxvk {
           DxvkGraphicsPipeline*           pipeline,
     const DxvkGraphicsPipelineStateInfo&  state,
           DxvkPipelinePriority            priority) {
-    std::unique_lock lock(m_lock);
-    this->startWorkers();
-
     pipeline->acquirePipeline();
-    m_tasksTotal += 1;
 
-    m_buckets[uint32_t(priority)].queue.emplace(pipeline, state);
-    notifyWorkers(priority);
+    enqueueEntry(PipelineEntry(pipeline, state), priority);
+  }
+
+
+  void DxvkPipelineWorkers::cancelGraphicsPipeline(
+          DxvkGraphicsPipeline*           pipeline) {
+    if (m_state.load(std::memory_order_acquire) == WorkerState::Idle)
+      return;
+
+    // Remove queued items first. Workers mark an item as active
+    // before releasing the lock of the queue they took it from,
+    // so any item that is not found here must be marked active.
+    for (uint32_t i = 0; i < m_workerCount; i++) {
+      auto& worker = m_workers[i];
+      std::unique_lock lock(worker.lock);
+
+      for (auto& queue : worker.queues) {
+        for (auto e = queue.begin(); e != queue.end(); ) {
+          if (e->graphicsPipeline == pipeline) {
+            cancelEntry(*e);
+            e = queue.erase(e);
+          } else {
+            e++;
+          }
+        }
+      }
+    }
+
+    for (uint32_t i = 0; i < m_workerCount; i++) {
+      auto& worker = m_workers[i];
+      std::unique_lock lock(worker.lock);
+
+      worker.cond.wait(lock, [&worker, pipeline] {
+        return worker.activePipeline.load() != pipeline;
+      });
+    }
   }
 
 
   void DxvkPipelineWorkers::stopWorkers() {
     { std::unique_lock lock(m_lock);
 
-      if (!m_workersRunning)
+      if (m_state.exchange(WorkerState::Stopped) != WorkerState::Running)
+        return;
+
+      for (uint32_t i = 0; i < m_workerCount; i++) {
+        std::unique_lock workerLock(m_workers[i].lock);
+        m_workers[i].cond.notify_all();
+      }
+    }
+
+    for (uint32_t i = 0; i < m_workerCount; i++)
+      m_workers[i].thread.join();
+
+    // Worker objects are kept alive until the object gets
+    // destroyed, since other threads may still access them.
+    cancelAllEntries();
+  }
+
+
+  void DxvkPipelineWorkers::enqueueEntry(
+          PipelineEntry&&                 entry,
+          DxvkPipelinePriority            priority) {
+    m_tasksTotal += 1;
+
+    if (unlikely(m_state.load(std::memory_order_acquire) != WorkerState::Running)) {
+      std::unique_lock lock(m_lock);
+
+      if (!startWorkers()) {
+        // Discard work submitted after the workers
+        // were stopped, nothing will process it.
+        entry.priority = priority;
+        m_queueCounters[uint32_t(priority)].queued += 1;
+
+        cancelEntry(entry);
         return;
+      }
+    }
+
+    // If no worker can process items of the given priority,
+    // treat it as the lowest priority that can be processed.
+    while (!m_eligibleWorkers[uint32_t(priority)])
+      priority = DxvkPipelinePriority(uint32_t(priority) - 1);
+
+    entry.priority = priority;
+    entry.queueTime = high_resolution_clock::now();
+
+    m_queueCounters[uint32_t(priority)].queued += 1;
 
-      m_workersRunning = false;
+    PipelineWorker* worker = findTargetWorker(priority);
 
-      for (uint32_t i = 0; i < m_buckets.size(); i++)
-        m_buckets[i].cond.notify_all();
+    { std::unique_lock lock(worker->lock);
+
+      // The workers may have been stopped since we last checked.
+      // Since stopWorkers drains all queues under the worker lock
+      // after changing the state, checking again here guarantees
+      // that the entry either gets drained or is cancelled here.
+      if (unlikely(m_state.load(std::memory_order_acquire) != WorkerState::Running)) {
+        lock.unlock();
+
+        cancelEntry(entry);
+        return;
+      }
+
+      worker->queues[uint32_t(priority)].push_back(std::move(entry));
+      worker->wakeup = true;
     }
 
-    for (auto& worker : m_workers)
-      worker.join();
+    worker->cond.notify_all();
+  }
+
 
-    m_workers.clear();
+  DxvkPipelineWorkers::PipelineWorker* DxvkPipelineWorkers::findTargetWorker(
+          DxvkPipelinePriority            priority) {
+    uint32_t count = m_eligibleWorkers[uint32_t(priority)];
+    uint32_t first = m_nextWorker.fetch_add(1, std::memory_order_relaxed) % count;
+
+    // Prefer idle workers so that new work gets picked up immediately.
+    // Otherwise, distribute work evenly and rely on work stealing.
+    for (uint32_t i = 0; i < count; i++) {
+      PipelineWorker* worker = &m_workers[(first + i) % count];
+
+      if (worker->idle.load(std::memory_order_relaxed))
+        return worker;
+    }
+
+    return &m_workers[first];
   }
 
 
-  void DxvkPipelineWorkers::notifyWorkers(DxvkPipelinePriority priority) {
-    uint32_t index = uint32_t(priority);
+  bool DxvkPipelineWorkers::fetchEntry(
+          uint32_t                        workerIndex,
+          PipelineEntry&                  entry) {
+    auto& worker = m_workers[workerIndex];
+    auto now = high_resolution_clock::now();
 
-    // If any workers are idle in a suitable set, notify the corresponding
-    // condition variable. If all workers are busy anyway, we know that the
-    // job is going to be picked up at some point anyway.
-    for (uint32_t i = index; i < m_buckets.size(); i++) {
-      if (m_buckets[i].idleWorkers) {
-        m_buckets[i].cond.notify_one();
-        break;
+    // Process local work first and only steal from
+    // other workers if there is nothing left to do.
+    for (uint32_t i = 0; i < m_workerCount; i++) {
+      uint32_t victimIndex = (workerIndex + i) % m_workerCount;
+
+      if (takeEntry(m_workers[victimIndex], worker, now, entry)) {
+        if (victimIndex != workerIndex)
+          m_tasksStolen += 1;
+
+        auto& counters = m_queueCounters[uint32_t(entry.priority)];
+
+        uint64_t waitTime = std::chrono::duration_cast<std::chrono::microseconds>(now - entry.queueTime).count();
+        uint64_t maxWaitTime = counters.maxWaitTime.load(std::memory_order_relaxed);
+
+        while (waitTime > maxWaitTime && !counters.maxWaitTime.compare_exchange_weak(maxWaitTime, waitTime))
+          continue;
+
+        counters.totalWaitTime += waitTime;
+        counters.started += 1;
+        return true;
       }
     }
+
+    return false;
   }
 
 
-  void DxvkPipelineWorkers::startWorkers() {
-    if (!std::exchange(m_workersRunning, true)) {
-      // Use all available cores by default
-      uint32_t workerCount = dxvk::thread::hardware_concurrency();
+  bool DxvkPipelineWorkers::takeEntry(
+          PipelineWorker&                 victim,
+          PipelineWorker&                 worker,
+          high_resolution_clock::time_point now,
+          PipelineEntry&                  entry) {
+    std::unique_lock lock(victim.lock);
+
+    // Pick the item with the highest effective priority, where
+    // each aging interval spent in the queue raises the priority
+    // by one. On ties, prefer the item with the higher priority.
+    uint32_t bestQueue = ~0u;
+    uint32_t bestPriority = ~0u;
+
+    for (uint32_t i = 0; i <= uint32_t(worker.maxPriority); i++) {
+      const auto& queue = victim.queues[i];
 
-      if (workerCount <  1) workerCount =  1;
-      if (workerCount > 64) workerCount = 64;
+      if (queue.empty())
+        continue;
 
-      // Reduce worker count on 32-bit to save adderss space
-      if (env::is32BitHostPlatform())
-        workerCount = std::min(workerCount, 16u);
+      uint32_t age = uint32_t((now - queue.front().queueTime) / AgingInterval);
+      uint32_t priority = i - std::min(i, age);
 
-      if (m_device->config().numCompilerThreads > 0)
-        workerCount = m_device->config().numCompilerThreads;
+      if (priority < bestPriority) {
+        bestQueue = i;
+        bestPriority = priority;
+      }
+    }
 
-      // Number of workers that can process pipeline pipelines with normal
-      // priority. Any other workers can only build high-priority pipelines.
-      uint32_t npWorkerCount = std::max(((workerCount - 1) * 5) / 7, 1u);
-      uint32_t lpWorkerCount = std::max(((workerCount - 1) * 2) / 7, 1u);
+    if (bestQueue == ~0u)
+      return false;
 
-      m_workers.reserve(workerCount);
+    auto& queue = victim.queues[bestQueue];
+    entry = std::move(queue.front());
+    queue.pop_front();
 
-      for (size_t i = 0; i < workerCount; i++) {
-        DxvkPipelinePriority priority = DxvkPipelinePriority::Normal;
+    worker.activePipeline.store(entry.graphicsPipeline);
+    return true;
+  }
 
-        if (m_device->canUseGraphicsPipelineLibrary()) {
-          if (i >= npWorkerCount)
-            priority = DxvkPipelinePriority::High;
-          else if (i < lpWorkerCount)
-            priority = DxvkPipelinePriority::Low;
-        }
 
-        auto& worker = m_workers.emplace_back([this, priority] {
-          runWorker(priority);
-        });
-        
-        worker.set_priority(ThreadPriority::Lowest);
+  void DxvkPipelineWorkers::cancelEntry(
+    const PipelineEntry&                  entry) {
+    if (entry.graphicsPipeline)
+      entry.graphicsPipeline->releasePipeline();
+
+    m_queueCounters[uint32_t(entry.priority)].cancelled += 1;
+
+    m_tasksCancelled += 1;
+    m_tasksCompleted += 1;
+  }
+
+
+  void DxvkPipelineWorkers::cancelAllEntries() {
+    for (uint32_t i = 0; i < m_workerCount; i++) {
+      auto& worker = m_workers[i];
+      std::unique_lock lock(worker.lock);
+
+      for (auto& queue : worker.queues) {
+        for (const auto& entry : queue)
+          cancelEntry(entry);
+
+        queue.clear();
       }
+    }
+  }
+
+
+  bool DxvkPipelineWorkers::startWorkers() {
+    WorkerState state = m_state.load();
+
+    if (state != WorkerState::Idle)
+      return state == WorkerState::Running;
+
+    // Use all available cores by default
+    uint32_t workerCount = dxvk::thread::hardware_concurrency();
+
+    if (workerCount <  1) workerCount =  1;
+    if (workerCount > 64) workerCount = 64;
+
+    // Reduce worker count on 32-bit to save adderss space
+    if (env::is32BitHostPlatform())
+      workerCount = std::min(workerCount, 16u);
 
-      Logger::info(str::format("DXVK: Using ", workerCount, " compiler threads"));
+    if (m_device->config().numCompilerThreads > 0)
+      workerCount = m_device->config().numCompilerThreads;
+
+    // Number of workers that can process pipeline pipelines with normal
+    // priority. Any other workers can only build high-priority pipelines.
+    uint32_t npWorkerCount = std::max(((workerCount - 1) * 5) / 7, 1u);
+    uint32_t lpWorkerCount = std::max(((workerCount - 1) * 2) / 7, 1u);
+
+    m_workerCount = workerCount;
+    m_workers = std::make_unique<PipelineWorker[]>(workerCount);
+
+    for (uint32_t i = 0; i < workerCount; i++) {
+      DxvkPipelinePriority priority = DxvkPipelinePriority::Normal;
+
+      if (m_device->canUseGraphicsPipelineLibrary()) {
+        if (i >= npWorkerCount)
+          priority = DxvkPipelinePriority::High;
+        else if (i < lpWorkerCount)
+          priority = DxvkPipelinePriority::Low;
+      }
+
+      m_workers[i].maxPriority = priority;
+
+      for (uint32_t j = 0; j <= uint32_t(priority); j++)
+        m_eligibleWorkers[j] += 1;
     }
+
+    // Publish worker objects before starting any threads
+    m_state.store(WorkerState::Running, std::memory_order_release);
+
+    for (uint32_t i = 0; i < workerCount; i++) {
+      auto& worker = m_workers[i];
+
+      worker.thread = dxvk::thread([this, i] {
+        runWorker(i);
+      });
+
+      worker.thread.set_priority(ThreadPriority::Lowest);
+    }
+
+    Logger::info(str::format("DXVK: Using ", workerCount, " compiler threads"));
+    return true;
   }
 
 
-  void DxvkPipelineWorkers::runWorker(DxvkPipelinePriority maxPriority) {
+  void DxvkPipelineWorkers::runWorker(
+          uint32_t                        workerIndex) {
     static const std::array<char, 3> suffixes = { 'h', 'n', 'l' };
 
-    const uint32_t maxPriorityIndex = uint32_t(maxPriority);
-    env::setThreadName(str::format("dxvk-shader-", suffixes.at(maxPriorityIndex)));
+    auto& worker = m_workers[workerIndex];
+    env::setThreadName(str::format("dxvk-shader-", suffixes.at(uint32_t(worker.maxPriority))));
 
     while (true) {
       PipelineEntry entry;
 
-      { std::unique_lock lock(m_lock);
-        auto& bucket = m_buckets[maxPriorityIndex];
-
-        bucket.idleWorkers += 1;
-        bucket.cond.wait(lock, [this, maxPriorityIndex, &entry] {
-          // Attempt to fetch a work item from the
-          // highest-priority queue that is not empty
-          for (uint32_t i = 0; i <= maxPriorityIndex; i++) {
-            if (!m_buckets[i].queue.empty()) {
-              entry = m_buckets[i].queue.front();
-              m_buckets[i].queue.pop();
-              return true;
-            }
-          }
+      // Skip pending work, exiting early is
+      // more important in this case.
+      if (m_state.load() != WorkerState::Running)
+        break;
 
-          return !m_workersRunning;
-        });
+      if (!fetchEntry(workerIndex, entry)) {
+        std::unique_lock lock(worker.lock);
 
-        bucket.idleWorkers -= 1;
+        worker.idle.store(true);
+        worker.cond.wait(lock, [this, &worker] {
+          return worker.wakeup
+              || hasEntries(worker)
+              || m_state.load() != WorkerState::Running;
+        });
 
-        // Skip pending work, exiting early is
-        // more important in this case.
-        if (!m_workersRunning)
-          break;
+        worker.idle.store(false);
+        worker.wakeup = false;
+        continue;
       }
 
       if (entry.pipelineLibrary) {
@@ -166,11 +384,29 @@ namespace dxvk {
         entry.graphicsPipeline->releasePipeline();
       }
 
+      if (entry.graphicsPipeline) {
+        // Unblock threads waiting for the pipeline to be cancelled
+        std::unique_lock lock(worker.lock);
+        worker.activePipeline.store(nullptr);
+        worker.cond.notify_all();
+      }
+
       m_tasksCompleted += 1;
     }
   }
 
 
+  bool DxvkPipelineWorkers::hasEntries(
+    const PipelineWorker&                 worker) {
+    for (const auto& queue : worker.queues) {
+      if (!queue.empty())
+        return true;
+    }
+
+    return false;
+  }
+
+
   DxvkPipelineManager::DxvkPipelineManager(
           DxvkDevice*         device)
   : m_device    (device),
@@ -263,18 +499,9 @@ namespace dxvk {
           // pipeline library so that it can potentially be reused.
           // Don't dispatch the pipeline library to a worker thread
           // since it should be compiled on demand anyway.
+          // The pipeline library is registered with the state
+          // cache once a base pipeline using it is drawn with.
           vsLibrary = createPipelineLibraryLocked(vsKey);
-
-          // Register the pipeline library with the state cache
-          // so that subsequent runs can still compile it early
-          DxvkStateCacheKey shaderKeys;
-          shaderKeys.vs = shaders.vs->getShaderKey();
-
-          if (shaders.tcs != nullptr) shaderKeys.tcs = shaders.tcs->getShaderKey();
-          if (shaders.tes != nullptr) shaderKeys.tes = shaders.tes->getShaderKey();
-          if (shaders.gs  != nullptr) shaderKeys.gs  = shaders.gs->getShaderKey();
-
-          m_stateCache.addPipelineLibrary(shaderKeys);
         }
       }
 
@@ -374,6 +601,7 @@ namespace dxvk {
     DxvkPipelineCount result;
     result.numGraphicsPipelines = m_stats.numGraphicsPipelines.load();
     result.numGraphicsLibraries = m_stats.numGraphicsLibraries.load();
+    result.numGraphicsPipelinesSaved = m_stats.numGraphicsPipelinesSaved.load();
     result.numComputePipelines  = m_stats.numComputePipelines.load();
     return result;
   }
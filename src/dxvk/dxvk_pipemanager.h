@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -22,6 +24,7 @@ namespace dxvk {
   struct DxvkPipelineCount {
     uint32_t numGraphicsPipelines;
     uint32_t numGraphicsLibraries;
+    uint32_t numGraphicsPipelinesSaved;
     uint32_t numComputePipelines;
   };
 
@@ -31,12 +34,36 @@ namespace dxvk {
   struct DxvkPipelineStats {
     std::atomic<uint32_t> numGraphicsPipelines  = { 0u };
     std::atomic<uint32_t> numGraphicsLibraries  = { 0u };
+    std::atomic<uint32_t> numGraphicsPipelinesSaved = { 0u };
     std::atomic<uint32_t> numComputePipelines   = { 0u };
   };
 
+  /**
+   * \brief Pipeline worker queue stats
+   *
+   * Stores statistics for one priority class.
+   * Wait times are given in microseconds.
+   */
+  struct DxvkPipelineQueueStats {
+    uint64_t queueDepth;
+    uint64_t tasksStarted;
+    uint64_t totalWaitTime;
+    uint64_t maxWaitTime;
+  };
+
+  /**
+   * \brief Pipeline worker stats
+   *
+   * Cancelled tasks are included in the number of
+   * completed tasks. Queue stats are indexed by
+   * pipeline priority.
+   */
   struct DxvkPipelineWorkerStats {
     uint64_t tasksCompleted;
     uint64_t tasksTotal;
+    uint64_t tasksCancelled;
+    uint64_t tasksStolen;
+    std::array<DxvkPipelineQueueStats, 3> queues;
   };
 
   /**
@@ -53,6 +80,13 @@ namespace dxvk {
    *
    * Spawns worker threads to compile shader pipeline
    * libraries and optimized pipelines asynchronously.
+   *
+   * Each worker owns a set of queues, one per priority, so
+   * that submissions and workers do not contend on a single
+   * lock. Work is handed to an idle worker if possible, and
+   * workers that run out of work steal from other workers.
+   * Items that have been waiting for a long time are aged
+   * towards a higher priority so that they do not starve.
    */
   class DxvkPipelineWorkers {
 
@@ -69,12 +103,7 @@ namespace dxvk {
      * The returned result may be immediately out of date.
      * \returns Worker statistics
      */
-    DxvkPipelineWorkerStats getStats() const {
-      DxvkPipelineWorkerStats result;
-      result.tasksCompleted = m_tasksCompleted.load(std::memory_order_acquire);
-      result.tasksTotal = m_tasksTotal.load(std::memory_order_relaxed);
-      return result;
-    }
+    DxvkPipelineWorkerStats getStats() const;
 
     /**
      * \brief Compiles a pipeline library
@@ -100,16 +129,39 @@ namespace dxvk {
       const DxvkGraphicsPipelineStateInfo&  state,
             DxvkPipelinePriority            priority);
 
+    /**
+     * \brief Cancels pending work for a graphics pipeline
+     *
+     * Removes any queued work items for the given pipeline
+     * and waits for work that is already in progress to
+     * complete. Must be called before the pipeline object
+     * gets destroyed.
+     * \param [in] pipeline Graphics pipeline
+     */
+    void cancelGraphicsPipeline(
+            DxvkGraphicsPipeline*           pipeline);
+
     /**
      * \brief Stops all worker threads
      *
      * Stops threads and waits for their current work
-     * to complete. Queued work will be discarded.
+     * to complete. Queued work will be cancelled, and
+     * no new work will be accepted afterwards.
      */
     void stopWorkers();
 
   private:
 
+    /// Time after which a queued item is treated as if
+    /// it had the next higher priority
+    constexpr static auto AgingInterval = std::chrono::milliseconds(500);
+
+    enum class WorkerState : uint32_t {
+      Idle    = 0,
+      Running = 1,
+      Stopped = 2,
+    };
+
     struct PipelineEntry {
       PipelineEntry()
       : pipelineLibrary(nullptr), graphicsPipeline(nullptr) { }
@@ -123,30 +175,79 @@ namespace dxvk {
       DxvkShaderPipelineLibrary*    pipelineLibrary;
       DxvkGraphicsPipeline*         graphicsPipeline;
       DxvkGraphicsPipelineStateInfo graphicsState;
+      DxvkPipelinePriority          priority = DxvkPipelinePriority::High;
+      high_resolution_clock::time_point queueTime;
+    };
+
+    struct PipelineWorker {
+      dxvk::mutex                     lock;
+      dxvk::condition_variable        cond;
+      std::array<std::deque<PipelineEntry>, 3> queues;
+      DxvkPipelinePriority            maxPriority = DxvkPipelinePriority::High;
+      bool                            wakeup      = false;
+      std::atomic<bool>               idle        = { false };
+      std::atomic<DxvkGraphicsPipeline*> activePipeline = { nullptr };
+      dxvk::thread                    thread;
     };
 
-    struct PipelineBucket {
-      dxvk::condition_variable  cond;
-      std::queue<PipelineEntry> queue;
-      uint32_t                  idleWorkers = 0;
+    struct PipelineQueueCounters {
+      std::atomic<uint64_t>           queued        = { 0ull };
+      std::atomic<uint64_t>           started       = { 0ull };
+      std::atomic<uint64_t>           cancelled     = { 0ull };
+      std::atomic<uint64_t>           totalWaitTime = { 0ull };
+      std::atomic<uint64_t>           maxWaitTime   = { 0ull };
     };
 
     DxvkDevice*                       m_device;
 
     std::atomic<uint64_t>             m_tasksTotal     = { 0ull };
     std::atomic<uint64_t>             m_tasksCompleted = { 0ull };
+    std::atomic<uint64_t>             m_tasksCancelled = { 0ull };
+    std::atomic<uint64_t>             m_tasksStolen    = { 0ull };
+
+    std::array<PipelineQueueCounters, 3> m_queueCounters;
 
     dxvk::mutex                       m_lock;
-    std::array<PipelineBucket, 3>     m_buckets;
+    std::atomic<WorkerState>          m_state = { WorkerState::Idle };
+
+    uint32_t                          m_workerCount = 0;
+    std::unique_ptr<PipelineWorker[]> m_workers;
+
+    /// Number of workers that can process items of
+    /// a given priority. Eligible workers always
+    /// have the lowest indices.
+    std::array<uint32_t, 3>           m_eligibleWorkers = { };
+    std::atomic<uint32_t>             m_nextWorker = { 0u };
+
+    void enqueueEntry(
+            PipelineEntry&&                 entry,
+            DxvkPipelinePriority            priority);
+
+    PipelineWorker* findTargetWorker(
+            DxvkPipelinePriority            priority);
+
+    bool fetchEntry(
+            uint32_t                        workerIndex,
+            PipelineEntry&                  entry);
+
+    bool takeEntry(
+            PipelineWorker&                 victim,
+            PipelineWorker&                 worker,
+            high_resolution_clock::time_point now,
+            PipelineEntry&                  entry);
+
+    void cancelEntry(
+      const PipelineEntry&                  entry);
 
-    bool                              m_workersRunning = false;
-    std::vector<dxvk::thread>         m_workers;
+    void cancelAllEntries();
 
-    void notifyWorkers(DxvkPipelinePriority priority);
+    bool startWorkers();
 
-    void startWorkers();
+    void runWorker(
+            uint32_t                        workerIndex);
 
-    void runWorker(DxvkPipelinePriority maxPriority);
+    static bool hasEntries(
+      const PipelineWorker&                 worker);
 
   };
 
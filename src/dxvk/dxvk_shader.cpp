@@ -2,6 +2,8 @@
 #include "dxvk_pipemanager.h"
 #include "dxvk_shader.h"
 
+#include "../spirv/spirv_optimizer.h"
+
 #include <dxvk_dummy_frag.h>
 
 #include <algorithm>
@@ -13,7 +15,8 @@ namespace dxvk {
   bool DxvkShaderModuleCreateInfo::eq(const DxvkShaderModuleCreateInfo& other) const {
     bool eq = fsDualSrcBlend  == other.fsDualSrcBlend
            && fsFlatShading   == other.fsFlatShading
-           && undefinedInputs == other.undefinedInputs;
+           && undefinedInputs == other.undefinedInputs
+           && unusedOutputs   == other.unusedOutputs;
 
     for (uint32_t i = 0; i < rtSwizzles.size() && eq; i++) {
       eq = rtSwizzles[i].r == other.rtSwizzles[i].r
@@ -31,6 +34,7 @@ namespace dxvk {
     hash.add(uint32_t(fsDualSrcBlend));
     hash.add(uint32_t(fsFlatShading));
     hash.add(undefinedInputs);
+    hash.add(unusedOutputs);
 
     for (uint32_t i = 0; i < rtSwizzles.size(); i++) {
       hash.add(rtSwizzles[i].r);
@@ -75,23 +79,13 @@ namespace dxvk {
 
     // Run an analysis pass over the SPIR-V code to gather some
     // info that we may need during pipeline compilation.
-    std::vector<BindingOffsets> bindingOffsets;
-    std::vector<uint32_t> varIds;
     std::vector<uint32_t> sampleMaskIds;
 
     SpirvCodeBuffer code = std::move(spirv);
-    uint32_t o1VarId = 0;
+    m_offsets = findCodeOffsets(code);
     
     for (auto ins : code) {
       if (ins.opCode() == spv::OpDecorate) {
-        if (ins.arg(2) == spv::DecorationBinding) {
-          uint32_t varId = ins.arg(1);
-          bindingOffsets.resize(std::max(bindingOffsets.size(), size_t(varId + 1)));
-          bindingOffsets[varId].bindingId = ins.arg(3);
-          bindingOffsets[varId].bindingOffset = ins.offset() + 3;
-          varIds.push_back(varId);
-        }
-
         if (ins.arg(2) == spv::DecorationBuiltIn) {
           if (ins.arg(3) == spv::BuiltInSampleMask)
             sampleMaskIds.push_back(ins.arg(1));
@@ -99,24 +93,10 @@ namespace dxvk {
             m_flags.set(DxvkShaderFlag::ExportsPosition);
         }
 
-        if (ins.arg(2) == spv::DecorationDescriptorSet) {
-          uint32_t varId = ins.arg(1);
-          bindingOffsets.resize(std::max(bindingOffsets.size(), size_t(varId + 1)));
-          bindingOffsets[varId].setOffset = ins.offset() + 3;
-        }
-
         if (ins.arg(2) == spv::DecorationSpecId) {
           if (ins.arg(3) <= MaxNumSpecConstants)
             m_specConstantMask |= 1u << ins.arg(3);
         }
-
-        if (ins.arg(2) == spv::DecorationLocation && ins.arg(3) == 1) {
-          m_o1LocOffset = ins.offset() + 3;
-          o1VarId = ins.arg(1);
-        }
-        
-        if (ins.arg(2) == spv::DecorationIndex && ins.arg(1) == o1VarId)
-          m_o1IdxOffset = ins.offset() + 3;
       }
 
       if (ins.opCode() == spv::OpMemberDecorate) {
@@ -161,14 +141,6 @@ namespace dxvk {
         break;
     }
 
-    // Combine spec constant IDs with other binding info
-    for (auto varId : varIds) {
-      BindingOffsets info = bindingOffsets[varId];
-
-      if (info.bindingOffset)
-        m_bindingOffsets.push_back(info);
-    }
-
     // Don't set pipeline library flag if the shader
     // doesn't actually support pipeline libraries
     m_needsLibraryCompile = canUsePipelineLibrary(true);
@@ -183,11 +155,24 @@ namespace dxvk {
   SpirvCodeBuffer DxvkShader::getCode(
     const DxvkBindingLayoutObjects*   layout,
     const DxvkShaderModuleCreateInfo& state) const {
-    SpirvCodeBuffer spirvCode = m_code.decompress();
+    // Demote outputs that the next stage does not consume to
+    // private variables, and let the optimizer remove any code
+    // that only exists to compute those outputs. This changes
+    // code offsets, so the pruned code comes with its own.
+    CodeOffsets prunedOffsets;
+
+    SpirvCodeBuffer spirvCode = state.unusedOutputs
+      ? getPrunedCode(state.unusedOutputs, prunedOffsets)
+      : m_code.decompress();
+
+    const CodeOffsets& offsets = state.unusedOutputs
+      ? prunedOffsets
+      : m_offsets;
+
     uint32_t* code = spirvCode.data();
     
     // Remap resource binding IDs
-    for (const auto& info : m_bindingOffsets) {
+    for (const auto& info : offsets.bindingOffsets) {
       auto mappedBinding = layout->lookupBinding(m_info.stage, info.bindingId);
 
       if (mappedBinding) {
@@ -200,8 +185,8 @@ namespace dxvk {
 
     // For dual-source blending we need to re-map
     // location 1, index 0 to location 0, index 1
-    if (state.fsDualSrcBlend && m_o1IdxOffset && m_o1LocOffset)
-      std::swap(code[m_o1IdxOffset], code[m_o1LocOffset]);
+    if (state.fsDualSrcBlend && offsets.o1IdxOffset && offsets.o1LocOffset)
+      std::swap(code[offsets.o1IdxOffset], code[offsets.o1LocOffset]);
     
     // Replace undefined input variables with zero
     for (uint32_t u : bit::BitMask(state.undefinedInputs))
@@ -219,6 +204,83 @@ namespace dxvk {
   }
 
 
+  SpirvCodeBuffer DxvkShader::getPrunedCode(
+          uint32_t                  unusedOutputs,
+          CodeOffsets&              offsets) const {
+    std::lock_guard<dxvk::mutex> lock(m_prunedMutex);
+
+    // Pipelines with the same set of unused outputs share the
+    // pruned module, so only run the rewrite and optimizer once
+    auto entry = m_prunedCode.find(unusedOutputs);
+
+    if (entry == m_prunedCode.end()) {
+      SpirvCodeBuffer code = m_code.decompress();
+      eliminateOutputs(code, unusedOutputs);
+      code = SpirvOptimizer(code).optimize();
+
+      PrunedCode pruned;
+      pruned.offsets = findCodeOffsets(code);
+      pruned.code = SpirvCompressedBuffer(code);
+
+      entry = m_prunedCode.emplace(unusedOutputs, std::move(pruned)).first;
+    }
+
+    offsets = entry->second.offsets;
+    return entry->second.code.decompress();
+  }
+
+
+  DxvkShader::CodeOffsets DxvkShader::findCodeOffsets(
+          SpirvCodeBuffer&          code) {
+    CodeOffsets result;
+
+    std::vector<BindingOffsets> bindingOffsets;
+    std::vector<uint32_t> varIds;
+
+    uint32_t o1VarId = 0;
+
+    for (auto ins : code) {
+      if (ins.opCode() == spv::OpDecorate) {
+        if (ins.arg(2) == spv::DecorationBinding) {
+          uint32_t varId = ins.arg(1);
+          bindingOffsets.resize(std::max(bindingOffsets.size(), size_t(varId + 1)));
+          bindingOffsets[varId].bindingId = ins.arg(3);
+          bindingOffsets[varId].bindingOffset = ins.offset() + 3;
+          varIds.push_back(varId);
+        }
+
+        if (ins.arg(2) == spv::DecorationDescriptorSet) {
+          uint32_t varId = ins.arg(1);
+          bindingOffsets.resize(std::max(bindingOffsets.size(), size_t(varId + 1)));
+          bindingOffsets[varId].setOffset = ins.offset() + 3;
+        }
+
+        if (ins.arg(2) == spv::DecorationLocation && ins.arg(3) == 1) {
+          result.o1LocOffset = ins.offset() + 3;
+          o1VarId = ins.arg(1);
+        }
+
+        if (ins.arg(2) == spv::DecorationIndex && ins.arg(1) == o1VarId)
+          result.o1IdxOffset = ins.offset() + 3;
+      }
+
+      // Decorations precede all function definitions
+      if (ins.opCode() == spv::OpFunction)
+        break;
+    }
+
+    // Combine spec constant IDs with other binding info
+    for (auto varId : varIds) {
+      BindingOffsets info = bindingOffsets[varId];
+
+      if (info.bindingOffset)
+        result.bindingOffsets.push_back(info);
+    }
+
+    return result;
+  }
+
+
   bool DxvkShader::canUsePipelineLibrary(bool standalone) const {
     if (standalone) {
       // Standalone pipeline libraries are unsupported for geometry
@@ -475,6 +537,151 @@ namespace dxvk {
   }
   
 
+  void DxvkShader::eliminateOutputs(SpirvCodeBuffer& code, uint32_t locationMask) {
+    uint32_t spirvVersion = code.data()[1];
+
+    std::unordered_map<uint32_t, uint32_t> locations;
+    std::unordered_set<uint32_t> patchIds;
+
+    // Output variables that get demoted, as well as all
+    // access chains that are derived from those variables
+    std::unordered_set<uint32_t> varIds;
+    std::unordered_set<uint32_t> derivedIds;
+    std::unordered_set<uint32_t> outputPointerTypes;
+
+    for (auto ins : code) {
+      switch (ins.opCode()) {
+        case spv::OpDecorate: {
+          if (ins.arg(2) == spv::DecorationLocation)
+            locations.insert({ ins.arg(1), ins.arg(3) });
+
+          if (ins.arg(2) == spv::DecorationPatch)
+            patchIds.insert(ins.arg(1));
+        } break;
+
+        case spv::OpVariable: {
+          if (ins.arg(3) != spv::StorageClassOutput)
+            break;
+
+          uint32_t varId = ins.arg(2);
+          auto location = locations.find(varId);
+
+          if (location == locations.end() || location->second >= 32
+           || !(locationMask & (1u << location->second))
+           || patchIds.find(varId) != patchIds.end())
+            break;
+
+          varIds.insert(varId);
+          derivedIds.insert(varId);
+          outputPointerTypes.insert(ins.arg(1));
+        } break;
+
+        case spv::OpAccessChain:
+        case spv::OpInBoundsAccessChain: {
+          if (derivedIds.find(ins.arg(3)) != derivedIds.end()) {
+            derivedIds.insert(ins.arg(2));
+            outputPointerTypes.insert(ins.arg(1));
+          }
+        } break;
+
+        default:
+          break;
+      }
+    }
+
+    if (varIds.empty())
+      return;
+
+    // Declare private pointer types for all output pointer types
+    // that we need to replace. New types are declared right after
+    // the original type so that the pointee type is defined. We
+    // can't reuse an existing private pointer type since it may
+    // only be declared after the output variable.
+    std::unordered_map<uint32_t, uint32_t> privateTypes;
+
+    for (uint32_t typeId : outputPointerTypes)
+      privateTypes.insert({ typeId, code.allocId() });
+
+    // Rebuild the code with the patched declarations
+    SpirvCodeBuffer result;
+    result.putHeader(spirvVersion, code.data()[3]);
+
+    for (auto ins : code) {
+      switch (ins.opCode()) {
+        case spv::OpEntryPoint: {
+          if (spirvVersion < spvVersion(1, 4)) {
+            uint32_t argIdx = 3 + code.strLen(ins.chr(3));
+            uint32_t length = argIdx;
+
+            for (uint32_t i = argIdx; i < ins.length(); i++)
+              length += varIds.find(ins.arg(i)) == varIds.end() ? 1 : 0;
+
+            result.putIns(spv::OpEntryPoint, length);
+
+            for (uint32_t i = 1; i < ins.length(); i++) {
+              if (i < argIdx || varIds.find(ins.arg(i)) == varIds.end())
+                result.putWord(ins.arg(i));
+            }
+            continue;
+          }
+        } break;
+
+        case spv::OpDecorate: {
+          // Private variables must not have any interface decorations
+          if (varIds.find(ins.arg(1)) != varIds.end())
+            continue;
+        } break;
+
+        case spv::OpTypePointer: {
+          auto entry = privateTypes.find(ins.arg(1));
+
+          if (entry != privateTypes.end()) {
+            result.putIns (spv::OpTypePointer, 4);
+            result.putWord(ins.arg(1));
+            result.putWord(ins.arg(2));
+            result.putWord(ins.arg(3));
+
+            result.putIns (spv::OpTypePointer, 4);
+            result.putWord(entry->second);
+            result.putWord(spv::StorageClassPrivate);
+            result.putWord(ins.arg(3));
+            continue;
+          }
+        } break;
+
+        case spv::OpVariable: {
+          if (varIds.find(ins.arg(2)) != varIds.end()) {
+            result.putIns (spv::OpVariable, ins.length());
+            result.putWord(privateTypes.at(ins.arg(1)));
+            result.putWord(ins.arg(2));
+            result.putWord(spv::StorageClassPrivate);
+
+            for (uint32_t i = 4; i < ins.length(); i++)
+              result.putWord(ins.arg(i));
+            continue;
+          }
+        } break;
+
+        case spv::OpAccessChain:
+        case spv::OpInBoundsAccessChain: {
+          if (derivedIds.find(ins.arg(2)) != derivedIds.end())
+            ins.setArg(1, privateTypes.at(ins.arg(1)));
+        } break;
+
+        default:
+          break;
+      }
+
+      result.putIns(ins.opCode(), ins.length());
+
+      for (uint32_t i = 1; i < ins.length(); i++)
+        result.putWord(ins.arg(i));
+    }
+
+    code = std::move(result);
+  }
+
+
   void DxvkShader::emitOutputSwizzles(
           SpirvCodeBuffer&          code,
           uint32_t                  outputMask,
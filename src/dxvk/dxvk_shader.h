@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include "dxvk_include.h"
@@ -11,6 +12,8 @@
 #include "../spirv/spirv_compression.h"
 #include "../spirv/spirv_module.h"
 
+#include "../util/util_time.h"
+
 namespace dxvk {
   
   class DxvkShader;
@@ -68,6 +71,20 @@ namespace dxvk {
   };
 
 
+  /**
+   * \brief Shader compile timings
+   *
+   * Can optionally be filled in by the shader
+   * compilers in order to measure the time
+   * spent in each stage of the translation.
+   */
+  struct DxvkShaderCompileTimings {
+    high_resolution_clock::duration analyze   = { };
+    high_resolution_clock::duration compile   = { };
+    high_resolution_clock::duration finalize  = { };
+  };
+
+
   /**
    * \brief Shader module create info
    */
@@ -75,6 +92,7 @@ namespace dxvk {
     bool      fsDualSrcBlend  = false;
     bool      fsFlatShading   = false;
     uint32_t  undefinedInputs = 0;
+    uint32_t  unusedOutputs   = 0;
 
     std::array<VkComponentMapping, MaxNumRenderTargets> rtSwizzles = { };
 
@@ -163,6 +181,16 @@ namespace dxvk {
       return m_code.decompress();
     }
 
+    /**
+     * \brief Gets compressed code without modification
+     *
+     * Useful to serialize the shader without
+     * having to decompress the code first.
+     */
+    const SpirvCompressedBuffer& getCompressedCode() const {
+      return m_code;
+    }
+
     /**
      * \brief Patches code using given info
      *
@@ -253,6 +281,17 @@ namespace dxvk {
       uint32_t setOffset;
     };
 
+    struct CodeOffsets {
+      std::vector<BindingOffsets> bindingOffsets;
+      size_t                      o1IdxOffset = 0;
+      size_t                      o1LocOffset = 0;
+    };
+
+    struct PrunedCode {
+      SpirvCompressedBuffer       code;
+      CodeOffsets                 offsets;
+    };
+
     DxvkShaderCreateInfo          m_info;
     SpirvCompressedBuffer         m_code;
     
@@ -260,21 +299,33 @@ namespace dxvk {
     DxvkShaderKey                 m_key;
     size_t                        m_hash = 0;
 
-    size_t                        m_o1IdxOffset = 0;
-    size_t                        m_o1LocOffset = 0;
 
     uint32_t                      m_specConstantMask = 0;
     std::atomic<bool>             m_needsLibraryCompile = { true };
 
     std::vector<char>             m_uniformData;
-    std::vector<BindingOffsets>   m_bindingOffsets;
+    CodeOffsets                   m_offsets;
 
     DxvkBindingLayout             m_bindings;
 
+    mutable dxvk::mutex           m_prunedMutex;
+    mutable std::unordered_map<uint32_t, PrunedCode> m_prunedCode;
+
+    SpirvCodeBuffer getPrunedCode(
+            uint32_t                  unusedOutputs,
+            CodeOffsets&              offsets) const;
+
+    static CodeOffsets findCodeOffsets(
+            SpirvCodeBuffer&          code);
+
     static void eliminateInput(
             SpirvCodeBuffer&          code,
             uint32_t                  location);
 
+    static void eliminateOutputs(
+            SpirvCodeBuffer&          code,
+            uint32_t                  locationMask);
+
     static void emitOutputSwizzles(
             SpirvCodeBuffer&          code,
             uint32_t                  outputMask,
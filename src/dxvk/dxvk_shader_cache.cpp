@@ -0,0 +1,567 @@
+#include <version.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include "dxvk_device.h"
+#include "dxvk_shader_cache.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Shader cache file lock
+   *
+   * Exclusive lock on a file next to the cache file. Since the
+   * lock is tied to the open file rather than the process, this
+   * serializes access between devices within the same process
+   * as well as between processes that share the cache file.
+   */
+  class DxvkShaderCacheLock {
+
+  public:
+
+    DxvkShaderCacheLock() { }
+
+    DxvkShaderCacheLock             (const DxvkShaderCacheLock&) = delete;
+    DxvkShaderCacheLock& operator = (const DxvkShaderCacheLock&) = delete;
+
+    ~DxvkShaderCacheLock() {
+      // Closing the file releases the lock
+#ifdef _WIN32
+      if (m_handle != INVALID_HANDLE_VALUE)
+        ::CloseHandle(m_handle);
+#else
+      if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    }
+
+    bool acquire(const str::path_string& path) {
+#ifdef _WIN32
+      m_handle = ::CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+      if (m_handle == INVALID_HANDLE_VALUE)
+        return false;
+
+      OVERLAPPED overlapped = { };
+
+      if (!::LockFileEx(m_handle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        ::CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+        return false;
+      }
+#else
+      m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+      if (m_fd < 0)
+        return false;
+
+      if (::flock(m_fd, LOCK_EX)) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+      }
+#endif
+      return true;
+    }
+
+  private:
+
+#ifdef _WIN32
+    HANDLE  m_handle  = INVALID_HANDLE_VALUE;
+#else
+    int     m_fd      = -1;
+#endif
+
+  };
+
+
+  /**
+   * \brief Shader cache entry data
+   *
+   * Helper to serialize and deserialize
+   * the payload of a single cache entry.
+   */
+  class DxvkShaderCacheEntryData {
+
+  public:
+
+    DxvkShaderCacheEntryData() { }
+
+    DxvkShaderCacheEntryData(std::vector<char>&& data)
+    : m_data(std::move(data)) { }
+
+    std::vector<char>& data() {
+      return m_data;
+    }
+
+    size_t size() const {
+      return m_data.size();
+    }
+
+    template<typename T>
+    void write(const T& data) {
+      write(&data, sizeof(T));
+    }
+
+    void write(const void* data, size_t size) {
+      size_t offset = m_data.size();
+      m_data.resize(offset + size);
+      std::memcpy(&m_data[offset], data, size);
+    }
+
+    template<typename T>
+    bool read(T& data) {
+      return read(&data, sizeof(T));
+    }
+
+    bool read(void* data, size_t size) {
+      if (m_read + size > m_data.size())
+        return false;
+
+      std::memcpy(data, &m_data[m_read], size);
+      m_read += size;
+      return true;
+    }
+
+    bool eof() const {
+      return m_read == m_data.size();
+    }
+
+  private:
+
+    std::vector<char> m_data;
+    size_t            m_read = 0;
+
+  };
+
+
+  DxvkShaderCache::DxvkShaderCache(
+          DxvkDevice*           device,
+    const std::string&          name)
+  : m_name(name) {
+    std::string useShaderCache = env::getEnvVar("DXVK_SHADER_CACHE");
+    m_enable = useShaderCache != "0" && useShaderCache != "disable" &&
+      device->config().enableShaderCache;
+
+    if (!m_enable)
+      return;
+
+    auto t0 = high_resolution_clock::now();
+
+    DxvkShaderCacheLock fileLock;
+
+    if (!lockCacheFile(fileLock)) {
+      Logger::warn("DXVK: Failed to lock shader cache file");
+      m_enable = false;
+      return;
+    }
+
+    bool valid = useShaderCache != "reset" && readCacheFile();
+
+    if (!valid) {
+      m_entries.clear();
+      m_enable = writeCacheHeader();
+    }
+
+    if (m_enable) {
+      auto t1 = high_resolution_clock::now();
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+      Logger::info(str::format("DXVK: Read ", m_entries.size(),
+        " shader cache entries in ", us.count() / 1000.0, " ms"));
+    }
+  }
+
+
+  DxvkShaderCache::~DxvkShaderCache() {
+    if (!m_enable)
+      return;
+
+    uint64_t lookups = m_lookupCount.load();
+    uint64_t hits = m_hitCount.load();
+
+    if (!lookups)
+      return;
+
+    Logger::info(str::format("DXVK: Shader cache: ", hits, " / ", lookups, " hits (",
+      (100 * hits) / lookups, "%), ", m_loadTimeUs.load() / 1000.0, " ms loading, ",
+      m_compileTimeUs.load() / 1000.0, " ms translating ", lookups - hits, " shaders"));
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::lookupShader(
+    const DxvkShaderKey&        key,
+    const Sha1Hash&             optionHash) {
+    if (!m_enable)
+      return nullptr;
+
+    auto t0 = high_resolution_clock::now();
+    m_lookupCount += 1;
+
+    std::vector<char> data;
+    Sha1Hash expectedHash;
+
+    { std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      auto entry = m_entries.find(computeKey(key, optionHash));
+
+      if (entry == m_entries.end())
+        return nullptr;
+
+      // The read stream may have reached the end of
+      // the file during a previous read, reset it.
+      m_readFile.clear();
+      m_readFile.seekg(entry->second.offset);
+
+      data.resize(entry->second.size);
+
+      if (!m_readFile.read(data.data(), data.size()))
+        return nullptr;
+
+      expectedHash = entry->second.hash;
+    }
+
+    // Validate entries lazily since the file may
+    // contain many shaders that are never used
+    if (Sha1Hash::compute(data.data(), data.size()) != expectedHash) {
+      Logger::warn(str::format("DXVK: Invalid shader cache entry for ", key.toString()));
+      return nullptr;
+    }
+
+    Rc<DxvkShader> shader = readShader(std::move(data));
+
+    if (shader == nullptr)
+      return nullptr;
+
+    shader->setShaderKey(key);
+
+    auto t1 = high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+    m_hitCount += 1;
+    m_loadTimeUs += us.count();
+    return shader;
+  }
+
+
+  void DxvkShaderCache::addShader(
+    const DxvkShaderKey&        key,
+    const Sha1Hash&             optionHash,
+    const Rc<DxvkShader>&       shader,
+          high_resolution_clock::duration compileTime) {
+    if (!m_enable)
+      return;
+
+    m_compileTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(compileTime).count();
+
+    DxvkShaderCacheKey cacheKey = computeKey(key, optionHash);
+    std::vector<char> data = writeShader(shader);
+
+    DxvkShaderCacheEntryHeader header;
+    header.key  = cacheKey.sha1;
+    header.hash = Sha1Hash::compute(data.data(), data.size());
+    header.size = data.size();
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    if (m_entries.find(cacheKey) != m_entries.end() || !m_writable)
+      return;
+
+    // Other devices or processes may append to the same file,
+    // so hold the file lock while writing and pick up any entries
+    // that were added since we last read the file. This also
+    // ensures that our offsets match the actual file contents.
+    DxvkShaderCacheLock fileLock;
+
+    if (!lockCacheFile(fileLock))
+      return;
+
+    if (!readCacheIndex()) {
+      Logger::warn("DXVK: Shader cache file replaced, disabling writes");
+      m_writable = false;
+      return;
+    }
+
+    if (m_entries.find(cacheKey) != m_entries.end())
+      return;
+
+    if (!m_writeFile.is_open()) {
+      m_writeFile = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary | std::ios_base::app);
+    }
+
+    if (!m_writeFile)
+      return;
+
+    m_writeFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_writeFile.write(data.data(), data.size());
+    m_writeFile.flush();
+
+    if (!m_writeFile)
+      return;
+
+    Entry entry;
+    entry.offset = m_fileSize + sizeof(header);
+    entry.size   = header.size;
+    entry.hash   = header.hash;
+
+    m_entries.insert({ cacheKey, entry });
+    m_fileSize += sizeof(header) + header.size;
+  }
+
+
+  bool DxvkShaderCache::readCacheFile() {
+    m_readFile = std::ifstream(getCacheFileName().c_str(), std::ios_base::binary);
+
+    if (!m_readFile) {
+      Logger::warn("DXVK: No shader cache file found");
+      return false;
+    }
+
+    DxvkShaderCacheHeader expected;
+    DxvkShaderCacheHeader header;
+
+    if (!m_readFile.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || std::memcmp(header.magic, expected.magic, sizeof(header.magic))) {
+      Logger::warn("DXVK: Failed to read shader cache header");
+      return false;
+    }
+
+    if (header.version != expected.version
+     || header.buildId != computeBuildId()) {
+      Logger::warn("DXVK: Shader cache outdated");
+      return false;
+    }
+
+    m_fileSize = sizeof(header);
+
+    if (!readCacheIndex()) {
+      Logger::warn("DXVK: Shader cache file corrupted");
+      return false;
+    }
+
+    return true;
+  }
+
+
+  bool DxvkShaderCache::readCacheIndex() {
+    // Only read the index here. Since entries are appended
+    // as shaders get compiled, a truncated entry at the end
+    // of the file means that the file was not closed properly.
+    m_readFile.clear();
+
+    if (!m_readFile.seekg(m_fileSize))
+      return false;
+
+    while (true) {
+      DxvkShaderCacheEntryHeader entryHeader;
+
+      if (!m_readFile.read(reinterpret_cast<char*>(&entryHeader), sizeof(entryHeader)))
+        break;
+
+      Entry entry;
+      entry.offset = m_fileSize + sizeof(entryHeader);
+      entry.size   = entryHeader.size;
+      entry.hash   = entryHeader.hash;
+
+      if (!m_readFile.seekg(entryHeader.size, std::ios_base::cur))
+        break;
+
+      m_fileSize = entry.offset + entry.size;
+      m_entries.insert({ DxvkShaderCacheKey { entryHeader.key }, entry });
+    }
+
+    // Make sure the file size matches our index, otherwise
+    // new entries would end up at the wrong offset.
+    m_readFile.clear();
+    m_readFile.seekg(0, std::ios_base::end);
+
+    return m_readFile.tellg() == m_fileSize;
+  }
+
+
+  bool DxvkShaderCache::writeCacheHeader() {
+    m_readFile.close();
+
+    m_writeFile = std::ofstream(getCacheFileName().c_str(),
+      std::ios_base::binary | std::ios_base::trunc);
+
+    if (!m_writeFile && env::createDirectory(getCacheDir())) {
+      m_writeFile = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary | std::ios_base::trunc);
+    }
+
+    if (!m_writeFile) {
+      Logger::warn("DXVK: Failed to create shader cache file");
+      return false;
+    }
+
+    Logger::warn("DXVK: Creating new shader cache file");
+
+    DxvkShaderCacheHeader header;
+    header.buildId = computeBuildId();
+
+    m_writeFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_writeFile.flush();
+
+    m_fileSize = sizeof(header);
+
+    m_readFile = std::ifstream(getCacheFileName().c_str(), std::ios_base::binary);
+    return bool(m_writeFile);
+  }
+
+
+  Rc<DxvkShader> DxvkShaderCache::readShader(
+          std::vector<char>&&   data) const {
+    DxvkShaderCacheEntryData reader(std::move(data));
+
+    DxvkShaderCreateInfo info;
+    std::vector<DxvkBindingInfo> bindings;
+    std::vector<char> uniformData;
+
+    uint32_t codeSize = 0;
+    uint32_t compressedSize = 0;
+    std::vector<uint32_t> compressedCode;
+
+    if (!reader.read(info.stage)
+     || !reader.read(info.bindingCount)
+     || !reader.read(info.inputMask)
+     || !reader.read(info.outputMask)
+     || !reader.read(info.flatShadingInputs)
+     || !reader.read(info.pushConstOffset)
+     || !reader.read(info.pushConstSize)
+     || !reader.read(info.uniformSize)
+     || !reader.read(info.xfbRasterizedStream)
+     || !reader.read(info.patchVertexCount)
+     || !reader.read(info.xfbStrides)
+     || !reader.read(info.outputTopology)
+     || !reader.read(codeSize)
+     || !reader.read(compressedSize))
+      return nullptr;
+
+    if (info.bindingCount > reader.size() / sizeof(DxvkBindingInfo)
+     || info.uniformSize > reader.size()
+     || compressedSize > reader.size() / sizeof(uint32_t))
+      return nullptr;
+
+    bindings.resize(info.bindingCount);
+    uniformData.resize(info.uniformSize);
+    compressedCode.resize(compressedSize);
+
+    if (!reader.read(bindings.data(), bindings.size() * sizeof(DxvkBindingInfo))
+     || !reader.read(uniformData.data(), uniformData.size())
+     || !reader.read(compressedCode.data(), compressedCode.size() * sizeof(uint32_t))
+     || !reader.eof())
+      return nullptr;
+
+    info.bindings    = bindings.data();
+    info.uniformData = uniformData.data();
+
+    SpirvCompressedBuffer code(codeSize, compressedCode.size(), compressedCode.data());
+    return new DxvkShader(info, code.decompress());
+  }
+
+
+  std::vector<char> DxvkShaderCache::writeShader(
+    const Rc<DxvkShader>&       shader) const {
+    DxvkShaderCacheEntryData writer;
+
+    const DxvkShaderCreateInfo& info = shader->info();
+    const DxvkBindingLayout& layout = shader->getBindings();
+    const SpirvCompressedBuffer& code = shader->getCompressedCode();
+
+    // The shader does not store the original binding
+    // array, so gather bindings from all descriptor sets
+    std::vector<DxvkBindingInfo> bindings;
+
+    for (uint32_t i = 0; i < DxvkDescriptorSets::SetCount; i++) {
+      for (uint32_t j = 0; j < layout.getBindingCount(i); j++)
+        bindings.push_back(layout.getBinding(i, j));
+    }
+
+    writer.write(info.stage);
+    writer.write(uint32_t(bindings.size()));
+    writer.write(info.inputMask);
+    writer.write(info.outputMask);
+    writer.write(info.flatShadingInputs);
+    writer.write(info.pushConstOffset);
+    writer.write(info.pushConstSize);
+    writer.write(info.uniformSize);
+    writer.write(info.xfbRasterizedStream);
+    writer.write(info.patchVertexCount);
+    writer.write(info.xfbStrides);
+    writer.write(info.outputTopology);
+    writer.write(uint32_t(code.dwords()));
+    writer.write(uint32_t(code.compressedDwords()));
+
+    writer.write(bindings.data(), bindings.size() * sizeof(DxvkBindingInfo));
+    writer.write(info.uniformData, info.uniformSize);
+    writer.write(code.compressedData(), code.compressedDwords() * sizeof(uint32_t));
+    return std::move(writer.data());
+  }
+
+
+  DxvkShaderCacheKey DxvkShaderCache::computeKey(
+    const DxvkShaderKey&        key,
+    const Sha1Hash&             optionHash) {
+    VkShaderStageFlags stage = key.type();
+
+    std::array<Sha1Data, 3> chunks = {{
+      { &stage,       sizeof(stage)      },
+      { &key.sha1(),  sizeof(Sha1Hash)   },
+      { &optionHash,  sizeof(Sha1Hash)   },
+    }};
+
+    return DxvkShaderCacheKey { Sha1Hash::compute(chunks.size(), chunks.data()) };
+  }
+
+
+  Sha1Hash DxvkShaderCache::computeBuildId() {
+    std::string version = DXVK_VERSION;
+    return Sha1Hash::compute(version.data(), version.size());
+  }
+
+
+  str::path_string DxvkShaderCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeBaseName();
+    path += exeName + "." + m_name + ".dxvk-shaders";
+    return str::topath(path.c_str());
+  }
+
+
+  bool DxvkShaderCache::lockCacheFile(DxvkShaderCacheLock& lock) const {
+    str::path_string lockFileName = getCacheFileName() + str::topath(".lock");
+
+    if (lock.acquire(lockFileName))
+      return true;
+
+    // The cache directory may not exist yet
+    std::string cacheDir = getCacheDir();
+
+    return !cacheDir.empty()
+      && env::createDirectory(cacheDir)
+      && lock.acquire(lockFileName);
+  }
+
+
+  std::string DxvkShaderCache::getCacheDir() const {
+    std::string path = env::getEnvVar("DXVK_SHADER_CACHE_PATH");
+
+    if (path.empty())
+      path = env::getEnvVar("DXVK_STATE_CACHE_PATH");
+
+    return path;
+  }
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "dxvk_shader.h"
+
+#include "../util/util_time.h"
+
+namespace dxvk {
+
+  class DxvkDevice;
+  class DxvkShaderCacheLock;
+
+  /**
+   * \brief Shader cache file header
+   *
+   * The build ID is derived from the DXVK version string,
+   * so that any change to the shader compilers invalidates
+   * previously cached shaders.
+   */
+  struct DxvkShaderCacheHeader {
+    char     magic[4] = { 'D', 'X', 'S', 'C' };
+    uint32_t version  = 1;
+    Sha1Hash buildId;
+  };
+
+
+  /**
+   * \brief Shader cache entry header
+   *
+   * Entries are stored as a header, followed
+   * by \c size bytes of payload data.
+   */
+  struct DxvkShaderCacheEntryHeader {
+    Sha1Hash key;
+    Sha1Hash hash;
+    uint32_t size;
+  };
+
+
+  /**
+   * \brief Shader cache lookup key
+   *
+   * Combines the shader key with a hash of all compiler
+   * options that affect the generated SPIR-V code.
+   */
+  struct DxvkShaderCacheKey {
+    Sha1Hash sha1;
+
+    bool eq(const DxvkShaderCacheKey& other) const {
+      return sha1 == other.sha1;
+    }
+
+    size_t hash() const {
+      return sha1.dword(0);
+    }
+  };
+
+
+  /**
+   * \brief Persistent shader cache
+   *
+   * Stores translated SPIR-V code along with the shader
+   * metadata on disk, so that shaders do not need to be
+   * translated again when the application is restarted.
+   * Only an index is read on startup, the actual shader
+   * data is loaded on demand. This class is thread-safe,
+   * and multiple devices or processes may share the same
+   * cache file since all file accesses that rely on the
+   * index take an OS-level lock on the file.
+   */
+  class DxvkShaderCache {
+
+  public:
+
+    DxvkShaderCache(
+            DxvkDevice*           device,
+      const std::string&          name);
+
+    ~DxvkShaderCache();
+
+    /**
+     * \brief Looks up shader in the cache
+     *
+     * \param [in] key Shader key
+     * \param [in] optionHash Hash of compiler options
+     * \returns Cached shader, or \c nullptr if no
+     *    valid shader was found for the given key.
+     */
+    Rc<DxvkShader> lookupShader(
+      const DxvkShaderKey&        key,
+      const Sha1Hash&             optionHash);
+
+    /**
+     * \brief Adds a shader to the cache
+     *
+     * Writes the shader to the cache file unless an entry
+     * with the same key exists already. The translation
+     * time is only used for statistics.
+     * \param [in] key Shader key
+     * \param [in] optionHash Hash of compiler options
+     * \param [in] shader The shader to add
+     * \param [in] compileTime Time spent compiling the shader
+     */
+    void addShader(
+      const DxvkShaderKey&        key,
+      const Sha1Hash&             optionHash,
+      const Rc<DxvkShader>&       shader,
+            high_resolution_clock::duration compileTime);
+
+  private:
+
+    struct Entry {
+      std::streamoff offset;
+      uint32_t       size;
+      Sha1Hash       hash;
+    };
+
+    bool                              m_enable = false;
+    bool                              m_writable = true;
+    std::string                       m_name;
+
+    dxvk::mutex                       m_mutex;
+    std::ifstream                     m_readFile;
+    std::ofstream                     m_writeFile;
+    std::streamoff                    m_fileSize = 0;
+
+    std::unordered_map<
+      DxvkShaderCacheKey, Entry,
+      DxvkHash, DxvkEq>               m_entries;
+
+    std::atomic<uint64_t>             m_lookupCount  = { 0ull };
+    std::atomic<uint64_t>             m_hitCount     = { 0ull };
+    std::atomic<uint64_t>             m_loadTimeUs   = { 0ull };
+    std::atomic<uint64_t>             m_compileTimeUs = { 0ull };
+
+    bool readCacheFile();
+
+    bool readCacheIndex();
+
+    bool writeCacheHeader();
+
+    Rc<DxvkShader> readShader(
+            std::vector<char>&&   data) const;
+
+    std::vector<char> writeShader(
+      const Rc<DxvkShader>&       shader) const;
+
+    static DxvkShaderCacheKey computeKey(
+      const DxvkShaderKey&        key,
+      const Sha1Hash&             optionHash);
+
+    static Sha1Hash computeBuildId();
+
+    str::path_string getCacheFileName() const;
+
+    bool lockCacheFile(
+            DxvkShaderCacheLock&  lock) const;
+
+    std::string getCacheDir() const;
+
+  };
+
+}
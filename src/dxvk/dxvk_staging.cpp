@@ -2,60 +2,154 @@
 #include "dxvk_staging.h"
 
 namespace dxvk {
-  
+
   DxvkStagingBuffer::DxvkStagingBuffer(
     const Rc<DxvkDevice>&     device,
           VkDeviceSize        size)
-  : m_device(device), m_offset(0), m_size(size) {
+  : m_device(device), m_size(size) {
 
   }
 
 
   DxvkStagingBuffer::~DxvkStagingBuffer() {
+    if (!m_stats.allocatedTotal)
+      return;
 
+    Logger::debug(str::format("DxvkStagingBuffer: ",
+      m_stats.allocatedTotal >> 10, " kB allocated, ",
+      m_stats.allocatedPeak >> 10, " kB peak usage, ",
+      m_stats.bufferCount, " buffers created, ",
+      m_stats.stallCount, " stalls (", m_stats.stallTicks / 1000, " ms)"));
   }
 
 
   DxvkBufferSlice DxvkStagingBuffer::alloc(VkDeviceSize align, VkDeviceSize size) {
-    DxvkBufferCreateInfo info;
-    info.size   = size;
-    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-                | VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
-                | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT
-                | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-                | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    info.access = VK_ACCESS_TRANSFER_READ_BIT
-                | VK_ACCESS_SHADER_READ_BIT;
-
     VkDeviceSize alignedSize = dxvk::align(size, align);
-    VkDeviceSize alignedOffset = dxvk::align(m_offset, align);
 
-    if (2 * alignedSize > m_size) {
-      return DxvkBufferSlice(m_device->createBuffer(info,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
-    }
+    m_stats.allocatedTotal += size;
+
+    // Don't let a single allocation occupy most of the ring
+    if (2 * alignedSize > m_size)
+      return DxvkBufferSlice(createBuffer(size));
+
+    if (m_buffer == nullptr)
+      m_buffer = createBuffer(m_size);
 
-    if (alignedOffset + alignedSize > m_size || m_buffer == nullptr) {
-      info.size = m_size;
+    // Skip the remainder of the buffer if the allocation
+    // does not fit, the padding is part of the region.
+    VkDeviceSize headOffset = m_head % m_size;
+    VkDeviceSize alignedOffset = dxvk::align(headOffset, align);
 
-      // Free resources first if possible, in some rare
-      // situations this may help avoid a memory allocation.
+    if (alignedOffset + alignedSize > m_size)
+      alignedOffset = m_size;
+
+    VkDeviceSize allocSize = alignedOffset - headOffset + alignedSize;
+
+    if (!reserve(allocSize)) {
+      // The current region is too large to ever fit into the
+      // ring, so start over with a new buffer. The old buffer
+      // stays alive until the GPU is done using it.
       m_buffer = nullptr;
-      m_buffer = m_device->createBuffer(info,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+      m_buffer = createBuffer(m_size);
+
+      m_head        = 0;
+      m_tail        = 0;
+      m_regionStart = 0;
+
       alignedOffset = 0;
+      allocSize = alignedSize;
     }
 
-    DxvkBufferSlice slice(m_buffer, alignedOffset, size);
-    m_offset = alignedOffset + alignedSize;
-    return slice;
+    m_head += allocSize;
+    m_stats.allocatedPeak = std::max(m_stats.allocatedPeak, m_head - m_tail);
+
+    return DxvkBufferSlice(m_buffer, alignedOffset % m_size, size);
+  }
+
+
+  bool DxvkStagingBuffer::endRegion(
+    const Rc<sync::Signal>&   signal,
+          uint64_t            value) {
+    if (m_head == m_regionStart)
+      return false;
+
+    m_regions.push({ signal, value, m_head });
+    m_regionStart = m_head;
+    return true;
   }
 
 
   void DxvkStagingBuffer::reset() {
     m_buffer = nullptr;
-    m_offset = 0;
+    m_regions = std::queue<Region>();
+
+    m_head        = 0;
+    m_tail        = 0;
+    m_regionStart = 0;
   }
-  
+
+
+  bool DxvkStagingBuffer::reserve(VkDeviceSize size) {
+    // Reclaim memory from all regions that have completed
+    while (!m_regions.empty()) {
+      const Region& region = m_regions.front();
+
+      if (region.signal->value() < region.value)
+        break;
+
+      m_tail = region.end;
+      m_regions.pop();
+    }
+
+    if (m_head - m_tail + size <= m_size)
+      return true;
+
+    // Waiting for pending regions is pointless if
+    // the current region alone does not leave enough
+    // space, and we cannot wait for that one.
+    if (m_head - m_regionStart + size > m_size) {
+      m_regions = std::queue<Region>();
+      return false;
+    }
+
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    while (m_head - m_tail + size > m_size) {
+      const Region& region = m_regions.front();
+      region.signal->wait(region.value);
+
+      m_tail = region.end;
+      m_regions.pop();
+    }
+
+    auto t1 = dxvk::high_resolution_clock::now();
+    auto ticks = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
+    m_stats.stallCount += 1;
+    m_stats.stallTicks += ticks.count();
+
+    m_device->addStatCtr(DxvkStatCounter::GpuSyncCount, 1);
+    m_device->addStatCtr(DxvkStatCounter::GpuSyncTicks, ticks.count());
+    return true;
+  }
+
+
+  Rc<DxvkBuffer> DxvkStagingBuffer::createBuffer(VkDeviceSize size) {
+    DxvkBufferCreateInfo info;
+    info.size   = size;
+    info.usage  = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+                | VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+                | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT
+                | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    info.access = VK_ACCESS_TRANSFER_READ_BIT
+                | VK_ACCESS_SHADER_READ_BIT;
+
+    m_stats.bufferCount += 1;
+
+    return m_device->createBuffer(info,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  }
+
 }
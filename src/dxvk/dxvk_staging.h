@@ -2,17 +2,36 @@
 
 #include <queue>
 
+#include "../util/sync/sync_signal.h"
+
 #include "dxvk_buffer.h"
 
 namespace dxvk {
-  
+
   class DxvkDevice;
 
+  /**
+   * \brief Staging buffer statistics
+   */
+  struct DxvkStagingBufferStats {
+    VkDeviceSize  allocatedTotal  = 0;  ///< Total number of bytes allocated
+    VkDeviceSize  allocatedPeak   = 0;  ///< Maximum number of ring bytes in use at once
+    uint64_t      stallCount      = 0;  ///< Number of times the ring had to wait for the GPU
+    uint64_t      stallTicks      = 0;  ///< Time spent waiting for the GPU, in microseconds
+    uint64_t      bufferCount     = 0;  ///< Number of buffers created
+  };
+
+
   /**
    * \brief Staging buffer
    *
-   * Provides a simple linear staging buffer
-   * allocator for data uploads.
+   * Ring allocator for data uploads. Allocations are
+   * grouped into regions, and the memory of a region
+   * is reused once the GPU has finished processing the
+   * submission that was signaled when the region ended.
+   * If the ring runs full, the allocator waits for the
+   * oldest region to complete, or creates a new ring
+   * buffer if the current region fills the entire ring.
    */
   class DxvkStagingBuffer {
 
@@ -22,7 +41,7 @@ namespace dxvk {
      * \brief Creates staging buffer
      *
      * \param [in] device DXVK device
-     * \param [in] size Buffer size
+     * \param [in] size Ring buffer size
      */
     DxvkStagingBuffer(
       const Rc<DxvkDevice>&     device,
@@ -30,32 +49,81 @@ namespace dxvk {
 
     /**
      * \brief Frees staging buffer
+     *
+     * Logs allocation statistics at debug level.
      */
     ~DxvkStagingBuffer();
 
     /**
      * \brief Allocates staging buffer memory
      *
-     * Tries to suballocate from existing buffer,
-     * or creates a new buffer if necessary.
+     * Suballocates from the ring buffer if possible,
+     * and may stall until memory is available. Large
+     * allocations will use a dedicated buffer.
      * \param [in] align Minimum alignment
      * \param [in] size Number of bytes to allocate
      * \returns Allocated slice
      */
     DxvkBufferSlice alloc(VkDeviceSize align, VkDeviceSize size);
 
+    /**
+     * \brief Ends current region
+     *
+     * Memory allocated since the last call will be reused
+     * once the given signal reaches the given value. The
+     * caller must ensure that the signal will be signaled
+     * after the GPU has finished using that memory.
+     * \param [in] signal Signal to wait for
+     * \param [in] value Signal value
+     * \returns \c true if the region contains any
+     *    allocations and the signal must be emitted
+     */
+    bool endRegion(
+      const Rc<sync::Signal>&   signal,
+            uint64_t            value);
+
+    /**
+     * \brief Queries size of the current region
+     * \returns Bytes allocated since the region began
+     */
+    VkDeviceSize getRegionSize() const {
+      return m_head - m_regionStart;
+    }
+
     /**
      * \brief Resets staging buffer and allocator
+     *
+     * Discards the current ring buffer without waiting
+     * for any pending regions. Must be used if memory
+     * cannot be tracked through regions, e.g. because
+     * it is used by command lists that can be submitted
+     * multiple times.
      */
     void reset();
 
   private:
 
+    struct Region {
+      Rc<sync::Signal>  signal;
+      uint64_t          value;
+      VkDeviceSize      end;
+    };
+
     Rc<DxvkDevice>  m_device;
     Rc<DxvkBuffer>  m_buffer;
-    VkDeviceSize    m_offset;
     VkDeviceSize    m_size;
 
+    VkDeviceSize    m_head        = 0;
+    VkDeviceSize    m_tail        = 0;
+    VkDeviceSize    m_regionStart = 0;
+
+    std::queue<Region>      m_regions;
+    DxvkStagingBufferStats  m_stats;
+
+    bool reserve(VkDeviceSize size);
+
+    Rc<DxvkBuffer> createBuffer(VkDeviceSize size);
+
   };
 
 }
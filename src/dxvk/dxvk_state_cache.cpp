@@ -9,12 +9,112 @@ namespace dxvk {
 
 
   /**
-   * \brief Packed entry header
+   * \brief State cache loader workers
+   *
+   * Threads that help the loader thread build lookup
+   * tables and validate entries. Threads are created
+   * once per load and reused for all parallel jobs.
    */
-  struct DxvkStateCacheEntryHeader {
-    uint32_t entryType : 1;
-    uint32_t stageMask : 5;
-    uint32_t entrySize : 26;
+  class DxvkStateCacheLoadWorkers {
+
+  public:
+
+    using Job = std::function<void (uint32_t, uint32_t)>;
+
+    DxvkStateCacheLoadWorkers(uint32_t threadCount)
+    : m_threadCount(threadCount) {
+      for (uint32_t i = 1; i < threadCount; i++)
+        m_threads.emplace_back([this, i] () { runWorker(i); });
+    }
+
+    ~DxvkStateCacheLoadWorkers() {
+      { std::lock_guard<dxvk::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+
+      m_jobCond.notify_all();
+
+      for (auto& thread : m_threads)
+        thread.join();
+    }
+
+    uint32_t threadCount() const {
+      return m_threadCount;
+    }
+
+    /**
+     * \brief Runs a job on all threads
+     *
+     * The calling thread participates with index 0.
+     * Returns once all threads have finished the job.
+     * \param [in] job Job, takes thread index and count
+     */
+    void run(const Job& job) {
+      { std::lock_guard<dxvk::mutex> lock(m_mutex);
+        m_job = &job;
+        m_jobId += 1;
+        m_pending = m_threadCount - 1;
+      }
+
+      m_jobCond.notify_all();
+
+      job(0, m_threadCount);
+
+      std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+      m_doneCond.wait(lock, [this] () {
+        return !m_pending;
+      });
+
+      m_job = nullptr;
+    }
+
+  private:
+
+    uint32_t                  m_threadCount;
+
+    dxvk::mutex               m_mutex;
+    dxvk::condition_variable  m_jobCond;
+    dxvk::condition_variable  m_doneCond;
+
+    const Job*                m_job     = nullptr;
+    uint64_t                  m_jobId   = 0;
+    uint32_t                  m_pending = 0;
+    bool                      m_stop    = false;
+
+    std::vector<dxvk::thread> m_threads;
+
+    void runWorker(uint32_t index) {
+      env::setThreadName("dxvk-cache-load");
+
+      uint64_t jobId = 0;
+
+      while (true) {
+        const Job* job = nullptr;
+
+        { std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+          m_jobCond.wait(lock, [this, jobId] () {
+            return m_stop || m_jobId != jobId;
+          });
+
+          if (m_stop)
+            return;
+
+          jobId = m_jobId;
+          job = m_job;
+        }
+
+        (*job)(index, m_threadCount);
+
+        { std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+          if (!(--m_pending))
+            m_doneCond.notify_one();
+        }
+      }
+    }
+
   };
 
 
@@ -42,11 +142,11 @@ namespace dxvk {
     }
 
     const char* data() const {
-      return m_data;
+      return m_mapped ? m_mapped : m_data;
     }
 
     Sha1Hash computeHash() const {
-      return Sha1Hash::compute(m_data, m_size);
+      return Sha1Hash::compute(data(), m_size);
     }
 
     template<typename T>
@@ -188,6 +288,19 @@ namespace dxvk {
       if (!stream.read(m_data, size))
         return false;
 
+      m_mapped = nullptr;
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
+    bool readFromMemory(const char* data, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      // Read directly from the given memory
+      // region rather than copying the data
+      m_mapped = data;
       m_size = size;
       m_read = 0;
       return true;
@@ -195,6 +308,8 @@ namespace dxvk {
 
   private:
 
+    const char* m_mapped = nullptr;
+
     size_t m_size = 0;
     size_t m_read = 0;
     char   m_data[MaxSize];
@@ -204,7 +319,7 @@ namespace dxvk {
       if (m_read + sizeof(T) > m_size)
         return false;
 
-      std::memcpy(&data, &m_data[m_read], sizeof(T));
+      std::memcpy(&data, &this->data()[m_read], sizeof(T));
       m_read += sizeof(T);
       return true;
     }
@@ -235,6 +350,83 @@ namespace dxvk {
   }
 
 
+  /**
+   * \brief State cache file builder
+   *
+   * Assembles an indexed state cache file in memory.
+   * Used when converting cache files from an older
+   * version, and when adding appended entries to the
+   * index of an existing cache file.
+   */
+  class DxvkStateCacheFileBuilder {
+
+  public:
+
+    size_t entryCount() const {
+      return m_index.size();
+    }
+
+    void addEntry(
+      const DxvkStateCacheIndexEntry& entry,
+      const DxvkStateCacheUsage&      usage,
+      const Sha1Hash&                 hash,
+      const char*                     data) {
+      DxvkStateCacheIndexEntry indexEntry = entry;
+      indexEntry.offset = uint32_t(m_data.size());
+      m_index.push_back(indexEntry);
+      m_usage.push_back(usage);
+
+      append(&entry.header, sizeof(entry.header));
+      append(&hash, sizeof(hash));
+      append(data, entry.header.entrySize);
+    }
+
+    std::vector<char> build(uint32_t version) const {
+      DxvkStateCacheHeader header;
+      header.version = version;
+
+      // v18 files do not have a usage table
+      size_t usageCount = version >= 19 ? m_usage.size() : 0;
+
+      DxvkStateCacheIndexHeader indexHeader;
+      indexHeader.entryCount = uint32_t(m_index.size());
+      indexHeader.dataSize = uint32_t(m_data.size());
+      indexHeader.hash = Sha1Hash::compute(m_index.data(),
+        m_index.size() * sizeof(DxvkStateCacheIndexEntry));
+
+      std::vector<char> result;
+      result.reserve(sizeof(header) + sizeof(indexHeader)
+        + m_index.size() * sizeof(DxvkStateCacheIndexEntry)
+        + usageCount * sizeof(DxvkStateCacheUsage)
+        + m_data.size());
+
+      auto appendTo = [&result] (const void* data, size_t size) {
+        auto bytes = reinterpret_cast<const char*>(data);
+        result.insert(result.end(), bytes, bytes + size);
+      };
+
+      appendTo(&header, sizeof(header));
+      appendTo(&indexHeader, sizeof(indexHeader));
+      appendTo(m_index.data(), m_index.size() * sizeof(DxvkStateCacheIndexEntry));
+      appendTo(m_usage.data(), usageCount * sizeof(DxvkStateCacheUsage));
+      appendTo(m_data.data(), m_data.size());
+      return result;
+    }
+
+  private:
+
+    std::vector<DxvkStateCacheIndexEntry> m_index;
+    std::vector<DxvkStateCacheUsage>      m_usage;
+    std::vector<char>                     m_data;
+
+    void append(const void* data, size_t size) {
+      auto bytes = reinterpret_cast<const char*>(data);
+      m_data.insert(m_data.end(), bytes, bytes + size);
+    }
+
+  };
+
+
   bool DxvkStateCacheKey::eq(const DxvkStateCacheKey& key) const {
     return this->vs.eq(key.vs)
         && this->tcs.eq(key.tcs)
@@ -269,16 +461,15 @@ namespace dxvk {
     if (!m_enable)
       return;
 
-    bool newFile = (useStateCache == "reset") || (!readCacheFile());
+    // Load the cache in the background so that the application
+    // can keep compiling shaders in the meantime. Pipelines for
+    // shaders that were registered early get queued once the
+    // lookup tables are ready.
+    bool reset = useStateCache == "reset";
 
-    if (newFile) {
-      auto file = openCacheFileForWrite(true);
-
-      // Write all valid entries to the cache file in
-      // case we're recovering a corrupted cache file
-      for (auto& e : m_entries)
-        writeCacheEntry(file, e);
-    }
+    m_loaderThread = dxvk::thread([this, reset] () {
+      loaderFunc(reset);
+    });
   }
   
 
@@ -292,20 +483,20 @@ namespace dxvk {
     if (!m_enable || shaders.vs.eq(g_nullShaderKey))
       return;
 
-    // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
+    DxvkStateCacheEntry entry = {
+      DxvkStateCacheEntryType::PipelineLibrary, shaders,
+      DxvkGraphicsPipelineStateInfo(), g_nullHash };
+    entry.firstUse = m_device->getCurrentFrameId();
 
-    for (auto e = entries.first; e != entries.second; e++) {
-      if (m_entries[e->second].type == DxvkStateCacheEntryType::PipelineLibrary)
-        return;
-    }
+    // Do not add an entry that is already in the cache. If the
+    // cache is still loading, the writer will check this later.
+    if (m_loaded.load() && useCacheEntry(entry))
+      return;
 
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
-    m_writerQueue.push({
-      DxvkStateCacheEntryType::PipelineLibrary, shaders,
-      DxvkGraphicsPipelineStateInfo(), g_nullHash });
+    m_writerQueue.push(entry);
     m_writerCond.notify_one();
 
     createWriter();
@@ -318,21 +509,20 @@ namespace dxvk {
     if (!m_enable || shaders.vs.eq(g_nullShaderKey))
       return;
 
-    // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
+    DxvkStateCacheEntry entry = {
+      DxvkStateCacheEntryType::MonolithicPipeline,
+      shaders, state, g_nullHash };
+    entry.firstUse = m_device->getCurrentFrameId();
 
-    for (auto e = entries.first; e != entries.second; e++) {
-      if (m_entries[e->second].type == DxvkStateCacheEntryType::MonolithicPipeline
-       && m_entries[e->second].gpState == state)
-        return;
-    }
+    // Do not add an entry that is already in the cache. If the
+    // cache is still loading, the writer will check this later.
+    if (m_loaded.load() && useCacheEntry(entry))
+      return;
 
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
-    m_writerQueue.push({
-      DxvkStateCacheEntryType::MonolithicPipeline,
-      shaders, state, g_nullHash });
+    m_writerQueue.push(entry);
     m_writerCond.notify_one();
 
     createWriter();
@@ -352,20 +542,43 @@ namespace dxvk {
     std::unique_lock<dxvk::mutex> entryLock(m_entryLock);
     m_shaderMap.insert({ key, shader });
 
+    // If the cache is still loading, pipelines using
+    // this shader will be queued once it is done
+    if (m_loaded.load())
+      queuePipelines(key, false);
+  }
+
+
+  void DxvkStateCache::queuePipelines(
+    const DxvkShaderKey&            key,
+          bool                      deduplicate) {
     // Deferred lock, don't stall workers unless we have to
     std::unique_lock<dxvk::mutex> workerLock;
 
-    auto pipelines = m_pipelineMap.equal_range(key);
+    auto pipelines = getMapShard(key).pipelineMap.equal_range(key);
 
     for (auto p = pipelines.first; p != pipelines.second; p++) {
       WorkerItem item;
 
+      // When queuing pipelines for all shaders registered
+      // so far, only queue each pipeline for one shader
+      if (deduplicate && !key.eq(getFirstShaderKey(p->second)))
+        continue;
+
       if (!getShaderByKey(p->second.vs,  item.gp.vs)
        || !getShaderByKey(p->second.tcs, item.gp.tcs)
        || !getShaderByKey(p->second.tes, item.gp.tes)
        || !getShaderByKey(p->second.gs,  item.gp.gs)
        || !getShaderByKey(p->second.fs,  item.gp.fs))
         continue;
+
+      // Process pipelines in the order of their highest-ranked
+      // entry, so that the ones needed first get compiled first
+      auto entries = getMapShard(p->second.vs).entryMap.equal_range(p->second);
+      item.rank = ~0u;
+
+      for (auto e = entries.first; e != entries.second; e++)
+        item.rank = std::min(item.rank, m_entryRank[e->second]);
       
       if (!workerLock)
         workerLock = std::unique_lock<dxvk::mutex>(m_workerLock);
@@ -391,11 +604,121 @@ namespace dxvk {
       m_writerCond.notify_all();
     }
 
+    // Join the loader first since it may start other threads
+    if (m_loaderThread.joinable())
+      m_loaderThread.join();
+
     if (m_workerThread.joinable())
       m_workerThread.join();
     
     if (m_writerThread.joinable())
       m_writerThread.join();
+
+    writeEntryUsage();
+  }
+
+
+  bool DxvkStateCache::readEntries(
+    const str::path_string&               path,
+          std::vector<DxvkStateCacheEntry>& entries,
+          uint32_t&                       invalidCount) {
+    std::ifstream ifile(path.c_str(), std::ios_base::binary);
+
+    DxvkStateCacheHeader header;
+    invalidCount = 0;
+
+    if (!ifile || !readCacheHeader(ifile, header)
+     || !isSupportedVersion(header.version))
+      return false;
+
+    // Files older than v18 are not indexed and
+    // can only be read sequentially
+    if (header.version < 18) {
+      while (ifile) {
+        DxvkStateCacheEntry entry;
+
+        if (readCacheEntry(header.version, ifile, entry))
+          entries.push_back(entry);
+        else if (ifile)
+          invalidCount += 1;
+      }
+
+      return true;
+    }
+
+    ifile.close();
+
+    MappedFile file(path);
+
+    if (!file)
+      return false;
+
+    IndexLayout layout;
+
+    if (!parseCacheIndex(header.version, file.data(), file.size(), layout))
+      return false;
+
+    auto index = reinterpret_cast<const DxvkStateCacheIndexEntry*>(file.data() + layout.indexOffset);
+    auto usage = reinterpret_cast<const DxvkStateCacheUsage*>(file.data() + layout.usageOffset);
+
+    for (uint32_t i = 0; i < layout.header.entryCount; i++) {
+      DxvkStateCacheEntry entry;
+
+      if (isRecordInBounds(index[i], layout.header.dataSize)
+       && decodeCacheRecord(header.version, file.data() + layout.dataOffset + index[i].offset,
+            layout.header.dataSize - index[i].offset, entry)
+       && entry.shaders.eq(index[i].shaders)) {
+        if (layout.usageOffset != layout.dataOffset) {
+          entry.firstUse = usage[i].firstUse;
+          entry.useCount = usage[i].useCount;
+        }
+
+        entries.push_back(entry);
+      } else {
+        invalidCount += 1;
+      }
+    }
+
+    // Read entries that were appended after the index
+    size_t offset = layout.dataOffset + layout.header.dataSize;
+
+    while (offset < file.size()) {
+      DxvkStateCacheIndexEntry indexEntry = { };
+      DxvkStateCacheEntry entry;
+
+      size_t recordSize = readCacheRecord(
+        file.data() + offset, file.size() - offset, indexEntry);
+
+      if (!recordSize) {
+        invalidCount += 1;
+        break;
+      }
+
+      if (decodeCacheRecord(header.version, file.data() + offset, recordSize, entry)) {
+        entry.useCount = 1;
+        entries.push_back(entry);
+      } else {
+        invalidCount += 1;
+      }
+
+      offset += recordSize;
+    }
+
+    return true;
+  }
+
+
+  bool DxvkStateCache::writeEntries(
+    const str::path_string&               path,
+    const std::vector<DxvkStateCacheEntry>& entries,
+          uint32_t                        version) {
+    std::vector<char> data = buildCacheFile(version, entries);
+
+    std::ofstream file(path.c_str(),
+      std::ios_base::binary |
+      std::ios_base::trunc);
+
+    return file && file.write(data.data(), data.size());
   }
 
 
@@ -419,18 +742,88 @@ namespace dxvk {
   }
 
 
-  void DxvkStateCache::mapPipelineToEntry(
-    const DxvkStateCacheKey&        key,
-          size_t                    entryId) {
-    m_entryMap.insert({ key, entryId });
+  bool DxvkStateCache::useCacheEntry(
+    const DxvkStateCacheEntry&      entry) {
+    auto entries = getMapShard(entry.shaders.vs).entryMap.equal_range(entry.shaders);
+
+    for (auto e = entries.first; e != entries.second; e++) {
+      DxvkStateCacheEntry cached;
+
+      if (!getCacheEntry(e->second, cached) || cached.type != entry.type)
+        continue;
+
+      if (entry.type == DxvkStateCacheEntryType::PipelineLibrary
+       || cached.gpState == entry.gpState) {
+        // Only the first use within a run is relevant. The
+        // frame is stored with an offset of one since zero
+        // indicates that the entry has not been used yet.
+        uint32_t unused = 0;
+        m_entryUseFrame[e->second].compare_exchange_strong(unused, entry.firstUse + 1);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  DxvkPipelinePriority DxvkStateCache::getEntryPriority(
+          size_t                    entryId) const {
+    // Only workers that can process low-priority pipelines
+    // exist if pipeline libraries are supported. Compile the
+    // first half of the ranked entries with normal priority
+    // so that they do not get starved by the remaining ones.
+    if (!m_device->canUseGraphicsPipelineLibrary())
+      return DxvkPipelinePriority::Normal;
+
+    return m_entryRank[entryId] < m_indexSize / 2
+      ? DxvkPipelinePriority::Normal
+      : DxvkPipelinePriority::Low;
   }
 
-  
-  void DxvkStateCache::mapShaderToPipeline(
-    const DxvkShaderKey&            shader,
+
+  void DxvkStateCache::writeEntryUsage() {
+    if (!m_usageOffset || !m_indexSize)
+      return;
+
+    std::vector<DxvkStateCacheUsage> usage(m_usage, m_usage + m_indexSize);
+    bool changed = false;
+
+    for (size_t i = 0; i < m_indexSize; i++) {
+      uint32_t frame = m_entryUseFrame[i].load();
+
+      if (frame) {
+        usage[i].firstUse = std::min(usage[i].firstUse, frame - 1);
+        usage[i].useCount += 1;
+        changed = true;
+      }
+    }
+
+    if (!changed)
+      return;
+
+    // The usage table has a fixed size and is not covered by the
+    // index hash, so it can be updated in place without having
+    // to rewrite the file or interfere with appended entries.
+    std::fstream file(getCacheFileName().c_str(),
+      std::ios_base::binary |
+      std::ios_base::in |
+      std::ios_base::out);
+
+    if (!file || !file.seekp(m_usageOffset)
+     || !file.write(reinterpret_cast<const char*>(usage.data()), usage.size() * sizeof(DxvkStateCacheUsage)))
+      Logger::warn("DXVK: Failed to update state cache usage data");
+  }
+
+
+  const DxvkShaderKey& DxvkStateCache::getFirstShaderKey(
     const DxvkStateCacheKey&        key) {
-    if (!shader.eq(g_nullShaderKey))
-      m_pipelineMap.insert({ shader, key });
+    for (const auto* shader : { &key.vs, &key.tcs, &key.tes, &key.gs }) {
+      if (!shader->eq(g_nullShaderKey))
+        return *shader;
+    }
+
+    return key.fs;
   }
 
 
@@ -443,17 +836,20 @@ namespace dxvk {
     key.fs  = getShaderKey(item.gp.fs);
 
     DxvkGraphicsPipeline* pipeline = nullptr;
-    auto entries = m_entryMap.equal_range(key);
+    auto entries = getMapShard(key.vs).entryMap.equal_range(key);
 
     for (auto e = entries.first; e != entries.second; e++) {
-      const auto& entry = m_entries[e->second];
+      DxvkStateCacheEntry entry;
+
+      if (!getCacheEntry(e->second, entry))
+        continue;
 
       switch (entry.type) {
         case DxvkStateCacheEntryType::MonolithicPipeline: {
           if (!pipeline)
             pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
 
-          m_pipeWorkers->compileGraphicsPipeline(pipeline, entry.gpState, DxvkPipelinePriority::Normal);
+          m_pipeWorkers->compileGraphicsPipeline(pipeline, entry.gpState, getEntryPriority(e->second));
         } break;
 
         case DxvkStateCacheEntryType::PipelineLibrary: {
@@ -468,13 +864,61 @@ namespace dxvk {
           if (item.gp.gs  != nullptr) libraryKey.addShader(item.gp.gs);
 
           auto pipelineLibrary = m_pipeManager->createShaderPipelineLibrary(libraryKey);
-          m_pipeWorkers->compilePipelineLibrary(pipelineLibrary, DxvkPipelinePriority::Normal);
+          m_pipeWorkers->compilePipelineLibrary(pipelineLibrary, getEntryPriority(e->second));
         } break;
       }
     }
   }
 
 
+  bool DxvkStateCache::getCacheEntry(
+          size_t                    entryId,
+          DxvkStateCacheEntry&      entry) {
+    auto status = m_entryStatus[entryId].load();
+
+    if (status == DxvkStateCacheEntryStatus::Invalid)
+      return false;
+
+    const auto& indexEntry = m_index[entryId];
+
+    const char* record = m_entryData + indexEntry.offset;
+    const char* recordData = record + sizeof(DxvkStateCacheEntryHeader) + sizeof(Sha1Hash);
+
+    DxvkStateCacheEntryData data;
+    bool valid = data.readFromMemory(recordData, indexEntry.header.entrySize);
+
+    // Entries are validated on first use only. The record header
+    // must match the index, and the check sum must match the data.
+    if (valid && status == DxvkStateCacheEntryStatus::Unknown) {
+      DxvkStateCacheEntryHeader header;
+      Sha1Hash hash;
+
+      std::memcpy(&header, record, sizeof(header));
+      std::memcpy(&hash, record + sizeof(header), sizeof(hash));
+
+      valid = !std::memcmp(&header, &indexEntry.header, sizeof(header))
+           && hash == data.computeHash();
+    }
+
+    valid = valid && decodeCacheEntry(DxvkStateCacheHeader().version,
+      DxvkStateCacheEntryType(indexEntry.header.entryType),
+      VkShaderStageFlags(indexEntry.header.stageMask), data, entry);
+
+    valid = valid && entry.shaders.eq(indexEntry.shaders);
+
+    if (status == DxvkStateCacheEntryStatus::Unknown) {
+      m_entryStatus[entryId].store(valid
+        ? DxvkStateCacheEntryStatus::Valid
+        : DxvkStateCacheEntryStatus::Invalid);
+
+      if (!valid)
+        Logger::warn("DXVK: Skipping invalid state cache entry");
+    }
+
+    return valid;
+  }
+
+
   bool DxvkStateCache::readCacheFile() {
     // Return success if the file was not found.
     // This way we will only create it on demand.
@@ -496,59 +940,443 @@ namespace dxvk {
     }
 
     // Discard caches of unsupported versions
-    if (curHeader.version < 8 || curHeader.version == 16
-     || curHeader.version > newHeader.version) {
+    if (!isSupportedVersion(curHeader.version)) {
       Logger::warn("DXVK: State cache version not supported");
       return false;
     }
 
-    // Notify user about format conversion
-    if (curHeader.version != newHeader.version)
-      Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
-
-    // Read actual cache entries from the file.
-    // If we encounter invalid entries, we should
-    // regenerate the entire state cache file.
-    uint32_t numInvalidEntries = 0;
+    // Indexed cache files are mapped rather than read
+    if (curHeader.version == newHeader.version) {
+      ifile.close();
+      return readCacheIndex();
+    }
 
-    while (ifile) {
-      DxvkStateCacheEntry entry;
+    // Notify user about format conversion
+    Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
 
-      if (readCacheEntry(curHeader.version, ifile, entry)) {
-        size_t entryId = m_entries.size();
-        m_entries.push_back(entry);
+    ifile.close();
 
-        mapPipelineToEntry(entry.shaders, entryId);
+    // Read and validate all entries of the old file, and
+    // build a new indexed file that only contains valid ones
+    std::vector<DxvkStateCacheEntry> entries;
+    uint32_t numInvalidEntries = 0;
 
-        mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
-        mapShaderToPipeline(entry.shaders.tes, entry.shaders);
-        mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
-      } else if (ifile) {
-        numInvalidEntries += 1;
-      }
-    }
+    if (!readEntries(getCacheFileName(), entries, numInvalidEntries))
+      return false;
 
     Logger::info(str::format(
-      "DXVK: Read ", m_entries.size(),
+      "DXVK: Read ", entries.size(),
       " valid state cache entries"));
 
     if (numInvalidEntries) {
       Logger::warn(str::format(
         "DXVK: Skipped ", numInvalidEntries,
         " invalid state cache entries"));
+    }
+
+    // Keep the converted file in memory, so that we
+    // don't depend on the cache file being writable
+    m_fileData = buildCacheFile(newHeader.version, entries);
+
+    IndexLayout layout;
+
+    if (!parseCacheIndex(newHeader.version, m_fileData.data(), m_fileData.size(), layout))
+      return false;
+
+    initCacheIndex(m_fileData.data(), layout, writeCacheFile(m_fileData));
+    return true;
+  }
+
+
+  bool DxvkStateCache::readCacheIndex() {
+    m_mappedFile = MappedFile(getCacheFileName());
+
+    if (!m_mappedFile) {
+      Logger::warn("DXVK: Failed to map state cache file");
       return false;
     }
-    
-    // Rewrite entire state cache if it is outdated
-    return curHeader.version == newHeader.version;
+
+    const char* fileData = m_mappedFile.data();
+    size_t fileSize = m_mappedFile.size();
+
+    IndexLayout layout;
+
+    if (!parseCacheIndex(DxvkStateCacheHeader().version, fileData, fileSize, layout)) {
+      Logger::warn("DXVK: Failed to read state cache index");
+      m_mappedFile = MappedFile();
+      return false;
+    }
+
+    // Look for entries that were appended to the file since
+    // the index was last written. These are validated lazily
+    // just like indexed entries, we only need the shader keys.
+    std::vector<DxvkStateCacheIndexEntry> newEntries;
+
+    size_t tailOffset = layout.dataOffset + layout.header.dataSize;
+    size_t tailSize = 0;
+
+    while (tailOffset + tailSize < fileSize) {
+      DxvkStateCacheIndexEntry entry = { };
+
+      size_t recordSize = readCacheRecord(
+        fileData + tailOffset + tailSize,
+        fileSize - tailOffset - tailSize, entry);
+
+      if (!recordSize)
+        break;
+
+      entry.offset = uint32_t(tailSize);
+      newEntries.push_back(entry);
+
+      tailSize += recordSize;
+    }
+
+    if (tailOffset + tailSize != fileSize)
+      Logger::warn("DXVK: Skipping truncated state cache entry");
+
+    // If the file is fully indexed, use the mapping directly
+    if (tailOffset == fileSize) {
+      Logger::info(str::format("DXVK: Read ", layout.header.entryCount, " state cache entries"));
+      initCacheIndex(fileData, layout, true);
+      return true;
+    }
+
+    // Otherwise, build a new file that includes all entries
+    // in the index. The file cannot be rewritten while it is
+    // mapped on all platforms, so keep the new file in memory.
+    auto index = reinterpret_cast<const DxvkStateCacheIndexEntry*>(fileData + layout.indexOffset);
+    auto usage = reinterpret_cast<const DxvkStateCacheUsage*>(fileData + layout.usageOffset);
+
+    DxvkStateCacheFileBuilder builder;
+
+    auto addRecord = [&builder] (
+      const DxvkStateCacheIndexEntry&       entry,
+      const DxvkStateCacheUsage&            usage,
+      const char*                           record) {
+      Sha1Hash hash;
+      std::memcpy(&hash, record + sizeof(DxvkStateCacheEntryHeader), sizeof(hash));
+      builder.addEntry(entry, usage, hash, record + sizeof(DxvkStateCacheEntryHeader) + sizeof(hash));
+    };
+
+    for (uint32_t i = 0; i < layout.header.entryCount; i++) {
+      if (isRecordInBounds(index[i], layout.header.dataSize))
+        addRecord(index[i], usage[i], fileData + layout.dataOffset + index[i].offset);
+    }
+
+    for (const auto& entry : newEntries) {
+      const char* record = fileData + tailOffset + entry.offset;
+
+      // New entries were used in exactly one run so far, and
+      // store the frame of their first use in the record.
+      DxvkStateCacheUsage newUsage;
+      newUsage.firstUse = readFirstUse(record);
+      newUsage.useCount = 1;
+
+      addRecord(entry, newUsage, record);
+    }
+
+    Logger::info(str::format(
+      "DXVK: Read ", builder.entryCount(), " state cache entries, ",
+      newEntries.size(), " of which were not indexed"));
+
+    m_fileData = builder.build(DxvkStateCacheHeader().version);
+    m_mappedFile = MappedFile();
+
+    if (!parseCacheIndex(DxvkStateCacheHeader().version, m_fileData.data(), m_fileData.size(), layout))
+      return false;
+
+    initCacheIndex(m_fileData.data(), layout, writeCacheFile(m_fileData));
+    return true;
+  }
+
+
+  bool DxvkStateCache::parseCacheIndex(
+          uint32_t                  version,
+    const char*                     fileData,
+          size_t                    fileSize,
+          IndexLayout&              layout) {
+    layout.indexOffset = sizeof(DxvkStateCacheHeader) + sizeof(layout.header);
+
+    if (fileSize < layout.indexOffset)
+      return false;
+
+    std::memcpy(&layout.header, fileData + sizeof(DxvkStateCacheHeader), sizeof(layout.header));
+
+    size_t indexSize = size_t(layout.header.entryCount) * sizeof(DxvkStateCacheIndexEntry);
+    size_t usageSize = 0;
+
+    // v18 does not have usage data
+    if (version >= 19)
+      usageSize = size_t(layout.header.entryCount) * sizeof(DxvkStateCacheUsage);
+
+    if (indexSize + usageSize > fileSize - layout.indexOffset
+     || layout.header.dataSize > fileSize - layout.indexOffset - indexSize - usageSize)
+      return false;
+
+    layout.usageOffset = layout.indexOffset + indexSize;
+    layout.dataOffset = layout.usageOffset + usageSize;
+
+    // Only the index is validated here, this is
+    // cheap compared to hashing all entry data
+    return layout.header.hash == Sha1Hash::compute(fileData + layout.indexOffset, indexSize);
+  }
+
+
+  void DxvkStateCache::initCacheIndex(
+    const char*                     fileData,
+    const IndexLayout&              layout,
+          bool                      fileValid) {
+    m_index = reinterpret_cast<const DxvkStateCacheIndexEntry*>(fileData + layout.indexOffset);
+    m_indexSize = layout.header.entryCount;
+
+    m_usage = reinterpret_cast<const DxvkStateCacheUsage*>(fileData + layout.usageOffset);
+    m_usageOffset = fileValid ? layout.usageOffset : 0;
+
+    m_entryData = fileData + layout.dataOffset;
+    m_entryStatus = std::vector<std::atomic<DxvkStateCacheEntryStatus>>(m_indexSize);
+    m_entryUseFrame = std::vector<std::atomic<uint32_t>>(m_indexSize);
+
+    // Build lookup tables in parallel. Each thread first sorts one
+    // range of the index into per-shard buckets, then each shard
+    // gets filled from the buckets of all threads, so that every
+    // index entry is only looked at once.
+    struct ShardBucket {
+      std::vector<uint32_t> entries;
+      std::vector<std::pair<uint32_t, const DxvkShaderKey*>> shaders;
+    };
+
+    using ShardBuckets = std::array<ShardBucket, MapShardCount>;
+
+    std::vector<ShardBuckets> buckets(getLoadWorkers().threadCount());
+    std::atomic<uint32_t> nextShard = { 0u };
+
+    runParallel([this, &buckets, &layout] (uint32_t index, uint32_t count) {
+      auto& threadBuckets = buckets[index];
+
+      size_t first = (m_indexSize * index) / count;
+      size_t last = (m_indexSize * (index + 1)) / count;
+
+      for (size_t i = first; i < last; i++) {
+        const auto& entry = m_index[i];
+
+        if (!isRecordInBounds(entry, layout.header.dataSize)) {
+          m_entryStatus[i].store(DxvkStateCacheEntryStatus::Invalid);
+          continue;
+        }
+
+        threadBuckets[getMapShardIndex(entry.shaders.vs)].entries.push_back(i);
+
+        for (const auto* shader : { &entry.shaders.vs, &entry.shaders.tcs,
+            &entry.shaders.tes, &entry.shaders.gs, &entry.shaders.fs }) {
+          if (!shader->eq(g_nullShaderKey))
+            threadBuckets[getMapShardIndex(*shader)].shaders.push_back({ uint32_t(i), shader });
+        }
+      }
+    });
+
+    runParallel([this, &buckets, &nextShard] (uint32_t, uint32_t) {
+      uint32_t shard;
+
+      while ((shard = nextShard++) < MapShardCount) {
+        auto& mapShard = m_mapShards[shard];
+
+        for (const auto& threadBuckets : buckets) {
+          for (uint32_t i : threadBuckets[shard].entries)
+            mapShard.entryMap.insert({ m_index[i].shaders, i });
+
+          for (const auto& s : threadBuckets[shard].shaders)
+            mapShard.pipelineMap.insert({ *s.second, m_index[s.first].shaders });
+        }
+      }
+    });
+
+    // Rank entries by the frame in which they were first used,
+    // so that pipelines needed early on get compiled first. If
+    // two entries were first used in the same frame, prefer the
+    // one that was used more often. Ties are broken by file
+    // order, which also reflects the order of first use.
+    std::vector<uint32_t> order(m_indexSize);
+
+    for (uint32_t i = 0; i < m_indexSize; i++)
+      order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [this] (uint32_t a, uint32_t b) {
+      if (m_usage[a].firstUse != m_usage[b].firstUse)
+        return m_usage[a].firstUse < m_usage[b].firstUse;
+
+      return m_usage[a].useCount > m_usage[b].useCount;
+    });
+
+    m_entryRank.resize(m_indexSize);
+
+    for (uint32_t i = 0; i < m_indexSize; i++)
+      m_entryRank[order[i]] = i;
+  }
+
+
+  void DxvkStateCache::validateCacheEntries() {
+    // Validate all entries ahead of time, so that the worker
+    // thread only needs to decode entries when compiling
+    // pipelines. Entries that get used in the meantime are
+    // validated on demand, so this is purely an optimization.
+    constexpr size_t ChunkSize = 256;
+
+    std::atomic<size_t> nextChunk = { 0u };
+
+    runParallel([this, &nextChunk] (uint32_t, uint32_t) {
+      size_t chunk;
+
+      while (!m_stopThreads.load() && (chunk = nextChunk++) * ChunkSize < m_indexSize) {
+        size_t first = chunk * ChunkSize;
+        size_t last = std::min(first + ChunkSize, m_indexSize);
+
+        for (size_t i = first; i < last; i++) {
+          DxvkStateCacheEntry entry;
+
+          if (m_entryStatus[i].load() == DxvkStateCacheEntryStatus::Unknown)
+            getCacheEntry(i, entry);
+        }
+      }
+    });
+  }
+
+
+  void DxvkStateCache::runParallel(
+    const std::function<void (uint32_t, uint32_t)>& fn) {
+    getLoadWorkers().run(fn);
+  }
+
+
+  DxvkStateCacheLoadWorkers& DxvkStateCache::getLoadWorkers() {
+    // Create the workers on first use and keep them
+    // around until loading is done, rather than
+    // spawning a new set of threads for every job.
+    if (!m_loadWorkers) {
+      uint32_t threadCount = std::clamp(dxvk::thread::hardware_concurrency(), 1u, MaxLoadThreads);
+      m_loadWorkers = std::make_unique<DxvkStateCacheLoadWorkers>(threadCount);
+    }
+
+    return *m_loadWorkers;
+  }
+
+
+  size_t DxvkStateCache::readCacheRecord(
+    const char*                     data,
+          size_t                    size,
+          DxvkStateCacheIndexEntry& entry) {
+    DxvkStateCacheEntryHeader header;
+    size_t headerSize = sizeof(header) + sizeof(Sha1Hash);
+
+    if (size < headerSize)
+      return 0;
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.entrySize > size - headerSize)
+      return 0;
+
+    DxvkStateCacheEntryData entryData;
+
+    if (!entryData.readFromMemory(data + headerSize, header.entrySize)
+     || !entryData.read(entry.shaders, DxvkStateCacheHeader().version,
+          VkShaderStageFlags(header.stageMask)))
+      return 0;
+
+    entry.header = header;
+    return headerSize + header.entrySize;
+  }
+
+
+  bool DxvkStateCache::isRecordInBounds(
+    const DxvkStateCacheIndexEntry& entry,
+          size_t                    dataSize) {
+    size_t recordSize = sizeof(DxvkStateCacheEntryHeader)
+      + sizeof(Sha1Hash) + entry.header.entrySize;
+
+    return entry.offset <= dataSize
+        && recordSize <= dataSize - entry.offset;
+  }
+
+
+  bool DxvkStateCache::decodeCacheRecord(
+          uint32_t                  version,
+    const char*                     record,
+          size_t                    size,
+          DxvkStateCacheEntry&      entry) {
+    DxvkStateCacheEntryHeader header;
+    DxvkStateCacheEntryData data;
+    Sha1Hash hash;
+
+    size_t headerSize = sizeof(header) + sizeof(hash);
+
+    if (size < headerSize)
+      return false;
+
+    std::memcpy(&header, record, sizeof(header));
+    std::memcpy(&hash, record + sizeof(header), sizeof(hash));
+
+    if (header.entrySize > size - headerSize
+     || !data.readFromMemory(record + headerSize, header.entrySize)
+     || hash != data.computeHash())
+      return false;
+
+    return decodeCacheEntry(version,
+      DxvkStateCacheEntryType(header.entryType),
+      VkShaderStageFlags(header.stageMask), data, entry);
+  }
+
+
+  uint32_t DxvkStateCache::readFirstUse(
+    const char*                     record) {
+    DxvkStateCacheEntryHeader header;
+    std::memcpy(&header, record, sizeof(header));
+
+    // The first use frame is always stored at
+    // the very end of the entry data
+    uint32_t firstUse = 0;
+
+    if (header.entrySize >= sizeof(firstUse)) {
+      std::memcpy(&firstUse, record + sizeof(header) + sizeof(Sha1Hash)
+        + header.entrySize - sizeof(firstUse), sizeof(firstUse));
+    }
+
+    return firstUse;
+  }
+
+
+  std::vector<char> DxvkStateCache::buildCacheFile(
+          uint32_t                  version,
+    const std::vector<DxvkStateCacheEntry>& entries) {
+    DxvkStateCacheFileBuilder builder;
+
+    for (const auto& entry : entries) {
+      DxvkStateCacheIndexEntry indexEntry = { };
+      DxvkStateCacheEntryData data;
+
+      DxvkStateCacheUsage usage;
+      usage.firstUse = entry.firstUse;
+      usage.useCount = std::max(entry.useCount, 1u);
+
+      encodeCacheEntry(version, entry, indexEntry.header, data);
+      indexEntry.shaders = entry.shaders;
+
+      builder.addEntry(indexEntry, usage, data.computeHash(), data.data());
+    }
+
+    return builder.build(version);
+  }
+
+
+  bool DxvkStateCache::isSupportedVersion(
+          uint32_t                  version) {
+    return version >= 8 && version != 16
+        && version <= DxvkStateCacheHeader().version;
   }
 
 
   bool DxvkStateCache::readCacheHeader(
           std::istream&             stream,
-          DxvkStateCacheHeader&     header) const {
+          DxvkStateCacheHeader&     header) {
     DxvkStateCacheHeader expected;
 
     auto data = reinterpret_cast<char*>(&header);
@@ -569,7 +1397,7 @@ namespace dxvk {
   bool DxvkStateCache::readCacheEntry(
           uint32_t                  version,
           std::istream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
+          DxvkStateCacheEntry&      entry) {
     // Read entry metadata and actual data
     DxvkStateCacheEntryHeader header;
     DxvkStateCacheEntryData data;
@@ -602,15 +1430,28 @@ namespace dxvk {
     if (hash != data.computeHash())
       return false;
 
+    return decodeCacheEntry(version,
+      DxvkStateCacheEntryType(header.entryType),
+      stageMask, data, entry);
+  }
+
+
+  bool DxvkStateCache::decodeCacheEntry(
+          uint32_t                  version,
+          DxvkStateCacheEntryType   entryType,
+          VkShaderStageFlags        stageMask,
+          DxvkStateCacheEntryData&  data,
+          DxvkStateCacheEntry&      entry) {
     // Set up entry metadata
-    entry.type = DxvkStateCacheEntryType(header.entryType);
+    entry.type = entryType;
 
     // Read shader hashes
-    auto entryType = DxvkStateCacheEntryType(header.entryType);
-    data.read(entry.shaders, version, stageMask);
+    if (!data.read(entry.shaders, version, stageMask))
+      return false;
 
+    // v19 stores the first use frame after all other data
     if (entryType == DxvkStateCacheEntryType::PipelineLibrary)
-      return true;
+      return version < 19 || data.read(entry.firstUse, version);
 
     DxvkBindingMaskV10 dummyBindingMask = { };
 
@@ -684,14 +1525,36 @@ namespace dxvk {
     if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
       return false;
 
+    if (version >= 19 && !data.read(entry.firstUse, version))
+      return false;
+
     return true;
   }
 
 
   void DxvkStateCache::writeCacheEntry(
           std::ostream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
+          DxvkStateCacheEntry&      entry) {
+    DxvkStateCacheEntryHeader header;
     DxvkStateCacheEntryData data;
+
+    encodeCacheEntry(DxvkStateCacheHeader().version, entry, header, data);
+
+    // General layout: header -> hash -> data
+    Sha1Hash hash = data.computeHash();
+
+    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
+    stream.write(data.data(), data.size());
+    stream.flush();
+  }
+
+
+  void DxvkStateCache::encodeCacheEntry(
+          uint32_t                  version,
+    const DxvkStateCacheEntry&      entry,
+          DxvkStateCacheEntryHeader& header,
+          DxvkStateCacheEntryData&  data) {
     VkShaderStageFlags stageMask = 0;
 
     // Write shader hashes
@@ -750,18 +1613,44 @@ namespace dxvk {
       }
     }
 
-    // General layout: header -> hash -> data
-    DxvkStateCacheEntryHeader header;
+    // Store the first use frame last, so that it can
+    // be read without having to decode the entry
+    if (version >= 19)
+      data.write(entry.firstUse);
+
     header.entryType = uint32_t(entry.type);
     header.stageMask = uint32_t(stageMask);
     header.entrySize = data.size();
+  }
 
-    Sha1Hash hash = data.computeHash();
 
-    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
-    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
-    stream.write(data.data(), data.size());
-    stream.flush();
+  void DxvkStateCache::loaderFunc(bool reset) {
+    env::setThreadName("dxvk-cache-load");
+
+    bool newFile = reset || !readCacheFile();
+
+    if (newFile)
+      openCacheFileForWrite(true);
+
+    // Queue pipelines for all shaders that got registered
+    // while the cache was loading, and allow the writer
+    // thread to start appending new entries to the file.
+    { std::unique_lock<dxvk::mutex> entryLock(m_entryLock);
+      m_loaded.store(true);
+
+      if (!m_stopThreads.load()) {
+        for (const auto& shader : m_shaderMap)
+          queuePipelines(shader.first, true);
+      }
+    }
+
+    { std::unique_lock<dxvk::mutex> writerLock(m_writerLock);
+      m_writerCond.notify_one();
+    }
+
+    validateCacheEntries();
+
+    m_loadWorkers = nullptr;
   }
 
 
@@ -783,7 +1672,7 @@ namespace dxvk {
         if (m_workerQueue.empty())
           break;
         
-        item = m_workerQueue.front();
+        item = m_workerQueue.top();
         m_workerQueue.pop();
       }
 
@@ -803,17 +1692,22 @@ namespace dxvk {
       { std::unique_lock<dxvk::mutex> lock(m_writerLock);
 
         m_writerCond.wait(lock, [this] () {
-          return m_writerQueue.size()
+          return (m_writerQueue.size() && m_loaded.load())
               || m_stopThreads.load();
         });
 
-        if (m_writerQueue.size() == 0)
+        if (m_writerQueue.size() == 0 || !m_loaded.load())
           break;
 
         entry = m_writerQueue.front();
         m_writerQueue.pop();
       }
 
+      // Entries may have been queued before the
+      // cache was loaded, so check them again
+      if (useCacheEntry(entry))
+        continue;
+
       if (!file.is_open())
         file = openCacheFileForWrite(false);
 
@@ -861,15 +1755,7 @@ namespace dxvk {
     }
 
     if (recreate) {
-      file = std::ofstream(getCacheFileName().c_str(),
-        std::ios_base::binary |
-        std::ios_base::trunc);
-
-      if (!file && env::createDirectory(getCacheDir())) {
-        file = std::ofstream(getCacheFileName().c_str(),
-          std::ios_base::binary |
-          std::ios_base::trunc);
-      }
+      file = createCacheFile();
     } else {
       file = std::ofstream(getCacheFileName().c_str(),
         std::ios_base::binary |
@@ -882,19 +1768,49 @@ namespace dxvk {
     if (recreate) {
       Logger::warn("DXVK: Creating new state cache file");
 
-      // Write header with the current version number
+      // Write header with the current version number,
+      // followed by an empty index. Any entries written
+      // to the file will be indexed on the next run.
       DxvkStateCacheHeader header;
+      DxvkStateCacheIndexHeader indexHeader;
+      indexHeader.hash = g_nullHash;
+
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+    }
+
+    return file;
+  }
+
 
-      auto data = reinterpret_cast<const char*>(&header);
-      auto size = sizeof(header);
+  std::ofstream DxvkStateCache::createCacheFile() const {
+    std::ofstream file(getCacheFileName().c_str(),
+      std::ios_base::binary |
+      std::ios_base::trunc);
 
-      file.write(data, size);
+    if (!file && env::createDirectory(getCacheDir())) {
+      file = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
     }
 
     return file;
   }
 
 
+  bool DxvkStateCache::writeCacheFile(
+    const std::vector<char>&        data) const {
+    std::ofstream file = createCacheFile();
+
+    if (!file || !file.write(data.data(), data.size())) {
+      Logger::warn("DXVK: Failed to write state cache file");
+      return false;
+    }
+
+    return true;
+  }
+
+
   std::string DxvkStateCache::getCacheDir() const {
     return env::getEnvVar("DXVK_STATE_CACHE_PATH");
   }
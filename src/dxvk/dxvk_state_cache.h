@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -10,11 +13,30 @@
 
 #include "dxvk_state_cache_types.h"
 
+#include "../util/util_mapped_file.h"
+
 namespace dxvk {
 
   class DxvkDevice;
   class DxvkPipelineManager;
   class DxvkPipelineWorkers;
+  class DxvkStateCacheLoadWorkers;
+
+  class DxvkStateCacheEntryData;
+
+  enum class DxvkPipelinePriority : uint32_t;
+
+  /**
+   * \brief State cache entry status
+   *
+   * Entries are validated when they are first
+   * accessed, rather than when loading the file.
+   */
+  enum class DxvkStateCacheEntryStatus : uint8_t {
+    Unknown = 0,
+    Valid   = 1,
+    Invalid = 2,
+  };
 
   /**
    * \brief State cache
@@ -24,6 +46,12 @@ namespace dxvk {
    * game, which allows DXVK to compile them ahead
    * of time instead of compiling them on the first
    * draw.
+   *
+   * Cache files are memory-mapped, and lookup tables
+   * are built from the file index without reading or
+   * validating the entry data itself. Loading happens
+   * on a background thread, and the lookup tables are
+   * sharded so that they can be built in parallel.
    */
   class DxvkStateCache {
 
@@ -41,6 +69,9 @@ namespace dxvk {
      *
      * If the pipeline is not already cached, this
      * will write a new pipeline to the cache file.
+     * Must only be called when the library is first
+     * used for a draw, since this records the current
+     * frame as the first use of the library.
      * \param [in] shaders Shader keys
      */
     void addPipelineLibrary(
@@ -74,12 +105,71 @@ namespace dxvk {
      */
     void stopWorkers();
 
+    /**
+     * \brief Reads all entries from a cache file
+     *
+     * Reads and validates all entries of a state cache
+     * file of any supported version, including entries
+     * that are not indexed yet. Used by offline tools.
+     * \param [in] path Cache file path
+     * \param [out] entries Valid entries in file order
+     * \param [out] invalidCount Number of skipped entries
+     * \returns \c false if the file could not be read
+     */
+    static bool readEntries(
+      const str::path_string&               path,
+            std::vector<DxvkStateCacheEntry>& entries,
+            uint32_t&                       invalidCount);
+
+    /**
+     * \brief Writes entries to a cache file
+     *
+     * Creates an indexed state cache file with the given
+     * entries. Older indexed versions can be written in
+     * order to test loading and converting such files.
+     * \param [in] path Cache file path
+     * \param [in] entries Entries to write
+     * \param [in] version File version, must be 18 or later
+     * \returns \c true on success
+     */
+    static bool writeEntries(
+      const str::path_string&               path,
+      const std::vector<DxvkStateCacheEntry>& entries,
+            uint32_t                        version = DxvkStateCacheHeader().version);
+
   private:
 
     using WriterItem = DxvkStateCacheEntry;
 
     struct WorkerItem {
       DxvkGraphicsPipelineShaders gp;
+      uint32_t                    rank = 0;
+
+      // Items with a lower rank are processed first
+      bool operator < (const WorkerItem& other) const {
+        return rank > other.rank;
+      }
+    };
+
+    struct IndexLayout {
+      DxvkStateCacheIndexHeader header;
+      size_t                    indexOffset = 0;
+      size_t                    usageOffset = 0;
+      size_t                    dataOffset  = 0;
+    };
+
+    constexpr static uint32_t MapShardCount = 16;
+
+    constexpr static uint32_t MaxLoadThreads = MapShardCount;
+
+    struct MapShard {
+      std::unordered_multimap<
+        DxvkStateCacheKey, size_t,
+        DxvkHash, DxvkEq> entryMap;
+
+      std::unordered_multimap<
+        DxvkShaderKey, DxvkStateCacheKey,
+        DxvkHash, DxvkEq> pipelineMap;
     };
 
     DxvkDevice*                       m_device;
@@ -87,26 +177,37 @@ namespace dxvk {
     DxvkPipelineWorkers*              m_pipeWorkers;
     bool                              m_enable = false;
 
-    std::vector<DxvkStateCacheEntry>  m_entries;
+    MappedFile                        m_mappedFile;
+    std::vector<char>                 m_fileData;
+
+    const DxvkStateCacheIndexEntry*   m_index       = nullptr;
+    size_t                            m_indexSize   = 0;
+    const DxvkStateCacheUsage*        m_usage       = nullptr;
+    size_t                            m_usageOffset = 0;
+    const char*                       m_entryData   = nullptr;
+
+    std::vector<std::atomic<DxvkStateCacheEntryStatus>> m_entryStatus;
+    std::vector<std::atomic<uint32_t>> m_entryUseFrame;
+    std::vector<uint32_t>             m_entryRank;
+
     std::atomic<bool>                 m_stopThreads = { false };
+    std::atomic<bool>                 m_loaded      = { false };
+
+    dxvk::thread                      m_loaderThread;
+
+    std::unique_ptr<DxvkStateCacheLoadWorkers> m_loadWorkers;
 
     dxvk::mutex                       m_entryLock;
 
-    std::unordered_multimap<
-      DxvkStateCacheKey, size_t,
-      DxvkHash, DxvkEq> m_entryMap;
+    std::array<MapShard, MapShardCount> m_mapShards;
 
-    std::unordered_multimap<
-      DxvkShaderKey, DxvkStateCacheKey,
-      DxvkHash, DxvkEq> m_pipelineMap;
-    
     std::unordered_map<
       DxvkShaderKey, Rc<DxvkShader>,
       DxvkHash, DxvkEq> m_shaderMap;
 
     dxvk::mutex                       m_workerLock;
     dxvk::condition_variable          m_workerCond;
-    std::queue<WorkerItem>            m_workerQueue;
+    std::priority_queue<WorkerItem>   m_workerQueue;
     dxvk::thread                      m_workerThread;
 
     dxvk::mutex                       m_writerLock;
@@ -121,32 +222,110 @@ namespace dxvk {
       const DxvkShaderKey&            key,
             Rc<DxvkShader>&           shader) const;
     
-    void mapPipelineToEntry(
-      const DxvkStateCacheKey&        key,
-            size_t                    entryId);
-    
-    void mapShaderToPipeline(
-      const DxvkShaderKey&            shader,
+    bool useCacheEntry(
+      const DxvkStateCacheEntry&      entry);
+
+    DxvkPipelinePriority getEntryPriority(
+            size_t                    entryId) const;
+
+    void writeEntryUsage();
+
+    void queuePipelines(
+      const DxvkShaderKey&            key,
+            bool                      deduplicate);
+
+    MapShard& getMapShard(
+      const DxvkShaderKey&            key) {
+      return m_mapShards[getMapShardIndex(key)];
+    }
+
+    static uint32_t getMapShardIndex(
+      const DxvkShaderKey&            key) {
+      return key.sha1().dword(1) % MapShardCount;
+    }
+
+    static const DxvkShaderKey& getFirstShaderKey(
       const DxvkStateCacheKey&        key);
 
     void compilePipelines(
       const WorkerItem&               item);
 
+    bool getCacheEntry(
+            size_t                    entryId,
+            DxvkStateCacheEntry&      entry);
+
     bool readCacheFile();
 
-    bool readCacheHeader(
+    bool readCacheIndex();
+
+    static bool parseCacheIndex(
+            uint32_t                  version,
+      const char*                     fileData,
+            size_t                    fileSize,
+            IndexLayout&              layout);
+
+    void initCacheIndex(
+      const char*                     fileData,
+      const IndexLayout&              layout,
+            bool                      fileValid);
+
+    void validateCacheEntries();
+
+    void runParallel(
+      const std::function<void (uint32_t, uint32_t)>& fn);
+
+    DxvkStateCacheLoadWorkers& getLoadWorkers();
+
+    static size_t readCacheRecord(
+      const char*                     data,
+            size_t                    size,
+            DxvkStateCacheIndexEntry& entry);
+
+    static bool decodeCacheRecord(
+            uint32_t                  version,
+      const char*                     record,
+            size_t                    size,
+            DxvkStateCacheEntry&      entry);
+
+    static uint32_t readFirstUse(
+      const char*                     record);
+
+    static std::vector<char> buildCacheFile(
+            uint32_t                  version,
+      const std::vector<DxvkStateCacheEntry>& entries);
+
+    static bool isSupportedVersion(
+            uint32_t                  version);
+
+    static bool readCacheHeader(
             std::istream&             stream,
-            DxvkStateCacheHeader&     header) const;
+            DxvkStateCacheHeader&     header);
 
-    bool readCacheEntry(
+    static bool readCacheEntry(
             uint32_t                  version,
             std::istream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
+            DxvkStateCacheEntry&      entry);
+
+    static bool decodeCacheEntry(
+            uint32_t                  version,
+            DxvkStateCacheEntryType   entryType,
+            VkShaderStageFlags        stageMask,
+            DxvkStateCacheEntryData&  data,
+            DxvkStateCacheEntry&      entry);
     
-    void writeCacheEntry(
+    static void writeCacheEntry(
             std::ostream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
+            DxvkStateCacheEntry&      entry);
+
+    static void encodeCacheEntry(
+            uint32_t                  version,
+      const DxvkStateCacheEntry&      entry,
+            DxvkStateCacheEntryHeader& header,
+            DxvkStateCacheEntryData&  data);
     
+    void loaderFunc(
+            bool                      reset);
+
     void workerFunc();
 
     void writerFunc();
@@ -162,6 +341,15 @@ namespace dxvk {
     std::ofstream openCacheFileForWrite(
             bool                      recreate) const;
 
+    std::ofstream createCacheFile() const;
+
+    bool writeCacheFile(
+      const std::vector<char>&        data) const;
+
+    static bool isRecordInBounds(
+      const DxvkStateCacheIndexEntry& entry,
+            size_t                    dataSize);
+
     std::string getCacheDir() const;
 
   };
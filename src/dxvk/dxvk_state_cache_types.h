@@ -42,12 +42,19 @@ namespace dxvk {
    * as the full state vector, including its render
    * pass format. This also includes a SHA-1 hash
    * that is used as a check sum to verify integrity.
+   *
+   * The first use frame and use count are used to
+   * decide which pipelines to compile first. Entries
+   * read from files without usage data have a first
+   * use of \c ~0u, so that they are ranked last.
    */
   struct DxvkStateCacheEntry {
     DxvkStateCacheEntryType       type;
     DxvkStateCacheKey             shaders;
     DxvkGraphicsPipelineStateInfo gpState;
     Sha1Hash                      hash;
+    uint32_t                      firstUse = ~0u;
+    uint32_t                      useCount = 0;
   };
 
 
@@ -60,12 +67,79 @@ namespace dxvk {
    */
   struct DxvkStateCacheHeader {
     char     magic[4]   = { 'D', 'X', 'V', 'K' };
-    uint32_t version    = 17;
+    uint32_t version    = 19;
     uint32_t entrySize  = 0; /* no longer meaningful */
   };
 
   static_assert(sizeof(DxvkStateCacheHeader) == 12);
 
+
+  /**
+   * \brief Packed entry header
+   */
+  struct DxvkStateCacheEntryHeader {
+    uint32_t entryType : 1;
+    uint32_t stageMask : 5;
+    uint32_t entrySize : 26;
+  };
+
+
+  /**
+   * \brief State cache index header
+   *
+   * Follows the file header since v18. The index is a
+   * tightly packed array of \c entryCount index entries,
+   * followed by \c entryCount usage entries since v19,
+   * and \c dataSize bytes of entry records. The hash only
+   * covers the index itself, entry records are validated
+   * individually when they are first used. Usage data is
+   * not validated since it gets updated in place.
+   *
+   * Entries that get appended to the file at runtime
+   * are not indexed, and will be added to the index
+   * the next time the cache file is loaded.
+   */
+  struct DxvkStateCacheIndexHeader {
+    uint32_t entryCount = 0;
+    uint32_t dataSize   = 0;
+    Sha1Hash hash;
+  };
+
+  static_assert(sizeof(DxvkStateCacheIndexHeader) == 28);
+
+
+  /**
+   * \brief State cache index entry
+   *
+   * Stores the entry type and shader keys, so that lookup
+   * tables can be built without touching the entry data.
+   * The offset is relative to the start of the data section
+   * and points to an entry record, which uses the same
+   * header -> hash -> data layout as previous versions.
+   */
+  struct DxvkStateCacheIndexEntry {
+    DxvkStateCacheEntryHeader header;
+    uint32_t                  offset;
+    DxvkStateCacheKey         shaders;
+  };
+
+  static_assert(sizeof(DxvkStateCacheIndexEntry) == 128);
+
+
+  /**
+   * \brief State cache usage entry
+   *
+   * Stores the frame in which the pipeline was first
+   * used, and the number of runs it was used in. This
+   * gets updated when the application shuts down.
+   */
+  struct DxvkStateCacheUsage {
+    uint32_t firstUse = 0;
+    uint32_t useCount = 0;
+  };
+
+  static_assert(sizeof(DxvkStateCacheUsage) == 8);
+
   using DxvkBindingMaskV10 = DxvkBindingSet<384>;
   using DxvkBindingMaskV8 = DxvkBindingSet<128>;
 
@@ -17,6 +17,7 @@ namespace dxvk {
     CmdBarrierCount,          ///< Number of pipeline barriers
     PipeCountGraphics,        ///< Number of graphics pipelines
     PipeCountLibrary,         ///< Number of graphics shader libraries
+    PipeCountSaved,           ///< Number of graphics pipelines saved by state normalization
     PipeCountCompute,         ///< Number of compute pipelines
     PipeTasksDone,            ///< Boolean indicating compiler activity
     PipeTasksTotal,           ///< Boolean indicating compiler activity
@@ -28,6 +29,8 @@ namespace dxvk {
     CsSyncCount,              ///< CS thread synchronizations
     CsSyncTicks,              ///< Time spent waiting on CS
     CsChunkCount,             ///< Submitted CS chunks
+    CsWakeupCount,            ///< CS thread wakeups from sleep
+    CsSpinHitCount,           ///< CS thread spins that found work
     DescriptorPoolCount,      ///< Descriptor pool count
     DescriptorSetCount,       ///< Descriptor sets allocated
     NumCounters,              ///< Number of counters available
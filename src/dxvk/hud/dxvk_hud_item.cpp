@@ -470,6 +470,7 @@ namespace dxvk::hud {
 
     m_graphicsPipelines = counters.getCtr(DxvkStatCounter::PipeCountGraphics);
     m_graphicsLibraries = counters.getCtr(DxvkStatCounter::PipeCountLibrary);
+    m_graphicsSaved     = counters.getCtr(DxvkStatCounter::PipeCountSaved);
     m_computePipelines  = counters.getCtr(DxvkStatCounter::PipeCountCompute);
   }
 
@@ -501,6 +502,19 @@ namespace dxvk::hud {
         str::format(m_graphicsLibraries));
     }
 
+    if (m_graphicsSaved) {
+      position.y += 20.0f;
+      renderer.drawText(16.0f,
+        { position.x, position.y },
+        { 1.0f, 0.25f, 1.0f, 1.0f },
+        "Pipelines saved:");
+
+      renderer.drawText(16.0f,
+        { position.x + 240.0f, position.y },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        str::format(m_graphicsSaved));
+    }
+
     position.y += 20.0f;
     renderer.drawText(16.0f,
       { position.x, position.y },
@@ -597,6 +611,11 @@ namespace dxvk::hud {
       std::string text  = str::format(std::setfill(' '), std::setw(5), memAllocatedMib, " MB (", percentage, "%) ",
         std::setw(5 + (percentage < 10 ? 1 : 0) + (percentage < 100 ? 1 : 0)), memUsedMib, " MB used");
 
+      if (m_heaps[i].memoryBudget) {
+        uint64_t memBudgetMib = m_heaps[i].memoryBudget >> 20;
+        text += str::format(", ", std::setfill(' '), std::setw(5), memBudgetMib, " MB budget");
+      }
+
       position.y += 16.0f;
       renderer.drawText(16.0f,
         { position.x, position.y },
@@ -648,9 +667,18 @@ namespace dxvk::hud {
       uint64_t diffCsChunks = (currCsChunks - m_prevCsChunks) / m_updateCount;
       m_prevCsChunks = currCsChunks;
 
+      uint64_t currCsWakeups = counters.getCtr(DxvkStatCounter::CsWakeupCount);
+      uint64_t diffCsWakeups = (currCsWakeups - m_prevCsWakeups) / m_updateCount;
+      m_prevCsWakeups = currCsWakeups;
+
+      uint64_t currCsSpinHits = counters.getCtr(DxvkStatCounter::CsSpinHitCount);
+      uint64_t diffCsSpinHits = (currCsSpinHits - m_prevCsSpinHits) / m_updateCount;
+      m_prevCsSpinHits = currCsSpinHits;
+
       uint64_t syncTicks = m_maxCsSyncTicks / 100;
 
       m_csChunkString = str::format(diffCsChunks);
+      m_csWakeString = str::format(diffCsWakeups, " (", diffCsSpinHits, " spin)");
       m_csSyncString = m_maxCsSyncCount
         ? str::format(m_maxCsSyncCount, " (", (syncTicks / 10), ".", (syncTicks % 10), " ms)")
         : str::format(m_maxCsSyncCount);
@@ -678,6 +706,17 @@ namespace dxvk::hud {
       { 1.0f, 1.0f, 1.0f, 1.0f },
       m_csChunkString);
 
+    position.y += 20.0f;
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.25f, 1.0f, 0.25f, 1.0f },
+      "CS wakeups:");
+
+    renderer.drawText(16.0f,
+      { position.x + 132.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      m_csWakeString);
+
     position.y += 20.0f;
     renderer.drawText(16.0f,
       { position.x, position.y },
@@ -332,6 +332,7 @@ namespace dxvk::hud {
 
     uint64_t m_graphicsPipelines  = 0;
     uint64_t m_graphicsLibraries  = 0;
+    uint64_t m_graphicsSaved      = 0;
     uint64_t m_computePipelines   = 0;
 
   };
@@ -414,6 +415,8 @@ namespace dxvk::hud {
     uint64_t m_prevCsSyncCount  = 0;
     uint64_t m_prevCsSyncTicks  = 0;
     uint64_t m_prevCsChunks     = 0;
+    uint64_t m_prevCsWakeups    = 0;
+    uint64_t m_prevCsSpinHits   = 0;
 
     uint64_t m_maxCsSyncCount   = 0;
     uint64_t m_maxCsSyncTicks   = 0;
@@ -422,6 +425,7 @@ namespace dxvk::hud {
 
     std::string m_csSyncString;
     std::string m_csChunkString;
+    std::string m_csWakeString;
 
     dxvk::high_resolution_clock::time_point m_lastUpdate
       = dxvk::high_resolution_clock::now();
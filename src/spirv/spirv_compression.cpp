@@ -80,7 +80,16 @@ namespace dxvk {
       m_code.shrink_to_fit();
   }
 
-    
+
+  SpirvCompressedBuffer::SpirvCompressedBuffer(
+          size_t                size,
+          size_t                compressedSize,
+    const uint32_t*             compressedData)
+  : m_size(size), m_code(compressedData, compressedData + compressedSize) {
+
+  }
+
+
   SpirvCompressedBuffer::~SpirvCompressedBuffer() {
 
   }
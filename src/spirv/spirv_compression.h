@@ -19,11 +19,43 @@ namespace dxvk {
     SpirvCompressedBuffer();
 
     SpirvCompressedBuffer(SpirvCodeBuffer& code);
+
+    SpirvCompressedBuffer(
+            size_t                size,
+            size_t                compressedSize,
+      const uint32_t*             compressedData);
     
     ~SpirvCompressedBuffer();
     
     SpirvCodeBuffer decompress() const;
 
+    /**
+     * \brief Uncompressed code size
+     * \returns Size of the decompressed code, in dwords
+     */
+    size_t dwords() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Compressed code size
+     * \returns Size of the compressed data, in dwords
+     */
+    size_t compressedDwords() const {
+      return m_code.size();
+    }
+
+    /**
+     * \brief Compressed code
+     *
+     * Can be used to serialize the compressed code. The
+     * data can be restored with the matching constructor.
+     * \returns Pointer to compressed data
+     */
+    const uint32_t* compressedData() const {
+      return m_code.data();
+    }
+
   private:
 
     size_t                m_size;
@@ -1,6 +1,7 @@
 #include <cstring>
 
 #include "spirv_module.h"
+#include "spirv_optimizer.h"
 
 namespace dxvk {
   
@@ -31,6 +32,18 @@ namespace dxvk {
     result.append(m_code);
     return result;
   }
+
+
+  SpirvCodeBuffer SpirvModule::compileOptimized(
+    const std::string&            name) const {
+    SpirvOptimizer optimizer(this->compile());
+    SpirvCodeBuffer result = optimizer.optimize();
+
+    Logger::debug(str::format(name, ": Optimized SPIR-V: ",
+      optimizer.getInputInstructionCount(), " -> ",
+      optimizer.getOutputInstructionCount(), " instructions"));
+    return result;
+  }
   
   
   uint32_t SpirvModule::allocateId() {
@@ -3664,6 +3677,14 @@ namespace dxvk {
     m_code.putIns (spv::OpReturn, 1);
     m_blockId = 0;
   }
+
+
+  void SpirvModule::opReturnValue(
+          uint32_t                value) {
+    m_code.putIns (spv::OpReturnValue, 2);
+    m_code.putWord(value);
+    m_blockId = 0;
+  }
   
   
   void SpirvModule::opDemoteToHelperInvocation() {
@@ -61,6 +61,18 @@ namespace dxvk {
     
     SpirvCodeBuffer compile() const;
 
+    /**
+     * \brief Compiles and optimizes the module
+     *
+     * Runs the passes implemented in \ref SpirvOptimizer
+     * on the generated code and logs the instruction count
+     * before and after optimization.
+     * \param [in] name Shader name, for logging purposes
+     * \returns Optimized code buffer
+     */
+    SpirvCodeBuffer compileOptimized(
+      const std::string&            name) const;
+
     size_t getInsertionPtr() {
       return m_code.getInsertionPtr();
     }
@@ -1251,6 +1263,9 @@ namespace dxvk {
       const SpirvPhiLabel*          sourceLabels);
     
     void opReturn();
+
+    void opReturnValue(
+            uint32_t                value);
     
     void opDemoteToHelperInvocation();
     
@@ -0,0 +1,1157 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "spirv_optimizer.h"
+
+namespace dxvk {
+
+  SpirvOptimizer::SpirvOptimizer(const SpirvCodeBuffer& code)
+  : m_code(code.data(), code.data() + code.dwords()) {
+    if (m_code.size() < 5 || m_code[0] != spv::MagicNumber)
+      return;
+
+    m_idBound = m_code[3];
+
+    uint32_t offset = 5;
+
+    while (offset < m_code.size()) {
+      Instruction ins;
+      ins.op      = spv::Op(m_code[offset] & spv::OpCodeMask);
+      ins.offset  = offset;
+      ins.length  = m_code[offset] >> spv::WordCountShift;
+      ins.removed = false;
+      ins.known   = false;
+
+      if (!ins.length || offset + ins.length > m_code.size())
+        break;
+
+      if (ins.op == spv::OpFunction && m_functionStart == ~0u)
+        m_functionStart = m_ins.size();
+
+      m_ins.push_back(ins);
+      offset += ins.length;
+    }
+
+    m_functionStart = std::min<uint32_t>(m_functionStart, m_ins.size());
+
+    // Don't touch anything if the code is malformed
+    if (offset != m_code.size()) {
+      m_ins.clear();
+      return;
+    }
+
+    Operands operands;
+
+    for (auto& ins : m_ins) {
+      ins.known = decodeOperands(ins, operands);
+      m_allKnown &= ins.known;
+
+      // Only instructions from this set can be treated as pure
+      if (ins.op == spv::OpExtInstImport) {
+        const char* name = reinterpret_cast<const char*>(&m_code[ins.offset + 2]);
+        size_t maxLength = (ins.length - 2) * sizeof(uint32_t);
+
+        if (std::memchr(name, 0, maxLength) && !std::strcmp(name, "GLSL.std.450"))
+          m_glslStd450Set = arg(ins, 1);
+      }
+    }
+
+    m_replacements.resize(m_idBound, 0);
+  }
+
+
+  SpirvOptimizer::~SpirvOptimizer() {
+
+  }
+
+
+  SpirvCodeBuffer SpirvOptimizer::optimize() {
+    if (m_ins.empty())
+      return SpirvCodeBuffer(m_code.size(), m_code.data());
+
+    if (m_allKnown) {
+      deduplicateConstants();
+      forwardLoadsStores();
+    }
+
+    eliminateDeadCode();
+
+    // Assemble final module. Entry point interfaces
+    // may list private variables that got removed.
+    std::vector<uint32_t> code(m_code.begin(), m_code.begin() + 5);
+    code.reserve(m_code.size());
+
+    m_liveCount = 0;
+
+    for (const auto& ins : m_ins) {
+      if (ins.removed)
+        continue;
+
+      m_liveCount += 1;
+
+      if (ins.op == spv::OpEntryPoint) {
+        uint32_t first = 3 + std::strlen(reinterpret_cast<const char*>(&m_code[ins.offset + 3])) / 4 + 1;
+        size_t insOffset = code.size();
+
+        code.insert(code.end(),
+          m_code.begin() + ins.offset,
+          m_code.begin() + ins.offset + first);
+
+        for (uint32_t i = first; i < ins.length; i++) {
+          uint32_t id = arg(ins, i);
+
+          if (isDefined(id))
+            code.push_back(id);
+        }
+
+        uint32_t length = code.size() - insOffset;
+        code[insOffset] = (length << spv::WordCountShift) | ins.op;
+      } else {
+        code.insert(code.end(),
+          m_code.begin() + ins.offset,
+          m_code.begin() + ins.offset + ins.length);
+      }
+    }
+
+    return SpirvCodeBuffer(code.size(), code.data());
+  }
+
+
+  void SpirvOptimizer::deduplicateConstants() {
+    // Constants that are decorated in any way need to be
+    // preserved since the decoration may change semantics.
+    std::vector<bool> decorated(m_idBound, false);
+
+    for (uint32_t i = 0; i < m_functionStart; i++) {
+      const auto& ins = m_ins[i];
+
+      if (ins.op == spv::OpDecorate && arg(ins, 1) < m_idBound)
+        decorated[arg(ins, 1)] = true;
+    }
+
+    std::unordered_map<std::string, uint32_t> constants;
+    std::string key;
+
+    Operands operands;
+    bool progress = false;
+
+    for (uint32_t i = 0; i < m_functionStart; i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed || !isConstantInstruction(ins.op))
+        continue;
+
+      // Composites may reference duplicates that we removed
+      decodeOperands(ins, operands);
+
+      for (uint32_t j = 0; j < operands.idIndices.size(); j++) {
+        uint32_t& id = m_code[ins.offset + operands.idIndices[j]];
+        id = getReplacement(id);
+      }
+
+      uint32_t resultId = arg(ins, 2);
+
+      if (resultId >= m_idBound || decorated[resultId])
+        continue;
+
+      // The key consists of the instruction with the result ID
+      // removed, which is trivially comparable as a byte string
+      key.assign(reinterpret_cast<const char*>(&m_code[ins.offset]), 2 * sizeof(uint32_t));
+      key.append(reinterpret_cast<const char*>(&m_code[ins.offset + 3]), (ins.length - 3) * sizeof(uint32_t));
+
+      auto entry = constants.insert({ key, resultId });
+
+      if (!entry.second) {
+        m_replacements[resultId] = entry.first->second;
+        ins.removed = true;
+        progress = true;
+      }
+    }
+
+    if (progress)
+      applyReplacements();
+  }
+
+
+  void SpirvOptimizer::forwardLoadsStores() {
+    buildDefs();
+
+    // Only consider variables which are exclusively accessed
+    // as a whole via plain loads and stores, so that we never
+    // have to reason about aliasing through access chains.
+    std::vector<bool> candidates(m_idBound, false);
+
+    for (const auto& ins : m_ins) {
+      if (ins.op != spv::OpVariable)
+        continue;
+
+      uint32_t storage = arg(ins, 3);
+
+      if (storage == spv::StorageClassFunction
+       || storage == spv::StorageClassPrivate)
+        candidates[arg(ins, 2)] = true;
+    }
+
+    Operands operands;
+
+    for (const auto& ins : m_ins) {
+      if (ins.removed || isDebugInstruction(ins.op) || ins.op == spv::OpEntryPoint)
+        continue;
+
+      decodeOperands(ins, operands);
+
+      for (uint32_t i = 0; i < operands.idIndices.size(); i++) {
+        uint32_t idx = operands.idIndices[i];
+        uint32_t id = arg(ins, idx);
+
+        if (id >= m_idBound || !candidates[id])
+          continue;
+
+        bool isPlainAccess = (ins.op == spv::OpLoad  && idx == 3 && ins.length == 4)
+                          || (ins.op == spv::OpStore && idx == 1 && ins.length == 3);
+
+        if (!isPlainAccess)
+          candidates[id] = false;
+      }
+    }
+
+    struct VarState {
+      uint32_t valueId;
+      uint32_t storeIns;
+    };
+
+    std::unordered_map<uint32_t, VarState> state;
+    bool progress = false;
+
+    for (uint32_t i = m_functionStart; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed)
+        continue;
+
+      switch (ins.op) {
+        case spv::OpLabel: {
+          // Only forward values within a single block
+          state.clear();
+        } break;
+
+        case spv::OpFunctionCall: {
+          // Private variables may be accessed by the callee
+          for (auto e = state.begin(); e != state.end(); ) {
+            if (getStorageClass(e->first) == spv::StorageClassPrivate)
+              e = state.erase(e);
+            else
+              e++;
+          }
+        } break;
+
+        case spv::OpLoad: {
+          uint32_t varId = arg(ins, 3);
+
+          if (ins.length != 4 || varId >= m_idBound || !candidates[varId])
+            break;
+
+          auto e = state.find(varId);
+
+          if (e != state.end()) {
+            m_replacements[arg(ins, 2)] = getReplacement(e->second.valueId);
+            ins.removed = true;
+            progress = true;
+          } else {
+            state.insert({ varId, VarState { arg(ins, 2), ~0u } });
+          }
+        } break;
+
+        case spv::OpStore: {
+          uint32_t varId = arg(ins, 1);
+
+          if (ins.length != 3 || varId >= m_idBound || !candidates[varId])
+            break;
+
+          uint32_t valueId = getReplacement(arg(ins, 2));
+          auto e = state.find(varId);
+
+          if (e != state.end()) {
+            // Storing the value that the variable already holds
+            if (getReplacement(e->second.valueId) == valueId) {
+              ins.removed = true;
+              progress = true;
+              break;
+            }
+
+            // The previous store was never read within the block
+            if (e->second.storeIns != ~0u) {
+              m_ins[e->second.storeIns].removed = true;
+              progress = true;
+            }
+          }
+
+          state[varId] = VarState { valueId, i };
+        } break;
+
+        default:
+          break;
+      }
+    }
+
+    if (progress)
+      applyReplacements();
+  }
+
+
+  void SpirvOptimizer::eliminateDeadCode() {
+    while (eliminateDeadCodeIteration())
+      continue;
+
+    removeDeadDebugInfo();
+  }
+
+
+  bool SpirvOptimizer::eliminateDeadCodeIteration() {
+    buildDefs();
+
+    auto getRootVar = [this] (uint32_t id) {
+      while (id < m_idBound && m_defs[id] != ~0u) {
+        const auto& def = m_ins[m_defs[id]];
+
+        if (def.op != spv::OpAccessChain
+         && def.op != spv::OpInBoundsAccessChain)
+          break;
+
+        id = arg(def, 3);
+      }
+
+      return id;
+    };
+
+    auto isLocalVar = [this] (uint32_t id) {
+      uint32_t storage = getStorageClass(id);
+
+      return storage == spv::StorageClassFunction
+          || storage == spv::StorageClassPrivate;
+    };
+
+    // Count uses of each ID. Stores to private or function
+    // variables and access chains into them do not count as
+    // uses of the variable, since they do not read the value.
+    std::vector<uint32_t> useCounts(m_idBound, 0);
+    Operands operands;
+
+    for (const auto& ins : m_ins) {
+      if (ins.removed || isDebugInstruction(ins.op))
+        continue;
+
+      if (!ins.known) {
+        for (uint32_t i = 1; i < ins.length; i++) {
+          uint32_t id = arg(ins, i);
+
+          if (id < m_idBound)
+            useCounts[id] += 1;
+        }
+
+        continue;
+      }
+
+      decodeOperands(ins, operands);
+
+      for (uint32_t i = 0; i < operands.idIndices.size(); i++) {
+        uint32_t idx = operands.idIndices[i];
+        uint32_t id = arg(ins, idx);
+
+        if (id >= m_idBound)
+          continue;
+
+        if (ins.op == spv::OpEntryPoint && getStorageClass(id) == spv::StorageClassPrivate)
+          continue;
+
+        if (ins.op == spv::OpStore && idx == 1 && isLocalVar(getRootVar(id)))
+          continue;
+
+        if ((ins.op == spv::OpAccessChain || ins.op == spv::OpInBoundsAccessChain)
+         && idx == 3 && isLocalVar(getRootVar(id)))
+          continue;
+
+        useCounts[id] += 1;
+      }
+    }
+
+    // A variable is read if it is used directly, or if any
+    // access chain derived from it is used in a way that
+    // does not just write to it.
+    std::vector<bool> liveVars(m_idBound, false);
+
+    for (const auto& ins : m_ins) {
+      if (ins.removed)
+        continue;
+
+      if (ins.op == spv::OpAccessChain || ins.op == spv::OpInBoundsAccessChain) {
+        uint32_t rootId = getRootVar(arg(ins, 3));
+
+        if (rootId < m_idBound && useCounts[arg(ins, 2)])
+          liveVars[rootId] = true;
+      }
+    }
+
+    for (uint32_t i = 0; i < m_idBound; i++)
+      liveVars[i] = liveVars[i] || useCounts[i];
+
+    bool progress = false;
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      auto& ins = m_ins[i];
+
+      if (ins.removed || !ins.known)
+        continue;
+
+      bool remove = false;
+
+      if (ins.op == spv::OpVariable) {
+        uint32_t varId = arg(ins, 2);
+        remove = isLocalVar(varId) && !liveVars[varId];
+      } else if (ins.op == spv::OpStore) {
+        uint32_t rootId = getRootVar(arg(ins, 1));
+        remove = isLocalVar(rootId) && !liveVars[rootId];
+      } else if (ins.op == spv::OpAccessChain || ins.op == spv::OpInBoundsAccessChain) {
+        uint32_t rootId = getRootVar(arg(ins, 3));
+
+        remove = isLocalVar(rootId)
+          ? !liveVars[rootId]
+          : !useCounts[arg(ins, 2)];
+      } else if (i < m_functionStart) {
+        remove = isConstantInstruction(ins.op)
+          && !useCounts[arg(ins, 2)];
+      } else if (isPureInstruction(ins)) {
+        remove = !useCounts[getResultId(ins)];
+      }
+
+      if (remove) {
+        ins.removed = true;
+        progress = true;
+      }
+    }
+
+    return progress;
+  }
+
+
+  void SpirvOptimizer::removeDeadDebugInfo() {
+    buildDefs();
+
+    for (auto& ins : m_ins) {
+      if (ins.removed || !isDebugInstruction(ins.op))
+        continue;
+
+      uint32_t id = arg(ins, 1);
+
+      if (id < m_idBound && m_defs[id] != ~0u && !isDefined(id))
+        ins.removed = true;
+    }
+  }
+
+
+  void SpirvOptimizer::applyReplacements() {
+    Operands operands;
+
+    for (const auto& ins : m_ins) {
+      if (ins.removed)
+        continue;
+
+      decodeOperands(ins, operands);
+
+      for (uint32_t i = 0; i < operands.idIndices.size(); i++) {
+        uint32_t& id = m_code[ins.offset + operands.idIndices[i]];
+        id = getReplacement(id);
+      }
+    }
+  }
+
+
+  void SpirvOptimizer::buildDefs() {
+    m_defs.assign(m_idBound, ~0u);
+
+    for (uint32_t i = 0; i < m_ins.size(); i++) {
+      uint32_t id = getResultId(m_ins[i]);
+
+      if (id && id < m_idBound)
+        m_defs[id] = i;
+    }
+  }
+
+
+  uint32_t SpirvOptimizer::getReplacement(
+          uint32_t                id) const {
+    while (id < m_idBound && m_replacements[id])
+      id = m_replacements[id];
+
+    return id;
+  }
+
+
+  bool SpirvOptimizer::isDefined(
+          uint32_t                id) const {
+    return id < m_idBound
+        && m_defs[id] != ~0u
+        && !m_ins[m_defs[id]].removed;
+  }
+
+
+  uint32_t SpirvOptimizer::getStorageClass(
+          uint32_t                varId) const {
+    if (varId >= m_idBound || m_defs[varId] == ~0u)
+      return ~0u;
+
+    const auto& def = m_ins[m_defs[varId]];
+
+    if (def.op != spv::OpVariable)
+      return ~0u;
+
+    return arg(def, 3);
+  }
+
+
+  bool SpirvOptimizer::decodeOperands(
+    const Instruction&            ins,
+          Operands&               operands) const {
+    operands.typeIndex   = 0;
+    operands.resultIndex = 0;
+    operands.idIndices.clear();
+
+    auto addIds = [&] (uint32_t first, uint32_t end) {
+      for (uint32_t i = first; i < std::min(end, ins.length); i++)
+        operands.idIndices.push_back(i);
+    };
+
+    auto setResult = [&] (bool hasType) {
+      operands.typeIndex   = hasType ? 1 : 0;
+      operands.resultIndex = hasType ? 2 : 1;
+    };
+
+    auto addMemoryOperands = [&] (uint32_t idx) {
+      if (idx < ins.length) {
+        uint32_t mask = arg(ins, idx++);
+
+        if (mask & spv::MemoryAccessAlignedMask)
+          idx += 1;
+
+        addIds(idx, ins.length);
+      }
+    };
+
+    auto addImageOperands = [&] (uint32_t idx) {
+      addIds(ins.op == spv::OpImageWrite ? 1 : 3, idx);
+      addIds(idx + 1, ins.length);
+    };
+
+    switch (ins.op) {
+      // Instructions without any ID operands
+      case spv::OpNop:
+      case spv::OpCapability:
+      case spv::OpExtension:
+      case spv::OpMemoryModel:
+      case spv::OpReturn:
+      case spv::OpKill:
+      case spv::OpUnreachable:
+      case spv::OpFunctionEnd:
+      case spv::OpEmitVertex:
+      case spv::OpEndPrimitive:
+      case spv::OpBeginInvocationInterlockEXT:
+      case spv::OpEndInvocationInterlockEXT:
+      case spv::OpDemoteToHelperInvocation:
+        return true;
+
+      case spv::OpSource:
+        addIds(3, 4);
+        return true;
+
+      // Result ID only
+      case spv::OpString:
+      case spv::OpExtInstImport:
+      case spv::OpLabel:
+      case spv::OpTypeVoid:
+      case spv::OpTypeBool:
+      case spv::OpTypeInt:
+      case spv::OpTypeFloat:
+      case spv::OpTypeSampler:
+        setResult(false);
+        return true;
+
+      case spv::OpTypeVector:
+      case spv::OpTypeMatrix:
+      case spv::OpTypeImage:
+      case spv::OpTypeSampledImage:
+      case spv::OpTypeRuntimeArray:
+        setResult(false);
+        addIds(2, 3);
+        return true;
+
+      case spv::OpTypeArray:
+      case spv::OpTypeStruct:
+      case spv::OpTypeFunction:
+        setResult(false);
+        addIds(2, ins.length);
+        return true;
+
+      case spv::OpTypePointer:
+        setResult(false);
+        addIds(3, 4);
+        return true;
+
+      // Debug info and annotations
+      case spv::OpName:
+      case spv::OpMemberName:
+      case spv::OpDecorate:
+      case spv::OpMemberDecorate:
+      case spv::OpExecutionMode:
+        addIds(1, 2);
+        return true;
+
+      case spv::OpExecutionModeId:
+      case spv::OpDecorateId:
+        addIds(1, ins.length);
+        return true;
+
+      case spv::OpEntryPoint: {
+        uint32_t nameLength = std::strlen(reinterpret_cast<const char*>(&m_code[ins.offset + 3]));
+        addIds(2, 3);
+        addIds(3 + nameLength / 4 + 1, ins.length);
+      } return true;
+
+      // Constants and global objects
+      case spv::OpConstantTrue:
+      case spv::OpConstantFalse:
+      case spv::OpConstant:
+      case spv::OpConstantNull:
+      case spv::OpSpecConstantTrue:
+      case spv::OpSpecConstantFalse:
+      case spv::OpSpecConstant:
+      case spv::OpFunctionParameter:
+        setResult(true);
+        return true;
+
+      case spv::OpVariable:
+        setResult(true);
+        addIds(4, 5);
+        return true;
+
+      case spv::OpFunction:
+        setResult(true);
+        addIds(4, 5);
+        return true;
+
+      // Instructions with only ID operands
+      case spv::OpUndef:
+      case spv::OpConstantComposite:
+      case spv::OpSpecConstantComposite:
+      case spv::OpFunctionCall:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpImageTexelPointer:
+      case spv::OpSampledImage:
+      case spv::OpImage:
+      case spv::OpImageQuerySizeLod:
+      case spv::OpImageQuerySize:
+      case spv::OpImageQueryLod:
+      case spv::OpImageQueryLevels:
+      case spv::OpImageQuerySamples:
+      case spv::OpImageSparseTexelsResident:
+      case spv::OpVectorExtractDynamic:
+      case spv::OpVectorInsertDynamic:
+      case spv::OpCompositeConstruct:
+      case spv::OpCopyObject:
+      case spv::OpTranspose:
+      case spv::OpConvertFToU:
+      case spv::OpConvertFToS:
+      case spv::OpConvertSToF:
+      case spv::OpConvertUToF:
+      case spv::OpUConvert:
+      case spv::OpSConvert:
+      case spv::OpFConvert:
+      case spv::OpQuantizeToF16:
+      case spv::OpBitcast:
+      case spv::OpSNegate:
+      case spv::OpFNegate:
+      case spv::OpIAdd:
+      case spv::OpFAdd:
+      case spv::OpISub:
+      case spv::OpFSub:
+      case spv::OpIMul:
+      case spv::OpFMul:
+      case spv::OpUDiv:
+      case spv::OpSDiv:
+      case spv::OpFDiv:
+      case spv::OpUMod:
+      case spv::OpSRem:
+      case spv::OpSMod:
+      case spv::OpFRem:
+      case spv::OpFMod:
+      case spv::OpVectorTimesScalar:
+      case spv::OpMatrixTimesScalar:
+      case spv::OpVectorTimesMatrix:
+      case spv::OpMatrixTimesVector:
+      case spv::OpMatrixTimesMatrix:
+      case spv::OpOuterProduct:
+      case spv::OpDot:
+      case spv::OpIAddCarry:
+      case spv::OpISubBorrow:
+      case spv::OpUMulExtended:
+      case spv::OpSMulExtended:
+      case spv::OpAny:
+      case spv::OpAll:
+      case spv::OpIsNan:
+      case spv::OpIsInf:
+      case spv::OpLogicalEqual:
+      case spv::OpLogicalNotEqual:
+      case spv::OpLogicalOr:
+      case spv::OpLogicalAnd:
+      case spv::OpLogicalNot:
+      case spv::OpSelect:
+      case spv::OpIEqual:
+      case spv::OpINotEqual:
+      case spv::OpUGreaterThan:
+      case spv::OpSGreaterThan:
+      case spv::OpUGreaterThanEqual:
+      case spv::OpSGreaterThanEqual:
+      case spv::OpULessThan:
+      case spv::OpSLessThan:
+      case spv::OpULessThanEqual:
+      case spv::OpSLessThanEqual:
+      case spv::OpFOrdEqual:
+      case spv::OpFUnordEqual:
+      case spv::OpFOrdNotEqual:
+      case spv::OpFUnordNotEqual:
+      case spv::OpFOrdLessThan:
+      case spv::OpFUnordLessThan:
+      case spv::OpFOrdGreaterThan:
+      case spv::OpFUnordGreaterThan:
+      case spv::OpFOrdLessThanEqual:
+      case spv::OpFUnordLessThanEqual:
+      case spv::OpFOrdGreaterThanEqual:
+      case spv::OpFUnordGreaterThanEqual:
+      case spv::OpShiftRightLogical:
+      case spv::OpShiftRightArithmetic:
+      case spv::OpShiftLeftLogical:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpBitwiseAnd:
+      case spv::OpNot:
+      case spv::OpBitFieldInsert:
+      case spv::OpBitFieldSExtract:
+      case spv::OpBitFieldUExtract:
+      case spv::OpBitReverse:
+      case spv::OpBitCount:
+      case spv::OpDPdx:
+      case spv::OpDPdy:
+      case spv::OpFwidth:
+      case spv::OpDPdxFine:
+      case spv::OpDPdyFine:
+      case spv::OpFwidthFine:
+      case spv::OpDPdxCoarse:
+      case spv::OpDPdyCoarse:
+      case spv::OpFwidthCoarse:
+      case spv::OpPhi:
+      case spv::OpAtomicLoad:
+      case spv::OpAtomicExchange:
+      case spv::OpAtomicCompareExchange:
+      case spv::OpAtomicIIncrement:
+      case spv::OpAtomicIDecrement:
+      case spv::OpAtomicIAdd:
+      case spv::OpAtomicISub:
+      case spv::OpAtomicSMin:
+      case spv::OpAtomicUMin:
+      case spv::OpAtomicSMax:
+      case spv::OpAtomicUMax:
+      case spv::OpAtomicAnd:
+      case spv::OpAtomicOr:
+      case spv::OpAtomicXor:
+      case spv::OpGroupNonUniformElect:
+      case spv::OpGroupNonUniformBroadcastFirst:
+      case spv::OpGroupNonUniformBallot:
+        setResult(true);
+        addIds(3, ins.length);
+        return true;
+
+      // Instructions with literal operands
+      case spv::OpArrayLength:
+      case spv::OpCompositeExtract:
+        setResult(true);
+        addIds(3, 4);
+        return true;
+
+      case spv::OpCompositeInsert:
+      case spv::OpVectorShuffle:
+        setResult(true);
+        addIds(3, 5);
+        return true;
+
+      case spv::OpExtInst:
+        setResult(true);
+        addIds(3, 4);
+        addIds(5, ins.length);
+        return true;
+
+      case spv::OpGroupNonUniformBallotBitCount:
+        setResult(true);
+        addIds(3, 4);
+        addIds(5, ins.length);
+        return true;
+
+      case spv::OpLoad:
+        setResult(true);
+        addIds(3, 4);
+        addMemoryOperands(4);
+        return true;
+
+      case spv::OpStore:
+        addIds(1, 3);
+        addMemoryOperands(3);
+        return true;
+
+      // Image instructions with optional image operands
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageSampleProjImplicitLod:
+      case spv::OpImageSampleProjExplicitLod:
+      case spv::OpImageFetch:
+      case spv::OpImageRead:
+      case spv::OpImageSparseSampleImplicitLod:
+      case spv::OpImageSparseSampleExplicitLod:
+      case spv::OpImageSparseSampleProjImplicitLod:
+      case spv::OpImageSparseSampleProjExplicitLod:
+      case spv::OpImageSparseFetch:
+      case spv::OpImageSparseRead:
+        setResult(true);
+        addImageOperands(5);
+        return true;
+
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+      case spv::OpImageSampleProjDrefImplicitLod:
+      case spv::OpImageSampleProjDrefExplicitLod:
+      case spv::OpImageGather:
+      case spv::OpImageDrefGather:
+      case spv::OpImageSparseSampleDrefImplicitLod:
+      case spv::OpImageSparseSampleDrefExplicitLod:
+      case spv::OpImageSparseSampleProjDrefImplicitLod:
+      case spv::OpImageSparseSampleProjDrefExplicitLod:
+      case spv::OpImageSparseGather:
+      case spv::OpImageSparseDrefGather:
+        setResult(true);
+        addImageOperands(6);
+        return true;
+
+      case spv::OpImageWrite:
+        addImageOperands(4);
+        return true;
+
+      // Control flow and other instructions without result
+      case spv::OpBranch:
+      case spv::OpReturnValue:
+      case spv::OpEmitStreamVertex:
+      case spv::OpEndStreamPrimitive:
+      case spv::OpSelectionMerge:
+        addIds(1, 2);
+        return true;
+
+      case spv::OpLoopMerge:
+        addIds(1, 3);
+        return true;
+
+      case spv::OpBranchConditional:
+        addIds(1, 4);
+        return true;
+
+      case spv::OpSwitch:
+        // Assumes a 32-bit selector, which is the
+        // only type our compilers ever generate.
+        addIds(1, 3);
+
+        for (uint32_t i = 4; i < ins.length; i += 2)
+          addIds(i, i + 1);
+        return true;
+
+      case spv::OpControlBarrier:
+      case spv::OpMemoryBarrier:
+      case spv::OpAtomicStore:
+        addIds(1, ins.length);
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+
+  uint32_t SpirvOptimizer::getResultId(
+    const Instruction&            ins) const {
+    if (!ins.known)
+      return 0;
+
+    Operands operands;
+    decodeOperands(ins, operands);
+
+    return operands.resultIndex
+      ? arg(ins, operands.resultIndex)
+      : 0;
+  }
+
+
+  bool SpirvOptimizer::isPureInstruction(
+    const Instruction&            ins) const {
+    switch (ins.op) {
+      case spv::OpLoad:
+        // Volatile loads must be preserved
+        return ins.length < 5
+            || !(arg(ins, 4) & spv::MemoryAccessVolatileMask);
+
+      case spv::OpUndef:
+      case spv::OpAccessChain:
+      case spv::OpInBoundsAccessChain:
+      case spv::OpImageTexelPointer:
+      case spv::OpArrayLength:
+      case spv::OpSampledImage:
+      case spv::OpImage:
+      case spv::OpImageQuerySizeLod:
+      case spv::OpImageQuerySize:
+      case spv::OpImageQueryLod:
+      case spv::OpImageQueryLevels:
+      case spv::OpImageQuerySamples:
+      case spv::OpImageSparseTexelsResident:
+      case spv::OpImageSampleImplicitLod:
+      case spv::OpImageSampleExplicitLod:
+      case spv::OpImageSampleProjImplicitLod:
+      case spv::OpImageSampleProjExplicitLod:
+      case spv::OpImageSampleDrefImplicitLod:
+      case spv::OpImageSampleDrefExplicitLod:
+      case spv::OpImageSampleProjDrefImplicitLod:
+      case spv::OpImageSampleProjDrefExplicitLod:
+      case spv::OpImageFetch:
+      case spv::OpImageGather:
+      case spv::OpImageDrefGather:
+      case spv::OpImageSparseSampleImplicitLod:
+      case spv::OpImageSparseSampleExplicitLod:
+      case spv::OpImageSparseSampleDrefImplicitLod:
+      case spv::OpImageSparseSampleDrefExplicitLod:
+      case spv::OpImageSparseFetch:
+      case spv::OpImageSparseGather:
+      case spv::OpImageSparseDrefGather:
+      case spv::OpVectorExtractDynamic:
+      case spv::OpVectorInsertDynamic:
+      case spv::OpVectorShuffle:
+      case spv::OpCompositeConstruct:
+      case spv::OpCompositeExtract:
+      case spv::OpCompositeInsert:
+      case spv::OpCopyObject:
+      case spv::OpTranspose:
+      case spv::OpConvertFToU:
+      case spv::OpConvertFToS:
+      case spv::OpConvertSToF:
+      case spv::OpConvertUToF:
+      case spv::OpUConvert:
+      case spv::OpSConvert:
+      case spv::OpFConvert:
+      case spv::OpQuantizeToF16:
+      case spv::OpBitcast:
+      case spv::OpSNegate:
+      case spv::OpFNegate:
+      case spv::OpIAdd:
+      case spv::OpFAdd:
+      case spv::OpISub:
+      case spv::OpFSub:
+      case spv::OpIMul:
+      case spv::OpFMul:
+      case spv::OpUDiv:
+      case spv::OpSDiv:
+      case spv::OpFDiv:
+      case spv::OpUMod:
+      case spv::OpSRem:
+      case spv::OpSMod:
+      case spv::OpFRem:
+      case spv::OpFMod:
+      case spv::OpVectorTimesScalar:
+      case spv::OpMatrixTimesScalar:
+      case spv::OpVectorTimesMatrix:
+      case spv::OpMatrixTimesVector:
+      case spv::OpMatrixTimesMatrix:
+      case spv::OpOuterProduct:
+      case spv::OpDot:
+      case spv::OpIAddCarry:
+      case spv::OpISubBorrow:
+      case spv::OpUMulExtended:
+      case spv::OpSMulExtended:
+      case spv::OpAny:
+      case spv::OpAll:
+      case spv::OpIsNan:
+      case spv::OpIsInf:
+      case spv::OpLogicalEqual:
+      case spv::OpLogicalNotEqual:
+      case spv::OpLogicalOr:
+      case spv::OpLogicalAnd:
+      case spv::OpLogicalNot:
+      case spv::OpSelect:
+      case spv::OpIEqual:
+      case spv::OpINotEqual:
+      case spv::OpUGreaterThan:
+      case spv::OpSGreaterThan:
+      case spv::OpUGreaterThanEqual:
+      case spv::OpSGreaterThanEqual:
+      case spv::OpULessThan:
+      case spv::OpSLessThan:
+      case spv::OpULessThanEqual:
+      case spv::OpSLessThanEqual:
+      case spv::OpFOrdEqual:
+      case spv::OpFUnordEqual:
+      case spv::OpFOrdNotEqual:
+      case spv::OpFUnordNotEqual:
+      case spv::OpFOrdLessThan:
+      case spv::OpFUnordLessThan:
+      case spv::OpFOrdGreaterThan:
+      case spv::OpFUnordGreaterThan:
+      case spv::OpFOrdLessThanEqual:
+      case spv::OpFUnordLessThanEqual:
+      case spv::OpFOrdGreaterThanEqual:
+      case spv::OpFUnordGreaterThanEqual:
+      case spv::OpShiftRightLogical:
+      case spv::OpShiftRightArithmetic:
+      case spv::OpShiftLeftLogical:
+      case spv::OpBitwiseOr:
+      case spv::OpBitwiseXor:
+      case spv::OpBitwiseAnd:
+      case spv::OpNot:
+      case spv::OpBitFieldInsert:
+      case spv::OpBitFieldSExtract:
+      case spv::OpBitFieldUExtract:
+      case spv::OpBitReverse:
+      case spv::OpBitCount:
+      case spv::OpDPdx:
+      case spv::OpDPdy:
+      case spv::OpFwidth:
+      case spv::OpDPdxFine:
+      case spv::OpDPdyFine:
+      case spv::OpFwidthFine:
+      case spv::OpDPdxCoarse:
+      case spv::OpDPdyCoarse:
+      case spv::OpFwidthCoarse:
+      case spv::OpPhi:
+        return true;
+
+      case spv::OpExtInst:
+        return m_glslStd450Set && arg(ins, 3) == m_glslStd450Set
+            && isPureGlslInstruction(arg(ins, 4));
+
+      default:
+        return false;
+    }
+  }
+
+
+  bool SpirvOptimizer::isPureGlslInstruction(
+          uint32_t                op) {
+    switch (op) {
+      case GLSLstd450Round:
+      case GLSLstd450RoundEven:
+      case GLSLstd450Trunc:
+      case GLSLstd450FAbs:
+      case GLSLstd450SAbs:
+      case GLSLstd450FSign:
+      case GLSLstd450SSign:
+      case GLSLstd450Floor:
+      case GLSLstd450Ceil:
+      case GLSLstd450Fract:
+      case GLSLstd450Radians:
+      case GLSLstd450Degrees:
+      case GLSLstd450Sin:
+      case GLSLstd450Cos:
+      case GLSLstd450Tan:
+      case GLSLstd450Asin:
+      case GLSLstd450Acos:
+      case GLSLstd450Atan:
+      case GLSLstd450Sinh:
+      case GLSLstd450Cosh:
+      case GLSLstd450Tanh:
+      case GLSLstd450Asinh:
+      case GLSLstd450Acosh:
+      case GLSLstd450Atanh:
+      case GLSLstd450Atan2:
+      case GLSLstd450Pow:
+      case GLSLstd450Exp:
+      case GLSLstd450Log:
+      case GLSLstd450Exp2:
+      case GLSLstd450Log2:
+      case GLSLstd450Sqrt:
+      case GLSLstd450InverseSqrt:
+      case GLSLstd450Determinant:
+      case GLSLstd450MatrixInverse:
+      case GLSLstd450ModfStruct:
+      case GLSLstd450FMin:
+      case GLSLstd450UMin:
+      case GLSLstd450SMin:
+      case GLSLstd450FMax:
+      case GLSLstd450UMax:
+      case GLSLstd450SMax:
+      case GLSLstd450FClamp:
+      case GLSLstd450UClamp:
+      case GLSLstd450SClamp:
+      case GLSLstd450FMix:
+      case GLSLstd450IMix:
+      case GLSLstd450Step:
+      case GLSLstd450SmoothStep:
+      case GLSLstd450Fma:
+      case GLSLstd450FrexpStruct:
+      case GLSLstd450Ldexp:
+      case GLSLstd450PackSnorm4x8:
+      case GLSLstd450PackUnorm4x8:
+      case GLSLstd450PackSnorm2x16:
+      case GLSLstd450PackUnorm2x16:
+      case GLSLstd450PackHalf2x16:
+      case GLSLstd450PackDouble2x32:
+      case GLSLstd450UnpackSnorm2x16:
+      case GLSLstd450UnpackUnorm2x16:
+      case GLSLstd450UnpackHalf2x16:
+      case GLSLstd450UnpackSnorm4x8:
+      case GLSLstd450UnpackUnorm4x8:
+      case GLSLstd450UnpackDouble2x32:
+      case GLSLstd450Length:
+      case GLSLstd450Distance:
+      case GLSLstd450Cross:
+      case GLSLstd450Normalize:
+      case GLSLstd450FaceForward:
+      case GLSLstd450Reflect:
+      case GLSLstd450Refract:
+      case GLSLstd450FindILsb:
+      case GLSLstd450FindSMsb:
+      case GLSLstd450FindUMsb:
+      case GLSLstd450NMin:
+      case GLSLstd450NMax:
+      case GLSLstd450NClamp:
+        return true;
+
+      // Modf and Frexp write through a pointer, and the
+      // interpolation functions take an input variable
+      default:
+        return false;
+    }
+  }
+
+
+  bool SpirvOptimizer::isDebugInstruction(
+          spv::Op                 op) {
+    return op == spv::OpName
+        || op == spv::OpMemberName
+        || op == spv::OpDecorate
+        || op == spv::OpMemberDecorate;
+  }
+
+
+  bool SpirvOptimizer::isConstantInstruction(
+          spv::Op                 op) {
+    return op == spv::OpConstantTrue
+        || op == spv::OpConstantFalse
+        || op == spv::OpConstant
+        || op == spv::OpConstantComposite
+        || op == spv::OpConstantNull
+        || op == spv::OpUndef;
+  }
+
+}
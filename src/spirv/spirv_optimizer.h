@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+
+#include "spirv_code_buffer.h"
+
+#include "../util/util_small_vector.h"
+
+namespace dxvk {
+
+  /**
+   * \brief SPIR-V optimizer
+   *
+   * Implements a small set of fast, conservative optimization
+   * passes that clean up code generated by the shader compilers
+   * before it is handed to the driver:
+   *
+   * - Deduplication of constants, which mostly affects
+   *   constants that got patched after being declared.
+   * - Forwarding of stored or loaded values of private and
+   *   function variables within a block, as well as removal
+   *   of stores that get overwritten within the same block.
+   * - Dead code elimination for side effect free instructions,
+   *   unused constants and variables that are never read.
+   *
+   * Passes which need to rewrite IDs are skipped if the module
+   * contains any instruction that the optimizer does not know.
+   */
+  class SpirvOptimizer {
+
+  public:
+
+    SpirvOptimizer(const SpirvCodeBuffer& code);
+
+    ~SpirvOptimizer();
+
+    /**
+     * \brief Runs all optimization passes
+     * \returns Optimized code buffer
+     */
+    SpirvCodeBuffer optimize();
+
+    /**
+     * \brief Number of instructions in the input module
+     * \returns Instruction count
+     */
+    uint32_t getInputInstructionCount() const {
+      return uint32_t(m_ins.size());
+    }
+
+    /**
+     * \brief Number of instructions in the optimized module
+     * \returns Instruction count
+     */
+    uint32_t getOutputInstructionCount() const {
+      return m_liveCount;
+    }
+
+  private:
+
+    struct Instruction {
+      spv::Op   op;
+      uint32_t  offset;
+      uint32_t  length;
+      bool      removed;
+      bool      known;
+    };
+
+    struct Operands {
+      uint32_t typeIndex   = 0;
+      uint32_t resultIndex = 0;
+      small_vector<uint32_t, 16> idIndices;
+    };
+
+    std::vector<uint32_t>     m_code;
+    std::vector<Instruction>  m_ins;
+
+    uint32_t                  m_idBound       = 0;
+    uint32_t                  m_functionStart = ~0u;
+    uint32_t                  m_liveCount     = 0;
+    uint32_t                  m_glslStd450Set = 0;
+    bool                      m_allKnown      = true;
+
+    std::vector<uint32_t>     m_defs;
+    std::vector<uint32_t>     m_replacements;
+
+    void deduplicateConstants();
+
+    void forwardLoadsStores();
+
+    void eliminateDeadCode();
+
+    bool eliminateDeadCodeIteration();
+
+    void removeDeadDebugInfo();
+
+    void applyReplacements();
+
+    void buildDefs();
+
+    uint32_t getReplacement(
+            uint32_t                id) const;
+
+    bool isDefined(
+            uint32_t                id) const;
+
+    uint32_t getStorageClass(
+            uint32_t                varId) const;
+
+    uint32_t arg(
+      const Instruction&            ins,
+            uint32_t                idx) const {
+      return idx < ins.length ? m_code[ins.offset + idx] : 0;
+    }
+
+    bool decodeOperands(
+      const Instruction&            ins,
+            Operands&               operands) const;
+
+    uint32_t getResultId(
+      const Instruction&            ins) const;
+
+    bool isPureInstruction(
+      const Instruction&            ins) const;
+
+    static bool isPureGlslInstruction(
+            uint32_t                op);
+
+    static bool isDebugInstruction(
+            spv::Op                 op);
+
+    static bool isConstantInstruction(
+            spv::Op                 op);
+
+  };
+
+}
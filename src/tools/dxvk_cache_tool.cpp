@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "../dxvk/dxvk_state_cache.h"
+
+using namespace dxvk;
+
+/**
+ * \brief State cache merge tool
+ *
+ * Merges any number of \c .dxvk-cache files into a single
+ * indexed cache file. Invalid and duplicate entries are
+ * removed in the process, so this can also be used to
+ * convert or compact a single file. The output file can
+ * be written in any indexed version and read back, which
+ * verifies that the file format survives a round trip.
+ */
+namespace {
+
+  struct CacheToolArgs {
+    bool                      sortByFirstUse = false;
+    bool                      checkOutput    = false;
+    uint32_t                  version        = DxvkStateCacheHeader().version;
+    std::string               outputFile;
+    std::vector<std::string>  inputFiles;
+  };
+
+
+  bool isSameEntry(
+    const DxvkStateCacheEntry&  a,
+    const DxvkStateCacheEntry&  b) {
+    if (a.type != b.type)
+      return false;
+
+    // Pipeline library entries do not store any state
+    return a.type == DxvkStateCacheEntryType::PipelineLibrary
+        || a.gpState == b.gpState;
+  }
+
+
+  bool parseArgs(int argc, char** argv, CacheToolArgs& args) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+
+      if (arg == "-o" && i + 1 < argc) {
+        args.outputFile = argv[++i];
+      } else if (arg == "-v" && i + 1 < argc) {
+        args.version = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+      } else if (arg == "-s") {
+        args.sortByFirstUse = true;
+      } else if (arg == "-c") {
+        args.checkOutput = true;
+      } else if (arg[0] != '-') {
+        args.inputFiles.push_back(arg);
+      } else {
+        return false;
+      }
+    }
+
+    return !args.outputFile.empty()
+        && !args.inputFiles.empty()
+        && args.version >= 18
+        && args.version <= DxvkStateCacheHeader().version;
+  }
+
+
+  bool checkOutputFile(
+    const CacheToolArgs&                    args,
+    const std::vector<DxvkStateCacheEntry>& entries) {
+    std::vector<DxvkStateCacheEntry> fileEntries;
+    uint32_t invalidCount = 0;
+
+    if (!DxvkStateCache::readEntries(str::topath(args.outputFile.c_str()), fileEntries, invalidCount)
+     || invalidCount || fileEntries.size() != entries.size())
+      return false;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+      const auto& a = entries[i];
+      const auto& b = fileEntries[i];
+
+      if (!a.shaders.eq(b.shaders) || !isSameEntry(a, b))
+        return false;
+
+      // Usage data is not stored in v18 files
+      if (args.version >= 19 && (a.firstUse != b.firstUse
+       || std::max(a.useCount, 1u) != b.useCount))
+        return false;
+    }
+
+    return true;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  CacheToolArgs args;
+
+  if (!parseArgs(argc, argv, args)) {
+    std::cerr << "Usage: " << argv[0] << " [-s] [-c] [-v <version>] -o <output> <input>..." << std::endl
+              << "  -s  Sort entries by first use" << std::endl
+              << "  -c  Read back the output file and compare it to the merged entries" << std::endl
+              << "  -v  Output file version, 18 to " << DxvkStateCacheHeader().version << std::endl;
+    return 1;
+  }
+
+  std::vector<DxvkStateCacheEntry> entries;
+
+  std::unordered_multimap<
+    DxvkStateCacheKey, size_t,
+    DxvkHash, DxvkEq> entryMap;
+
+  size_t duplicateCount = 0;
+
+  for (const auto& inputFile : args.inputFiles) {
+    std::vector<DxvkStateCacheEntry> fileEntries;
+    uint32_t invalidCount = 0;
+
+    if (!DxvkStateCache::readEntries(str::topath(inputFile.c_str()), fileEntries, invalidCount)) {
+      std::cerr << inputFile << ": Failed to read state cache file" << std::endl;
+      return 1;
+    }
+
+    std::cout << inputFile << ": " << fileEntries.size() << " entries";
+
+    if (invalidCount)
+      std::cout << ", " << invalidCount << " invalid";
+
+    std::cout << std::endl;
+
+    for (const auto& entry : fileEntries) {
+      auto range = entryMap.equal_range(entry.shaders);
+      auto match = std::find_if(range.first, range.second, [&] (const auto& e) {
+        return isSameEntry(entries[e.second], entry);
+      });
+
+      if (match != range.second) {
+        // Merge usage data so that pipelines used early
+        // on in any of the input files get ranked first
+        auto& existing = entries[match->second];
+        existing.firstUse = std::min(existing.firstUse, entry.firstUse);
+        existing.useCount += entry.useCount;
+        duplicateCount += 1;
+      } else {
+        entryMap.insert({ entry.shaders, entries.size() });
+        entries.push_back(entry);
+      }
+    }
+  }
+
+  if (args.sortByFirstUse) {
+    // Entries without usage data go last and keep their relative
+    // order, which approximates the order in which they were used.
+    std::stable_sort(entries.begin(), entries.end(),
+      [] (const DxvkStateCacheEntry& a, const DxvkStateCacheEntry& b) {
+        if (a.firstUse != b.firstUse)
+          return a.firstUse < b.firstUse;
+
+        return a.useCount > b.useCount;
+      });
+  }
+
+  if (!DxvkStateCache::writeEntries(str::topath(args.outputFile.c_str()), entries, args.version)) {
+    std::cerr << args.outputFile << ": Failed to write state cache file" << std::endl;
+    return 1;
+  }
+
+  if (args.checkOutput && !checkOutputFile(args, entries)) {
+    std::cerr << args.outputFile << ": Round trip check failed" << std::endl;
+    return 1;
+  }
+
+  std::cout << args.outputFile << ": " << entries.size() << " entries, "
+            << duplicateCount << " duplicates removed" << std::endl;
+  return 0;
+}
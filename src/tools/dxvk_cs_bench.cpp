@@ -0,0 +1,141 @@
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../dxvk/dxvk_cs.h"
+
+#include "../util/util_time.h"
+
+using namespace dxvk;
+
+/**
+ * \brief CS chunk benchmark
+ *
+ * Measures how many commands per second can be recorded into
+ * and replayed from CS chunks, for commands with payloads of
+ * various sizes. Commands are executed with a null context, so
+ * this only measures the overhead of the command encoding
+ * itself. No Vulkan device is required.
+ */
+namespace {
+
+  constexpr uint32_t CommandCount = 1u << 22;
+
+  // Commands are recorded and replayed in batches of
+  // this many chunks, so that memory usage stays low
+  // even for commands with large payloads.
+  constexpr size_t ChunksPerBatch = 256;
+
+  struct BenchResult {
+    double  recordRate = 0.0;
+    double  replayRate = 0.0;
+    double  cmdsPerChunk = 0.0;
+  };
+
+
+  template<size_t N>
+  struct Payload {
+    std::array<uint32_t, N> dwords;
+  };
+
+
+  double toRate(high_resolution_clock::duration duration) {
+    double s = std::chrono::duration<double>(duration).count();
+    return s > 0.0 ? double(CommandCount) / s : 0.0;
+  }
+
+
+  template<size_t N>
+  BenchResult runBenchmark() {
+    DxvkCsChunkPool pool;
+
+    std::vector<DxvkCsChunk*> chunks;
+    chunks.reserve(ChunksPerBatch);
+
+    high_resolution_clock::duration recordTime = { };
+    high_resolution_clock::duration replayTime = { };
+
+    size_t   chunkCount = 0;
+    uint32_t sink = 0;
+    uint32_t i = 0;
+
+    while (i < CommandCount) {
+      DxvkCsChunk* chunk = pool.allocChunk(DxvkCsChunkFlags());
+
+      auto t0 = high_resolution_clock::now();
+
+      for ( ; i < CommandCount; i++) {
+        Payload<N> payload;
+        payload.dwords.fill(i);
+
+        auto command = [cPayload = payload, &sink] (DxvkContext*) {
+          sink += cPayload.dwords[N - 1];
+        };
+
+        if (!chunk->push(command)) {
+          chunks.push_back(chunk);
+
+          if (chunks.size() == ChunksPerBatch) {
+            chunk = nullptr;
+            break;
+          }
+
+          chunk = pool.allocChunk(DxvkCsChunkFlags());
+          chunk->push(command);
+        }
+      }
+
+      if (chunk)
+        chunks.push_back(chunk);
+
+      auto t1 = high_resolution_clock::now();
+
+      for (auto c : chunks)
+        c->executeAll(nullptr);
+
+      auto t2 = high_resolution_clock::now();
+
+      recordTime += t1 - t0;
+      replayTime += t2 - t1;
+
+      chunkCount += chunks.size();
+
+      for (auto c : chunks)
+        pool.freeChunk(c);
+
+      chunks.clear();
+    }
+
+    // Prevent the compiler from discarding the commands
+    if (sink == 1u)
+      std::cout << std::endl;
+
+    BenchResult result;
+    result.recordRate = toRate(recordTime);
+    result.replayRate = toRate(replayTime);
+    result.cmdsPerChunk = double(CommandCount) / double(chunkCount);
+    return result;
+  }
+
+
+  void printResult(size_t payloadSize, const BenchResult& result) {
+    std::cout << std::fixed << std::setprecision(1)
+      << std::setw(12) << payloadSize
+      << std::setw(16) << result.recordRate / 1.0e6
+      << std::setw(16) << result.replayRate / 1.0e6
+      << std::setw(16) << result.cmdsPerChunk << std::endl;
+  }
+
+}
+
+
+int main() {
+  std::cout << "Payload (B)    Record (M/s)    Replay (M/s)      Cmds/chunk" << std::endl;
+
+  printResult(sizeof(Payload<1>),  runBenchmark<1>());
+  printResult(sizeof(Payload<4>),  runBenchmark<4>());
+  printResult(sizeof(Payload<16>), runBenchmark<16>());
+  printResult(sizeof(Payload<64>), runBenchmark<64>());
+  return 0;
+}
@@ -0,0 +1,290 @@
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../dxvk/dxvk_allocator.h"
+
+#include "../util/util_time.h"
+
+using namespace dxvk;
+
+/**
+ * \brief Memory sub-allocator benchmark
+ *
+ * Simulates allocation churn on a single 256 MiB chunk of a fake
+ * memory type, using random sizes and alignments similar to those
+ * of typical buffer and image resources. Compares the TLSF chunk
+ * allocator against the free-list allocator it replaced. Only the
+ * chunk bookkeeping is exercised, so no Vulkan device is required.
+ */
+namespace {
+
+  constexpr VkDeviceSize ChunkSize = VkDeviceSize(256) << 20;
+  constexpr VkDeviceSize LiveSize = ChunkSize / 4 * 3;
+  constexpr uint32_t OperationCount = 1u << 21;
+
+  struct Request {
+    VkDeviceSize  size;
+    VkDeviceSize  align;
+    uint32_t      freeIndex;
+    bool          isAlloc;
+  };
+
+  struct BenchResult {
+    double        nsPerOp      = 0.0;
+    uint32_t      failedAllocs = 0;
+    VkDeviceSize  freeSize     = 0;
+    VkDeviceSize  largestBlock = 0;
+  };
+
+
+  /**
+   * \brief Worst-fit free list allocator
+   *
+   * Equivalent to the previous implementation
+   * of the memory chunk sub-allocator.
+   */
+  class FreeListAllocator {
+
+  public:
+
+    FreeListAllocator(VkDeviceSize size) {
+      m_freeList.push_back({ 0, size });
+    }
+
+    DxvkSubAllocation alloc(VkDeviceSize size, VkDeviceSize alignment) {
+      if (m_freeList.empty())
+        return DxvkSubAllocation();
+
+      auto bestSlice = m_freeList.begin();
+
+      for (auto slice = m_freeList.begin(); slice != m_freeList.end(); slice++) {
+        if (slice->length == size) {
+          bestSlice = slice;
+          break;
+        } else if (slice->length > bestSlice->length) {
+          bestSlice = slice;
+        }
+      }
+
+      const VkDeviceSize sliceStart = bestSlice->offset;
+      const VkDeviceSize sliceEnd   = bestSlice->offset + bestSlice->length;
+
+      const VkDeviceSize allocStart = align(sliceStart,        alignment);
+      const VkDeviceSize allocEnd   = align(allocStart + size, alignment);
+
+      if (allocEnd > sliceEnd)
+        return DxvkSubAllocation();
+
+      m_freeList.erase(bestSlice);
+
+      if (allocStart != sliceStart)
+        m_freeList.push_back({ sliceStart, allocStart - sliceStart });
+
+      if (allocEnd != sliceEnd)
+        m_freeList.push_back({ allocEnd, sliceEnd - allocEnd });
+
+      DxvkSubAllocation result;
+      result.block  = 0;
+      result.offset = allocStart;
+      result.length = allocEnd - allocStart;
+      return result;
+    }
+
+    void free(const DxvkSubAllocation& allocation) {
+      VkDeviceSize offset = allocation.offset;
+      VkDeviceSize length = allocation.length;
+
+      auto curr = m_freeList.begin();
+
+      while (curr != m_freeList.end()) {
+        if (curr->offset == offset + length) {
+          length += curr->length;
+          curr = m_freeList.erase(curr);
+        } else if (curr->offset + curr->length == offset) {
+          offset -= curr->length;
+          length += curr->length;
+          curr = m_freeList.erase(curr);
+        } else {
+          curr++;
+        }
+      }
+
+      m_freeList.push_back({ offset, length });
+    }
+
+    VkDeviceSize freeSize() const {
+      VkDeviceSize result = 0;
+
+      for (const auto& slice : m_freeList)
+        result += slice.length;
+
+      return result;
+    }
+
+    VkDeviceSize largestFreeBlock() const {
+      VkDeviceSize result = 0;
+
+      for (const auto& slice : m_freeList)
+        result = std::max(result, slice.length);
+
+      return result;
+    }
+
+  private:
+
+    struct FreeSlice {
+      VkDeviceSize offset;
+      VkDeviceSize length;
+    };
+
+    std::vector<FreeSlice> m_freeList;
+
+  };
+
+
+  /**
+   * \brief TLSF allocator wrapper
+   */
+  class TlsfAllocator {
+
+  public:
+
+    TlsfAllocator(VkDeviceSize size)
+    : m_allocator(size) { }
+
+    DxvkSubAllocation alloc(VkDeviceSize size, VkDeviceSize alignment) {
+      return m_allocator.alloc(size, alignment);
+    }
+
+    void free(const DxvkSubAllocation& allocation) {
+      m_allocator.free(allocation.block);
+    }
+
+    VkDeviceSize freeSize() const {
+      return m_allocator.freeSize();
+    }
+
+    VkDeviceSize largestFreeBlock() const {
+      return m_allocator.largestFreeBlock();
+    }
+
+  private:
+
+    DxvkTlsfAllocator m_allocator;
+
+  };
+
+
+  std::vector<Request> generateRequests() {
+    std::mt19937 rng(0x5eed);
+
+    // Mostly small allocations with the occasional large
+    // one, and alignments ranging from 16 bytes to 64 kiB.
+    std::uniform_int_distribution<uint32_t> sizeLog2(8, 24);
+    std::uniform_int_distribution<uint32_t> alignLog2(4, 16);
+    std::uniform_int_distribution<uint32_t> action(0, 99);
+
+    std::vector<Request> requests;
+    requests.reserve(OperationCount);
+
+    // Keep the amount of live memory around a fixed fraction
+    // of the chunk size to simulate a steady state workload
+    std::vector<VkDeviceSize> liveSizes;
+    VkDeviceSize liveSize = 0;
+
+    for (uint32_t i = 0; i < OperationCount; i++) {
+      Request request = { };
+      request.isAlloc = liveSizes.empty() || (liveSize < LiveSize && action(rng) < 60);
+
+      if (request.isAlloc) {
+        uint32_t log2 = sizeLog2(rng);
+        log2 = std::min(log2, std::min(sizeLog2(rng), sizeLog2(rng)));
+
+        request.size  = (VkDeviceSize(1) << log2) + (rng() & ((1u << log2) - 1));
+        request.align = VkDeviceSize(1) << alignLog2(rng);
+
+        liveSizes.push_back(request.size);
+        liveSize += request.size;
+      } else {
+        request.freeIndex = rng() % liveSizes.size();
+
+        liveSize -= liveSizes[request.freeIndex];
+        liveSizes[request.freeIndex] = liveSizes.back();
+        liveSizes.pop_back();
+      }
+
+      requests.push_back(request);
+    }
+
+    return requests;
+  }
+
+
+  template<typename Allocator>
+  BenchResult runBenchmark(const std::vector<Request>& requests) {
+    Allocator allocator(ChunkSize);
+
+    std::vector<DxvkSubAllocation> live;
+    live.reserve(requests.size());
+
+    BenchResult result;
+
+    auto t0 = high_resolution_clock::now();
+
+    for (const auto& request : requests) {
+      if (request.isAlloc) {
+        DxvkSubAllocation allocation = allocator.alloc(request.size, request.align);
+
+        // Keep the live list consistent with the generated
+        // requests even if the chunk is out of memory
+        if (!allocation.length)
+          result.failedAllocs += 1;
+
+        live.push_back(allocation);
+      } else {
+        DxvkSubAllocation allocation = live[request.freeIndex];
+        live[request.freeIndex] = live.back();
+        live.pop_back();
+
+        if (allocation.length)
+          allocator.free(allocation);
+      }
+    }
+
+    auto t1 = high_resolution_clock::now();
+
+    result.nsPerOp      = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(requests.size());
+    result.freeSize     = allocator.freeSize();
+    result.largestBlock = allocator.largestFreeBlock();
+    return result;
+  }
+
+
+  void printResult(const char* name, const BenchResult& result) {
+    double fragmentation = result.freeSize
+      ? 100.0 * double(result.freeSize - result.largestBlock) / double(result.freeSize)
+      : 0.0;
+
+    std::cout << std::left << std::setw(12) << name << std::right
+      << std::fixed << std::setprecision(1)
+      << std::setw(12) << result.nsPerOp
+      << std::setw(12) << result.failedAllocs
+      << std::setw(12) << (result.freeSize >> 20)
+      << std::setw(14) << (result.largestBlock >> 20)
+      << std::setw(12) << fragmentation << std::endl;
+  }
+
+}
+
+
+int main() {
+  std::vector<Request> requests = generateRequests();
+
+  std::cout << "Allocator          ns/op      Failed  Free (MiB) Largest (MiB)    Frag (%)" << std::endl;
+
+  printResult("Free list", runBenchmark<FreeListAllocator>(requests));
+  printResult("TLSF",      runBenchmark<TlsfAllocator>(requests));
+  return 0;
+}
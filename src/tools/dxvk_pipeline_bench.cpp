@@ -0,0 +1,124 @@
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../dxvk/dxvk_graphics.h"
+
+#include "../util/util_time.h"
+
+using namespace dxvk;
+
+/**
+ * \brief Pipeline instance lookup benchmark
+ *
+ * Measures the cost of looking up graphics pipeline instances
+ * by their state vector as the number of instances per pipeline
+ * grows, comparing a linear search over the instance list with
+ * the hashed instance table. No Vulkan device is required.
+ */
+namespace {
+
+  constexpr uint32_t LookupCount = 1u << 20;
+
+  struct BenchResult {
+    double  linearNs = 0.0;
+    double  hashedNs = 0.0;
+  };
+
+
+  DxvkGraphicsPipelineStateInfo makeState(uint32_t index) {
+    // Vary spec constants so that states only differ in a few
+    // words, like permutations of one shader commonly do
+    DxvkGraphicsPipelineStateInfo state;
+    state.sc.specConstants[0] = index & 0xff;
+    state.sc.specConstants[1] = index >> 8;
+    return state;
+  }
+
+
+  DxvkGraphicsPipelineInstance* findLinear(
+    const sync::List<DxvkGraphicsPipelineInstance>& list,
+    const DxvkGraphicsPipelineStateInfo& state) {
+    for (auto& instance : list) {
+      if (instance.state == state)
+        return &instance;
+    }
+
+    return nullptr;
+  }
+
+
+  double toNsPerLookup(high_resolution_clock::duration duration) {
+    return std::chrono::duration<double, std::nano>(duration).count() / double(LookupCount);
+  }
+
+
+  BenchResult runBenchmark(uint32_t instanceCount) {
+    sync::List<DxvkGraphicsPipelineInstance> list;
+    DxvkGraphicsPipelineInstanceTable table;
+
+    std::vector<DxvkGraphicsPipelineStateInfo> states;
+    states.reserve(instanceCount);
+
+    for (uint32_t i = 0; i < instanceCount; i++) {
+      auto& state = states.emplace_back(makeState(i));
+
+      auto instance = &(*list.emplace(state, state.hash(), VK_NULL_HANDLE, VK_NULL_HANDLE));
+      table.insert(instance);
+    }
+
+    // Use the same random access pattern for both methods
+    std::mt19937 rng(instanceCount);
+    std::vector<uint32_t> queries(LookupCount);
+
+    for (auto& q : queries)
+      q = rng() % instanceCount;
+
+    uintptr_t sink = 0;
+
+    auto t0 = high_resolution_clock::now();
+
+    for (uint32_t q : queries)
+      sink ^= uintptr_t(findLinear(list, states[q]));
+
+    auto t1 = high_resolution_clock::now();
+
+    for (uint32_t q : queries) {
+      const auto& state = states[q];
+      sink ^= uintptr_t(table.find(state, state.hash()));
+    }
+
+    auto t2 = high_resolution_clock::now();
+
+    // Prevent the compiler from discarding the lookups
+    if (sink == uintptr_t(1))
+      std::cout << std::endl;
+
+    BenchResult result;
+    result.linearNs = toNsPerLookup(t1 - t0);
+    result.hashedNs = toNsPerLookup(t2 - t1);
+    return result;
+  }
+
+}
+
+
+int main() {
+  static const std::array<uint32_t, 8> instanceCounts = {
+    1, 2, 4, 8, 16, 64, 256, 1024 };
+
+  std::cout << "Instances    Linear (ns)    Hashed (ns)" << std::endl;
+
+  for (uint32_t count : instanceCounts) {
+    BenchResult result = runBenchmark(count);
+
+    std::cout << std::fixed << std::setprecision(1)
+      << std::setw(9) << count
+      << std::setw(15) << result.linearNs
+      << std::setw(15) << result.hashedNs << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../dxbc/dxbc_module.h"
+#include "../dxbc/dxbc_reader.h"
+
+#include "../dxso/dxso_module.h"
+#include "../dxso/dxso_reader.h"
+
+#include "../d3d9/d3d9_caps.h"
+#include "../d3d9/d3d9_constant_layout.h"
+
+#include "../util/thread.h"
+#include "../util/util_math.h"
+#include "../util/util_time.h"
+
+using namespace dxvk;
+
+/**
+ * \brief Offline shader translation benchmark
+ *
+ * Loads all \c .dxbc and \c .dxso files from a directory, e.g.
+ * one populated via \c DXVK_SHADER_DUMP_PATH, and translates
+ * them to SPIR-V without creating a Vulkan device. This allows
+ * measuring compiler performance in isolation.
+ *
+ * With \c -V, every shader is instead compiled with and without
+ * the SPIR-V optimizer, and both modules are checked with
+ * \c spirv-val, which must be in \c PATH. Shaders that are
+ * only invalid after optimization are reported as optimizer
+ * bugs.
+ */
+namespace {
+
+  enum class ShaderType : uint32_t {
+    Dxbc,
+    Dxso,
+  };
+
+  struct ShaderFile {
+    ShaderType        type;
+    std::string       name;
+    std::vector<char> data;
+  };
+
+  struct BenchStats {
+    uint64_t                  shaderCount = 0;
+    uint64_t                  failCount   = 0;
+    uint64_t                  spirvSize   = 0;
+    high_resolution_clock::duration parse = { };
+    DxvkShaderCompileTimings  timings;
+
+    void merge(const BenchStats& other) {
+      shaderCount       += other.shaderCount;
+      failCount         += other.failCount;
+      spirvSize         += other.spirvSize;
+      parse             += other.parse;
+      timings.analyze   += other.timings.analyze;
+      timings.compile   += other.timings.compile;
+      timings.finalize  += other.timings.finalize;
+    }
+  };
+
+  struct BenchArgs {
+    uint32_t    threadCount = 0;
+    uint32_t    iterations  = 1;
+    bool        validate    = false;
+    std::string directory;
+  };
+
+
+  DxbcModuleInfo getDxbcModuleInfo(bool optimize) {
+    DxbcModuleInfo moduleInfo = { };
+    moduleInfo.options  = DxbcOptions();
+    moduleInfo.options.optimizeSpirv = optimize;
+    moduleInfo.tess     = nullptr;
+    moduleInfo.xfb      = nullptr;
+    return moduleInfo;
+  }
+
+
+  DxsoModuleInfo getDxsoModuleInfo(bool optimize) {
+    // The default constructor leaves all members
+    // uninitialized, so set everything explicitly.
+    DxsoModuleInfo moduleInfo;
+    moduleInfo.options.strictConstantCopies             = false;
+    moduleInfo.options.d3d9FloatEmulation               = D3D9FloatEmulation::Enabled;
+    moduleInfo.options.strictPow                        = true;
+    moduleInfo.options.shaderModel                      = 3;
+    moduleInfo.options.invariantPosition                = true;
+    moduleInfo.options.forceSamplerTypeSpecConstants    = false;
+    moduleInfo.options.forceSampleRateShading           = false;
+    moduleInfo.options.vertexFloatConstantBufferAsSSBO  = false;
+    moduleInfo.options.longMad                          = false;
+    moduleInfo.options.robustness2Supported             = true;
+    moduleInfo.options.optimizeSpirv                    = optimize;
+    moduleInfo.options.vertexPulling                    = false;
+    return moduleInfo;
+  }
+
+
+  D3D9ConstantLayout getDxsoConstantLayout(DxsoProgramType type) {
+    D3D9ConstantLayout layout;
+    layout.floatCount   = type == DxsoProgramTypes::VertexShader
+      ? caps::MaxFloatConstantsVS
+      : caps::MaxFloatConstantsPS;
+    layout.intCount     = caps::MaxOtherConstants;
+    layout.boolCount    = caps::MaxOtherConstants;
+    layout.bitmaskCount = align(layout.boolCount, 32) / 32;
+    return layout;
+  }
+
+
+  Rc<DxvkShader> compileDxbc(
+    const ShaderFile&           file,
+          BenchStats&           stats,
+          bool                  optimize) {
+    auto t0 = high_resolution_clock::now();
+
+    DxbcReader reader(file.data.data(), file.data.size());
+    DxbcModule module(reader);
+
+    stats.parse += high_resolution_clock::now() - t0;
+
+    DxbcModuleInfo moduleInfo = getDxbcModuleInfo(optimize);
+    return module.compile(moduleInfo, file.name, &stats.timings);
+  }
+
+
+  Rc<DxvkShader> compileDxso(
+    const ShaderFile&           file,
+          BenchStats&           stats,
+          bool                  optimize) {
+    auto t0 = high_resolution_clock::now();
+
+    DxsoReader reader(file.data.data());
+    DxsoModule module(reader);
+
+    auto t1 = high_resolution_clock::now();
+
+    DxsoAnalysisInfo analysis = module.analyze();
+
+    auto t2 = high_resolution_clock::now();
+
+    stats.parse           += t1 - t0;
+    stats.timings.analyze += t2 - t1;
+
+    DxsoModuleInfo moduleInfo = getDxsoModuleInfo(optimize);
+    D3D9ConstantLayout layout = getDxsoConstantLayout(module.info().type());
+
+    return module.compile(moduleInfo, file.name,
+      analysis, layout, &stats.timings);
+  }
+
+
+  Rc<DxvkShader> tryCompileShader(
+    const ShaderFile&           file,
+          BenchStats&           stats,
+          bool                  optimize) {
+    try {
+      return file.type == ShaderType::Dxbc
+        ? compileDxbc(file, stats, optimize)
+        : compileDxso(file, stats, optimize);
+    } catch (const DxvkError& e) {
+      std::cerr << file.name << ": " << e.message() << std::endl;
+      return nullptr;
+    }
+  }
+
+
+  void compileShader(
+    const ShaderFile&           file,
+          BenchStats&           stats) {
+    Rc<DxvkShader> shader = tryCompileShader(file, stats, true);
+
+    if (shader != nullptr) {
+      stats.shaderCount += 1;
+      stats.spirvSize   += shader->getRawCode().size();
+    } else {
+      stats.failCount += 1;
+    }
+  }
+
+
+  std::vector<ShaderFile> loadShaders(
+    const std::string&          directory,
+          ShaderType            type) {
+    std::vector<ShaderFile> result;
+
+    const char* extension = type == ShaderType::Dxbc ? ".dxbc" : ".dxso";
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+      if (!entry.is_regular_file() || entry.path().extension() != extension)
+        continue;
+
+      std::ifstream stream(entry.path(), std::ios_base::binary);
+
+      ShaderFile file;
+      file.type = type;
+      file.name = entry.path().stem().string();
+      file.data.assign(
+        std::istreambuf_iterator<char>(stream),
+        std::istreambuf_iterator<char>());
+
+      if (!file.data.empty())
+        result.push_back(std::move(file));
+    }
+
+    // Process shaders in a deterministic order
+    std::sort(result.begin(), result.end(), [] (const ShaderFile& a, const ShaderFile& b) {
+      return a.name < b.name;
+    });
+
+    return result;
+  }
+
+
+  BenchStats runBenchmark(
+    const std::vector<ShaderFile>& shaders,
+          uint32_t              iterations,
+          uint32_t              threadCount) {
+    std::atomic<size_t> nextIndex = { 0u };
+    size_t totalCount = shaders.size() * iterations;
+
+    std::vector<BenchStats> threadStats(threadCount);
+    std::vector<dxvk::thread> threads;
+
+    auto runThread = [&] (uint32_t threadId) {
+      size_t index;
+
+      while ((index = nextIndex++) < totalCount)
+        compileShader(shaders[index % shaders.size()], threadStats[threadId]);
+    };
+
+    for (uint32_t i = 1; i < threadCount; i++)
+      threads.emplace_back([runThread, i] { runThread(i); });
+
+    runThread(0);
+
+    for (auto& thread : threads)
+      thread.join();
+
+    BenchStats result;
+
+    for (const auto& stats : threadStats)
+      result.merge(stats);
+
+    return result;
+  }
+
+
+  double toMs(high_resolution_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+
+  void printStats(
+    const char*                 label,
+    const BenchStats&           stats,
+          high_resolution_clock::duration elapsed,
+          uint32_t              threadCount) {
+    double elapsedMs = toMs(elapsed);
+    double count = double(std::max<uint64_t>(stats.shaderCount + stats.failCount, 1));
+
+    std::cout << std::fixed << std::setprecision(3)
+      << label << " (" << threadCount << (threadCount == 1 ? " thread" : " threads") << "):" << std::endl
+      << "  Shaders:      " << stats.shaderCount << " compiled, " << stats.failCount << " failed" << std::endl
+      << "  Wall time:    " << elapsedMs << " ms" << std::endl
+      << "  Throughput:   " << (elapsedMs > 0.0 ? 1000.0 * count / elapsedMs : 0.0) << " shaders/s" << std::endl
+      << "  Parse:        " << toMs(stats.parse) / count << " ms/shader" << std::endl
+      << "  Analyze:      " << toMs(stats.timings.analyze) / count << " ms/shader" << std::endl
+      << "  Compile:      " << toMs(stats.timings.compile) / count << " ms/shader" << std::endl
+      << "  Finalize:     " << toMs(stats.timings.finalize) / count << " ms/shader" << std::endl
+      << "  SPIR-V size:  " << stats.spirvSize << " bytes total, "
+        << (stats.spirvSize / std::max<uint64_t>(stats.shaderCount, 1)) << " bytes/shader" << std::endl;
+  }
+
+
+  void runSuite(
+    const char*                 label,
+    const std::vector<ShaderFile>& shaders,
+    const BenchArgs&            args) {
+    if (shaders.empty())
+      return;
+
+    std::cout << label << ": " << shaders.size() << " shaders, "
+      << args.iterations << " iteration(s)" << std::endl;
+
+    // Single-threaded run to measure raw compiler performance
+    auto t0 = high_resolution_clock::now();
+    BenchStats st = runBenchmark(shaders, args.iterations, 1);
+    auto t1 = high_resolution_clock::now();
+
+    printStats(label, st, t1 - t0, 1);
+
+    if (args.threadCount > 1) {
+      auto t2 = high_resolution_clock::now();
+      BenchStats mt = runBenchmark(shaders, args.iterations, args.threadCount);
+      auto t3 = high_resolution_clock::now();
+
+      printStats(label, mt, t3 - t2, args.threadCount);
+
+      double st_ms = toMs(t1 - t0);
+      double mt_ms = toMs(t3 - t2);
+
+      if (mt_ms > 0.0)
+        std::cout << "  Scaling:      " << (st_ms / mt_ms) << "x" << std::endl;
+    }
+
+    std::cout << std::endl;
+  }
+
+
+  bool validateShader(
+    const std::filesystem::path& path,
+    const Rc<DxvkShader>&       shader) {
+    std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+    shader->getRawCode().store(stream);
+    stream.close();
+
+    if (!stream)
+      return false;
+
+    std::string command = "spirv-val --target-env vulkan1.3 \"" + path.string() + "\"";
+    return std::system(command.c_str()) == 0;
+  }
+
+
+  bool runValidation(
+    const char*                 label,
+    const std::vector<ShaderFile>& shaders) {
+    if (shaders.empty())
+      return true;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "dxvk-shader-bench";
+    std::filesystem::create_directories(directory);
+
+    uint32_t invalidCount = 0;
+    uint32_t optimizerCount = 0;
+
+    for (const auto& file : shaders) {
+      BenchStats stats;
+
+      // Validate the unoptimized module as well so that
+      // bugs in the optimizer can be told apart from bugs
+      // in the shader compiler itself.
+      Rc<DxvkShader> shader = tryCompileShader(file, stats, false);
+      Rc<DxvkShader> optimized = tryCompileShader(file, stats, true);
+
+      if (shader == nullptr || optimized == nullptr)
+        continue;
+
+      bool valid = validateShader(directory / (file.name + ".spv"), shader);
+      bool optimizedValid = validateShader(directory / (file.name + ".opt.spv"), optimized);
+
+      if (!valid)
+        invalidCount += 1;
+
+      if (valid && !optimizedValid) {
+        std::cerr << file.name << ": Optimized SPIR-V is invalid" << std::endl;
+        optimizerCount += 1;
+      }
+    }
+
+    std::cout << label << ": " << shaders.size() << " shaders, "
+      << invalidCount << " invalid, "
+      << optimizerCount << " broken by the optimizer" << std::endl;
+    return !optimizerCount;
+  }
+
+
+  bool parseArgs(int argc, char** argv, BenchArgs& args) {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+
+      if ((arg == "-j" || arg == "-n") && i + 1 < argc) {
+        int value = std::atoi(argv[++i]);
+
+        if (value < 1)
+          return false;
+
+        if (arg == "-j")
+          args.threadCount = uint32_t(value);
+        else
+          args.iterations = uint32_t(value);
+      } else if (arg == "-V") {
+        args.validate = true;
+      } else if (arg[0] != '-' && args.directory.empty()) {
+        args.directory = arg;
+      } else {
+        return false;
+      }
+    }
+
+    if (!args.threadCount)
+      args.threadCount = std::max(1u, dxvk::thread::hardware_concurrency());
+
+    return !args.directory.empty();
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchArgs args;
+
+  if (!parseArgs(argc, argv, args)) {
+    std::cerr << "Usage: " << argv[0] << " [-j threads] [-n iterations] [-V] <directory>" << std::endl;
+    return 1;
+  }
+
+  try {
+    if (args.validate) {
+      bool dxbcValid = runValidation("DXBC", loadShaders(args.directory, ShaderType::Dxbc));
+      bool dxsoValid = runValidation("DXSO", loadShaders(args.directory, ShaderType::Dxso));
+      return dxbcValid && dxsoValid ? 0 : 1;
+    }
+
+    runSuite("DXBC", loadShaders(args.directory, ShaderType::Dxbc), args);
+    runSuite("DXSO", loadShaders(args.directory, ShaderType::Dxso), args);
+  } catch (const std::filesystem::filesystem_error& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
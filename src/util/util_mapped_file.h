@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+
+#include "util_string.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Read-only file mapping
+   *
+   * Maps the entire contents of a file into the address
+   * space of the process. The mapped size is determined
+   * when the file is opened, so data that gets appended
+   * to the file afterwards will not be visible.
+   */
+  class MappedFile {
+
+  public:
+
+    MappedFile();
+
+    /**
+     * \brief Maps a file
+     *
+     * If the file does not exist, is empty, or cannot
+     * be mapped for any other reason, the resulting
+     * object will not hold a valid mapping.
+     * \param [in] path File path
+     */
+    explicit MappedFile(
+      const str::path_string&     path);
+
+    MappedFile(MappedFile&& other);
+
+    MappedFile& operator = (MappedFile&& other);
+
+    ~MappedFile();
+
+    /**
+     * \brief Pointer to mapped file data
+     * \returns Pointer to mapped data
+     */
+    const char* data() const {
+      return reinterpret_cast<const char*>(m_data);
+    }
+
+    /**
+     * \brief Size of the mapping, in bytes
+     * \returns Mapped size
+     */
+    size_t size() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Checks whether the mapping is valid
+     * \returns \c true if the file is mapped
+     */
+    explicit operator bool () const {
+      return m_data != nullptr;
+    }
+
+  private:
+
+    void*  m_data = nullptr;
+    size_t m_size = 0;
+
+    void unmap();
+
+  };
+
+}
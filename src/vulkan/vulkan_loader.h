@@ -404,6 +404,10 @@ namespace dxvk::vk
     VULKAN_FN(vkSetHdrMetadataEXT);
 #endif
 
+#ifdef VK_EXT_pageable_device_local_memory
+    VULKAN_FN(vkSetDeviceMemoryPriorityEXT);
+#endif
+
 #ifdef VK_EXT_shader_module_identifier
     VULKAN_FN(vkGetShaderModuleCreateInfoIdentifierEXT);
     VULKAN_FN(vkGetShaderModuleIdentifierEXT);